@@ -269,6 +269,8 @@ DBusClient::initLibrary(int flags)
             bind(&DBusConfigurationManager::hardwareEncodingChanged, confM, _1)),
         exportable_callback<ConfigurationSignal::MessageSend>(
             bind(&DBusConfigurationManager::messageSend, confM, _1)),
+        exportable_callback<ConfigurationSignal::MetricsReport>(
+            bind(&DBusConfigurationManager::metricsReport, confM, _1)),
     };
 
     // Presence event handlers
@@ -991,4 +991,16 @@ bool
 DBusConfigurationManager::isAllModerators(const std::string& accountID)
 {
     return libjami::isAllModerators(accountID);
-}
\ No newline at end of file
+}
+
+std::map<std::string, std::string>
+DBusConfigurationManager::getMetrics()
+{
+    return libjami::getMetrics();
+}
+
+void
+DBusConfigurationManager::setMetricsReportInterval(const uint32_t& intervalMs)
+{
+    libjami::setMetricsReportInterval(intervalMs);
+}
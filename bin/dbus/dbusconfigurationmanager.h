@@ -244,6 +244,8 @@ public:
     bool isLocalModeratorsEnabled(const std::string& accountID);
     void setAllModerators(const std::string& accountID, const bool& allModerators);
     bool isAllModerators(const std::string& accountID);
+    std::map<std::string, std::string> getMetrics();
+    void setMetricsReportInterval(const uint32_t& intervalMs);
     std::string startConversation(const std::string& accountId);
     void acceptConversationRequest(const std::string& accountId, const std::string& conversationId);
     void declineConversationRequest(const std::string& accountId, const std::string& conversationId);
@@ -137,6 +137,12 @@ DBusPluginManagerInterface::getCallMediaHandlerStatus(const std::string& callId)
     return libjami::getCallMediaHandlerStatus(callId);
 }
 
+std::map<std::string, std::string>
+DBusPluginManagerInterface::getCallMediaHandlerStats(const std::string& callId)
+{
+    return libjami::getCallMediaHandlerStats(callId);
+}
+
 std::map<std::string, std::string>
 DBusPluginManagerInterface::getChatHandlerDetails(const std::string& chatHanlderId)
 {
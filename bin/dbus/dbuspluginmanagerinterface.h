@@ -79,6 +79,7 @@ public:
                            const bool& toggle);
     std::map<std::string, std::string> getCallMediaHandlerDetails(const std::string& mediaHandlerId);
     std::vector<std::string> getCallMediaHandlerStatus(const std::string& callId);
+    std::map<std::string, std::string> getCallMediaHandlerStats(const std::string& callId);
     std::map<std::string, std::string> getChatHandlerDetails(const std::string& chatHandlerId);
     std::vector<std::string> getChatHandlerStatus(const std::string& accontId,
                                                   const std::string& peerId);
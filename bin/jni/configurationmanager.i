@@ -69,6 +69,7 @@ public:
 
     virtual void audioMeter(const std::string& /*id*/, float /*level*/){}
     virtual void messageSend(const std::string& /*message*/){}
+    virtual void metricsReport(const std::map<std::string, std::string>& /*metrics*/){}
 };
 %}
 
@@ -231,6 +232,9 @@ void pushNotificationReceived(const std::string& from, const std::map<std::strin
 bool isAudioMeterActive(const std::string& id);
 void setAudioMeterState(const std::string& id, bool state);
 
+std::map<std::string, std::string> getMetrics();
+void setMetricsReportInterval(uint32_t intervalMs);
+
 void setDefaultModerator(const std::string& accountID, const std::string& peerURI, bool state);
 std::vector<std::string> getDefaultModerators(const std::string& accountID);
 void enableLocalModerators(const std::string& accountID, bool isModEnabled);
@@ -286,4 +290,5 @@ public:
 
     virtual void audioMeter(const std::string& /*id*/, float /*level*/){}
     virtual void messageSend(const std::string& /*message*/){}
+    virtual void metricsReport(const std::map<std::string, std::string>& /*metrics*/){}
 };
@@ -41,6 +41,7 @@ void toggleCallMediaHandler(const std::string& mediaHandlerId, const std::string
 void toggleChatHandler(const std::string& chatHandlerId, const std::string& accountId, const std::string& peerId, bool toggle);
 std::map<std::string,std::string> getCallMediaHandlerDetails(const std::string& mediaHandlerId);
 std::vector<std::string> getCallMediaHandlerStatus(const std::string& callId);
+std::map<std::string,std::string> getCallMediaHandlerStats(const std::string& callId);
 std::map<std::string,std::string> getChatHandlerDetails(const std::string& chatHandlerId);
 std::vector<std::string> getChatHandlerStatus(const std::string& accountId, const std::string& peerId);
 bool getPluginsEnabled();
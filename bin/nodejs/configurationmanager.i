@@ -65,6 +65,7 @@ public:
 
     virtual void audioMeter(const std::string& /*id*/, float /*level*/){}
     virtual void messageSend(const std::string& /*message*/){}
+    virtual void metricsReport(const std::map<std::string, std::string>& /*metrics*/){}
 };
 %}
 
@@ -219,6 +220,9 @@ void connectivityChanged();
 bool isAudioMeterActive(const std::string& id);
 void setAudioMeterState(const std::string& id, bool state);
 
+std::map<std::string, std::string> getMetrics();
+void setMetricsReportInterval(uint32_t intervalMs);
+
 void setDefaultModerator(const std::string& accountID, const std::string& peerURI, bool state);
 std::vector<std::string> getDefaultModerators(const std::string& accountID);
 void enableLocalModerators(const std::string& accountID, bool isModEnabled);
@@ -267,4 +271,5 @@ public:
 
     virtual void audioMeter(const std::string& /*id*/, float /*level*/){}
     virtual void messageSend(const std::string& /*message*/){}
+    virtual void metricsReport(const std::map<std::string, std::string>& /*metrics*/){}
 };
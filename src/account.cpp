@@ -83,8 +83,8 @@ Account::~Account() {}
 void
 Account::hangupCalls()
 {
-    for (const auto& callId : callSet_.getCallIds())
-        Manager::instance().hangupCall(getAccountID(), callId);
+    callSet_.forEachCall(
+        [&](const auto& call) { Manager::instance().hangupCall(getAccountID(), call->getCallId()); });
 }
 
 void
@@ -392,6 +392,16 @@ public:
         return callSet_.getCall(callId);
     }
     std::vector<std::string> getCallList() const { return callSet_.getCallIds(); }
+    template<typename Callback>
+    void forEachCall(Callback&& cb) const
+    {
+        callSet_.forEachCall(std::forward<Callback>(cb));
+    }
+    template<typename Predicate>
+    std::shared_ptr<Call> findCall(Predicate&& pred) const
+    {
+        return callSet_.findCall(std::forward<Predicate>(pred));
+    }
     std::shared_ptr<Conference> getConference(const std::string& confId) const
     {
         return callSet_.getConference(confId);
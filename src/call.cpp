@@ -640,8 +640,22 @@ Call::setConferenceInfo(const std::string& msg)
     std::string err;
     Json::CharReaderBuilder rbuilder;
     auto reader = std::unique_ptr<Json::CharReader>(rbuilder.newCharReader());
+    uint64_t ack = 0;
     if (reader->parse(msg.data(), msg.data() + msg.size(), &json, &err)) {
-        if (json.isObject()) {
+        if (json.isObject() and json.isMember(ConfInfo::BASE)) {
+            // changes since the previous confInfo
+            std::unique_lock<std::mutex> lk(confInfoMutex_);
+            if (json[ConfInfo::BASE].asUInt64() != receivedConfInfoSeq_
+                or not receivedConfInfo_.applyDelta(json)) {
+                lk.unlock();
+                JAMI_WARNING("[call:{}] Conference infos out of sync, request a snapshot", id_);
+                sendConfInfoAck(0);
+                return;
+            }
+            receivedConfInfoSeq_ = json[ConfInfo::SEQ].asUInt64();
+            newInfo = receivedConfInfo_;
+            peerConfProtocol_ = newInfo.v;
+        } else if (json.isObject()) {
             // new confInfo
             if (json.isMember("p")) {
                 for (const auto& participantInfo : json["p"]) {
@@ -660,6 +674,13 @@ Call::setConferenceInfo(const std::string& msg)
                 newInfo.w = json["w"].asInt();
             if (json.isMember("h"))
                 newInfo.h = json["h"].asInt();
+            if (json.isMember("layout"))
+                newInfo.layout = json["layout"].asInt();
+            // Only hosts supporting deltas number their confInfo
+            ack = json[ConfInfo::SEQ].asUInt64();
+            std::lock_guard<std::mutex> lk(confInfoMutex_);
+            receivedConfInfo_ = newInfo;
+            receivedConfInfoSeq_ = ack;
         } else {
             // old confInfo
             for (const auto& participantInfo : json) {
@@ -689,6 +710,8 @@ Call::setConferenceInfo(const std::string& msg)
             conf->mergeConfInfo(newInfo, getPeerNumber());
         }
     }
+    if (ack != 0)
+        sendConfInfoAck(ack);
 }
 
 void
@@ -721,6 +744,15 @@ Call::sendConfInfo(const std::string& json)
         sendTextMessage(messages, account->getFromUri());
 }
 
+void
+Call::sendConfInfoAck(uint64_t seq)
+{
+    Json::Value root;
+    root["version"] = 1;
+    root[ConfInfo::ACK] = Json::UInt64(seq);
+    sendConfOrder(root);
+}
+
 void
 Call::resetConfInfo()
 {
@@ -541,6 +541,11 @@ protected:
     /// Supported conference protocol version
     int peerConfProtocol_ {0};
     std::string toUsername_ {};
+
+    /// Conference infos received from the peer, deltas are applied on it. Protected by confInfoMutex_
+    ConfInfo receivedConfInfo_ {};
+    uint64_t receivedConfInfoSeq_ {0};
+    void sendConfInfoAck(uint64_t seq);
 };
 
 // Helpers
@@ -18,6 +18,7 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
  */
 
+#include <algorithm>
 #include <stdexcept>
 
 #include "call_factory.h"
@@ -49,10 +50,13 @@ CallFactory::newSipCall(const std::shared_ptr<SIPAccountBase>& account,
         return {};
     }
 
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
+    std::lock_guard<std::mutex> lk(callIndexMutex_);
     auto id = getNewCallID();
     auto call = std::make_shared<SIPCall>(account, id, type, mediaList);
-    callMaps_[call->getLinkType()].emplace(id, call);
+    update([&](CallIndex& index) {
+        index.calls.emplace(id, call);
+        index.counts[static_cast<std::size_t>(call->getLinkType())]++;
+    });
     account->attach(call);
     return call;
 }
@@ -66,20 +70,21 @@ CallFactory::forbid()
 void
 CallFactory::removeCall(Call& call)
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
+    std::lock_guard<std::mutex> lk(callIndexMutex_);
 
     const auto& id = call.getCallId();
     JAMI_DBG("Removing call %s", id.c_str());
-    auto& map = callMaps_.at(call.getLinkType());
-    map.erase(id);
-    JAMI_DBG("Remaining %zu call", map.size());
+    auto link = static_cast<std::size_t>(call.getLinkType());
+    update([&](CallIndex& index) {
+        if (index.calls.erase(id))
+            index.counts[link]--;
+    });
+    JAMI_DBG("Remaining %zu call", snapshot()->counts[link]);
 }
 
 void
 CallFactory::removeCall(const std::string& id)
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
-
     if (auto call = getCall(id)) {
         removeCall(*call);
     } else
@@ -89,171 +94,111 @@ CallFactory::removeCall(const std::string& id)
 bool
 CallFactory::hasCall(const std::string& id) const
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
-
-    for (const auto& item : callMaps_) {
-        const auto& map = item.second;
-        if (map.find(id) != map.cend())
-            return true;
-    }
-
-    return false;
+    auto index = snapshot();
+    return index->calls.find(id) != index->calls.end();
 }
 
 bool
 CallFactory::empty() const
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
-
-    for (const auto& item : callMaps_) {
-        if (not item.second.empty())
-            return false;
-    }
-
-    return true;
+    return snapshot()->calls.empty();
 }
 
 void
 CallFactory::clear()
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
-    callMaps_.clear();
+    std::lock_guard<std::mutex> lk(callIndexMutex_);
+    std::atomic_store(&index_, std::shared_ptr<const CallIndex>(std::make_shared<CallIndex>()));
 }
 
 std::shared_ptr<Call>
 CallFactory::getCall(const std::string& id) const
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
-
-    for (const auto& item : callMaps_) {
-        const auto& map = item.second;
-        const auto& iter = map.find(id);
-        if (iter != map.cend())
-            return iter->second;
-    }
-
-    return nullptr;
+    auto index = snapshot();
+    auto it = index->calls.find(id);
+    return it != index->calls.end() ? it->second : nullptr;
 }
 
 std::vector<std::shared_ptr<Call>>
 CallFactory::getAllCalls() const
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
+    auto index = snapshot();
     std::vector<std::shared_ptr<Call>> v;
-
-    for (const auto& itemmap : callMaps_) {
-        const auto& map = itemmap.second;
-        v.reserve(v.size() + map.size());
-        for (const auto& item : map)
-            v.push_back(item.second);
-    }
-
+    v.reserve(index->calls.size());
+    for (const auto& item : index->calls)
+        v.push_back(item.second);
     return v;
 }
 
 std::vector<std::string>
 CallFactory::getCallIDs() const
 {
+    auto index = snapshot();
     std::vector<std::string> v;
-
-    for (const auto& item : callMaps_) {
-        const auto& map = item.second;
-        for (const auto& it : map)
-            v.push_back(it.first);
-    }
-
-    v.shrink_to_fit();
+    v.reserve(index->calls.size());
+    for (const auto& item : index->calls)
+        v.push_back(item.first);
+    // The index is unordered, keep ids stable for clients
+    std::sort(v.begin(), v.end());
     return v;
 }
 
 std::size_t
 CallFactory::callCount() const
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
-    std::size_t count = 0;
-
-    for (const auto& itemmap : callMaps_)
-        count += itemmap.second.size();
-
-    return count;
+    return snapshot()->calls.size();
 }
 
 bool
 CallFactory::hasCall(const std::string& id, Call::LinkType link) const
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
-
-    auto const map = getMap_(link);
-    return map and map->find(id) != map->cend();
+    return getCall(id, link) != nullptr;
 }
 
 bool
 CallFactory::empty(Call::LinkType link) const
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
-
-    const auto map = getMap_(link);
-    return !map or map->empty();
+    return callCount(link) == 0;
 }
 
 std::shared_ptr<Call>
 CallFactory::getCall(const std::string& id, Call::LinkType link) const
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
-
-    const auto map = getMap_(link);
-    if (!map)
+    auto call = getCall(id);
+    if (call and call->getLinkType() != link)
         return nullptr;
-
-    const auto& it = map->find(id);
-    if (it == map->cend())
-        return nullptr;
-
-    return it->second;
+    return call;
 }
 
 std::vector<std::shared_ptr<Call>>
 CallFactory::getAllCalls(Call::LinkType link) const
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
+    auto index = snapshot();
     std::vector<std::shared_ptr<Call>> v;
-
-    const auto map = getMap_(link);
-    if (map) {
-        for (const auto& it : *map)
-            v.push_back(it.second);
-    }
-
-    v.shrink_to_fit();
+    v.reserve(index->counts[static_cast<std::size_t>(link)]);
+    for (const auto& item : index->calls)
+        if (item.second->getLinkType() == link)
+            v.push_back(item.second);
     return v;
 }
 
 std::vector<std::string>
 CallFactory::getCallIDs(Call::LinkType link) const
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
+    auto index = snapshot();
     std::vector<std::string> v;
-
-    const auto map = getMap_(link);
-    if (map) {
-        for (const auto& it : *map)
-            v.push_back(it.first);
-    }
-
-    v.shrink_to_fit();
+    v.reserve(index->counts[static_cast<std::size_t>(link)]);
+    for (const auto& item : index->calls)
+        if (item.second->getLinkType() == link)
+            v.push_back(item.first);
+    std::sort(v.begin(), v.end());
     return v;
 }
 
 std::size_t
 CallFactory::callCount(Call::LinkType link) const
 {
-    std::lock_guard<std::recursive_mutex> lk(callMapsMutex_);
-
-    const auto map = getMap_(link);
-    if (!map)
-        return 0;
-
-    return map->size();
+    return snapshot()->counts[static_cast<std::size_t>(link)];
 }
 
 } // namespace jami
@@ -20,11 +20,13 @@
 
 #pragma once
 
+#include <array>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include "call.h"
@@ -35,6 +37,12 @@ namespace jami {
 class SIPAccountBase;
 class SIPCall;
 
+/**
+ * Owns all calls.
+ *
+ * Calls are stored in an immutable index, replaced on each change (read-copy-update):
+ * readers never take a lock, only call creation and removal copy the index.
+ */
 class CallFactory
 {
 public:
@@ -99,6 +107,31 @@ public:
      */
     void clear();
 
+    /**
+     * Call cb for each call, without copying the call list.
+     * Calls created or removed by cb are not visited.
+     */
+    template<typename Callback>
+    void forEachCall(Callback&& cb) const
+    {
+        auto index = snapshot();
+        for (const auto& [id, call] : index->calls)
+            cb(call);
+    }
+
+    /**
+     * Return the first call for which pred returns true
+     */
+    template<typename Predicate>
+    std::shared_ptr<Call> findCall(Predicate&& pred) const
+    {
+        auto index = snapshot();
+        for (const auto& [id, call] : index->calls)
+            if (pred(call))
+                return call;
+        return {};
+    }
+
     /**
      * Return all calls. Type can optionally be specified.
      */
@@ -118,27 +151,35 @@ public:
     std::size_t callCount(Call::LinkType link) const;
 
 private:
+    struct CallIndex
+    {
+        std::unordered_map<std::string, std::shared_ptr<Call>> calls {};
+        // Number of calls by link type
+        std::array<std::size_t, 2> counts {};
+    };
+
+    std::shared_ptr<const CallIndex> snapshot() const { return std::atomic_load(&index_); }
+
     /**
-     * @brief Get the calls map
-     * @param link The call type
-     * @return A pointer to the calls map instance
-     * @warning Concurrency protection must done by the caller.
+     * Replace the index by a modified copy
+     * @warning callIndexMutex_ must be locked
      */
-    const CallMap* getMap_(Call::LinkType link) const
+    template<typename Update>
+    void update(Update&& upd)
     {
-        auto const& itermap = callMaps_.find(link);
-        if (itermap != callMaps_.cend())
-            return &itermap->second;
-        return nullptr;
+        auto index = std::make_shared<CallIndex>(*snapshot());
+        upd(*index);
+        std::atomic_store(&index_, std::shared_ptr<const CallIndex>(std::move(index)));
     }
 
     std::mt19937_64& rand_;
 
-    mutable std::recursive_mutex callMapsMutex_ {};
+    // Serialize writers
+    std::mutex callIndexMutex_ {};
 
     std::atomic_bool allowNewCall_ {true};
 
-    std::map<Call::LinkType, CallMap> callMaps_ {};
+    std::shared_ptr<const CallIndex> index_ {std::make_shared<CallIndex>()};
 };
 
 } // namespace jami
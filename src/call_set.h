@@ -22,94 +22,143 @@
 #include "call.h"
 #include "conference.h"
 
-#include <map>
+#include <algorithm>
 #include <memory>
-#include <string>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace jami {
 
+/**
+ * Calls and conferences of an account.
+ * Readers use an immutable snapshot and never take the lock (read-copy-update).
+ */
 class CallSet
 {
 public:
     std::shared_ptr<Call> getCall(const std::string& callId) const
     {
-        std::lock_guard<std::mutex> l(mutex_);
-        auto i = calls_.find(callId);
-        return i == calls_.end() ? std::shared_ptr<Call> {} : i->second.lock();
+        auto calls = std::atomic_load(&calls_);
+        auto i = calls->find(callId);
+        return i == calls->end() ? std::shared_ptr<Call> {} : i->second.lock();
     }
     std::shared_ptr<Conference> getConference(const std::string& conferenceId) const
     {
-        std::lock_guard<std::mutex> l(mutex_);
-        auto i = conferences_.find(conferenceId);
-        return i == conferences_.end() ? std::shared_ptr<Conference> {} : i->second;
+        auto conferences = std::atomic_load(&conferences_);
+        auto i = conferences->find(conferenceId);
+        return i == conferences->end() ? std::shared_ptr<Conference> {} : i->second;
     }
 
     void add(const std::shared_ptr<Call>& call)
     {
         std::lock_guard<std::mutex> l(mutex_);
-        calls_.emplace(call->getCallId(), call);
+        update(calls_, [&](auto& calls) { calls.emplace(call->getCallId(), call); });
     }
     void add(const std::shared_ptr<Conference>& conference)
     {
         std::lock_guard<std::mutex> l(mutex_);
-        conferences_.emplace(conference->getConfId(), conference);
+        update(conferences_, [&](auto& conferences) {
+            conferences.emplace(conference->getConfId(), conference);
+        });
     }
     bool remove(const std::shared_ptr<Call>& call)
     {
         std::lock_guard<std::mutex> l(mutex_);
-        return calls_.erase(call->getCallId()) > 0;
+        bool removed = false;
+        update(calls_, [&](auto& calls) { removed = calls.erase(call->getCallId()) > 0; });
+        return removed;
     }
     bool removeConference(const std::string& confId)
     {
         std::lock_guard<std::mutex> l(mutex_);
-        return conferences_.erase(confId) > 0;
+        bool removed = false;
+        update(conferences_, [&](auto& conferences) { removed = conferences.erase(confId) > 0; });
+        return removed;
+    }
+
+    /**
+     * Call cb for each live call, without copying the call list
+     */
+    template<typename Callback>
+    void forEachCall(Callback&& cb) const
+    {
+        auto calls = std::atomic_load(&calls_);
+        for (const auto& callIt : *calls)
+            if (auto call = callIt.second.lock())
+                cb(call);
+    }
+    template<typename Predicate>
+    std::shared_ptr<Call> findCall(Predicate&& pred) const
+    {
+        auto calls = std::atomic_load(&calls_);
+        for (const auto& callIt : *calls)
+            if (auto call = callIt.second.lock())
+                if (pred(call))
+                    return call;
+        return {};
+    }
+    template<typename Callback>
+    void forEachConference(Callback&& cb) const
+    {
+        auto conferences = std::atomic_load(&conferences_);
+        for (const auto& confIt : *conferences)
+            if (const auto& conf = confIt.second)
+                cb(conf);
     }
 
     std::vector<std::string> getCallIds() const
     {
-        std::lock_guard<std::mutex> l(mutex_);
+        auto calls = std::atomic_load(&calls_);
         std::vector<std::string> ids;
-        ids.reserve(calls_.size());
-        for (const auto& callIt : calls_)
+        ids.reserve(calls->size());
+        for (const auto& callIt : *calls)
             ids.emplace_back(callIt.first);
+        // Snapshots are unordered, keep ids stable for clients
+        std::sort(ids.begin(), ids.end());
         return ids;
     }
     std::vector<std::shared_ptr<Call>> getCalls() const
     {
-        std::lock_guard<std::mutex> l(mutex_);
         std::vector<std::shared_ptr<Call>> calls;
-        calls.reserve(calls_.size());
-        for (const auto& callIt : calls_)
-            if (auto call = callIt.second.lock())
-                calls.emplace_back(std::move(call));
+        forEachCall([&](const auto& call) { calls.emplace_back(call); });
         return calls;
     }
 
     std::vector<std::string> getConferenceIds() const
     {
-        std::lock_guard<std::mutex> l(mutex_);
+        auto conferences = std::atomic_load(&conferences_);
         std::vector<std::string> ids;
-        ids.reserve(conferences_.size());
-        for (const auto& confIt : conferences_)
+        ids.reserve(conferences->size());
+        for (const auto& confIt : *conferences)
             ids.emplace_back(confIt.first);
+        std::sort(ids.begin(), ids.end());
         return ids;
     }
     std::vector<std::shared_ptr<Conference>> getConferences() const
     {
-        std::lock_guard<std::mutex> l(mutex_);
         std::vector<std::shared_ptr<Conference>> confs;
-        confs.reserve(conferences_.size());
-        for (const auto& confIt : conferences_)
-            if (const auto& conf = confIt.second)
-                confs.emplace_back(conf);
+        forEachConference([&](const auto& conf) { confs.emplace_back(conf); });
         return confs;
     }
 
 private:
-    mutable std::mutex mutex_;
-    std::map<std::string, std::weak_ptr<Call>> calls_;
-    std::map<std::string, std::shared_ptr<Conference>> conferences_;
+    using WeakCallMap = std::unordered_map<std::string, std::weak_ptr<Call>>;
+    using ConferenceMap = std::unordered_map<std::string, std::shared_ptr<Conference>>;
+
+    // Replace the map by a modified copy, mutex_ must be locked
+    template<typename Map, typename Update>
+    static void update(std::shared_ptr<const Map>& map, Update&& upd)
+    {
+        auto copy = std::make_shared<Map>(*std::atomic_load(&map));
+        upd(*copy);
+        std::atomic_store(&map, std::shared_ptr<const Map>(std::move(copy)));
+    }
+
+    std::mutex mutex_;
+    std::shared_ptr<const WeakCallMap> calls_ {std::make_shared<WeakCallMap>()};
+    std::shared_ptr<const ConferenceMap> conferences_ {std::make_shared<ConferenceMap>()};
 };
 
 } // namespace jami
@@ -45,6 +45,7 @@
 #include "client/ring_signal.h"
 #include "connectivity/upnp/upnp_context.h"
 #include "audio/ringbufferpool.h"
+#include "metrics.h"
 
 #ifdef __APPLE__
 #include <TargetConditionals.h>
@@ -1074,6 +1075,18 @@ setAudioMeterState(const std::string& id, bool state)
     jami::Manager::instance().getRingBufferPool().setAudioMeterState(id, state);
 }
 
+std::map<std::string, std::string>
+getMetrics()
+{
+    return jami::metrics::Registry::instance().snapshot();
+}
+
+void
+setMetricsReportInterval(uint32_t intervalMs)
+{
+    jami::Manager::instance().setMetricsReportInterval(std::chrono::milliseconds(intervalMs));
+}
+
 void
 setDefaultModerator(const std::string& accountID, const std::string& peerURI, bool state)
 {
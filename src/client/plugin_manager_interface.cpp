@@ -220,6 +220,18 @@ getCallMediaHandlerStatus(const std::string& callId)
     return {};
 }
 
+std::map<std::string, std::string>
+getCallMediaHandlerStats(const std::string& callId)
+{
+#ifdef ENABLE_PLUGIN
+    return jami::Manager::instance()
+        .getJamiPluginManager()
+        .getCallServicesManager()
+        .getCallMediaHandlerStats(callId);
+#endif
+    return {};
+}
+
 std::map<std::string, std::string>
 getChatHandlerDetails(const std::string& chatHandlerId)
 {
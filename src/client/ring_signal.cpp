@@ -92,6 +92,7 @@ getSignalHandlers()
         exported_callback<libjami::ConfigurationSignal::HardwareDecodingChanged>(),
         exported_callback<libjami::ConfigurationSignal::HardwareEncodingChanged>(),
         exported_callback<libjami::ConfigurationSignal::MessageSend>(),
+        exported_callback<libjami::ConfigurationSignal::MetricsReport>(),
 
         /* Presence */
         exported_callback<libjami::PresenceSignal::NewServerSubscriptionRequest>(),
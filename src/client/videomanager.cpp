@@ -25,6 +25,7 @@
 #include "localrecorder.h"
 #include "localrecordermanager.h"
 #include "libav_utils.h"
+#include "frame_pool.h"
 #include "video/video_input.h"
 #include "video/video_device_monitor.h"
 #include "account.h"
@@ -36,6 +37,7 @@
 #endif
 #include "client/ring_signal.h"
 #include "audio/ringbufferpool.h"
+#include "audio/audio_kernels.h"
 #include "jami/media_const.h"
 #include "libav_utils.h"
 #include "call_const.h"
@@ -131,7 +133,7 @@ AudioFrame::reserve(size_t nb_samples)
         auto d = pointer();
         d->nb_samples = nb_samples;
         int err;
-        if ((err = av_frame_get_buffer(d, 0)) < 0) {
+        if ((err = jami::frame_pool::getAudioBuffer(d)) < 0) {
             throw std::bad_alloc();
         }
     }
@@ -159,19 +161,13 @@ AudioFrame::mix(const AudioFrame& frame)
         for (unsigned i = 0; i < channels; i++) {
             auto c = (int16_t*) f.extended_data[i];
             auto cIn = (int16_t*) fIn.extended_data[i];
-            for (unsigned s = 0; s < samplesPerChannel; s++) {
-                c[s] = std::clamp((int32_t) c[s] + (int32_t) cIn[s],
-                                  (int32_t) std::numeric_limits<int16_t>::min(),
-                                  (int32_t) std::numeric_limits<int16_t>::max());
-            }
+            jami::kernels::mixS16(c, cIn, samplesPerChannel);
         }
     } else if (fmt == AV_SAMPLE_FMT_FLT || fmt == AV_SAMPLE_FMT_FLTP) {
         for (unsigned i = 0; i < channels; i++) {
             auto c = (float*) f.extended_data[i];
             auto cIn = (float*) fIn.extended_data[i];
-            for (unsigned s = 0; s < samplesPerChannel; s++) {
-                c[s] += cIn[s];
-            }
+            jami::kernels::mixFloat(c, cIn, samplesPerChannel);
         }
     } else {
         throw std::invalid_argument(std::string("Unsupported format for mixing: ")
@@ -188,19 +184,16 @@ AudioFrame::calcRMS() const
     int perChannel = planar ? frame_->nb_samples : frame_->nb_samples * frame_->ch_layout.nb_channels;
     int channels = planar ? frame_->ch_layout.nb_channels : 1;
     if (fmt == AV_SAMPLE_FMT_S16 || fmt == AV_SAMPLE_FMT_S16P) {
+        uint64_t sum = 0;
         for (int c = 0; c < channels; ++c) {
             auto buf = reinterpret_cast<int16_t*>(frame_->extended_data[c]);
-            for (int i = 0; i < perChannel; ++i) {
-                auto sample = buf[i] * 0.000030517578125f;
-                rms += sample * sample;
-            }
+            sum += jami::kernels::sumSquaresS16(buf, perChannel);
         }
+        rms = sum * (0.000030517578125 * 0.000030517578125);
     } else if (fmt == AV_SAMPLE_FMT_FLT || fmt == AV_SAMPLE_FMT_FLTP) {
         for (int c = 0; c < channels; ++c) {
             auto buf = reinterpret_cast<float*>(frame_->extended_data[c]);
-            for (int i = 0; i < perChannel; ++i) {
-                rms += buf[i] * buf[i];
-            }
+            rms += jami::kernels::sumSquaresFloat(buf, perChannel);
         }
     } else {
         // Should not happen
@@ -284,7 +277,7 @@ VideoFrame::reserve(int format, int width, int height)
     }
 
     setGeometry(format, width, height);
-    if (av_frame_get_buffer(libav_frame, 32))
+    if (jami::frame_pool::getVideoBuffer(libav_frame, 32))
         throw std::bad_alloc();
     allocated_ = true;
     releaseBufferCb_ = {};
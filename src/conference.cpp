@@ -44,6 +44,7 @@
 #include "call_factory.h"
 
 #include "logger.h"
+#include "metrics.h"
 #include "jami/media_const.h"
 #include "audio/ringbufferpool.h"
 #include "sip/sipcall.h"
@@ -54,6 +55,20 @@ using namespace std::literals;
 
 namespace jami {
 
+// Changes to conference infos are coalesced over this interval
+static constexpr std::chrono::milliseconds CONF_INFO_INTERVAL {100};
+// A snapshot is sent after this many deltas, so that a peer can't drift forever
+static constexpr unsigned CONF_INFO_MAX_DELTAS {100};
+
+static std::string
+participantKey(std::string_view uri, std::string_view device, std::string_view sinkId)
+{
+    std::string key;
+    key.reserve(uri.size() + device.size() + sinkId.size() + 2);
+    key.append(uri).append(1, '\n').append(device).append(1, '\n').append(sinkId);
+    return key;
+}
+
 Conference::Conference(const std::shared_ptr<Account>& account,
                        const std::string& confId,
                        bool attachHost,
@@ -813,8 +828,8 @@ ConfInfo::toVectorMapStringString() const
     return infos;
 }
 
-std::string
-ConfInfo::toString() const
+Json::Value
+ConfInfo::toJson() const
 {
     Json::Value val = {};
     for (const auto& info : *this) {
@@ -824,30 +839,204 @@ ConfInfo::toString() const
     val["h"] = h;
     val["v"] = v;
     val["layout"] = layout;
-    return Json::writeString(Json::StreamWriterBuilder {}, val);
+    return val;
+}
+
+std::string
+ConfInfo::toString() const
+{
+    return Json::writeString(Json::StreamWriterBuilder {}, toJson());
+}
+
+Json::Value
+ConfInfo::toDeltaJson(const ConfInfo& previous) const
+{
+    std::map<std::string, const ParticipantInfo*> removed;
+    for (const auto& info : previous)
+        if (!removed.emplace(participantKey(info.uri, info.device, info.sinkId), &info).second)
+            return {};
+
+    Json::Value val(Json::objectValue);
+    std::set<std::string> keys;
+    for (const auto& info : *this) {
+        auto key = participantKey(info.uri, info.device, info.sinkId);
+        if (!keys.emplace(key).second)
+            return {};
+        auto it = removed.find(key);
+        if (it == removed.end()) {
+            val["d"].append(info.toJson());
+        } else {
+            if (*it->second != info)
+                val["d"].append(info.toJson());
+            removed.erase(it);
+        }
+    }
+    for (const auto& [key, info] : removed) {
+        Json::Value r;
+        r["uri"] = info->uri;
+        r["device"] = info->device;
+        r["sinkId"] = info->sinkId;
+        val["r"].append(r);
+    }
+    val["w"] = w;
+    val["h"] = h;
+    val["v"] = v;
+    val["layout"] = layout;
+    return val;
+}
+
+bool
+ConfInfo::applyDelta(const Json::Value& delta)
+{
+    if (!delta.isObject())
+        return false;
+    const auto& removed = delta["r"];
+    const auto& changed = delta["d"];
+    if ((!removed.isNull() && !removed.isArray()) || (!changed.isNull() && !changed.isArray()))
+        return false;
+
+    auto find = [&](std::string_view uri, std::string_view device, std::string_view sinkId) {
+        return std::find_if(begin(), end(), [&](const ParticipantInfo& p) {
+            return p.uri == uri && p.device == device && p.sinkId == sinkId;
+        });
+    };
+    for (const auto& r : removed) {
+        auto it = find(r["uri"].asString(), r["device"].asString(), r["sinkId"].asString());
+        if (it != end())
+            erase(it);
+    }
+    for (const auto& participantInfo : changed) {
+        if (!participantInfo.isMember("uri"))
+            continue;
+        ParticipantInfo pInfo;
+        pInfo.fromJson(participantInfo);
+        auto it = find(pInfo.uri, pInfo.device, pInfo.sinkId);
+        if (it != end())
+            *it = std::move(pInfo);
+        else
+            emplace_back(std::move(pInfo));
+    }
+    if (delta.isMember("w"))
+        w = delta["w"].asInt();
+    if (delta.isMember("h"))
+        h = delta["h"].asInt();
+    if (delta.isMember("v"))
+        v = delta["v"].asInt();
+    if (delta.isMember("layout"))
+        layout = delta["layout"].asInt();
+    return true;
 }
 
 void
 Conference::sendConferenceInfos()
 {
-    // Inform calls that the layout has changed
-    foreachCall([&](auto call) {
-        // Produce specific JSON for each participant (2 separate accounts can host ...
-        // a conference on a same device, the conference is not link to one account).
-        auto w = call->getAccount();
-        auto account = w.lock();
-        if (!account)
-            return;
+    if (confInfoPending_.exchange(true))
+        return;
+    // Called from the destructor, nothing to send
+    auto w = weak_from_this();
+    if (w.expired()) {
+        confInfoPending_ = false;
+        return;
+    }
+    auto flush = [w] {
+        if (auto shared = w.lock())
+            shared->flushConferenceInfos();
+    };
+    auto delay = clock::time_point(clock::duration(lastConfInfoFlush_.load())) + CONF_INFO_INTERVAL
+                 - clock::now();
+    if (delay > clock::duration::zero())
+        Manager::instance().scheduler().scheduleIn(std::move(flush), delay);
+    else
+        runOnMainThread(std::move(flush));
+}
 
-        dht::ThreadPool::io().run(
-            [call,
-             confInfo = getConfInfoHostUri(account->getUsername() + "@ring.dht",
-                                           call->getPeerNumber())] {
-                call->sendConfInfo(confInfo.toString());
-            });
-    });
+std::string
+Conference::confInfoMessage(SentConfInfo& sent, ConfInfo&& info)
+{
+    static auto& snapshots = metrics::counter("conference.info.snapshots");
+    static auto& deltas = metrics::counter("conference.info.deltas");
+    static auto& skipped = metrics::counter("conference.info.skipped");
 
-    auto confInfo = getConfInfoHostUri("", "");
+    if (sent.seq != 0 && !sent.forceSnapshot && info == sent.info
+        && info.layout == sent.info.layout) {
+        skipped.inc();
+        return {};
+    }
+
+    Json::Value msg;
+    if (sent.deltasEnabled && !sent.forceSnapshot && sent.deltas < CONF_INFO_MAX_DELTAS)
+        msg = info.toDeltaJson(sent.info);
+    if (msg.isObject()) {
+        msg[ConfInfo::BASE] = Json::UInt64(sent.seq);
+        sent.deltas++;
+        deltas.inc();
+    } else {
+        msg = info.toJson();
+        sent.deltas = 0;
+        sent.forceSnapshot = false;
+        if (!sent.deltasEnabled && sent.resyncSeq == 0)
+            sent.resyncSeq = sent.seq + 1;
+        snapshots.inc();
+    }
+    msg[ConfInfo::SEQ] = Json::UInt64(++sent.seq);
+    sent.info = std::move(info);
+
+    Json::StreamWriterBuilder wbuilder;
+    wbuilder["commentStyle"] = "None";
+    wbuilder["indentation"] = "";
+    return Json::writeString(wbuilder, msg);
+}
+
+void
+Conference::onConfInfoAck(const std::string& callId, uint64_t seq)
+{
+    std::lock_guard<std::mutex> lk(confInfoMutex_);
+    auto it = sentConfInfos_.find(callId);
+    if (it == sentConfInfos_.end())
+        return;
+    auto& sent = it->second;
+    if (seq == 0) {
+        // The peer missed an update, resynchronize it with a snapshot
+        JAMI_DEBUG("[conf {:s}] Conference infos out of sync for call {:s}", id_, callId);
+        sent.deltasEnabled = false;
+        sent.forceSnapshot = true;
+        sent.resyncSeq = 0;
+        sendConferenceInfos();
+    } else if (!sent.deltasEnabled && sent.resyncSeq != 0 && seq >= sent.resyncSeq
+               && seq <= sent.seq) {
+        // Next updates will be received after the snapshots already sent
+        sent.deltasEnabled = true;
+        sent.resyncSeq = 0;
+    }
+}
+
+void
+Conference::flushConferenceInfos()
+{
+    confInfoPending_ = false;
+    lastConfInfoFlush_ = clock::now().time_since_epoch().count();
+
+    ConfInfo confInfo;
+    {
+        std::lock_guard<std::mutex> lk(confInfoMutex_);
+        // Inform calls that the layout has changed
+        foreachCall([&](auto call) {
+            // Produce specific JSON for each participant (2 separate accounts can host ...
+            // a conference on a same device, the conference is not link to one account).
+            auto w = call->getAccount();
+            auto account = w.lock();
+            if (!account)
+                return;
+
+            auto msg = confInfoMessage(sentConfInfos_[call->getCallId()],
+                                       getConfInfoHostUri(account->getUsername() + "@ring.dht",
+                                                          call->getPeerNumber()));
+            if (!msg.empty())
+                dht::ThreadPool::io().run(
+                    [call, msg = std::move(msg)] { call->sendConfInfo(msg); });
+        });
+        confInfo = getConfInfoHostUri("", "");
+    }
 #ifdef ENABLE_VIDEO
     createSinks(confInfo);
 #endif
@@ -883,6 +1072,10 @@ Conference::removeParticipant(const std::string& participant_id)
         if (!participants_.erase(participant_id))
             return;
     }
+    {
+        std::lock_guard<std::mutex> lk(confInfoMutex_);
+        sentConfInfos_.erase(participant_id);
+    }
     if (auto call = std::dynamic_pointer_cast<SIPCall>(getCall(participant_id))) {
         const auto& peerId = getRemoteId(call);
         participantsMuted_.erase(call->getCallId());
@@ -1195,6 +1388,10 @@ Conference::onConfOrder(const std::string& callId, const std::string& confOrder)
             JAMI_WARN("Couldn't parse conference order from %s", peerId.c_str());
             return;
         }
+        if (root.isMember(ConfInfo::ACK)) {
+            onConfInfoAck(callId, root[ConfInfo::ACK].asUInt64());
+            return;
+        }
 
         parser_.initData(std::move(root), peerId);
         parser_.parse();
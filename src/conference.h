@@ -24,6 +24,7 @@
 #include "config.h"
 #endif
 
+#include <atomic>
 #include <chrono>
 #include <set>
 #include <string>
@@ -42,6 +43,7 @@
 #include "recordable.h"
 
 #ifdef ENABLE_PLUGIN
+#include "plugin/mediaprocessor.h"
 #include "plugin/streamdata.h"
 #endif
 
@@ -157,6 +159,13 @@ struct ParticipantInfo
 
 struct ConfInfo : public std::vector<ParticipantInfo>
 {
+    // Versioned updates: each update carries a sequence number, and deltas the
+    // sequence number of the update they apply to. Peers acknowledge snapshots
+    // with a confOrder, or request a new one by acknowledging 0.
+    static constexpr const char* SEQ = "seq";
+    static constexpr const char* BASE = "base";
+    static constexpr const char* ACK = "confInfoSeq";
+
     int h {0};
     int w {0};
     int v {1}; // Supported conference protocol version
@@ -184,7 +193,19 @@ struct ConfInfo : public std::vector<ParticipantInfo>
     friend bool operator!=(const ConfInfo& c1, const ConfInfo& c2) { return !(c1 == c2); }
 
     std::vector<std::map<std::string, std::string>> toVectorMapStringString() const;
+    Json::Value toJson() const;
     std::string toString() const;
+
+    /**
+     * Serialize changed, added and removed participants since previous
+     * @return null if participants can't be identified and a full snapshot is needed
+     */
+    Json::Value toDeltaJson(const ConfInfo& previous) const;
+    /**
+     * Apply changes serialized with toDeltaJson()
+     * @return false if the delta is invalid
+     */
+    bool applyDelta(const Json::Value& delta);
 };
 
 using ParticipantSet = std::set<std::string>;
@@ -446,7 +467,32 @@ private:
     mutable std::mutex confInfoMutex_ {};
     ConfInfo confInfo_ {};
 
+    /**
+     * Last conference infos sent to a call. Once the peer acknowledged a
+     * snapshot, only changes are sent.
+     */
+    struct SentConfInfo
+    {
+        ConfInfo info {};
+        uint64_t seq {0};
+        uint64_t resyncSeq {0}; // first snapshot sent since deltas were disabled
+        unsigned deltas {0};    // deltas sent since the last snapshot
+        bool deltasEnabled {false};
+        bool forceSnapshot {false};
+    };
+    // Protected by confInfoMutex_, by call id
+    std::map<std::string, SentConfInfo> sentConfInfos_ {};
+    std::atomic_bool confInfoPending_ {false};
+    std::atomic<clock::rep> lastConfInfoFlush_ {0};
+
+    /**
+     * Schedule sending conference infos to calls and client. Changes are
+     * coalesced and sent at most once per CONF_INFO_INTERVAL.
+     */
     void sendConferenceInfos();
+    void flushConferenceInfos();
+    std::string confInfoMessage(SentConfInfo& sent, ConfInfo&& info);
+    void onConfInfoAck(const std::string& callId, uint64_t seq);
     std::shared_ptr<RingBuffer> ghostRingBuffer_;
 
 #ifdef ENABLE_VIDEO
@@ -499,7 +545,7 @@ private:
      * Call Streams and some typedefs
      */
     using AVMediaStream = Observable<std::shared_ptr<MediaFrame>>;
-    using MediaStreamSubject = PublishMapSubject<std::shared_ptr<MediaFrame>, AVFrame*>;
+    using MediaStreamSubject = PluginMediaProcessor;
 
 #ifdef ENABLE_VIDEO
     /**
@@ -22,6 +22,7 @@
 #include "manager.h"
 #include "peer_connection.h"
 #include "logger.h"
+#include "metrics.h"
 
 #include <asio.hpp>
 #include <opendht/crypto.h>
@@ -61,8 +62,20 @@ struct ConnectionInfo
     std::function<void(bool)> onConnected_;
     std::unique_ptr<asio::steady_timer> waitForAnswer_ {};
 
+    // Used to measure ICE negotiation and TLS handshake durations
+    std::chrono::steady_clock::time_point start_ {std::chrono::steady_clock::now()};
+    std::chrono::steady_clock::time_point tlsStart_ {};
 };
 
+static void
+onIceNegotiated(ConnectionInfo& info)
+{
+    static auto& iceTime = metrics::histogram("connection_manager.ice_negotiation_ms");
+    info.tlsStart_ = std::chrono::steady_clock::now();
+    iceTime.recordDuration(
+        std::chrono::duration_cast<std::chrono::milliseconds>(info.tlsStart_ - info.start_));
+}
+
 class ConnectionManager::Impl : public std::enable_shared_from_this<ConnectionManager::Impl>
 {
 public:
@@ -407,6 +420,7 @@ ConnectionManager::Impl::connectDeviceOnNegoDone(
         JAMI_ERR("No ICE detected or not running");
         return false;
     }
+    onIceNegotiated(*info);
 
     // Build socket
     auto endpoint = std::make_unique<IceSocketEndpoint>(std::shared_ptr<IceTransport>(
@@ -782,6 +796,13 @@ ConnectionManager::Impl::onTlsNegotiationDone(bool ok,
     // Note: if not initied by connectDevice() the channel name will be empty (because no channel
     // asked yet)
     auto isDhtRequest = name.empty();
+    static auto& tlsTime = metrics::histogram("connection_manager.tls_handshake_ms");
+    static auto& tlsFailures = metrics::counter("connection_manager.tls_failures");
+    if (ok and info->tlsStart_ != std::chrono::steady_clock::time_point {})
+        tlsTime.recordDuration(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - info->tlsStart_));
+    else if (!ok)
+        tlsFailures.inc();
     if (!ok) {
         if (isDhtRequest) {
             JAMI_ERR() << "TLS connection failure for peer " << deviceId
@@ -897,6 +918,7 @@ ConnectionManager::Impl::onRequestOnNegoDone(const PeerConnectionRequest& req)
         JAMI_ERR("No ICE detected");
         return false;
     }
+    onIceNegotiated(*info);
 
     // Build socket
     auto endpoint = std::make_unique<IceSocketEndpoint>(std::shared_ptr<IceTransport>(
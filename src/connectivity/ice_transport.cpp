@@ -28,6 +28,8 @@
 #include "jami/callmanager_interface.h"
 #include "tracepoint.h"
 
+#include <opendht/thread_pool.h>
+
 #include <pjlib.h>
 
 #include <map>
@@ -67,6 +69,12 @@ static constexpr uint16_t IPV4_HEADER_SIZE = 20; ///< Size in bytes of IPV4 pack
 static constexpr int MAX_CANDIDATES {32};
 static constexpr int MAX_DESTRUCTION_TIMEOUT {3000};
 static constexpr int HANDLE_EVENT_DURATION {500};
+// A public address is queried again after this delay...
+static constexpr std::chrono::seconds PUBLIC_ADDRESS_VALIDITY {30};
+// ...but still used for candidates until the refresh completes
+static constexpr std::chrono::minutes PUBLIC_ADDRESS_STALE_VALIDITY {10};
+// Queries run on an account's DHT, which may be stopped before answering
+static constexpr std::chrono::seconds PUBLIC_ADDRESS_QUERY_TIMEOUT {10};
 
 //==============================================================================
 
@@ -142,6 +150,14 @@ public:
     void addServerReflexiveCandidates(const std::vector<std::pair<IpAddr, IpAddr>>& addrList);
     // Generate server reflexive candidates using the published (DHT/Account) address
     std::vector<std::pair<IpAddr, IpAddr>> setupGenericReflexiveCandidates();
+    // Generate server reflexive candidates mapping the account local address to publicAddr
+    std::vector<std::pair<IpAddr, IpAddr>> setupReflexiveCandidates(IpAddr publicAddr) const;
+    // Generate server reflexive candidates using the public address learnt by
+    // other transports from the same STUN servers. Set stunCacheKey_ if the
+    // servers must be queried.
+    std::vector<std::pair<IpAddr, IpAddr>> setupStunReflexiveCandidates();
+    // Cache the public addresses answered by the STUN servers
+    void cacheStunAddresses();
     // Generate server reflexive candidates using UPNP mappings.
     std::vector<std::pair<IpAddr, IpAddr>> setupUpnpReflexiveCandidates();
     void setDefaultRemoteAddress(unsigned comp_id, const IpAddr& addr);
@@ -204,6 +220,9 @@ public:
     // STUN and TURN servers
     std::vector<StunServerInfo> stunServers_;
     std::vector<TurnServerInfo> turnServers_;
+    // Key of the STUN servers' answer in the public address cache, set when
+    // this transport queries them
+    std::string stunCacheKey_ {};
 
     /**
      * Returns the IP of each candidate for a given component in the ICE session
@@ -472,7 +491,20 @@ IceTransport::Impl::initIceInstance(const IceTransportOptions& options)
         }
     }
 
-    if (upnpSrflxCand.empty() and genericSrflxCand.empty()) {
+    // The STUN servers give every transport the same public address: they
+    // are only queried when it isn't known yet or expired.
+    auto stunSrflxCand = setupStunReflexiveCandidates();
+    if (not stunSrflxCand.empty()) {
+        auto stunAddr = stunSrflxCand[0].second.toString();
+        if ((upnpSrflxCand.empty() or upnpSrflxCand[0].second.toString() != stunAddr)
+            and (genericSrflxCand.empty() or genericSrflxCand[0].second.toString() != stunAddr)) {
+            addServerReflexiveCandidates(stunSrflxCand);
+            JAMI_DBG("[ice:%p] Added cached STUN srflx candidates", this);
+        }
+    }
+
+    if (upnpSrflxCand.empty() and genericSrflxCand.empty() and stunSrflxCand.empty()
+        and stunCacheKey_.empty()) {
         JAMI_WARN("[ice:%p] No server reflexive candidates added", this);
     }
 
@@ -521,8 +553,10 @@ IceTransport::Impl::initIceInstance(const IceTransportOptions& options)
     };
 
     // Add STUN servers
-    for (auto& server : stunServers_)
-        add_stun_server(*pool_, config_, server);
+    if (not stunCacheKey_.empty()) {
+        for (auto& server : stunServers_)
+            add_stun_server(*pool_, config_, server);
+    }
 
     // Add TURN servers
     for (auto& server : turnServers_)
@@ -720,6 +754,7 @@ IceTransport::Impl::onComplete(pj_ice_strans*, pj_ice_strans_op op, pj_status_t
     }
 
     if (done and op == PJ_ICE_STRANS_OP_INIT) {
+        cacheStunAddresses();
         if (initiatorSession_)
             setInitiatorSession();
         else
@@ -930,8 +965,9 @@ IceTransport::Impl::requestUpnpMappings()
         // Set port number to 0 to get any available port.
         Mapping requestedMap(portType);
 
-        // Request the mapping
-        Mapping::sharedPtr_t mapPtr = upnp_->reserveMapping(requestedMap);
+        // Only take mappings already open: a pending one can't be used as a
+        // candidate and requesting it per transport floods the IGD.
+        Mapping::sharedPtr_t mapPtr = upnp_->reserveMapping(requestedMap, true);
 
         // To use a mapping, it must be valid, open and has valid host address.
         if (mapPtr and mapPtr->getMapKey() and (mapPtr->getState() == MappingState::OPEN)
@@ -949,7 +985,8 @@ IceTransport::Impl::requestUpnpMappings()
             }
         } else {
             JAMI_WARN("[ice:%p] UPNP mapping request failed!", this);
-            upnp_->releaseMapping(requestedMap);
+            if (mapPtr)
+                upnp_->releaseMapping(*mapPtr);
         }
     }
 }
@@ -1026,8 +1063,15 @@ IceTransport::Impl::setupGenericReflexiveCandidates()
         return {};
     }
 
+    return setupReflexiveCandidates(accountPublicAddr_);
+}
+
+std::vector<std::pair<IpAddr, IpAddr>>
+IceTransport::Impl::setupReflexiveCandidates(IpAddr publicAddr) const
+{
     std::vector<std::pair<IpAddr, IpAddr>> addrList;
     auto isTcp = isTcpEnabled();
+    auto localAddr = accountLocalAddr_;
 
     addrList.reserve(compCount_);
     for (unsigned id = 1; id <= compCount_; id++) {
@@ -1038,14 +1082,87 @@ IceTransport::Impl::setupGenericReflexiveCandidates()
                               : upnp::Controller::generateRandomPort(isTcp ? PortType::TCP
                                                                            : PortType::UDP);
 
-        accountLocalAddr_.setPort(port);
-        accountPublicAddr_.setPort(port);
-        addrList.emplace_back(accountLocalAddr_, accountPublicAddr_);
+        localAddr.setPort(port);
+        publicAddr.setPort(port);
+        addrList.emplace_back(localAddr, publicAddr);
     }
 
     return addrList;
 }
 
+std::vector<std::pair<IpAddr, IpAddr>>
+IceTransport::Impl::setupStunReflexiveCandidates()
+{
+    if (stunServers_.empty())
+        return {};
+
+    // Servers are asked over the transport protocol: keep UDP and TCP answers apart
+    std::string key = isTcpEnabled() ? "stun:tcp" : "stun:udp";
+    for (auto const& server : stunServers_)
+        key += " " + server.uri;
+
+    bool refresh = false;
+    auto& publicAddresses = Manager::instance().getIceTransportFactory().publicAddresses();
+    auto cached = publicAddresses.lookup(key, refresh);
+
+    std::vector<std::pair<IpAddr, IpAddr>> addrList;
+    if (cached and not cached->empty() and accountLocalAddr_)
+        addrList = setupReflexiveCandidates(cached->front());
+
+    // Without candidates, this transport asks the servers itself
+    if (refresh or addrList.empty())
+        stunCacheKey_ = std::move(key);
+    return addrList;
+}
+
+void
+IceTransport::Impl::cacheStunAddresses()
+{
+    if (stunCacheKey_.empty())
+        return;
+
+    pj_ice_sess_cand cand[MAX_CANDIDATES];
+    unsigned cand_cnt = PJ_ARRAY_SIZE(cand);
+    if (pj_ice_strans_enum_cands(icest_, 1, &cand_cnt, cand) != PJ_SUCCESS) {
+        JAMI_ERR("[ice:%p] pj_ice_strans_enum_cands() failed", this);
+        return;
+    }
+
+    // Srflx candidates are also made from the user mappings (UPnP, DHT or
+    // cached address): only keep the ones answered by the STUN servers.
+    auto isUserMapping = [&](const pj_sockaddr& addr) {
+        for (unsigned i = 0; i < config_.stun_tp_cnt; i++) {
+            auto const& stunCfg = config_.stun_tp[i].cfg;
+            for (unsigned j = 0; j < stunCfg.user_mapping_cnt; j++)
+                if (pj_sockaddr_cmp(&stunCfg.user_mapping[j].mapped_addr, &addr) == 0)
+                    return true;
+        }
+        return false;
+    };
+
+    std::vector<IpAddr> addresses;
+    for (unsigned i = 0; i < cand_cnt; ++i) {
+        if (cand[i].type != PJ_ICE_CAND_TYPE_SRFLX or isUserMapping(cand[i].addr))
+            continue;
+        IpAddr addr {cand[i].addr};
+        // IPv4 first: it is the family of the srflx user mappings
+        if (addr.isIpv4())
+            addresses.insert(addresses.begin(), addr);
+        else
+            addresses.emplace_back(addr);
+    }
+
+    if (addresses.empty()) {
+        JAMI_DBG("[ice:%p] No public address answered by the STUN servers", this);
+        return;
+    }
+    JAMI_DBG("[ice:%p] Caching public address %s answered by the STUN servers",
+             this,
+             addresses.front().toString().c_str());
+    Manager::instance().getIceTransportFactory().publicAddresses().put(stunCacheKey_,
+                                                                        std::move(addresses));
+}
+
 std::vector<std::pair<IpAddr, IpAddr>>
 IceTransport::Impl::setupUpnpReflexiveCandidates()
 {
@@ -1809,6 +1926,13 @@ IceTransportFactory::IceTransportFactory()
               delete p;
           })
     , ice_cfg_()
+    , publicAddresses_(Manager::instance().scheduler(),
+                       PUBLIC_ADDRESS_VALIDITY,
+                       PUBLIC_ADDRESS_STALE_VALIDITY,
+                       PUBLIC_ADDRESS_QUERY_TIMEOUT,
+                       [](std::function<void()>&& cb) {
+                           dht::ThreadPool::io().run(std::move(cb));
+                       })
 {
     pj_caching_pool_init(cp_.get(), NULL, 0);
 
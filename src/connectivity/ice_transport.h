@@ -22,6 +22,7 @@
 
 #include "ice_socket.h"
 #include "ip_utils.h"
+#include "network_cache.h"
 
 #include <pjnath.h>
 #include <pjlib.h>
@@ -267,9 +268,17 @@ public:
     pj_pool_factory* getPoolFactory() { return &cp_->factory; }
     std::shared_ptr<pj_caching_pool> getPoolCaching() { return cp_; }
 
+    /**
+     * Public addresses used for server reflexive candidates, shared by all
+     * transports of the process. Keyed by source: DHT lookups per local
+     * interface ("dht:"), STUN servers asked by transports ("stun:").
+     */
+    NetworkCache<std::vector<IpAddr>>& publicAddresses() { return publicAddresses_; }
+
 private:
     std::shared_ptr<pj_caching_pool> cp_;
     pj_ice_strans_cfg ice_cfg_;
+    NetworkCache<std::vector<IpAddr>> publicAddresses_;
 };
 
 }; // namespace jami
@@ -22,6 +22,7 @@
 #include "peer_connection.h"
 #include "ice_transport.h"
 #include "connectivity/security/certstore.h"
+#include "metrics.h"
 
 #include <opendht/thread_pool.h>
 #include <asio/io_context.hpp>
@@ -71,9 +72,11 @@ public:
                 shutdown();
             }
         }}
-    {}
+    {
+        metrics::gauge("multiplexed_socket.sockets").add();
+    }
 
-    ~Impl() {}
+    ~Impl() { metrics::gauge("multiplexed_socket.sockets").sub(); }
 
     void join()
     {
@@ -243,6 +246,8 @@ MultiplexedSocket::Impl::eventLoop()
             break;
         }
 
+        static auto& rxBytes = metrics::counter("multiplexed_socket.rx_bytes");
+        rxBytes.inc(size);
         pac_.buffer_consumed(size);
         msgpack::object_handle oh;
         while (pac_.next(oh) && !stop) {
@@ -630,6 +635,9 @@ MultiplexedSocket::write(const uint16_t& channel,
         if (ec)
             JAMI_ERR("Error when writing on socket: %s", ec.message().c_str());
         shutdown();
+    } else {
+        static auto& txBytes = metrics::counter("multiplexed_socket.tx_bytes");
+        txBytes.inc(len);
     }
     return res;
 }
@@ -747,6 +755,18 @@ MultiplexedSocket::eraseChannel(uint16_t channel)
 
 ////////////////////////////////////////////////////////////////
 
+/// Throughput counter of a kind of channel. Channel names embed ids, so
+/// channels are grouped by scheme ("git", "sip", "data-transfer"...)
+/// to keep the number of metrics bounded.
+static metrics::Counter&
+channelCounter(std::string_view name, std::string_view what)
+{
+    auto kind = name.substr(0, std::min(name.find("://"), name.find('/')));
+    if (kind.empty())
+        kind = "other";
+    return metrics::counter(fmt::format("multiplexed_socket.channel.{}.{}", kind, what));
+}
+
 class ChannelSocket::Impl
 {
 public:
@@ -760,6 +780,8 @@ public:
         , endpoint(std::move(endpoint))
         , isInitiator_(isInitiator)
         , rmFromMxSockCb_(std::move(rmFromMxSockCb))
+        , rxBytes(channelCounter(name, "rx_bytes"))
+        , txBytes(channelCounter(name, "tx_bytes"))
     {}
 
     ~Impl() {}
@@ -772,6 +794,8 @@ public:
     std::weak_ptr<MultiplexedSocket> endpoint {};
     bool isInitiator_ {false};
     std::function<void()> rmFromMxSockCb_;
+    metrics::Counter& rxBytes;
+    metrics::Counter& txBytes;
 
     bool isAnswered_ {false};
     bool isRemovable_ {false};
@@ -993,6 +1017,7 @@ ChannelSocket::setOnRecv(RecvCb&& cb)
 void
 ChannelSocket::onRecv(std::vector<uint8_t>&& pkt)
 {
+    pimpl_->rxBytes.inc(pkt.size());
     std::lock_guard<std::mutex> lkSockets(pimpl_->mutex);
     if (pimpl_->cb) {
         pimpl_->cb(&pkt[0], pkt.size());
@@ -1106,6 +1131,7 @@ ChannelSocket::write(const ValueType* buf, std::size_t len, std::error_code& ec)
             }
             sent += toSend;
         } while (sent < len);
+        pimpl_->txBytes.inc(sent);
         return sent;
     }
     ec = std::make_error_code(std::errc::broken_pipe);
@@ -0,0 +1,268 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include "scheduled_executor.h"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace jami {
+
+/**
+ * Process-wide cache of values learnt from the network (public address,
+ * mapped ports...) which are the same for every transport gathering
+ * candidates at a given time.
+ *
+ * - a value younger than the validity window is served without query;
+ * - an older value is still served right away (so connectivity checks can
+ *   start) while a refresh runs in background, until it becomes older than
+ *   the stale window;
+ * - concurrent requests for a key share a single in-flight query;
+ * - a query not answered within the query timeout fails: it may run on a
+ *   transport that was stopped meanwhile, and must not block other callers;
+ * - invalidate() drops every value, e.g. after a connectivity change. Queries
+ *   in flight are restarted and their previous results ignored;
+ * - values learnt by the callers themselves use lookup() and put() instead of
+ *   a query.
+ */
+template<typename T>
+class NetworkCache
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using Callback = std::function<void(const std::optional<T>&)>;
+    /**
+     * Query the value, then call the callback once, with nullopt on failure.
+     * A query that doesn't answer before the query timeout fails.
+     */
+    using Query = std::function<void(std::function<void(std::optional<T>&&)>&&)>;
+    /** Run a callback outside of the caller's stack */
+    using Executor = std::function<void(std::function<void()>&&)>;
+
+    /**
+     * @param scheduler  runs query deadlines, must be stopped before the cache is destroyed
+     */
+    NetworkCache(ScheduledExecutor& scheduler,
+                 clock::duration validity,
+                 clock::duration staleValidity,
+                 clock::duration queryTimeout,
+                 Executor&& executor = {})
+        : scheduler_(scheduler)
+        , validity_(validity)
+        , staleValidity_(staleValidity)
+        , queryTimeout_(queryTimeout)
+        , executor_(std::move(executor))
+    {}
+
+    /**
+     * Get the value of @key, running @query if needed.
+     * Cached values are given to @cb through the executor.
+     */
+    void get(const std::string& key, Query&& query, Callback&& cb)
+    {
+        std::optional<T> cached;
+        uint64_t queryId = 0;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            auto& entry = entries_[key];
+            auto now = clock::now();
+            auto age = now - entry.updated;
+            if (entry.value and age < staleValidity_)
+                cached = entry.value;
+            if (not cached or age >= validity_) {
+                if (not cached)
+                    entry.waiters.emplace_back(std::move(cb));
+                if (not entry.querying) {
+                    entry.querying = true;
+                    entry.query = query;
+                    queryId = startQuery(key, entry);
+                }
+            }
+        }
+        if (cached) {
+            if (executor_)
+                executor_([cb = std::move(cb), cached = std::move(cached)] { cb(cached); });
+            else
+                cb(cached);
+        }
+        if (queryId)
+            runQuery(key, query, queryId);
+    }
+
+    /**
+     * Fresh or stale value of @key, without querying.
+     */
+    std::optional<T> cached(const std::string& key) const
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end() or clock::now() - it->second.updated >= staleValidity_)
+            return std::nullopt;
+        return it->second.value;
+    }
+
+    /**
+     * For values learnt as a side effect of the callers' own work (e.g. STUN
+     * binding requests sent while gathering candidates), which put() them.
+     * Return the fresh or stale value of @key, and set @refresh if the caller
+     * must learn it again: always without value, and for a single caller at
+     * a time (until the query timeout) once the value expired.
+     */
+    std::optional<T> lookup(const std::string& key, bool& refresh)
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        auto& entry = entries_[key];
+        auto age = clock::now() - entry.updated;
+        if (not entry.value or age >= staleValidity_) {
+            refresh = true;
+            return std::nullopt;
+        }
+        refresh = age >= validity_ and not entry.querying;
+        if (refresh) {
+            entry.querying = true;
+            startQuery(key, entry);
+        }
+        return entry.value;
+    }
+
+    /**
+     * Store @value for @key as fresh, and give it to the waiters of the query
+     * in flight if any.
+     */
+    void put(const std::string& key, T value)
+    {
+        std::vector<Callback> waiters;
+        std::optional<T> result;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            auto& entry = entries_[key];
+            entry.value = std::move(value);
+            entry.updated = clock::now();
+            if (entry.querying) {
+                entry.querying = false;
+                entry.query = {};
+                waiters = std::move(entry.waiters);
+                entry.waiters.clear();
+            }
+            result = entry.value;
+        }
+        for (auto& cb : waiters)
+            cb(result);
+    }
+
+    void invalidate()
+    {
+        std::vector<std::tuple<std::string, Query, uint64_t>> restart;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            for (auto& [key, entry] : entries_) {
+                entry.value.reset();
+                if (entry.querying and entry.query)
+                    restart.emplace_back(key, entry.query, startQuery(key, entry));
+                else
+                    // Refresh claimed by lookup(): every caller learns the value again
+                    entry.querying = false;
+            }
+        }
+        for (auto& [key, query, queryId] : restart)
+            runQuery(key, query, queryId);
+    }
+
+    /** Number of queries started since creation */
+    uint64_t queries() const
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        return queries_;
+    }
+
+private:
+    struct Entry
+    {
+        std::optional<T> value {};
+        clock::time_point updated {};
+        bool querying {false};
+        Query query {};
+        /** Identifies the query in flight, older answers are ignored */
+        uint64_t queryId {0};
+        std::vector<Callback> waiters {};
+    };
+
+    /** Identify a new query for @entry and schedule its deadline. Called with mutex_ locked. */
+    uint64_t startQuery(const std::string& key, Entry& entry)
+    {
+        ++queries_;
+        auto queryId = ++lastQueryId_;
+        entry.queryId = queryId;
+        // Previous deadlines are left to expire: their query id doesn't match anymore
+        scheduler_.scheduleIn([this, key, queryId] { onResult(key, queryId, std::nullopt); },
+                              queryTimeout_);
+        return queryId;
+    }
+
+    void runQuery(const std::string& key, const Query& query, uint64_t queryId)
+    {
+        query([this, key, queryId](std::optional<T>&& value) {
+            onResult(key, queryId, std::move(value));
+        });
+    }
+
+    void onResult(const std::string& key, uint64_t queryId, std::optional<T>&& value)
+    {
+        std::vector<Callback> waiters;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            auto it = entries_.find(key);
+            // Answer after the deadline or from the previous network
+            if (it == entries_.end() or not it->second.querying
+                or it->second.queryId != queryId)
+                return;
+            auto& entry = it->second;
+            entry.querying = false;
+            entry.query = {};
+            waiters = std::move(entry.waiters);
+            entry.waiters.clear();
+            if (value) {
+                entry.value = value;
+                entry.updated = clock::now();
+            }
+        }
+        for (auto& cb : waiters)
+            cb(value);
+    }
+
+    ScheduledExecutor& scheduler_;
+    const clock::duration validity_;
+    const clock::duration staleValidity_;
+    const clock::duration queryTimeout_;
+    const Executor executor_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> entries_;
+    uint64_t lastQueryId_ {0};
+    uint64_t queries_ {0};
+};
+
+} // namespace jami
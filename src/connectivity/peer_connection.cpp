@@ -162,6 +162,17 @@ IceSocketEndpoint::write(const ValueType* buf, std::size_t len, std::error_code&
 
 //==============================================================================
 
+/// Key of the resumable session between two identities. Certificates are hashed rather than
+/// keys, so that a session is never resumed with a renewed certificate.
+static std::string
+resumptionId(const TlsSocketEndpoint::Identity& local, const dht::crypto::Certificate& peer)
+{
+    if (not local.second)
+        return {};
+    return dht::InfoHash::get(local.second->getPacked()).toString()
+           + dht::InfoHash::get(peer.getPacked()).toString();
+}
+
 class TlsSocketEndpoint::Impl
 {
 public:
@@ -193,6 +204,7 @@ public:
             /*.dh_params = */ dh_params,
             /*.timeout = */ TLS_TIMEOUT,
             /*.cert_check = */ nullptr,
+            /*.resumption_id = */ resumptionId(local_identity, peer_cert),
         };
         tls = std::make_unique<tls::TlsSession>(std::move(ep), tls_param, tls_cbs);
     }
@@ -224,6 +236,7 @@ public:
             /*.dh_params = */ dh_params,
             /*.timeout = */ std::chrono::duration_cast<decltype(tls::TlsParams::timeout)>(TLS_TIMEOUT),
             /*.cert_check = */ nullptr,
+            /*.resumption_id = */ {},
         };
         tls = std::make_unique<tls::TlsSession>(std::move(ep), tls_param, tls_cbs);
     }
@@ -424,6 +437,12 @@ TlsSocketEndpoint::monitor() const
 {
     if (auto ice = pimpl_->underlyingICE())
         JAMI_DBG("\t- Ice connection: %s", ice->link().c_str());
+    if (pimpl_->tls)
+        JAMI_DBG("\t- TLS handshake: %lld ms%s",
+                 (long long) std::chrono::duration_cast<std::chrono::milliseconds>(
+                     pimpl_->tls->handshakeDuration())
+                     .count(),
+                 pimpl_->tls->isResumed() ? " (resumed)" : "");
 }
 
 IpAddr
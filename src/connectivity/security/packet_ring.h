@@ -0,0 +1,117 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#pragma once
+
+#include "noncopyable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace jami {
+namespace tls {
+
+/**
+ * Bounded lock-free queue of packets, for one producer and one consumer thread.
+ *
+ * Packets are copied into per-slot slabs that are kept from one packet to the
+ * next, so that the queue stops allocating once warmed up. The consumer reads
+ * packets in place. When the queue is full, new packets are dropped.
+ */
+class PacketRing
+{
+public:
+    /** Initial size of a slab, enough for a packet of a typical MTU */
+    static constexpr std::size_t SLAB_SIZE {2048};
+
+    struct Packet
+    {
+        const uint8_t* data;
+        std::size_t size;
+    };
+
+    /**
+     * @param capacity  maximum number of packets, must be a power of two
+     */
+    explicit PacketRing(std::size_t capacity)
+        : slabs_(capacity)
+        , mask_(capacity - 1)
+    {}
+
+    /**
+     * Producer: queue a copy of the packet.
+     * @return false if the packet was dropped because the queue is full
+     */
+    bool push(const uint8_t* data, std::size_t size)
+    {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == slabs_.size()) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        auto& slab = slabs_[tail & mask_];
+        if (slab.data.size() < size)
+            slab.data.resize(std::max(size, SLAB_SIZE));
+        std::memcpy(slab.data.data(), data, size);
+        slab.size = size;
+        // Sequentially consistent, to pair with consumers checking empty() before sleeping
+        tail_.store(tail + 1);
+        return true;
+    }
+
+    /**
+     * Consumer: oldest packet, valid until pop(). Must not be empty.
+     */
+    Packet front() const
+    {
+        const auto& slab = slabs_[head_.load(std::memory_order_relaxed) & mask_];
+        return {slab.data.data(), slab.size};
+    }
+
+    /**
+     * Consumer: release the oldest packet
+     */
+    void pop() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    bool empty() const { return head_.load(std::memory_order_relaxed) == tail_.load(); }
+    std::size_t size() const { return tail_.load() - head_.load(); }
+    std::size_t capacity() const { return slabs_.size(); }
+    /** Number of packets dropped because the queue was full */
+    std::size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    NON_COPYABLE(PacketRing);
+
+    struct Slab
+    {
+        std::vector<uint8_t> data;
+        std::size_t size {0};
+    };
+
+    std::vector<Slab> slabs_;
+    const std::size_t mask_;
+    // Producer and consumer indexes on separate cache lines
+    alignas(64) std::atomic<std::size_t> head_ {0};
+    alignas(64) std::atomic<std::size_t> tail_ {0};
+    std::atomic<std::size_t> dropped_ {0};
+};
+
+} // namespace tls
+} // namespace jami
@@ -24,6 +24,8 @@
 #include <connectivity/ip_utils.h> // DO NOT CHANGE ORDER OF THIS INCLUDE OR MINGWIN FAILS TO BUILD
 
 #include "tls_session.h"
+#include "tls_session_cache.h"
+#include "packet_ring.h"
 
 #include "threadloop.h"
 #include "logger.h"
@@ -31,6 +33,7 @@
 #include "compiler_intrinsics.h"
 #include "manager.h"
 #include "certstore.h"
+#include "metrics.h"
 #include "scheduled_executor.h"
 
 #include <gnutls/gnutls.h>
@@ -83,7 +86,7 @@ static constexpr const char* TLS_FULL_PRIORITY_STRING {
     "GROUP-FFDHE8192:+GROUP-X25519:%SERVER_PRECEDENCE:%SAFE_RENEGOTIATION"};
 static constexpr uint32_t RX_MAX_SIZE {64 * 1024}; // 64k = max size of a UDP packet
 static constexpr std::size_t INPUT_MAX_SIZE {
-    1000}; // Maximum number of packets to store before dropping (pkt size = DTLS_MTU)
+    1024}; // Maximum number of packets to store before dropping (pkt size = DTLS_MTU), power of two
 static constexpr ssize_t FLOOD_THRESHOLD {4 * 1024};
 static constexpr auto FLOOD_PAUSE = std::chrono::milliseconds(
     100); // Time to wait after an invalid cookie packet (anti flood attack)
@@ -199,6 +202,57 @@ private:
     T creds_;
 };
 
+/**
+ * Bounds the number of concurrent handshakes, so that a burst of connections
+ * (e.g. after a network change) leaves CPU time to media threads.
+ * A slot is only held while GnuTLS computes: sessions give it back while
+ * waiting for their peer, which may be waiting for a slot too.
+ */
+class HandshakeGate
+{
+public:
+    static HandshakeGate& instance()
+    {
+        // Intentionally leaked: used by TLS threads until the end of the process
+        static auto* gate = new HandshakeGate(std::max(1u, std::thread::hardware_concurrency() / 2));
+        return *gate;
+    }
+
+    explicit HandshakeGate(unsigned slots)
+        : slots_(slots)
+    {}
+
+    /// Wait for a free slot, or until cancelled() returns true.
+    /// \return true if a slot was acquired
+    template<typename Cancelled>
+    bool acquire(Cancelled&& cancelled)
+    {
+        std::unique_lock<std::mutex> lk(mutex_);
+        while (slots_ == 0) {
+            if (cancelled())
+                return false;
+            cv_.wait_for(lk, std::chrono::milliseconds(100));
+        }
+        --slots_;
+        return true;
+    }
+
+    void release()
+    {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            ++slots_;
+        }
+        cv_.notify_one();
+    }
+
+private:
+    NON_COPYABLE(HandshakeGate);
+    std::mutex mutex_ {};
+    std::condition_variable cv_ {};
+    unsigned slots_;
+};
+
 } // namespace
 
 //==============================================================================
@@ -245,9 +299,14 @@ public:
     std::atomic<int> maxPayload_ {-1};
 
     // IO GnuTLS <-> ICE
+    // rxQueue_ is filled by the transport thread and consumed by the FSM thread.
+    // rxMutex_ and rxCv_ are only used to sleep: the transport thread only takes
+    // the lock to wake the FSM thread if it is waiting.
     std::mutex rxMutex_ {};
     std::condition_variable rxCv_ {};
-    std::list<std::vector<ValueType>> rxQueue_ {};
+    PacketRing rxQueue_ {INPUT_MAX_SIZE};
+    std::atomic_bool rxWaiting_ {false};
+    void notifyRx();
 
     bool flushProcessing_ {false};     ///< protect against recursive call to flushRxQueue
     std::vector<ValueType> rawPktBuf_; ///< gnutls incoming packet buffer
@@ -263,6 +322,7 @@ public:
     ssize_t sendRawVec(const giovec_t*, int);
     ssize_t recvRaw(void*, size_t);
     int waitForRawData(std::chrono::milliseconds);
+    int waitForTransportData(std::chrono::milliseconds);
 
     bool initFromRecordState(int offset = 0);
     void handleDataPacket(std::vector<ValueType>&&, uint64_t);
@@ -271,7 +331,6 @@ public:
     // Statistics
     std::atomic<std::size_t> stRxRawPacketCnt_ {0};
     std::atomic<std::size_t> stRxRawBytesCnt_ {0};
-    std::atomic<std::size_t> stRxRawPacketDropCnt_ {0};
     std::atomic<std::size_t> stTxRawPacketCnt_ {0};
     std::atomic<std::size_t> stTxRawBytesCnt_ {0};
     void dump_io_stats() const;
@@ -292,6 +351,15 @@ public:
     void initCredentials();
     bool commonSessionInit();
 
+    // Session resumption and handshake statistics
+    void storeSession();
+    bool acquireHandshakeSlot();
+    void releaseHandshakeSlot();
+    bool handshakeSlot_ {false}; ///< FSM thread only
+    clock::time_point handshakeStart_ {};
+    std::atomic<duration> handshakeDuration_ {duration::zero()};
+    std::atomic_bool resumed_ {false};
+
     std::shared_ptr<dht::crypto::Certificate> peerCertificate(gnutls_session_t session) const;
 
     /*
@@ -347,15 +415,15 @@ TlsSession::TlsSessionImpl::TlsSessionImpl(std::unique_ptr<SocketType>&& transpo
 {
     if (not transport_->isReliable()) {
         transport_->setOnRecv([this](const ValueType* buf, size_t len) {
-            std::lock_guard<std::mutex> lk {rxMutex_};
-            if (rxQueue_.size() == INPUT_MAX_SIZE) {
-                rxQueue_.pop_front(); // drop oldest packet if input buffer is full
-                ++stRxRawPacketDropCnt_;
+            static auto& dropped = metrics::counter("tls.rx.dropped");
+            // drop new packets if input buffer is full
+            if (not rxQueue_.push(buf, len)) {
+                dropped.inc();
+                return len;
             }
-            rxQueue_.emplace_back(buf, buf + len);
             ++stRxRawPacketCnt_;
             stRxRawBytesCnt_ += len;
-            rxCv_.notify_one();
+            notifyRx();
             return len;
         });
     }
@@ -383,13 +451,42 @@ TlsSession::TlsSessionImpl::typeName() const
 void
 TlsSession::TlsSessionImpl::dump_io_stats() const
 {
-    JAMI_DBG("[TLS] RxRawPkt=%zu (%zu bytes) - TxRawPkt=%zu (%zu bytes)",
+    JAMI_DBG("[TLS] RxRawPkt=%zu (%zu bytes, %zu dropped) - TxRawPkt=%zu (%zu bytes)",
              stRxRawPacketCnt_.load(),
              stRxRawBytesCnt_.load(),
+             rxQueue_.dropped(),
              stTxRawPacketCnt_.load(),
              stTxRawBytesCnt_.load());
 }
 
+namespace {
+// Tell the transport thread that the FSM thread is waiting for packets
+class RxWaiting
+{
+public:
+    explicit RxWaiting(std::atomic_bool& waiting)
+        : waiting_(waiting)
+    {
+        waiting_ = true;
+    }
+    ~RxWaiting() { waiting_ = false; }
+
+private:
+    std::atomic_bool& waiting_;
+};
+} // namespace
+
+void
+TlsSession::TlsSessionImpl::notifyRx()
+{
+    // Sequentially consistent with the queue: either the waiting FSM thread sees the
+    // packet before sleeping, or we see it waiting.
+    if (rxWaiting_) {
+        std::lock_guard<std::mutex> lk {rxMutex_};
+        rxCv_.notify_one();
+    }
+}
+
 TlsSessionState
 TlsSession::TlsSessionImpl::setupClient()
 {
@@ -413,6 +510,28 @@ TlsSession::TlsSessionImpl::setupClient()
         return TlsSessionState::SHUTDOWN;
     }
 
+    if (not params_.resumption_id.empty()) {
+        auto& cache = TlsSessionCache::instance();
+        auto data = cache.get(params_.resumption_id);
+        if (not data.empty()
+            and gnutls_session_set_data(session_, data.data(), data.size()) != GNUTLS_E_SUCCESS)
+            cache.erase(params_.resumption_id);
+#if GNUTLS_VERSION_NUMBER >= 0x030605
+        // TLS 1.3 tickets are sent after the handshake
+        gnutls_handshake_set_hook_function(
+            session_,
+            GNUTLS_HANDSHAKE_NEW_SESSION_TICKET,
+            GNUTLS_HOOK_POST,
+            [](gnutls_session_t session, unsigned, unsigned, unsigned incoming, const gnutls_datum_t*) {
+                if (incoming and gnutls_protocol_get_version(session) == GNUTLS_TLS1_3) {
+                    auto this_ = reinterpret_cast<TlsSessionImpl*>(gnutls_session_get_ptr(session));
+                    this_->storeSession();
+                }
+                return 0;
+            });
+#endif
+    }
+
     return TlsSessionState::HANDSHAKE;
 }
 
@@ -443,6 +562,16 @@ TlsSession::TlsSessionImpl::setupServer()
     if (not commonSessionInit())
         return TlsSessionState::SHUTDOWN;
 
+    // Let known clients resume their sessions
+    auto ticketKey = TlsSessionCache::instance().ticketKey();
+    if (ticketKey.data) {
+        gnutls_session_ticket_enable_server(session_, &ticketKey);
+        gnutls_db_set_cache_expiration(session_,
+                                       std::chrono::duration_cast<std::chrono::seconds>(
+                                           TlsSessionCache::SESSION_LIFETIME)
+                                           .count());
+    }
+
     return TlsSessionState::HANDSHAKE;
 }
 
@@ -689,7 +818,13 @@ TlsSession::TlsSessionImpl::verifyCertificateWrapper(gnutls_session_t session)
             v.set_value(status);
         }
     });
+    // The OCSP responder is remote: don't hold a handshake slot meanwhile
+    auto hadSlot = handshakeSlot_;
+    if (hadSlot)
+        releaseHandshakeSlot();
     f.wait();
+    if (hadSlot and not acquireHandshakeSlot())
+        return GNUTLS_E_INTERRUPTED;
 
     return f.get();
 }
@@ -926,16 +1061,16 @@ TlsSession::TlsSessionImpl::recvRaw(void* buf, size_t size)
         return -1;
     }
 
-    std::lock_guard<std::mutex> lk {rxMutex_};
     if (rxQueue_.empty()) {
         gnutls_transport_set_errno(session_, EAGAIN);
         return -1;
     }
 
-    const auto& pkt = rxQueue_.front();
-    const std::size_t count = std::min(pkt.size(), size);
-    std::copy_n(pkt.begin(), count, reinterpret_cast<ValueType*>(buf));
-    rxQueue_.pop_front();
+    // Read directly from the queue slab
+    auto pkt = rxQueue_.front();
+    const std::size_t count = std::min(pkt.size, size);
+    std::memcpy(buf, pkt.data, count);
+    rxQueue_.pop();
     return count;
 }
 
@@ -944,6 +1079,22 @@ TlsSession::TlsSessionImpl::recvRaw(void* buf, size_t size)
 // Should return 0 on timeout, a positive number if data are available for read, or -1 on error.
 int
 TlsSession::TlsSessionImpl::waitForRawData(std::chrono::milliseconds timeout)
+{
+    if (not handshakeSlot_)
+        return waitForTransportData(timeout);
+
+    // Let other handshakes run while the peer answers
+    releaseHandshakeSlot();
+    auto ret = waitForTransportData(timeout);
+    if (not acquireHandshakeSlot()) {
+        gnutls_transport_set_errno(session_, EINTR);
+        return -1;
+    }
+    return ret;
+}
+
+int
+TlsSession::TlsSessionImpl::waitForTransportData(std::chrono::milliseconds timeout)
 {
     if (transport_->isReliable()) {
         std::error_code ec;
@@ -965,6 +1116,7 @@ TlsSession::TlsSessionImpl::waitForRawData(std::chrono::milliseconds timeout)
 
     // non-reliable uses callback installed with setOnRecv()
     std::unique_lock<std::mutex> lk {rxMutex_};
+    RxWaiting waiting {rxWaiting_};
     rxCv_.wait_for(lk, timeout, [this] {
         return !rxQueue_.empty() or state_ == TlsSessionState::SHUTDOWN;
     });
@@ -1044,6 +1196,9 @@ TlsSession::TlsSessionImpl::cleanup()
     if (cookie_key_.data)
         gnutls_free(cookie_key_.data);
 
+    if (auto dropped = rxQueue_.dropped())
+        JAMI_WARNING("[TLS] {} received packets dropped (input buffer full)", dropped);
+
     transport_->shutdown();
 }
 
@@ -1051,6 +1206,7 @@ TlsSessionState
 TlsSession::TlsSessionImpl::handleStateSetup(UNUSED TlsSessionState state)
 {
     JAMI_DBG("[TLS] Start %s session", typeName());
+    handshakeStart_ = clock::now();
 
     try {
         if (anonymous_)
@@ -1081,6 +1237,7 @@ TlsSession::TlsSessionImpl::handleStateCookie(TlsSessionState state)
     {
         // block until rx packet or shutdown
         std::unique_lock<std::mutex> lk {rxMutex_};
+        RxWaiting waiting {rxWaiting_};
         if (!rxCv_.wait_for(lk, COOKIE_TIMEOUT, [this] {
                 return !rxQueue_.empty() or state_ == TlsSessionState::SHUTDOWN;
             })) {
@@ -1090,7 +1247,7 @@ TlsSession::TlsSessionImpl::handleStateCookie(TlsSessionState state)
         // Shutdown state?
         if (rxQueue_.empty())
             return TlsSessionState::SHUTDOWN;
-        count = rxQueue_.front().size();
+        count = rxQueue_.front().size;
     }
 
     // Total bytes rx during cookie checking (see flood protection below)
@@ -1100,10 +1257,14 @@ TlsSession::TlsSessionImpl::handleStateCookie(TlsSessionState state)
 
     // Peek and verify front packet
     {
-        std::lock_guard<std::mutex> lk {rxMutex_};
-        auto& pkt = rxQueue_.front();
+        auto pkt = rxQueue_.front();
         std::memset(&prestate_, 0, sizeof(prestate_));
-        ret = gnutls_dtls_cookie_verify(&cookie_key_, nullptr, 0, pkt.data(), pkt.size(), &prestate_);
+        ret = gnutls_dtls_cookie_verify(&cookie_key_,
+                                        nullptr,
+                                        0,
+                                        const_cast<uint8_t*>(pkt.data),
+                                        pkt.size,
+                                        &prestate_);
     }
 
     if (ret < 0) {
@@ -1118,10 +1279,7 @@ TlsSession::TlsSessionImpl::handleStateCookie(TlsSessionState state)
                                 });
 
         // Drop front packet
-        {
-            std::lock_guard<std::mutex> lk {rxMutex_};
-            rxQueue_.pop_front();
-        }
+        rxQueue_.pop();
 
         // Cookie may be sent on multiple network packets
         // So we retry until we get a valid cookie.
@@ -1146,11 +1304,16 @@ TlsSession::TlsSessionImpl::handleStateHandshake(TlsSessionState state)
     int ret;
     size_t retry_count = 0;
     JAMI_DEBUG("[TLS] handshake");
+
+    if (not acquireHandshakeSlot())
+        return TlsSessionState::SHUTDOWN;
     do {
         ret = gnutls_handshake(session_);
     } while ((ret == GNUTLS_E_INTERRUPTED or ret == GNUTLS_E_AGAIN)
              and ++retry_count < HANDSHAKE_MAX_RETRY
              and state_.load() != TlsSessionState::SHUTDOWN);
+    if (handshakeSlot_)
+        releaseHandshakeSlot();
     if (retry_count > 0) {
         JAMI_ERROR("[TLS] handshake retried count: {}", retry_count);
     }
@@ -1220,6 +1383,34 @@ TlsSession::TlsSessionImpl::handleStateHandshake(TlsSessionState state)
         return TlsSessionState::SHUTDOWN;
     }
 
+    if (gnutls_session_is_resumed(session_)) {
+        // Certificates are not verified on resumption: check the peer is still accepted
+        resumed_ = true;
+        if (callbacks_.verifyCertificate
+            and callbacks_.verifyCertificate(session_) != GNUTLS_E_SUCCESS) {
+            JAMI_ERROR("[TLS] resumed session refused");
+            if (not params_.resumption_id.empty())
+                TlsSessionCache::instance().erase(params_.resumption_id);
+            return TlsSessionState::SHUTDOWN;
+        }
+        pCert_ = peerCertificate(session_);
+    }
+#if GNUTLS_VERSION_NUMBER >= 0x030605
+    if (gnutls_protocol_get_version(session_) != GNUTLS_TLS1_3)
+#endif
+        storeSession();
+
+    static auto& latency = metrics::histogram("tls.handshake.latency_ms");
+    static auto& fullHandshakes = metrics::counter("tls.handshake.full");
+    static auto& resumedHandshakes = metrics::counter("tls.handshake.resumed");
+    auto elapsed = clock::now() - handshakeStart_;
+    handshakeDuration_ = elapsed;
+    latency.recordDuration(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed));
+    (resumed_ ? resumedHandshakes : fullHandshakes).inc();
+    JAMI_DEBUG("[TLS] {} handshake done in {:d} ms",
+               resumed_ ? "resumed" : "full",
+               duration2ms(elapsed));
+
     // Aware about certificates updates
     if (callbacks_.onCertificatesUpdate) {
         unsigned int remote_count;
@@ -1232,6 +1423,41 @@ TlsSession::TlsSessionImpl::handleStateHandshake(TlsSessionState state)
                                                    : TlsSessionState::MTU_DISCOVERY;
 }
 
+bool
+TlsSession::TlsSessionImpl::acquireHandshakeSlot()
+{
+    static auto& queueDelay = metrics::histogram("tls.handshake.queue_us");
+    auto queued = clock::now();
+    if (not HandshakeGate::instance().acquire([this] {
+            return state_.load() == TlsSessionState::SHUTDOWN
+                   or newState_.load() == TlsSessionState::SHUTDOWN;
+        }))
+        return false;
+    queueDelay.recordDuration(
+        std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - queued));
+    handshakeSlot_ = true;
+    return true;
+}
+
+void
+TlsSession::TlsSessionImpl::releaseHandshakeSlot()
+{
+    handshakeSlot_ = false;
+    HandshakeGate::instance().release();
+}
+
+void
+TlsSession::TlsSessionImpl::storeSession()
+{
+    if (isServer_ or params_.resumption_id.empty())
+        return;
+    gnutls_datum_t data {nullptr, 0};
+    if (gnutls_session_get_data2(session_, &data) != GNUTLS_E_SUCCESS)
+        return;
+    TlsSessionCache::instance().set(params_.resumption_id, {data.data, data.data + data.size});
+    gnutls_free(data.data);
+}
+
 TlsSessionState
 TlsSession::TlsSessionImpl::handleStateMtuDiscovery(UNUSED TlsSessionState state)
 {
@@ -1466,6 +1692,7 @@ TlsSession::TlsSessionImpl::handleStateEstablished(TlsSessionState state)
     // block until rx packet or state change
     {
         std::unique_lock<std::mutex> lk {rxMutex_};
+        RxWaiting waiting {rxWaiting_};
         if (nextFlush_.empty())
             rxCv_.wait(lk, [this] {
                 return state_ != TlsSessionState::ESTABLISHED or not rxQueue_.empty()
@@ -1507,8 +1734,8 @@ TlsSession::TlsSessionImpl::handleStateEstablished(TlsSessionState state)
                 return TlsSessionState::SHUTDOWN;
         }
 
-        rawPktBuf_.resize(ret);
-        handleDataPacket(std::move(rawPktBuf_), array2uint(seq));
+        // Keep the receive buffer, only copy the record
+        handleDataPacket({rawPktBuf_.begin(), rawPktBuf_.begin() + ret}, array2uint(seq));
         // no state change
     } else if (ret == GNUTLS_E_HEARTBEAT_PING_RECEIVED) {
         JAMI_DBG("[TLS] PMTUD: ping received sending pong");
@@ -1704,5 +1931,23 @@ TlsSession::peerCertificate() const
     return pimpl_->pCert_;
 }
 
+std::size_t
+TlsSession::droppedPackets() const
+{
+    return pimpl_->rxQueue_.dropped();
+}
+
+bool
+TlsSession::isResumed() const
+{
+    return pimpl_->resumed_;
+}
+
+duration
+TlsSession::handshakeDuration() const
+{
+    return pimpl_->handshakeDuration_;
+}
+
 } // namespace tls
 } // namespace jami
@@ -80,6 +80,10 @@ struct TlsParams
     // Callback for certificate checkings
     std::function<int(unsigned status, const gnutls_datum_t* cert_list, unsigned cert_list_size)>
         cert_check;
+
+    // Client only: key of the resumable session in TlsSessionCache (empty to disable).
+    // Must identify both the local and the peer identities.
+    std::string resumption_id;
 };
 
 /// TlsSession
@@ -146,6 +150,16 @@ public:
 
     std::shared_ptr<dht::crypto::Certificate> peerCertificate() const;
 
+    /// Number of received packets dropped because the input buffer was full (unreliable
+    /// transports only).
+    std::size_t droppedPackets() const;
+
+    /// Return true if the session was resumed instead of fully negotiated.
+    bool isResumed() const;
+
+    /// Time spent from the session setup to the end of the handshake (0 if not established).
+    duration handshakeDuration() const;
+
 private:
     class TlsSessionImpl;
     std::unique_ptr<TlsSessionImpl> pimpl_;
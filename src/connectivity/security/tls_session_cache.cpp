@@ -0,0 +1,165 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#include "tls_session_cache.h"
+
+#include "fileutils.h"
+#include "logger.h"
+#include "persistence.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace jami {
+namespace tls {
+
+static int64_t
+nowSeconds()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               TlsSessionCache::clock::now().time_since_epoch())
+        .count();
+}
+
+TlsSessionCache&
+TlsSessionCache::instance()
+{
+    // Intentionally leaked: sessions may be stored by threads that outlive static destruction
+    static TlsSessionCache* cache = [] {
+        // Session data are secrets: only readable by the user
+        auto dir = fileutils::get_cache_dir() + DIR_SEPARATOR_STR "tls";
+        fileutils::check_dir(dir.c_str(), 0700);
+        return new TlsSessionCache(dir + DIR_SEPARATOR_STR "sessions");
+    }();
+    return *cache;
+}
+
+TlsSessionCache::TlsSessionCache(std::string path)
+    : path_(std::move(path))
+{
+    load();
+}
+
+bool
+TlsSessionCache::expired(const Session& session, int64_t now) const
+{
+    return now - session.created
+           > std::chrono::duration_cast<std::chrono::seconds>(SESSION_LIFETIME).count();
+}
+
+std::vector<uint8_t>
+TlsSessionCache::get(const std::string& id)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = state_.sessions.find(id);
+    if (it == state_.sessions.end())
+        return {};
+    if (expired(it->second, nowSeconds())) {
+        state_.sessions.erase(it);
+        save();
+        return {};
+    }
+    return it->second.data;
+}
+
+void
+TlsSessionCache::set(const std::string& id, std::vector<uint8_t>&& data)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto now = nowSeconds();
+    auto& session = state_.sessions[id];
+    session.data = std::move(data);
+    session.created = now;
+    if (state_.sessions.size() > MAX_SESSIONS) {
+        // Drop expired sessions, then the oldest ones
+        for (auto it = state_.sessions.begin(); it != state_.sessions.end();) {
+            if (expired(it->second, now))
+                it = state_.sessions.erase(it);
+            else
+                ++it;
+        }
+        while (state_.sessions.size() > MAX_SESSIONS)
+            state_.sessions.erase(std::min_element(state_.sessions.begin(),
+                                                   state_.sessions.end(),
+                                                   [](const auto& a, const auto& b) {
+                                                       return a.second.created < b.second.created;
+                                                   }));
+    }
+    save();
+}
+
+void
+TlsSessionCache::erase(const std::string& id)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (state_.sessions.erase(id))
+        save();
+}
+
+std::size_t
+TlsSessionCache::size() const
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    return state_.sessions.size();
+}
+
+gnutls_datum_t
+TlsSessionCache::ticketKey()
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (state_.key.empty()) {
+        gnutls_datum_t key {nullptr, 0};
+        if (gnutls_session_ticket_key_generate(&key) != GNUTLS_E_SUCCESS)
+            return {nullptr, 0};
+        state_.key.assign(key.data, key.data + key.size);
+        gnutls_memset(key.data, 0, key.size);
+        gnutls_free(key.data);
+        save();
+    }
+    return {state_.key.data(), (unsigned) state_.key.size()};
+}
+
+void
+TlsSessionCache::load()
+{
+    if (path_.empty())
+        return;
+    try {
+        Persistence::instance().flush(path_);
+        std::ifstream file = fileutils::ifstream(path_, std::ios::binary);
+        if (!file.is_open())
+            return;
+        std::string content((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+        msgpack::object_handle oh = msgpack::unpack(content.data(), content.size());
+        oh.get().convert(state_);
+        JAMI_DEBUG("[TLS] Loaded {} resumable sessions", state_.sessions.size());
+    } catch (const std::exception& e) {
+        JAMI_WARNING("[TLS] Unable to load sessions: {}", e.what());
+        state_ = {};
+    }
+}
+
+void
+TlsSessionCache::save()
+{
+    if (not path_.empty())
+        Persistence::instance().writePacked(path_, state_, true);
+}
+
+} // namespace tls
+} // namespace jami
@@ -0,0 +1,99 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#pragma once
+
+#include "noncopyable.h"
+
+#include <gnutls/gnutls.h>
+#include <msgpack.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace jami {
+namespace tls {
+
+/**
+ * TLS session resumption data.
+ *
+ * Clients store the session data of established sessions, keyed by
+ * local and peer identities, to resume them on the next connection.
+ * Servers share a ticket key used to encrypt session tickets.
+ * The cache is bounded and persisted, so that sessions can be resumed
+ * after a restart.
+ */
+class TlsSessionCache
+{
+public:
+    using clock = std::chrono::system_clock;
+    static constexpr std::size_t MAX_SESSIONS {512};
+    /** Also used as the server ticket lifetime */
+    static constexpr std::chrono::hours SESSION_LIFETIME {12};
+
+    static TlsSessionCache& instance();
+
+    /**
+     * @param path  file where the cache is persisted, empty for a memory-only cache
+     */
+    explicit TlsSessionCache(std::string path);
+
+    /**
+     * @return the session data stored for id, empty if none or expired
+     */
+    std::vector<uint8_t> get(const std::string& id);
+    void set(const std::string& id, std::vector<uint8_t>&& data);
+    void erase(const std::string& id);
+    std::size_t size() const;
+
+    /**
+     * Server ticket key, generated on first use
+     */
+    gnutls_datum_t ticketKey();
+
+private:
+    NON_COPYABLE(TlsSessionCache);
+
+    struct Session
+    {
+        std::vector<uint8_t> data;
+        int64_t created {0};
+        MSGPACK_DEFINE_MAP(data, created)
+    };
+
+    struct State
+    {
+        std::vector<uint8_t> key;
+        std::map<std::string, Session> sessions;
+        MSGPACK_DEFINE_MAP(key, sessions)
+    };
+
+    bool expired(const Session& session, int64_t now) const;
+    void load();
+    void save();
+
+    const std::string path_;
+    mutable std::mutex mutex_ {};
+    State state_ {};
+};
+
+} // namespace tls
+} // namespace jami
@@ -34,7 +34,7 @@ constexpr static uint16_t UPNP_TCP_PORT_MAX {UPNP_TCP_PORT_MIN + 5000};
 constexpr static uint16_t UPNP_UDP_PORT_MIN {20000};
 constexpr static uint16_t UPNP_UDP_PORT_MAX {UPNP_UDP_PORT_MIN + 5000};
 
-UPnPContext::UPnPContext()
+UPnPContext::UPnPContext(std::vector<std::shared_ptr<UPnPProtocol>> protocols)
 {
     JAMI_DBG("Creating UPnPContext instance [%p]", this);
 
@@ -43,7 +43,8 @@ UPnPContext::UPnPContext()
     portRange_.emplace(PortType::UDP, std::make_pair(UPNP_UDP_PORT_MIN, UPNP_UDP_PORT_MAX));
 
     if (not isValidThread()) {
-        runOnUpnpContextQueue([this] { init(); });
+        runOnUpnpContextQueue(
+            [this, protocols = std::move(protocols)]() mutable { init(std::move(protocols)); });
         return;
     }
 }
@@ -102,11 +103,19 @@ UPnPContext::~UPnPContext()
 }
 
 void
-UPnPContext::init()
+UPnPContext::init(std::vector<std::shared_ptr<UPnPProtocol>>&& protocols)
 {
     threadId_ = getCurrentThread();
     CHECK_VALID_THREAD();
 
+    if (not protocols.empty()) {
+        for (auto& protocol : protocols) {
+            protocol->setObserver(this);
+            protocolList_.emplace(protocol->getProtocol(), std::move(protocol));
+        }
+        return;
+    }
+
 #if HAVE_LIBNATPMP
     auto natPmp = std::make_shared<NatPmp>();
     natPmp->setObserver(this);
@@ -303,7 +312,7 @@ UPnPContext::getExternalIP() const
 }
 
 Mapping::sharedPtr_t
-UPnPContext::reserveMapping(Mapping& requestedMap)
+UPnPContext::reserveMapping(Mapping& requestedMap, bool openOnly)
 {
     auto desiredPort = requestedMap.getExternalPort();
 
@@ -326,7 +335,8 @@ UPnPContext::reserveMapping(Mapping& requestedMap)
         for (auto const& [_, map] : mappingList) {
             // If the desired port is null, we pick the first available port.
             if (map->isValid() and (desiredPort == 0 or map->getExternalPort() == desiredPort)
-                and map->isAvailable()) {
+                and map->isAvailable()
+                and (not openOnly or map->getState() == MappingState::OPEN)) {
                 // Considere the first available mapping regardless of its
                 // state. A mapping with OPEN state will be used if found.
                 if (not mapRes)
@@ -342,7 +352,11 @@ UPnPContext::reserveMapping(Mapping& requestedMap)
     }
 
     // Create a mapping if none was available.
-    if (not mapRes) {
+    if (not mapRes and openOnly) {
+        // Many callers may ask at once (e.g. transports re-created after a network
+        // change), let the provisioning below request the mappings once for all
+        JAMI_DBG("No open mapping available for [%s]", requestedMap.getTypeStr());
+    } else if (not mapRes) {
         JAMI_WARN("Did not find any available mapping. Will request one now");
         mapRes = registerMapping(requestedMap);
     }
@@ -685,10 +699,10 @@ UPnPContext::updateMappingList(bool async)
     }
 
     // Prune the mapping list if needed
-    if (protocolList_.at(NatProtocolType::PUPNP)->isReady()) {
+    if (isProtocolReady(NatProtocolType::PUPNP)) {
 #if HAVE_LIBNATPMP
         // Dont perform if NAT-PMP is valid.
-        if (not protocolList_.at(NatProtocolType::NAT_PMP)->isReady())
+        if (not isProtocolReady(NatProtocolType::NAT_PMP))
 #endif
         {
             pruneMappingList();
@@ -697,11 +711,18 @@ UPnPContext::updateMappingList(bool async)
 
 #if HAVE_LIBNATPMP
     // Renew nat-pmp allocations
-    if (protocolList_.at(NatProtocolType::NAT_PMP)->isReady())
+    if (isProtocolReady(NatProtocolType::NAT_PMP))
         renewAllocations();
 #endif
 }
 
+bool
+UPnPContext::isProtocolReady(NatProtocolType type) const
+{
+    auto it = protocolList_.find(type);
+    return it != protocolList_.end() and it->second->isReady();
+}
+
 void
 UPnPContext::pruneMappingList()
 {
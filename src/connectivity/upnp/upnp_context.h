@@ -46,6 +46,7 @@
 #include <mutex>
 #include <memory>
 #include <string>
+#include <vector>
 #include <chrono>
 #include <random>
 #include <atomic>
@@ -88,7 +89,8 @@ private:
     };
 
 public:
-    UPnPContext();
+    // Use the given protocols instead of the built-in ones (NAT-PMP, PUPNP), e.g. stand-ins
+    UPnPContext(std::vector<std::shared_ptr<UPnPProtocol>> protocols = {});
     ~UPnPContext();
 
     // Retrieve the UPnPContext singleton.
@@ -110,7 +112,9 @@ public:
     void connectivityChanged();
 
     // Returns a shared pointer of the mapping.
-    Mapping::sharedPtr_t reserveMapping(Mapping& requestedMap);
+    // If openOnly is set, only a mapping already open is provided: no new mapping
+    // is requested for the caller, the pool of provisioned mappings is refilled instead.
+    Mapping::sharedPtr_t reserveMapping(Mapping& requestedMap, bool openOnly = false);
 
     // Release an used mapping (make it available for future use).
     void releaseMapping(const Mapping& map);
@@ -125,7 +129,10 @@ public:
 
 private:
     // Initialization
-    void init();
+    void init(std::vector<std::shared_ptr<UPnPProtocol>>&& protocols);
+
+    // Check if the protocol is used and has a valid IGD.
+    bool isProtocolReady(NatProtocolType type) const;
 
     /**
      * @brief start the search for IGDs activate the mapping
@@ -82,12 +82,12 @@ Controller::reserveMapping(uint16_t port, PortType type)
 }
 
 Mapping::sharedPtr_t
-Controller::reserveMapping(Mapping& requestedMap)
+Controller::reserveMapping(Mapping& requestedMap, bool openOnly)
 {
     assert(upnpContext_);
 
     // Try to get a provisioned port
-    auto mapRes = upnpContext_->reserveMapping(requestedMap);
+    auto mapRes = upnpContext_->reserveMapping(requestedMap, openOnly);
     if (mapRes)
         addLocalMap(*mapRes);
     return mapRes;
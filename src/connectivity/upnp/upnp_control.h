@@ -60,7 +60,8 @@ public:
     // Request port mapping.
     // Returns a shared pointer on the allocated mapping. The shared
     // pointer may point to nothing on failure.
-    Mapping::sharedPtr_t reserveMapping(Mapping& map);
+    // If openOnly is set, only an already open mapping is provided.
+    Mapping::sharedPtr_t reserveMapping(Mapping& map, bool openOnly = false);
     Mapping::sharedPtr_t reserveMapping(uint16_t port, PortType type);
 
     // Remove port mapping.
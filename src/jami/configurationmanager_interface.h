@@ -282,6 +282,20 @@ LIBJAMI_PUBLIC bool isAudioMeterActive(const std::string& id);
  */
 LIBJAMI_PUBLIC void setAudioMeterState(const std::string& id, bool state);
 
+/**
+ * Returns a snapshot of the daemon's internal metrics (counters, gauges and
+ * latency histograms). Histograms are flattened as <name>.count, <name>.sum,
+ * <name>.min, <name>.max, <name>.mean, <name>.p50, <name>.p90 and <name>.p99.
+ */
+LIBJAMI_PUBLIC std::map<std::string, std::string> getMetrics();
+
+/**
+ * Emit a MetricsReport signal every @intervalMs milliseconds.
+ *
+ * NOTE 0 disables periodic reports.
+ */
+LIBJAMI_PUBLIC void setMetricsReportInterval(uint32_t intervalMs);
+
 /**
  * Add/remove default moderator for conferences
  */
@@ -559,6 +573,11 @@ struct LIBJAMI_PUBLIC ConfigurationSignal
         constexpr static const char* name = "MessageSend";
         using cb_type = void(const std::string&);
     };
+    struct LIBJAMI_PUBLIC MetricsReport
+    {
+        constexpr static const char* name = "MetricsReport";
+        using cb_type = void(const std::map<std::string, std::string>& /*metrics*/);
+    };
 };
 
 } // namespace libjami
@@ -63,6 +63,8 @@ LIBJAMI_PUBLIC void toggleChatHandler(const std::string& chatHandlerId,
 LIBJAMI_PUBLIC std::map<std::string, std::string> getCallMediaHandlerDetails(
     const std::string& mediaHandlerId);
 LIBJAMI_PUBLIC std::vector<std::string> getCallMediaHandlerStatus(const std::string& callId);
+LIBJAMI_PUBLIC std::map<std::string, std::string> getCallMediaHandlerStats(
+    const std::string& callId);
 LIBJAMI_PUBLIC std::map<std::string, std::string> getChatHandlerDetails(
     const std::string& chatHandlerId);
 LIBJAMI_PUBLIC std::vector<std::string> getChatHandlerStatus(const std::string& accountId,
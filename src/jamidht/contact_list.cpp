@@ -19,6 +19,7 @@
 #include "logger.h"
 #include "jamiaccount.h"
 #include "fileutils.h"
+#include "persistence.h"
 
 #ifdef ENABLE_PLUGIN
 #include "manager.h"
@@ -47,6 +48,10 @@ ContactList::~ContactList() {}
 void
 ContactList::load()
 {
+    auto& persistence = Persistence::instance();
+    persistence.flush(path_ + DIR_SEPARATOR_STR "contacts");
+    persistence.flush(path_ + DIR_SEPARATOR_STR "incomingTrustRequests");
+    persistence.flush(path_ + DIR_SEPARATOR_STR "knownDevices");
     loadContacts();
     loadTrustRequests();
     loadKnownDevices();
@@ -235,16 +240,14 @@ ContactList::loadContacts()
 void
 ContactList::saveContacts() const
 {
-    std::ofstream file(path_ + DIR_SEPARATOR_STR "contacts", std::ios::trunc | std::ios::binary);
-    msgpack::pack(file, contacts_);
+    Persistence::instance().writePacked(path_ + DIR_SEPARATOR_STR "contacts", contacts_);
 }
 
 void
 ContactList::saveTrustRequests() const
 {
-    std::ofstream file(path_ + DIR_SEPARATOR_STR "incomingTrustRequests",
-                       std::ios::trunc | std::ios::binary);
-    msgpack::pack(file, trustRequests_);
+    Persistence::instance().writePacked(path_ + DIR_SEPARATOR_STR "incomingTrustRequests",
+                                        trustRequests_);
 }
 
 void
@@ -449,14 +452,12 @@ ContactList::loadKnownDevices()
 void
 ContactList::saveKnownDevices() const
 {
-    std::ofstream file(path_ + DIR_SEPARATOR_STR "knownDevices", std::ios::trunc | std::ios::binary);
-
     std::map<dht::PkId, std::pair<std::string, uint64_t>> devices;
     for (const auto& id : knownDevices_)
         devices.emplace(id.first,
                         std::make_pair(id.second.name, clock::to_time_t(id.second.last_sync)));
 
-    msgpack::pack(file, devices);
+    Persistence::instance().writePacked(path_ + DIR_SEPARATOR_STR "knownDevices", devices);
 }
 
 void
@@ -21,6 +21,7 @@
 
 #include "account_const.h"
 #include "fileutils.h"
+#include "persistence.h"
 #include "jamiaccount.h"
 #include "client/ring_signal.h"
 
@@ -430,6 +431,7 @@ public:
     {
         try {
             // read file
+            Persistence::instance().flush(fetchedPath_);
             auto file = fileutils::loadFile(fetchedPath_);
             // load values
             msgpack::object_handle oh = msgpack::unpack((const char*) file.data(), file.size());
@@ -441,14 +443,14 @@ public:
     }
     void saveFetched()
     {
-        std::ofstream file(fetchedPath_, std::ios::trunc | std::ios::binary);
-        msgpack::pack(file, fetchedDevices_);
+        Persistence::instance().writePacked(fetchedPath_, fetchedDevices_);
     }
 
     void loadSending()
     {
         try {
             // read file
+            Persistence::instance().flush(sendingPath_);
             auto file = fileutils::loadFile(sendingPath_);
             // load values
             msgpack::object_handle oh = msgpack::unpack((const char*) file.data(), file.size());
@@ -460,14 +462,14 @@ public:
     }
     void saveSending()
     {
-        std::ofstream file(sendingPath_, std::ios::trunc | std::ios::binary);
-        msgpack::pack(file, sending_);
+        Persistence::instance().writePacked(sendingPath_, sending_);
     }
 
     void loadLastDisplayed() const
     {
         try {
             // read file
+            Persistence::instance().flush(lastDisplayedPath_);
             auto file = fileutils::loadFile(lastDisplayedPath_);
             // load values
             msgpack::object_handle oh = msgpack::unpack((const char*) file.data(), file.size());
@@ -480,14 +482,14 @@ public:
 
     void saveLastDisplayed() const
     {
-        std::ofstream file(lastDisplayedPath_, std::ios::trunc | std::ios::binary);
-        msgpack::pack(file, lastDisplayed_);
+        Persistence::instance().writePacked(lastDisplayedPath_, lastDisplayed_);
     }
 
     void loadActiveCalls() const
     {
         try {
             // read file
+            Persistence::instance().flush(activeCallsPath_);
             auto file = fileutils::loadFile(activeCallsPath_);
             // load values
             msgpack::object_handle oh = msgpack::unpack((const char*) file.data(), file.size());
@@ -500,14 +502,14 @@ public:
 
     void saveActiveCalls() const
     {
-        std::ofstream file(activeCallsPath_, std::ios::trunc | std::ios::binary);
-        msgpack::pack(file, activeCalls_);
+        Persistence::instance().writePacked(activeCallsPath_, activeCalls_);
     }
 
     void loadHostedCalls() const
     {
         try {
             // read file
+            Persistence::instance().flush(hostedCallsPath_);
             auto file = fileutils::loadFile(hostedCallsPath_);
             // load values
             msgpack::object_handle oh = msgpack::unpack((const char*) file.data(), file.size());
@@ -520,8 +522,7 @@ public:
 
     void saveHostedCalls() const
     {
-        std::ofstream file(hostedCallsPath_, std::ios::trunc | std::ios::binary);
-        msgpack::pack(file, hostedCalls_);
+        Persistence::instance().writePacked(hostedCallsPath_, hostedCalls_);
     }
 
     void voteUnban(const std::string& contactUri, const std::string& type, const OnDoneCb& cb);
@@ -1265,8 +1266,11 @@ Conversation::isRemoving()
 void
 Conversation::erase()
 {
-    if (pimpl_->conversationDataPath_ != "")
+    if (pimpl_->conversationDataPath_ != "") {
+        // A queued write would recreate the files after removal
+        Persistence::instance().discard(pimpl_->conversationDataPath_);
         fileutils::removeAll(pimpl_->conversationDataPath_, true);
+    }
     if (!pimpl_->repository_)
         return;
     std::lock_guard<std::mutex> lk(pimpl_->writeMtx_);
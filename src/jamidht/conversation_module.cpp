@@ -20,7 +20,11 @@
 
 #include "conversation_module.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <thread>
 
 #include <opendht/thread_pool.h>
 
@@ -28,6 +32,7 @@
 #include "call.h"
 #include "client/ring_signal.h"
 #include "fileutils.h"
+#include "persistence.h"
 #include "jamidht/account_manager.h"
 #include "jamidht/jamiaccount.h"
 #include "manager.h"
@@ -516,6 +521,7 @@ ConversationModule::Impl::checkConversationsEvents()
     bool hasHandler = conversationsEventHandler and not conversationsEventHandler->isCancelled();
     if (not pendingConversationsFetch_.empty() and not hasHandler) {
         conversationsEventHandler = Manager::instance().scheduler().scheduleAtFixedRate(
+            ScheduledExecutor::key(accountId_),
             [w = weak()] {
                 if (auto this_ = w.lock())
                     return this_->handlePendingConversations();
@@ -924,11 +930,8 @@ void
 ConversationModule::saveConvRequestsToPath(
     const std::string& path, const std::map<std::string, ConversationRequest>& conversationsRequests)
 {
-    std::lock_guard<std::mutex> lock(
-        fileutils::getFileLock(path + DIR_SEPARATOR_STR + "convRequests"));
-    std::ofstream file(path + DIR_SEPARATOR_STR + "convRequests",
-                       std::ios::trunc | std::ios::binary);
-    msgpack::pack(file, conversationsRequests);
+    Persistence::instance().writePacked(path + DIR_SEPARATOR_STR + "convRequests",
+                                        conversationsRequests);
 }
 
 void
@@ -941,8 +944,7 @@ ConversationModule::saveConvInfos(const std::string& accountId, const ConvInfoMa
 void
 ConversationModule::saveConvInfosToPath(const std::string& path, const ConvInfoMap& conversations)
 {
-    std::ofstream file(path + DIR_SEPARATOR_STR + "convInfo", std::ios::trunc | std::ios::binary);
-    msgpack::pack(file, conversations);
+    Persistence::instance().writePacked(path + DIR_SEPARATOR_STR + "convInfo", conversations);
 }
 
 ////////////////////////////////////////////////////////////////
@@ -972,13 +974,52 @@ ConversationModule::loadConversations()
     auto conversationsRepositories = fileutils::readDirectory(
         fileutils::get_data_dir() + DIR_SEPARATOR_STR + pimpl_->accountId_ + DIR_SEPARATOR_STR
         + "conversations");
+
+    // Open repositories in parallel, without conversationsMtx_ as this is the longest part
+    auto count = conversationsRepositories.size();
+    std::vector<std::shared_ptr<Conversation>> loaded(count);
+    std::atomic_size_t next {0};
+    auto loadNext = [&] {
+        for (std::size_t i; (i = next++) < count;) {
+            const auto& repository = conversationsRepositories[i];
+            try {
+                loaded[i] = std::make_shared<Conversation>(pimpl_->account_, repository);
+            } catch (const std::exception& e) {
+                JAMI_WARN("[Account %s] Conversations not loaded : %s",
+                          pimpl_->accountId_.c_str(),
+                          e.what());
+            }
+        }
+    };
+    auto workers = std::min<std::size_t>(count,
+                                         std::clamp(std::thread::hardware_concurrency(), 1u, 8u));
+    std::mutex loadMtx;
+    std::condition_variable loadCv;
+    std::size_t running = workers > 1 ? workers - 1 : 0;
+    for (std::size_t w = 1; w < workers; ++w) {
+        dht::ThreadPool::io().run([&] {
+            loadNext();
+            std::lock_guard<std::mutex> lk(loadMtx);
+            if (--running == 0)
+                loadCv.notify_all();
+        });
+    }
+    loadNext();
+    {
+        std::unique_lock<std::mutex> lk(loadMtx);
+        loadCv.wait(lk, [&] { return running == 0; });
+    }
+
     std::unique_lock<std::mutex> lk(pimpl_->conversationsMtx_);
     pimpl_->convInfos_ = convInfos(pimpl_->accountId_);
     pimpl_->conversations_.clear();
     std::set<std::string> toRm;
-    for (const auto& repository : conversationsRepositories) {
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto& repository = conversationsRepositories[i];
+        auto& conv = loaded[i];
+        if (!conv)
+            continue;
         try {
-            auto conv = std::make_shared<Conversation>(pimpl_->account_, repository);
             auto members = conv->memberUris(uri, {});
             // NOTE: The following if is here to protect against any incorrect state
             // that can be introduced
@@ -2381,8 +2422,7 @@ ConversationModule::convInfosFromPath(const std::string& path)
     std::map<std::string, ConvInfo> convInfos;
     try {
         // read file
-        std::lock_guard<std::mutex> lock(
-            fileutils::getFileLock(path + DIR_SEPARATOR_STR + "convInfo"));
+        Persistence::instance().flush(path + DIR_SEPARATOR_STR + "convInfo");
         auto file = fileutils::loadFile("convInfo", path);
         // load values
         msgpack::object_handle oh = msgpack::unpack((const char*) file.data(), file.size());
@@ -2406,8 +2446,7 @@ ConversationModule::convRequestsFromPath(const std::string& path)
     std::map<std::string, ConversationRequest> convRequests;
     try {
         // read file
-        std::lock_guard<std::mutex> lock(
-            fileutils::getFileLock(path + DIR_SEPARATOR_STR + "convRequests"));
+        Persistence::instance().flush(path + DIR_SEPARATOR_STR + "convRequests");
         auto file = fileutils::loadFile("convRequests", path);
         // load values
         msgpack::object_handle oh = msgpack::unpack((const char*) file.data(), file.size());
@@ -44,7 +44,18 @@ struct SyncMsg
     std::map<std::string, std::map<std::string, std::string>> p;
     // Last displayed messages
     std::map<std::string, std::map<std::string, std::string>> ld;
-    MSGPACK_DEFINE(ds, c, cr, p, ld)
+    // Incremental sync, ignored by older versions.
+    // v is the version of the sender's sync state (0 for legacy full syncs),
+    // s the version the delta is based on and n the number of batches left.
+    uint64_t v {0};
+    uint64_t s {0};
+    uint32_t n {0};
+    // If ack is set, a is the last version of the receiver's state applied by the sender
+    bool ack {false};
+    uint64_t a {0};
+    // Compressed SyncMsg holding the payload
+    std::vector<uint8_t> z;
+    MSGPACK_DEFINE(ds, c, cr, p, ld, v, s, n, ack, a, z)
 };
 
 using ChannelCb = std::function<bool(const std::shared_ptr<ChannelSocket>&)>;
@@ -22,26 +22,54 @@
 #include "jamiaccount.h"
 #include "fileutils.h"
 #include "gittransport.h"
+#include "persistence.h"
 #include "string_utils.h"
 #include "client/ring_signal.h"
 #include "vcard.h"
 
 using random_device = dht::crypto::random_device;
 
+#include <opendht/thread_pool.h>
+
+#include <atomic>
+#include <condition_variable>
 #include <ctime>
 #include <fstream>
 #include <future>
 #include <json/json.h>
+#include <msgpack.hpp>
 #include <regex>
 #include <exception>
 #include <optional>
+#include <thread>
+#include <unordered_set>
 
 using namespace std::string_view_literals;
 constexpr auto DIFF_REGEX = " +\\| +[0-9]+.*"sv;
 constexpr size_t MAX_FETCH_SIZE {256 * 1024 * 1024}; // 256Mb
+// Stored in the git directory, so it is never committed nor synced
+constexpr auto METADATA_FILE = "conversation_metadata"sv;
 
 namespace jami {
 
+/**
+ * Snapshot of the data needed to load a conversation without reading the repository.
+ * Members are only valid for the head they were computed at. Mode and initial members
+ * come from the initial commit, so they never change.
+ */
+struct RepositoryMetadata
+{
+    static constexpr int VERSION = 1;
+
+    int version {VERSION};
+    std::string head;
+    int mode {-1};
+    std::vector<std::pair<std::string, int>> members;
+    std::vector<std::string> initialMembers;
+
+    MSGPACK_DEFINE_MAP(version, head, mode, members, initialMembers)
+};
+
 static const std::regex regex_display_name("<|>");
 
 inline std::string_view
@@ -58,6 +86,59 @@ as_view(const GitObject& blob)
 
 enum class CallbackResult { Skip, Break, Ok };
 
+/**
+ * Run fn(i) for every i in [0, count) on the computation pool and the calling thread.
+ * Returns once all calls are done. Pool jobs starting after all indexes are taken
+ * return immediately, so waiting never depends on a busy pool.
+ */
+template<typename Fn>
+static void
+parallelFor(std::size_t count, Fn&& fn)
+{
+    struct State
+    {
+        std::atomic_size_t next {0};
+        std::mutex mtx {};
+        std::condition_variable cv {};
+        std::size_t running {0};
+    };
+    auto state = std::make_shared<State>();
+    auto* f = &fn;
+    auto run = [state, count, f] {
+        {
+            std::lock_guard<std::mutex> lk(state->mtx);
+            if (state->next >= count)
+                return;
+            ++state->running;
+        }
+        for (std::size_t i; (i = state->next++) < count;)
+            (*f)(i);
+        std::lock_guard<std::mutex> lk(state->mtx);
+        if (--state->running == 0)
+            state->cv.notify_all();
+    };
+    auto helpers = std::min<std::size_t>(count, std::thread::hardware_concurrency());
+    for (std::size_t i = 1; i < helpers; ++i)
+        dht::ThreadPool::computation().run(run);
+    for (std::size_t i; (i = state->next++) < count;)
+        fn(i);
+    std::unique_lock<std::mutex> lk(state->mtx);
+    state->cv.wait(lk, [&] { return state->running == 0; });
+}
+
+/**
+ * Devices whose certificates were validated by the commits being checked, with the index
+ * of the first commit validating them. Commit checks run in parallel, so a check can't
+ * rely on the certificates pinned by previous commits and uses this instead.
+ * Set by validCommits() on the thread checking a commit.
+ */
+struct ValidatedDevices
+{
+    const std::map<std::string, std::pair<std::string, std::size_t>>* devices {nullptr};
+    std::size_t commitIndex {0};
+};
+static thread_local ValidatedDevices validatedDevices {};
+
 using PreConditionCb
     = std::function<CallbackResult(const std::string&, const GitAuthor&, const GitCommit&)>;
 using PostConditionCb
@@ -70,7 +151,8 @@ public:
         : account_(account)
         , id_(id)
     {
-        initMembers();
+        if (!loadMetadata())
+            initMembers();
     }
 
     // NOTE! We use temporary GitRepository to avoid to keep file opened (TODO check why
@@ -115,7 +197,34 @@ public:
                    const std::string& commitId,
                    const std::string& parentId) const;
     bool checkEdit(const std::string& userDevice, const ConversationCommit& commit) const;
-    bool isValidUserAtCommit(const std::string& userDevice, const std::string& commitId) const;
+    /**
+     * Certificates of a commit author, read from the commit tree
+     */
+    struct UserAtCommit
+    {
+        bool valid {false};
+        std::string userUri {};
+        std::shared_ptr<dht::crypto::Certificate> deviceCert {};
+        std::shared_ptr<dht::crypto::Certificate> userCert {};
+    };
+    /**
+     * Check that a device and its user are members at a commit. Doesn't pin certificates.
+     */
+    UserAtCommit userAtCommit(const std::string& userDevice, const std::string& commitId) const;
+    void pinUserAtCommit(const std::string& userDevice, const UserAtCommit& user) const;
+    /**
+     * Parse a certificate blob, parsed certificates are cached by blob oid
+     */
+    std::shared_ptr<dht::crypto::Certificate> certificate(const GitObject& blob) const;
+    /**
+     * Check the content of a commit, depending on its type.
+     * @param error     Set to the error reported to the client if invalid
+     */
+    bool checkCommit(const ConversationCommit& commit, std::string& error) const;
+    /**
+     * @return the commit where the author must be a member, empty for the initial commit
+     */
+    std::string userCommitId(const ConversationCommit& commit) const;
     bool checkInitialCommit(const std::string& userDevice,
                             const std::string& commitId,
                             const std::string& commitMsg) const;
@@ -169,6 +278,14 @@ public:
 
     std::vector<std::string> getInitialMembers() const;
 
+    std::string head(git_repository* repo) const;
+    std::string metadataPath(git_repository* repo) const;
+    bool loadMetadata();
+    /**
+     * @note membersMtx_ must be locked
+     */
+    void saveMetadata(git_repository* repo) const;
+
     bool resolveBan(const std::string_view type, const std::string& uri);
     bool resolveUnban(const std::string_view type, const std::string& uri);
 
@@ -179,6 +296,8 @@ public:
     // Members utils
     mutable std::mutex membersMtx_ {};
     std::vector<ConversationMember> members_ {};
+    mutable std::mutex initialMembersMtx_ {};
+    mutable std::vector<std::string> initialMembers_ {};
 
     std::vector<ConversationMember> members() const
     {
@@ -250,11 +369,19 @@ public:
         if (it != deviceToUri_.end())
             return it->second;
 
+        auto cert = tls::CertificateStore::instance().getCertificate(deviceId);
+        if ((!cert || !cert->issuer) && validatedDevices.devices) {
+            // Validated by a previous commit, but not pinned yet
+            auto itDevice = validatedDevices.devices->find(deviceId);
+            if (itDevice != validatedDevices.devices->end()
+                && itDevice->second.second < validatedDevices.commitIndex)
+                return itDevice->second.first;
+        }
+
         auto repo = repository();
         if (!repo)
             return {};
 
-        auto cert = tls::CertificateStore::instance().getCertificate(deviceId);
         if (!cert || !cert->issuer) {
             // Not pinned, so load certificate from repo
             std::string deviceFile = git_repository_workdir(repo.get())
@@ -272,6 +399,9 @@ public:
     mutable std::mutex deviceToUriMtx_;
     mutable std::map<std::string, std::string> deviceToUri_;
 
+    mutable std::mutex certificatesMtx_ {};
+    mutable std::map<std::string, std::shared_ptr<dht::crypto::Certificate>> certificates_ {};
+
     /**
      * Verify that a certificate modification is correct
      * @param certPath      Where the certificate is saved (relative path)
@@ -1421,37 +1551,60 @@ ConversationRepository::Impl::checkValidProfileUpdate(const std::string& userDev
     return true;
 }
 
-bool
-ConversationRepository::Impl::isValidUserAtCommit(const std::string& userDevice,
-                                                  const std::string& commitId) const
+std::shared_ptr<dht::crypto::Certificate>
+ConversationRepository::Impl::certificate(const GitObject& object) const
+{
+    // Certificates were already checked once pinned, so the cache is only useful while
+    // validating a batch of commits. Keep it small.
+    static constexpr std::size_t MAX_CERTIFICATES = 256;
+    auto* blob = reinterpret_cast<git_blob*>(object.get());
+    auto* oid = git_object_id(object.get());
+    std::string key(reinterpret_cast<const char*>(oid->id), GIT_OID_RAWSZ);
+    {
+        std::lock_guard<std::mutex> lk(certificatesMtx_);
+        auto it = certificates_.find(key);
+        if (it != certificates_.end())
+            return it->second;
+    }
+    auto cert = std::make_shared<dht::crypto::Certificate>(static_cast<const uint8_t*>(
+                                                               git_blob_rawcontent(blob)),
+                                                           git_blob_rawsize(blob));
+    std::lock_guard<std::mutex> lk(certificatesMtx_);
+    if (certificates_.size() >= MAX_CERTIFICATES)
+        certificates_.clear();
+    certificates_.emplace(std::move(key), cert);
+    return cert;
+}
+
+ConversationRepository::Impl::UserAtCommit
+ConversationRepository::Impl::userAtCommit(const std::string& userDevice,
+                                           const std::string& commitId) const
 {
+    UserAtCommit ret;
     auto cert = tls::CertificateStore::instance().getCertificate(userDevice);
     auto hasPinnedCert = cert and cert->issuer;
     auto repo = repository();
     if (not repo)
-        return false;
+        return ret;
 
     // Retrieve tree for commit
     auto tree = treeAtCommit(repo.get(), commitId);
     if (not tree)
-        return false;
+        return ret;
 
     // Check that /devices/userDevice.crt exists
     std::string deviceFile = fmt::format("devices/{}.crt", userDevice);
     auto blob_device = fileAtTree(deviceFile, tree);
     if (!blob_device) {
         JAMI_ERR("%s announced but not found", deviceFile.c_str());
-        return false;
+        return ret;
     }
-    auto* blob = reinterpret_cast<git_blob*>(blob_device.get());
-    auto deviceCert = dht::crypto::Certificate(static_cast<const uint8_t*>(
-                                                   git_blob_rawcontent(blob)),
-                                               git_blob_rawsize(blob));
-    auto userUri = deviceCert.getIssuerUID();
+    auto deviceCert = certificate(blob_device);
+    auto userUri = deviceCert->getIssuerUID();
     if (userUri.empty()) {
         JAMI_ERR("%s got no issuer UID", deviceFile.c_str());
         if (not hasPinnedCert) {
-            return false;
+            return ret;
         } else {
             // HACK: JAMS device's certificate does not contains any issuer
             // So, getIssuerUID() will be empty here, so there is no way
@@ -1465,40 +1618,50 @@ ConversationRepository::Impl::isValidUserAtCommit(const std::string& userDevice,
     auto blob_parent = memberCertificate(userUri, tree);
     if (not blob_parent) {
         JAMI_ERR("Certificate not found for %s", userUri.c_str());
-        return false;
+        return ret;
     }
 
     // Check that certificates were still valid
-    blob = reinterpret_cast<git_blob*>(blob_parent.get());
-    auto parentCert = dht::crypto::Certificate(static_cast<const uint8_t*>(
-                                                   git_blob_rawcontent(blob)),
-                                               git_blob_rawsize(blob));
+    auto parentCert = certificate(blob_parent);
 
     git_oid oid;
     git_commit* commit_ptr = nullptr;
     if (git_oid_fromstr(&oid, commitId.c_str()) < 0
         || git_commit_lookup(&commit_ptr, repo.get(), &oid) < 0) {
         JAMI_WARN("Failed to look up commit %s", commitId.c_str());
-        return false;
+        return ret;
     }
     GitCommit commit = {commit_ptr, git_commit_free};
 
     auto commitTime = std::chrono::system_clock::from_time_t(git_commit_time(commit.get()));
-    if (deviceCert.getExpiration() < commitTime) {
-        JAMI_ERR("Certificate %s expired", deviceCert.getId().to_c_str());
-        return false;
+    if (deviceCert->getExpiration() < commitTime) {
+        JAMI_ERR("Certificate %s expired", deviceCert->getId().to_c_str());
+        return ret;
     }
-    if (parentCert.getExpiration() < commitTime) {
-        JAMI_ERR("Certificate %s expired", parentCert.getId().to_c_str());
-        return false;
+    if (parentCert->getExpiration() < commitTime) {
+        JAMI_ERR("Certificate %s expired", parentCert->getId().to_c_str());
+        return ret;
     }
 
-    auto res = parentCert.getId().toString() == userUri;
-    if (res && not hasPinnedCert) {
-        tls::CertificateStore::instance().pinCertificate(std::move(deviceCert));
-        tls::CertificateStore::instance().pinCertificate(std::move(parentCert));
-    }
-    return res;
+    ret.valid = parentCert->getId().toString() == userUri;
+    ret.userUri = std::move(userUri);
+    ret.deviceCert = std::move(deviceCert);
+    ret.userCert = std::move(parentCert);
+    return ret;
+}
+
+void
+ConversationRepository::Impl::pinUserAtCommit(const std::string& userDevice,
+                                              const UserAtCommit& user) const
+{
+    auto cert = tls::CertificateStore::instance().getCertificate(userDevice);
+    if (cert && cert->issuer)
+        return;
+    // Cached certificates are shared between threads, pin copies
+    tls::CertificateStore::instance().pinCertificate(
+        dht::crypto::Certificate(user.deviceCert->getPacked()));
+    tls::CertificateStore::instance().pinCertificate(
+        dht::crypto::Certificate(user.userCert->getPacked()));
 }
 
 bool
@@ -2226,6 +2389,11 @@ ConversationRepository::Impl::getCommitType(const std::string& commitMsg) const
 std::vector<std::string>
 ConversationRepository::Impl::getInitialMembers() const
 {
+    // The initial commit never changes, so cache members once they can be resolved
+    std::lock_guard<std::mutex> lk(initialMembersMtx_);
+    if (!initialMembers_.empty())
+        return initialMembers_;
+
     LogOptions options;
     options.from = id_;
     options.nbOfCommits = 1;
@@ -2251,10 +2419,89 @@ ConversationRepository::Impl::getInitialMembers() const
                            &err)) {
             return {authorId};
         }
-        if (root.isMember("invited") && root["invited"].asString() != authorId)
-            return {authorId, root["invited"].asString()};
+        if (root.isMember("invited") && root["invited"].asString() != authorId) {
+            initialMembers_ = {authorId, root["invited"].asString()};
+            return initialMembers_;
+        }
     }
-    return {authorId};
+    initialMembers_ = {authorId};
+    return initialMembers_;
+}
+
+std::string
+ConversationRepository::Impl::head(git_repository* repo) const
+{
+    git_oid oid;
+    if (git_reference_name_to_id(&oid, repo, "HEAD") < 0)
+        return {};
+    return git_oid_tostr_s(&oid);
+}
+
+std::string
+ConversationRepository::Impl::metadataPath(git_repository* repo) const
+{
+    return fmt::format("{}{}", git_repository_path(repo), METADATA_FILE);
+}
+
+bool
+ConversationRepository::Impl::loadMetadata()
+{
+    auto repo = repository();
+    if (!repo)
+        return false;
+    RepositoryMetadata metadata;
+    try {
+        auto file = fileutils::loadFile(metadataPath(repo.get()));
+        auto oh = msgpack::unpack(reinterpret_cast<const char*>(file.data()), file.size());
+        oh.get().convert(metadata);
+    } catch (const std::exception&) {
+        return false;
+    }
+    if (metadata.version != RepositoryMetadata::VERSION || metadata.mode < 0
+        || metadata.mode > static_cast<int>(ConversationMode::PUBLIC))
+        return false;
+
+    mode_ = static_cast<ConversationMode>(metadata.mode);
+    if (!metadata.initialMembers.empty()) {
+        std::lock_guard<std::mutex> lk(initialMembersMtx_);
+        initialMembers_ = std::move(metadata.initialMembers);
+    }
+    // Members changed since the snapshot, let initMembers() rebuild them
+    if (metadata.head.empty() || metadata.head != head(repo.get()))
+        return false;
+
+    std::lock_guard<std::mutex> lk(membersMtx_);
+    members_.clear();
+    members_.reserve(metadata.members.size());
+    for (auto& [uri, role] : metadata.members) {
+        if (role < 0 || role > static_cast<int>(MemberRole::LEFT)) {
+            members_.clear();
+            return false;
+        }
+        members_.emplace_back(ConversationMember {std::move(uri), static_cast<MemberRole>(role)});
+    }
+    return true;
+}
+
+void
+ConversationRepository::Impl::saveMetadata(git_repository* repo) const
+{
+    RepositoryMetadata metadata;
+    metadata.head = head(repo);
+    if (metadata.head.empty() || !mode_)
+        return;
+    metadata.mode = static_cast<int>(*mode_);
+    metadata.members.reserve(members_.size());
+    for (const auto& member : members_)
+        metadata.members.emplace_back(member.uri, static_cast<int>(member.role));
+    {
+        std::lock_guard<std::mutex> lk(initialMembersMtx_);
+        metadata.initialMembers = initialMembers_;
+    }
+    // Replaced atomically: a snapshot interrupted while written must not be loaded
+    msgpack::sbuffer buffer;
+    msgpack::pack(buffer, metadata);
+    Persistence::writeFile(metadataPath(repo), std::string(buffer.data(), buffer.size()));
 }
 
 bool
@@ -2331,7 +2578,7 @@ ConversationRepository::Impl::initMembers()
     if (!repo)
         throw std::logic_error("Invalid git repository");
 
-    std::vector<std::string> uris;
+    std::unordered_set<std::string> uris;
     std::lock_guard<std::mutex> lk(membersMtx_);
     members_.clear();
     std::string repoPath = git_repository_workdir(repo.get());
@@ -2353,24 +2600,21 @@ ConversationRepository::Impl::initMembers()
         for (const auto& f : fileutils::readDirectory(p)) {
             auto pos = f.find(".crt");
             auto uri = f.substr(0, pos);
-            auto it = std::find(uris.begin(), uris.end(), uri);
-            if (it == uris.end()) {
+            if (uris.emplace(uri).second)
                 members_.emplace_back(ConversationMember {uri, roles[i]});
-                uris.emplace_back(uri);
-            }
         }
         ++i;
     }
 
     if (mode() == ConversationMode::ONE_TO_ONE) {
         for (const auto& member : getInitialMembers()) {
-            auto it = std::find(uris.begin(), uris.end(), member);
-            if (it == uris.end()) {
+            if (uris.find(member) == uris.end()) {
                 // If member is in initial commit, but not in invited, this means that user left.
                 members_.emplace_back(ConversationMember {member, MemberRole::LEFT});
             }
         }
     }
+    saveMetadata(repo.get());
 }
 
 std::optional<std::map<std::string, std::string>>
@@ -2568,206 +2812,248 @@ ConversationRepository::cloneConversation(const std::weak_ptr<JamiAccount>& acco
     return repo;
 }
 
+std::string
+ConversationRepository::Impl::userCommitId(const ConversationCommit& commit) const
+{
+    if (commit.parents.size() == 0)
+        return {};
+    if (commit.parents.size() == 1 && getCommitType(commit.commit_msg) == "member") {
+        Json::Value root;
+        Json::CharReaderBuilder rbuilder;
+        auto reader = std::unique_ptr<Json::CharReader>(rbuilder.newCharReader());
+        if (reader->parse(commit.commit_msg.data(),
+                          commit.commit_msg.data() + commit.commit_msg.size(),
+                          &root,
+                          nullptr)
+            && root["action"].asString() == "remove") {
+            // In this case, we remove the user. So if self, the user will not be
+            // valid for this commit. Check previous commit
+            return commit.parents[0];
+        }
+    }
+    return commit.id;
+}
+
 bool
-ConversationRepository::Impl::validCommits(
-    const std::vector<ConversationCommit>& commitsToValidate) const
+ConversationRepository::Impl::checkCommit(const ConversationCommit& commit,
+                                          std::string& error) const
 {
-    for (const auto& commit : commitsToValidate) {
-        auto userDevice = commit.author.email;
-        auto validUserAtCommit = commit.id;
-        if (commit.parents.size() == 0) {
-            if (!checkInitialCommit(userDevice, commit.id, commit.commit_msg)) {
-                JAMI_WARN("Malformed initial commit %s. Please check you use the latest "
-                          "version of Jami, or that your contact is not doing unwanted stuff.",
+    auto userDevice = commit.author.email;
+    if (commit.parents.size() == 0) {
+        if (!checkInitialCommit(userDevice, commit.id, commit.commit_msg)) {
+            JAMI_WARN("Malformed initial commit %s. Please check you use the latest "
+                      "version of Jami, or that your contact is not doing unwanted stuff.",
+                      commit.id.c_str());
+            error = "Malformed initial commit";
+            return false;
+        }
+    } else if (commit.parents.size() == 1) {
+        auto type = getCommitType(commit.commit_msg);
+        if (type == "vote") {
+            // Check that vote is valid
+            if (!checkVote(userDevice, commit.id, commit.parents[0])) {
+                JAMI_WARN("Malformed vote commit %s. Please check you use the latest version "
+                          "of Jami, or that your contact is not doing unwanted stuff.",
                           commit.id.c_str());
-                if (auto shared = account_.lock()) {
-                    emitSignal<libjami::ConversationSignal::OnConversationError>(
-                        shared->getAccountID(), id_, EVALIDFETCH, "Malformed initial commit");
-                }
+                error = "Malformed vote";
                 return false;
             }
-        } else if (commit.parents.size() == 1) {
-            auto type = getCommitType(commit.commit_msg);
-            if (type == "vote") {
-                // Check that vote is valid
-                if (!checkVote(userDevice, commit.id, commit.parents[0])) {
-                    JAMI_WARN("Malformed vote commit %s. Please check you use the latest version "
-                              "of Jami, or that your contact is not doing unwanted stuff.",
-                              commit.id.c_str());
-                    if (auto shared = account_.lock()) {
-                        emitSignal<libjami::ConversationSignal::OnConversationError>(
-                            shared->getAccountID(), id_, EVALIDFETCH, "Malformed vote");
-                    }
+        } else if (type == "member") {
+            std::string err;
+            Json::Value root;
+            Json::CharReaderBuilder rbuilder;
+            auto reader = std::unique_ptr<Json::CharReader>(rbuilder.newCharReader());
+            if (!reader->parse(commit.commit_msg.data(),
+                               commit.commit_msg.data() + commit.commit_msg.size(),
+                               &root,
+                               &err)) {
+                JAMI_ERR() << "Failed to parse " << err;
+                error = "Malformed member commit";
+                return false;
+            }
+            std::string action = root["action"].asString();
+            std::string uriMember = root["uri"].asString();
+            if (action == "add") {
+                if (!checkValidAdd(userDevice, uriMember, commit.id, commit.parents[0])) {
+                    JAMI_WARN(
+                        "Malformed add commit %s. Please check you use the latest version "
+                        "of Jami, or that your contact is not doing unwanted stuff.",
+                        commit.id.c_str());
+                    error = "Malformed add member commit";
                     return false;
                 }
-            } else if (type == "member") {
-                std::string err;
-                Json::Value root;
-                Json::CharReaderBuilder rbuilder;
-                auto reader = std::unique_ptr<Json::CharReader>(rbuilder.newCharReader());
-                if (!reader->parse(commit.commit_msg.data(),
-                                   commit.commit_msg.data() + commit.commit_msg.size(),
-                                   &root,
-                                   &err)) {
-                    JAMI_ERR() << "Failed to parse " << err;
-                    if (auto shared = account_.lock()) {
-                        emitSignal<libjami::ConversationSignal::OnConversationError>(
-                            shared->getAccountID(), id_, EVALIDFETCH, "Malformed member commit");
-                    }
+            } else if (action == "join") {
+                if (!checkValidJoins(userDevice, uriMember, commit.id, commit.parents[0])) {
+                    JAMI_WARN(
+                        "Malformed joins commit %s. Please check you use the latest version "
+                        "of Jami, or that your contact is not doing unwanted stuff.",
+                        commit.id.c_str());
+                    error = "Malformed join member commit";
                     return false;
                 }
-                std::string action = root["action"].asString();
-                std::string uriMember = root["uri"].asString();
-                if (action == "add") {
-                    if (!checkValidAdd(userDevice, uriMember, commit.id, commit.parents[0])) {
-                        JAMI_WARN(
-                            "Malformed add commit %s. Please check you use the latest version "
-                            "of Jami, or that your contact is not doing unwanted stuff.",
-                            commit.id.c_str());
-                        if (auto shared = account_.lock()) {
-                            emitSignal<libjami::ConversationSignal::OnConversationError>(
-                                shared->getAccountID(),
-                                id_,
-                                EVALIDFETCH,
-                                "Malformed add member commit");
-                        }
-                        return false;
-                    }
-                } else if (action == "join") {
-                    if (!checkValidJoins(userDevice, uriMember, commit.id, commit.parents[0])) {
-                        JAMI_WARN(
-                            "Malformed joins commit %s. Please check you use the latest version "
-                            "of Jami, or that your contact is not doing unwanted stuff.",
-                            commit.id.c_str());
-                        if (auto shared = account_.lock()) {
-                            emitSignal<libjami::ConversationSignal::OnConversationError>(
-                                shared->getAccountID(),
-                                id_,
-                                EVALIDFETCH,
-                                "Malformed join member commit");
-                        }
-                        return false;
-                    }
-                } else if (action == "remove") {
-                    // In this case, we remove the user. So if self, the user will not be
-                    // valid for this commit. Check previous commit
-                    validUserAtCommit = commit.parents[0];
-                    if (!checkValidRemove(userDevice, uriMember, commit.id, commit.parents[0])) {
-                        JAMI_WARN(
-                            "Malformed removes commit %s. Please check you use the latest version "
-                            "of Jami, or that your contact is not doing unwanted stuff.",
-                            commit.id.c_str());
-                        if (auto shared = account_.lock()) {
-                            emitSignal<libjami::ConversationSignal::OnConversationError>(
-                                shared->getAccountID(),
-                                id_,
-                                EVALIDFETCH,
-                                "Malformed remove member commit");
-                        }
-                        return false;
-                    }
-                } else if (action == "ban" || action == "unban") {
-                    // Note device.size() == "member".size()
-                    if (!checkValidVoteResolution(userDevice,
-                                                  uriMember,
-                                                  commit.id,
-                                                  commit.parents[0],
-                                                  action)) {
-                        JAMI_WARN(
-                            "Malformed removes commit %s. Please check you use the latest version "
-                            "of Jami, or that your contact is not doing unwanted stuff.",
-                            commit.id.c_str());
-                        if (auto shared = account_.lock()) {
-                            emitSignal<libjami::ConversationSignal::OnConversationError>(
-                                shared->getAccountID(),
-                                id_,
-                                EVALIDFETCH,
-                                "Malformed ban member commit");
-                        }
-                        return false;
-                    }
-                } else {
-                    JAMI_WARN("Malformed member commit %s with action %s. Please check you use the "
-                              "latest "
-                              "version of Jami, or that your contact is not doing unwanted stuff.",
-                              commit.id.c_str(),
-                              action.c_str());
-                    if (auto shared = account_.lock()) {
-                        emitSignal<libjami::ConversationSignal::OnConversationError>(
-                            shared->getAccountID(), id_, EVALIDFETCH, "Malformed member commit");
-                    }
-                    return false;
-                }
-            } else if (type == "application/update-profile") {
-                if (!checkValidProfileUpdate(userDevice, commit.id, commit.parents[0])) {
-                    JAMI_WARN("Malformed profile updates commit %s. Please check you use the "
-                              "latest version "
-                              "of Jami, or that your contact is not doing unwanted stuff.",
-                              commit.id.c_str());
-                    if (auto shared = account_.lock()) {
-                        emitSignal<libjami::ConversationSignal::OnConversationError>(
-                            shared->getAccountID(),
-                            id_,
-                            EVALIDFETCH,
-                            "Malformed profile updates commit");
-                    }
+            } else if (action == "remove") {
+                if (!checkValidRemove(userDevice, uriMember, commit.id, commit.parents[0])) {
+                    JAMI_WARN(
+                        "Malformed removes commit %s. Please check you use the latest version "
+                        "of Jami, or that your contact is not doing unwanted stuff.",
+                        commit.id.c_str());
+                    error = "Malformed remove member commit";
                     return false;
                 }
-            } else if (type == "application/edited-message") {
-                if (!checkEdit(userDevice, commit)) {
-                    JAMI_ERROR("Commit {:s} malformed", commit.id);
-                    if (auto shared = account_.lock()) {
-                        emitSignal<libjami::ConversationSignal::OnConversationError>(
-                            shared->getAccountID(), id_, EVALIDFETCH, "Malformed edit commit");
-                    }
+            } else if (action == "ban" || action == "unban") {
+                // Note device.size() == "member".size()
+                if (!checkValidVoteResolution(userDevice,
+                                              uriMember,
+                                              commit.id,
+                                              commit.parents[0],
+                                              action)) {
+                    JAMI_WARN(
+                        "Malformed removes commit %s. Please check you use the latest version "
+                        "of Jami, or that your contact is not doing unwanted stuff.",
+                        commit.id.c_str());
+                    error = "Malformed ban member commit";
                     return false;
                 }
             } else {
-                // Note: accept all mimetype here, as we can have new mimetypes
-                // Just avoid to add weird files
-                // Check that no weird file is added outside device cert nor removed
-                if (!checkValidUserDiff(userDevice, commit.id, commit.parents[0])) {
-                    JAMI_WARN("Malformed %s commit %s. Please check you use the latest "
-                              "version of Jami, or that your contact is not doing unwanted stuff.",
-                              type.c_str(),
-                              commit.id.c_str());
-                    if (auto shared = account_.lock()) {
-                        emitSignal<libjami::ConversationSignal::OnConversationError>(
-                            shared->getAccountID(), id_, EVALIDFETCH, "Malformed commit");
-                    }
-                    return false;
-                }
+                JAMI_WARN("Malformed member commit %s with action %s. Please check you use the "
+                          "latest "
+                          "version of Jami, or that your contact is not doing unwanted stuff.",
+                          commit.id.c_str(),
+                          action.c_str());
+                error = "Malformed member commit";
+                return false;
             }
-
-            // For all commit, check that user is valid,
-            // So that user certificate MUST be in /members or /admins
-            // and device cert MUST be in /devices
-            if (!isValidUserAtCommit(userDevice, validUserAtCommit)) {
-                JAMI_WARN(
-                    "Malformed commit %s. Please check you use the latest version of Jami, or "
-                    "that your contact is not doing unwanted stuff. %s",
-                    validUserAtCommit.c_str(),
-                    commit.commit_msg.c_str());
-                if (auto shared = account_.lock()) {
-                    emitSignal<libjami::ConversationSignal::OnConversationError>(
-                        shared->getAccountID(), id_, EVALIDFETCH, "Malformed commit");
-                }
+        } else if (type == "application/update-profile") {
+            if (!checkValidProfileUpdate(userDevice, commit.id, commit.parents[0])) {
+                JAMI_WARN("Malformed profile updates commit %s. Please check you use the "
+                          "latest version "
+                          "of Jami, or that your contact is not doing unwanted stuff.",
+                          commit.id.c_str());
+                error = "Malformed profile updates commit";
+                return false;
+            }
+        } else if (type == "application/edited-message") {
+            if (!checkEdit(userDevice, commit)) {
+                JAMI_ERROR("Commit {:s} malformed", commit.id);
+                error = "Malformed edit commit";
                 return false;
             }
         } else {
-            // Merge commit, for now, check user
-            if (!isValidUserAtCommit(userDevice, validUserAtCommit)) {
+            // Note: accept all mimetype here, as we can have new mimetypes
+            // Just avoid to add weird files
+            // Check that no weird file is added outside device cert nor removed
+            if (!checkValidUserDiff(userDevice, commit.id, commit.parents[0])) {
+                JAMI_WARN("Malformed %s commit %s. Please check you use the latest "
+                          "version of Jami, or that your contact is not doing unwanted stuff.",
+                          type.c_str(),
+                          commit.id.c_str());
+                error = "Malformed commit";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool
+ConversationRepository::Impl::validCommits(
+    const std::vector<ConversationCommit>& commitsToValidate) const
+{
+    struct CommitValidation
+    {
+        std::string userCommitId;
+        UserAtCommit user;
+        std::exception_ptr userException;
+        std::string error;
+        std::exception_ptr exception;
+    };
+    auto count = commitsToValidate.size();
+    std::vector<CommitValidation> validations(count);
+
+    // Commits are checked in parallel, but the result is the same as checking them
+    // in order: the first invalid commit is reported and later ones are skipped when possible
+    std::atomic_size_t firstInvalid {count};
+    auto setInvalid = [&](std::size_t i) {
+        auto current = firstInvalid.load();
+        while (i < current && !firstInvalid.compare_exchange_weak(current, i)) {}
+    };
+
+    // For all commit, check that user is valid,
+    // So that user certificate MUST be in /members or /admins
+    // and device cert MUST be in /devices
+    parallelFor(count, [&](std::size_t i) {
+        if (i > firstInvalid)
+            return;
+        auto& validation = validations[i];
+        try {
+            validation.userCommitId = userCommitId(commitsToValidate[i]);
+            if (validation.userCommitId.empty())
+                return;
+            validation.user = userAtCommit(commitsToValidate[i].author.email,
+                                           validation.userCommitId);
+            if (!validation.user.valid)
+                setInvalid(i);
+        } catch (...) {
+            validation.userException = std::current_exception();
+            setInvalid(i);
+        }
+    });
+
+    // Certificates are pinned once the whole commit is valid. Until then, let
+    // following commits find the devices validated before them.
+    std::map<std::string, std::pair<std::string, std::size_t>> devices;
+    for (std::size_t i = 0; i < count; ++i)
+        if (validations[i].user.valid)
+            devices.emplace(commitsToValidate[i].author.email,
+                            std::make_pair(validations[i].user.userUri, i));
+
+    parallelFor(count, [&](std::size_t i) {
+        if (i > firstInvalid)
+            return;
+        auto& validation = validations[i];
+        validatedDevices = {&devices, i};
+        try {
+            if (!checkCommit(commitsToValidate[i], validation.error))
+                setInvalid(i);
+        } catch (...) {
+            validation.exception = std::current_exception();
+            setInvalid(i);
+        }
+        validatedDevices = {};
+    });
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto& commit = commitsToValidate[i];
+        auto& validation = validations[i];
+        if (validation.exception)
+            std::rethrow_exception(validation.exception);
+        if (validation.error.empty() && validation.userException)
+            std::rethrow_exception(validation.userException);
+        if (validation.error.empty() && !validation.userCommitId.empty()
+            && !validation.user.valid) {
+            if (commit.parents.size() > 1) {
                 JAMI_WARN("Malformed merge commit %s. Please check you use the latest version of "
                           "Jami, or "
                           "that your contact is not doing unwanted stuff.",
-                          validUserAtCommit.c_str());
-                if (auto shared = account_.lock()) {
-                    emitSignal<libjami::ConversationSignal::OnConversationError>(
-                        shared->getAccountID(), id_, EVALIDFETCH, "Malformed commit");
-                }
-                return false;
+                          validation.userCommitId.c_str());
+            } else {
+                JAMI_WARN(
+                    "Malformed commit %s. Please check you use the latest version of Jami, or "
+                    "that your contact is not doing unwanted stuff. %s",
+                    validation.userCommitId.c_str(),
+                    commit.commit_msg.c_str());
             }
+            validation.error = "Malformed commit";
+        }
+        if (!validation.error.empty()) {
+            if (auto shared = account_.lock()) {
+                emitSignal<libjami::ConversationSignal::OnConversationError>(
+                    shared->getAccountID(), id_, EVALIDFETCH, validation.error);
+            }
+            return false;
         }
+        if (validation.user.valid)
+            pinUserAtCommit(commit.author.email, validation.user);
         JAMI_DBG("Validate commit %s", commit.id.c_str());
     }
     return true;
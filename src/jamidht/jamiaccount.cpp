@@ -34,6 +34,8 @@
 #include "conversation_channel_handler.h"
 #include "sync_channel_handler.h"
 #include "transfer_channel_handler.h"
+#include "presence_scheduler.h"
+#include "shared_dht_node.h"
 
 #include "sip/sdp.h"
 #include "sip/sipvoiplink.h"
@@ -64,6 +66,7 @@
 #include "libav_utils.h"
 #endif
 #include "fileutils.h"
+#include "persistence.h"
 #include "string_utils.h"
 #include "archiver.h"
 #include "data_transfer.h"
@@ -90,6 +93,7 @@
 #include <cinttypes>
 #include <cstdarg>
 #include <initializer_list>
+#include <limits>
 #include <memory>
 #include <regex>
 #include <sstream>
@@ -169,22 +173,6 @@ setState(const std::string& accountID, const State migrationState)
 
 } // namespace Migration
 
-struct JamiAccount::BuddyInfo
-{
-    /* the buddy id */
-    dht::InfoHash id;
-
-    /* number of devices connected on the DHT */
-    uint32_t devices_cnt {};
-
-    /* The disposable object to update buddy info */
-    std::future<size_t> listenToken;
-
-    BuddyInfo(dht::InfoHash id)
-        : id(id)
-    {}
-};
-
 struct JamiAccount::PendingCall
 {
     std::chrono::steady_clock::time_point start;
@@ -329,6 +317,10 @@ JamiAccount::flush()
     // Class base method
     SIPAccountBase::flush();
 
+    auto& persistence = Persistence::instance();
+    persistence.discard(cachePath_);
+    persistence.discard(dataPath_);
+    persistence.discard(idPath_);
     fileutils::removeAll(cachePath_);
     fileutils::removeAll(dataPath_);
     fileutils::removeAll(idPath_, true);
@@ -1617,76 +1609,105 @@ JamiAccount::trackBuddyPresence(const std::string& buddy_id, bool track)
              track ? "Track" : "Untrack",
              buddy_id.c_str());
 
-    auto h = dht::InfoHash(buddyUri);
-    std::lock_guard<std::mutex> lock(buddyInfoMtx);
+    auto id = dht::InfoHash(buddyUri).toString();
     if (track) {
-        auto buddy = trackedBuddies_.emplace(h, BuddyInfo {h});
-        if (buddy.second) {
-            trackPresence(buddy.first->first, buddy.first->second);
-        }
+        // Contacts added recently are listened first, until some activity says otherwise
+        PresenceScheduler::time_point lastActivity {};
+        auto details = getContactDetails(id);
+        auto added = details.find("added");
+        if (added != details.end())
+            lastActivity = std::chrono::system_clock::from_time_t(
+                to_int<std::time_t>(added->second, 0));
+        presenceScheduler()->track(id, lastActivity);
     } else {
-        auto buddy = trackedBuddies_.find(h);
-        if (buddy != trackedBuddies_.end()) {
-            if (auto dht = dht_)
-                if (dht->isRunning())
-                    dht->cancelListen(h, std::move(buddy->second.listenToken));
-            trackedBuddies_.erase(buddy);
-        }
+        presenceScheduler()->untrack(id);
     }
 }
 
-void
-JamiAccount::trackPresence(const dht::InfoHash& h, BuddyInfo& buddy)
+std::shared_ptr<PresenceScheduler>
+JamiAccount::presenceScheduler()
 {
-    auto dht = dht_;
-    if (not dht or not dht->isRunning()) {
-        return;
-    }
-    buddy.listenToken = dht->listen<
-        DeviceAnnouncement>(h, [this, h](DeviceAnnouncement&& dev, bool expired) {
-        bool wasConnected, isConnected;
-        {
-            std::lock_guard<std::mutex> lock(buddyInfoMtx);
-            auto buddy = trackedBuddies_.find(h);
-            if (buddy == trackedBuddies_.end())
-                return true;
-            wasConnected = buddy->second.devices_cnt > 0;
-            if (expired)
-                --buddy->second.devices_cnt;
-            else
-                ++buddy->second.devices_cnt;
-            isConnected = buddy->second.devices_cnt > 0;
-        }
-        // NOTE: the rest can use configurationMtx_, that can be locked during unregister so
-        // do not retrigger on dht
-        runOnMainThread([w = weak(), h, dev, expired, isConnected, wasConnected]() {
+    std::lock_guard<std::mutex> lock(buddyInfoMtx);
+    if (presence_)
+        return presence_;
+    presence_ = std::make_shared<PresenceScheduler>(
+        Manager::instance().scheduler(),
+        "presence:" + getAccountID(),
+        [w = weak()](const std::string& id) -> std::future<size_t> {
             auto sthis = w.lock();
-            if (!sthis)
-                return;
-            if (not expired) {
-                // Retry messages every time a new device announce its presence
-                sthis->messageEngine_.onPeerOnline(h.toString());
-                sthis->findCertificate(
-                    dev.dev, [sthis, h](const std::shared_ptr<dht::crypto::Certificate>& cert) {
-                        if (cert) {
-                            auto pk = std::make_shared<dht::crypto::PublicKey>(cert->getPublicKey());
-                            if (sthis->convModule()->needsSyncingWith(h.toString(),
-                                                                      pk->getLongId().toString()))
-                                sthis->requestSIPConnection(
-                                    h.toString(),
-                                    pk->getLongId(),
-                                    "sync"); // Both sides will sync conversations
+            if (not sthis)
+                return {};
+            auto dht = sthis->dht_;
+            if (not dht or not dht->isRunning())
+                return {};
+            return dht->listen<DeviceAnnouncement>(
+                dht::InfoHash(id), [w, id](DeviceAnnouncement&& dev, bool expired) {
+                    auto sthis = w.lock();
+                    if (not sthis)
+                        return false;
+                    auto transition = sthis->presenceScheduler()->deviceAnnounced(id, expired);
+                    if (not transition)
+                        return true;
+                    // NOTE: the rest can use configurationMtx_, that can be locked during
+                    // unregister so do not retrigger on dht
+                    runOnMainThread([w, id, dev, expired, t = *transition]() {
+                        auto sthis = w.lock();
+                        if (!sthis)
+                            return;
+                        auto h = dht::InfoHash(id);
+                        if (not expired)
+                            sthis->onTrackedDeviceAnnounced(h, dev.dev);
+                        if (t.isOnline and not t.wasOnline) {
+                            sthis->onTrackedBuddyOnline(h);
+                        } else if (not t.isOnline and t.wasOnline) {
+                            sthis->onTrackedBuddyOffline(h);
                         }
                     });
-            }
-            if (isConnected and not wasConnected) {
-                sthis->onTrackedBuddyOnline(h);
-            } else if (not isConnected and wasConnected) {
-                sthis->onTrackedBuddyOffline(h);
-            }
+                    return true;
+                });
+        },
+        [w = weak()](const std::string& id, std::future<size_t>&& token) {
+            if (auto sthis = w.lock())
+                if (auto dht = sthis->dht_)
+                    if (dht->isRunning())
+                        dht->cancelListen(dht::InfoHash(id), std::move(token));
+        },
+        [w = weak()](const std::string& id, bool) {
+            // Not listened anymore, its presence is unknown
+            runOnMainThread([w, id] {
+                if (auto sthis = w.lock())
+                    sthis->onTrackedBuddyOffline(dht::InfoHash(id));
+            });
         });
+    return presence_;
+}
 
-        return true;
+void
+JamiAccount::onTrackedDeviceAnnounced(const dht::InfoHash& h, const dht::InfoHash& device)
+{
+    // Many buddies can come online at once (e.g. after a DHT reconnection): rate limit
+    // the connections it triggers, coalesced per buddy and per device
+    auto presence = presenceScheduler();
+    // Retry messages every time a new device announce its presence
+    presence->scheduleReconnect("messages:" + h.toString(), [w = weak(), h] {
+        if (auto sthis = w.lock())
+            sthis->messageEngine_.onPeerOnline(h.toString());
+    });
+    presence->scheduleReconnect("sync:" + device.toString(), [w = weak(), h, device] {
+        auto sthis = w.lock();
+        if (!sthis)
+            return;
+        sthis->findCertificate(
+            device, [sthis, h](const std::shared_ptr<dht::crypto::Certificate>& cert) {
+                if (cert) {
+                    auto pk = std::make_shared<dht::crypto::PublicKey>(cert->getPublicKey());
+                    if (sthis->convModule()->needsSyncingWith(h.toString(),
+                                                              pk->getLongId().toString()))
+                        sthis->requestSIPConnection(h.toString(),
+                                                    pk->getLongId(),
+                                                    "sync"); // Both sides will sync conversations
+                }
+            });
     });
 }
 
@@ -1694,10 +1715,7 @@ std::map<std::string, bool>
 JamiAccount::getTrackedBuddyPresence() const
 {
     std::lock_guard<std::mutex> lock(buddyInfoMtx);
-    std::map<std::string, bool> presence_info;
-    for (const auto& buddy_info_p : trackedBuddies_)
-        presence_info.emplace(buddy_info_p.first.toString(), buddy_info_p.second.devices_cnt > 0);
-    return presence_info;
+    return presence_ ? presence_->presence() : std::map<std::string, bool> {};
 }
 
 void
@@ -1710,29 +1728,34 @@ JamiAccount::onTrackedBuddyOnline(const dht::InfoHash& contactId)
     auto details = getContactDetails(id);
     auto it = details.find("confirmed");
     if (it == details.end() or it->second == "false") {
-        auto convId = convModule()->getOneToOneConversation(id);
-        if (convId.empty())
-            return;
         // In this case, the TrustRequest was sent but never confirmed (cause the contact was
         // offline maybe) To avoid the contact to never receive the conv request, retry there
-        std::lock_guard<std::recursive_mutex> lock(configurationMutex_);
-        if (accountManager_) {
-            // Retrieve cached payload for trust request.
-            auto requestPath = cachePath_ + DIR_SEPARATOR_STR + "requests" + DIR_SEPARATOR_STR
-                               + contactId.toString();
-            std::vector<uint8_t> payload;
-            try {
-                payload = fileutils::loadFile(requestPath);
-            } catch (...) {
-            }
+        presenceScheduler()->scheduleReconnect("request:" + id, [w = weak(), id] {
+            auto sthis = w.lock();
+            if (!sthis)
+                return;
+            auto convId = sthis->convModule()->getOneToOneConversation(id);
+            if (convId.empty())
+                return;
+            std::lock_guard<std::recursive_mutex> lock(sthis->configurationMutex_);
+            if (sthis->accountManager_) {
+                // Retrieve cached payload for trust request.
+                auto requestPath = sthis->cachePath_ + DIR_SEPARATOR_STR + "requests"
+                                   + DIR_SEPARATOR_STR + id;
+                std::vector<uint8_t> payload;
+                try {
+                    payload = fileutils::loadFile(requestPath);
+                } catch (...) {
+                }
 
-            if (payload.size() > 64000) {
-                JAMI_WARN() << "Trust request is too big, reset payload";
-                payload.clear();
-            }
+                if (payload.size() > 64000) {
+                    JAMI_WARN() << "Trust request is too big, reset payload";
+                    payload.clear();
+                }
 
-            accountManager_->sendTrustRequest(id, convId, payload);
-        }
+                sthis->accountManager_->sendTrustRequest(id, convId, payload);
+            }
+        });
     }
 }
 
@@ -1808,10 +1831,29 @@ JamiAccount::doRegister_()
         config.push_topic = conf.notificationTopic;
         config.push_platform = conf.platform;
         config.threaded = true;
-        config.peer_discovery = conf.dhtPeerDiscovery;
-        config.peer_publish = conf.dhtPeerDiscovery;
-        if (conf.proxyEnabled)
+        sharedDht_.reset();
+        auto sharedPort = Manager::instance().preferences.getSharedDhtPort();
+        if (not conf.proxyEnabled and sharedPort > 0
+            and sharedPort <= std::numeric_limits<in_port_t>::max()) {
+            SharedDhtNode::Config sharedConfig;
+            sharedConfig.proxyPort = static_cast<in_port_t>(sharedPort);
+            sharedConfig.peerDiscovery = conf.dhtPeerDiscovery;
+            sharedConfig.persistPath = fileutils::get_cache_dir()
+                                       + DIR_SEPARATOR_STR "shared_dhtstate";
+            sharedDht_ = SharedDhtNode::acquire(sharedConfig);
+        }
+        // Peer discovery is done by the shared node, for all accounts
+        config.peer_discovery = conf.dhtPeerDiscovery and not sharedDht_;
+        config.peer_publish = conf.dhtPeerDiscovery and not sharedDht_;
+        if (conf.proxyEnabled) {
             config.proxy_server = proxyServerCached_;
+        } else if (sharedDht_) {
+            // Bootstrap and maintenance are done once by the shared node, the account
+            // only runs a client keeping its identity
+            sharedDht_->bootstrap(loadBootstrap());
+            config.proxy_server = sharedDht_->proxyServer();
+            config.push_token.clear();
+        }
 
         if (not config.proxy_server.empty()) {
             JAMI_LOG("[Account {}] using proxy server {}",
@@ -1943,10 +1985,15 @@ JamiAccount::doRegister_()
         };
 
         setRegistrationState(RegistrationState::TRYING);
-        dht_->run(dhtPortUsed(), config, std::move(context));
-
-        for (const auto& bootstrap : loadBootstrap())
-            dht_->bootstrap(bootstrap);
+        if (sharedDht_) {
+            // No UDP socket: the account's runner only talks to the shared node
+            context.sock = SharedDhtNode::clientSocket();
+            dht_->run(config, std::move(context));
+        } else {
+            dht_->run(dhtPortUsed(), config, std::move(context));
+            for (const auto& bootstrap : loadBootstrap())
+                dht_->bootstrap(bootstrap);
+        }
 
         accountManager_->setDht(dht_);
 
@@ -2111,11 +2158,7 @@ JamiAccount::doRegister_()
             return true;
         });
 
-        std::lock_guard<std::mutex> lock(buddyInfoMtx);
-        for (auto& buddy : trackedBuddies_) {
-            buddy.second.devices_cnt = 0;
-            trackPresence(buddy.first, buddy.second);
-        }
+        presenceScheduler()->restart();
     } catch (const std::exception& e) {
         JAMI_ERR("Error registering DHT account: %s", e.what());
         setRegistrationState(RegistrationState::ERROR_GENERIC);
@@ -2219,6 +2262,7 @@ JamiAccount::onTextMessage(const std::string& id,
 {
     try {
         const std::string fromUri {parseJamiUri(from)};
+        presenceScheduler()->touch(dht::InfoHash(fromUri).toString());
         SIPAccountBase::onTextMessage(id, fromUri, deviceId, payloads);
     } catch (...) {
     }
@@ -2275,6 +2319,7 @@ JamiAccount::doUnregister(std::function<void(bool)> released_cb)
         cv.wait(lock, [&] { return shutdown_complete; });
     }
     dht_->join();
+    sharedDht_.reset();
     setRegistrationState(RegistrationState::UNREGISTERED);
 
     lock.unlock();
@@ -2324,6 +2369,7 @@ JamiAccount::connectivityChanged()
     }
     // reset cache
     setPublishedAddress({});
+    Manager::instance().getIceTransportFactory().publicAddresses().invalidate();
 }
 
 bool
@@ -2379,6 +2425,7 @@ std::set<ID, std::less<>>
 loadIdList(const std::string& path)
 {
     std::set<ID, std::less<>> ids;
+    Persistence::instance().flush(path);
     std::ifstream file = fileutils::ifstream(path);
     if (!file.is_open()) {
         JAMI_DBG("Could not load %s", path.c_str());
@@ -2403,13 +2450,10 @@ template<typename List = std::set<dht::Value::Id>>
 void
 saveIdList(const std::string& path, const List& ids)
 {
-    std::ofstream file = fileutils::ofstream(path, std::ios::trunc | std::ios::binary);
-    if (!file.is_open()) {
-        JAMI_ERR("Could not save to %s", path.c_str());
-        return;
-    }
+    std::ostringstream file;
     for (auto& c : ids)
         file << std::hex << c << "\n";
+    Persistence::instance().write(path, file.str());
 }
 
 void
@@ -3008,6 +3052,7 @@ JamiAccount::sendMessage(const std::string& to,
 
     auto toH = dht::InfoHash(toUri);
     auto now = clock::to_time_t(clock::now());
+    presenceScheduler()->touch(toH.toString());
 
     auto confirm = std::make_shared<PendingConfirmation>();
     if (onlyConnected) {
@@ -3276,36 +3321,64 @@ JamiAccount::getIceOptions(std::function<void(IceTransportOptions&&)> cb) noexce
 void
 JamiAccount::storeActiveIpAddress(std::function<void()>&& cb)
 {
-    dht_->getPublicAddress([this, cb = std::move(cb)](std::vector<dht::SockAddr>&& results) {
-        bool hasIpv4 {false}, hasIpv6 {false};
-        for (auto& result : results) {
-            auto family = result.getFamily();
-            if (family == AF_INET) {
-                if (not hasIpv4) {
-                    hasIpv4 = true;
-                    JAMI_DBG("[Account %s] Store DHT public IPv4 address : %s",
-                             getAccountID().c_str(),
-                             result.toString().c_str());
-                    setPublishedAddress(*result.get());
-                    if (upnpCtrl_) {
-                        upnpCtrl_->setPublicAddress(*result.get());
+    // Public addresses are shared by accounts using the same interface: during
+    // reconnection storms, only one DHT query is made and transports use the
+    // cached address meanwhile
+    auto& cache = Manager::instance().getIceTransportFactory().publicAddresses();
+    cache.get(
+        "dht:" + getLocalInterface(),
+        [w = weak()](auto&& done) {
+            auto sthis = w.lock();
+            if (not sthis) {
+                done(std::nullopt);
+                return;
+            }
+            // A client of the shared node would get the loopback address it is
+            // seen from: ask the node itself
+            auto shared = sthis->sharedDht_;
+            auto dht = shared ? shared->node() : sthis->dht_;
+            dht->getPublicAddress(
+                [done = std::move(done)](std::vector<dht::SockAddr>&& results) {
+                    bool hasIpv4 {false}, hasIpv6 {false};
+                    std::vector<IpAddr> addresses;
+                    for (auto& result : results) {
+                        if (result.isLoopback())
+                            continue;
+                        auto family = result.getFamily();
+                        if (family == AF_INET and not hasIpv4) {
+                            hasIpv4 = true;
+                            addresses.emplace_back(*result.get());
+                        } else if (family == AF_INET6 and not hasIpv6) {
+                            hasIpv6 = true;
+                            addresses.emplace_back(*result.get());
+                        }
+                        if (hasIpv4 and hasIpv6)
+                            break;
                     }
-                }
-            } else if (family == AF_INET6) {
-                if (not hasIpv6) {
-                    hasIpv6 = true;
-                    JAMI_DBG("[Account %s] Store DHT public IPv6 address : %s",
-                             getAccountID().c_str(),
-                             result.toString().c_str());
-                    setPublishedAddress(*result.get());
+                    if (addresses.empty())
+                        done(std::nullopt);
+                    else
+                        done(std::move(addresses));
+                });
+        },
+        [w = weak(), cb = std::move(cb)](const std::optional<std::vector<IpAddr>>& addresses) {
+            auto sthis = w.lock();
+            if (not sthis)
+                return;
+            if (addresses) {
+                for (const auto& address : *addresses) {
+                    JAMI_DBG("[Account %s] Store DHT public %s address : %s",
+                             sthis->getAccountID().c_str(),
+                             address.getFamily() == AF_INET ? "IPv4" : "IPv6",
+                             address.toString().c_str());
+                    sthis->setPublishedAddress(address);
+                    if (sthis->upnpCtrl_ and address.getFamily() == AF_INET)
+                        sthis->upnpCtrl_->setPublicAddress(address);
                 }
             }
-            if (hasIpv4 and hasIpv6)
-                break;
-        }
-        if (cb)
-            cb();
-    });
+            if (cb)
+                cb();
+        });
 }
 
 bool
@@ -88,6 +88,8 @@ struct AccountInfo;
 class SipTransport;
 class ChanneledOutgoingTransfer;
 class SyncModule;
+class PresenceScheduler;
+class SharedDhtNode;
 struct TextMessageCtx;
 
 using SipConnectionKey = std::pair<std::string /* accountId */, DeviceId>;
@@ -622,7 +624,6 @@ private:
      */
     struct PendingCall;
     struct PendingMessage;
-    struct BuddyInfo;
     struct DiscoveredPeer;
 
     inline std::string getProxyConfigKey() const
@@ -638,7 +639,15 @@ private:
                                                                       const std::string& pin,
                                                                       bool previous = false);
 
-    void trackPresence(const dht::InfoHash& h, BuddyInfo& buddy);
+    /**
+     * Get the scheduler of the presence listens, created on first use.
+     */
+    std::shared_ptr<PresenceScheduler> presenceScheduler();
+
+    /**
+     * A device of a tracked buddy announced itself: retry messages and sync with it.
+     */
+    void onTrackedDeviceAnnounced(const dht::InfoHash& h, const dht::InfoHash& device);
 
     void doRegister_();
 
@@ -728,6 +737,8 @@ private:
     std::shared_ptr<dht::Logger> logger_;
 
     std::shared_ptr<dht::DhtRunner> dht_ {};
+    /** Node serving dht_ if accounts share one, see SharedDhtNode */
+    std::shared_ptr<SharedDhtNode> sharedDht_ {};
     std::unique_ptr<AccountManager> accountManager_;
     dht::crypto::Identity id_ {};
 
@@ -741,7 +752,7 @@ private:
 
     /* tracked buddies presence */
     mutable std::mutex buddyInfoMtx;
-    std::map<dht::InfoHash, BuddyInfo> trackedBuddies_;
+    std::shared_ptr<PresenceScheduler> presence_;
 
     mutable std::mutex dhtValuesMtx_;
     bool dhtPublicInCalls_ {true};
@@ -25,6 +25,7 @@
 #include "logger.h"
 #include "string_utils.h"
 #include "fileutils.h"
+#include "persistence.h"
 #include "base64.h"
 #include "scheduled_executor.h"
 
@@ -440,8 +441,9 @@ void
 NameDirectory::scheduleCacheSave()
 {
     // JAMI_DBG("Scheduling cache save to %s", cachePath_.c_str());
+    static const auto key = ScheduledExecutor::key("namedirectory");
     std::weak_ptr<Task> task = Manager::instance().scheduler().scheduleIn(
-        [this] { dht::ThreadPool::io().run([this] { saveCache(); }); }, SAVE_INTERVAL);
+        key, [this] { dht::ThreadPool::io().run([this] { saveCache(); }); }, SAVE_INTERVAL);
     std::swap(saveTask_, task);
     if (auto old = task.lock())
         old->cancel();
@@ -451,11 +453,9 @@ void
 NameDirectory::saveCache()
 {
     fileutils::recursive_mkdir(fileutils::get_cache_dir() + DIR_SEPARATOR_STR + CACHE_DIRECTORY);
-    std::lock_guard<std::mutex> lock(fileutils::getFileLock(cachePath_));
-    std::ofstream file = fileutils::ofstream(cachePath_, std::ios::trunc | std::ios::binary);
     {
         std::lock_guard<std::mutex> l(cacheLock_);
-        msgpack::pack(file, nameCache_);
+        Persistence::instance().writePacked(cachePath_, nameCache_);
     }
     JAMI_DBG("Saved %lu name-address mappings to %s",
              (long unsigned) nameCache_.size(),
@@ -469,7 +469,7 @@ NameDirectory::loadCache()
 
     // read file
     {
-        std::lock_guard<std::mutex> lock(fileutils::getFileLock(cachePath_));
+        Persistence::instance().flush(cachePath_);
         std::ifstream file = fileutils::ifstream(cachePath_);
         if (!file.is_open()) {
             JAMI_DBG("Could not load %s", cachePath_.c_str());
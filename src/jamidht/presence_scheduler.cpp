@@ -0,0 +1,334 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "presence_scheduler.h"
+
+#include <algorithm>
+
+namespace jami {
+
+PresenceScheduler::PresenceScheduler(ScheduledExecutor& executor,
+                                     std::string_view name,
+                                     ListenCb&& listen,
+                                     CancelListenCb&& cancelListen,
+                                     PresenceCb&& onPresenceLost,
+                                     const Config& config)
+    : executor_(executor)
+    , key_(ScheduledExecutor::key(name))
+    , config_(config)
+    , listen_(std::move(listen))
+    , cancelListen_(std::move(cancelListen))
+    , onPresenceLost_(std::move(onPresenceLost))
+{}
+
+PresenceScheduler::~PresenceScheduler()
+{
+    if (rotationTask_)
+        rotationTask_->cancel();
+    if (drainTask_)
+        drainTask_->cancel();
+}
+
+bool
+PresenceScheduler::track(const std::string& buddy, time_point lastActivity)
+{
+    std::vector<std::string> lost;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        auto [it, inserted] = buddies_.emplace(buddy, Buddy {});
+        if (not inserted)
+            return false;
+        it->second.lastActivity = lastActivity;
+        if (buddies_.size() <= config_.maxListens) {
+            it->second.token = listen_(buddy);
+            if (it->second.token.valid()) {
+                it->second.listening = true;
+                ++listening_;
+            }
+        } else {
+            rebalance(lost);
+        }
+        if (not rotationTask_)
+            startRotation();
+    }
+    notifyLost(lost);
+    return true;
+}
+
+void
+PresenceScheduler::untrack(const std::string& buddy)
+{
+    std::vector<std::string> lost;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        auto it = buddies_.find(buddy);
+        if (it == buddies_.end())
+            return;
+        auto wasFull = buddies_.size() > config_.maxListens;
+        if (it->second.listening) {
+            cancelListen_(buddy, std::move(it->second.token));
+            --listening_;
+        }
+        buddies_.erase(it);
+        if (wasFull)
+            rebalance(lost);
+    }
+    notifyLost(lost);
+}
+
+void
+PresenceScheduler::touch(const std::string& buddy, time_point t)
+{
+    std::vector<std::string> lost;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        auto it = buddies_.find(buddy);
+        if (it == buddies_.end() or it->second.lastActivity >= t)
+            return;
+        it->second.lastActivity = t;
+        // Promote the buddy now rather than waiting for its turn in the rotation
+        if (not it->second.listening)
+            rebalance(lost);
+    }
+    notifyLost(lost);
+}
+
+std::optional<PresenceScheduler::Transition>
+PresenceScheduler::deviceAnnounced(const std::string& buddy, bool expired)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = buddies_.find(buddy);
+    if (it == buddies_.end() or not it->second.listening)
+        return std::nullopt;
+    auto& devices = it->second.devices;
+    Transition t;
+    t.wasOnline = devices > 0;
+    if (not expired)
+        ++devices;
+    else if (devices > 0)
+        --devices;
+    t.isOnline = devices > 0;
+    return t;
+}
+
+void
+PresenceScheduler::restart()
+{
+    std::vector<std::string> lost;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        // Tokens belong to the previous DHT instance, drop them without cancelling
+        for (auto& [id, buddy] : buddies_) {
+            buddy.token = {};
+            buddy.listening = false;
+            buddy.devices = 0;
+        }
+        listening_ = 0;
+        rebalance(lost);
+    }
+    notifyLost(lost);
+}
+
+void
+PresenceScheduler::scheduleReconnect(const std::string& key, std::function<void()>&& job)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = reconnectJobs_.find(key);
+    if (it != reconnectJobs_.end()) {
+        it->second = std::move(job);
+        return;
+    }
+    reconnectJobs_.emplace(key, std::move(job));
+    reconnectQueue_.emplace_back(key);
+    scheduleDrain();
+}
+
+std::map<std::string, bool>
+PresenceScheduler::presence() const
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::map<std::string, bool> ret;
+    for (const auto& [id, buddy] : buddies_)
+        ret.emplace(id, buddy.devices > 0);
+    return ret;
+}
+
+bool
+PresenceScheduler::isListening(const std::string& buddy) const
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = buddies_.find(buddy);
+    return it != buddies_.end() and it->second.listening;
+}
+
+size_t
+PresenceScheduler::listening() const
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    return listening_;
+}
+
+size_t
+PresenceScheduler::pendingReconnects() const
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    return reconnectQueue_.size();
+}
+
+void
+PresenceScheduler::startRotation()
+{
+    rotationTask_ = executor_.scheduleAtFixedRate(
+        key_,
+        [w = weak_from_this()] {
+            auto sthis = w.lock();
+            if (not sthis)
+                return false;
+            sthis->rotate();
+            return true;
+        },
+        config_.rotationPeriod);
+}
+
+void
+PresenceScheduler::rotate()
+{
+    std::vector<std::string> lost;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        rotation_ += config_.rotatingListens;
+        // Also retries listens that failed while the DHT wasn't running
+        rebalance(lost);
+    }
+    notifyLost(lost);
+}
+
+void
+PresenceScheduler::rebalance(std::vector<std::string>& lost)
+{
+    using BuddyIt = decltype(buddies_)::iterator;
+    std::vector<BuddyIt> order;
+    order.reserve(buddies_.size());
+    for (auto it = buddies_.begin(); it != buddies_.end(); ++it)
+        order.emplace_back(it);
+
+    auto permanent = order.size();
+    if (order.size() > config_.maxListens) {
+        std::sort(order.begin(), order.end(), [](const BuddyIt& a, const BuddyIt& b) {
+            bool aOnline = a->second.devices > 0, bOnline = b->second.devices > 0;
+            if (aOnline != bOnline)
+                return aOnline;
+            if (a->second.lastActivity != b->second.lastActivity)
+                return a->second.lastActivity > b->second.lastActivity;
+            return a->first < b->first;
+        });
+        permanent = config_.maxListens - std::min(config_.rotatingListens, config_.maxListens);
+    }
+
+    std::vector<bool> wanted(order.size(), false);
+    std::fill(wanted.begin(), wanted.begin() + permanent, true);
+    if (auto tail = order.size() - permanent) {
+        auto slots = std::min(config_.maxListens - permanent, tail);
+        for (size_t i = 0; i < slots; ++i)
+            wanted[permanent + (rotation_ + i) % tail] = true;
+    }
+
+    // Cancel first so the number of listens never exceeds the limit
+    for (size_t i = 0; i < order.size(); ++i) {
+        auto& [id, buddy] = *order[i];
+        if (wanted[i] or not buddy.listening)
+            continue;
+        cancelListen_(id, std::move(buddy.token));
+        buddy.listening = false;
+        --listening_;
+        if (buddy.devices > 0) {
+            buddy.devices = 0;
+            lost.emplace_back(id);
+        }
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+        auto& [id, buddy] = *order[i];
+        if (not wanted[i] or buddy.listening)
+            continue;
+        buddy.token = listen_(id);
+        if (buddy.token.valid()) {
+            buddy.listening = true;
+            ++listening_;
+        }
+    }
+}
+
+void
+PresenceScheduler::notifyLost(const std::vector<std::string>& lost)
+{
+    for (const auto& id : lost)
+        onPresenceLost_(id, false);
+}
+
+void
+PresenceScheduler::scheduleDrain()
+{
+    if (drainPending_)
+        return;
+    drainPending_ = true;
+    auto now = std::chrono::steady_clock::now();
+    auto next = lastDrain_ + config_.reconnectInterval;
+    if (next <= now) {
+        executor_.run(key_, [w = weak_from_this()] {
+            if (auto sthis = w.lock())
+                sthis->drain();
+        });
+        return;
+    }
+    auto jitter = config_.reconnectJitter.count() > 0
+                      ? duration(std::uniform_int_distribution<duration::rep>(
+                          0, config_.reconnectJitter.count())(rand_))
+                      : duration::zero();
+    drainTask_ = executor_.scheduleIn(
+        key_,
+        [w = weak_from_this()] {
+            if (auto sthis = w.lock())
+                sthis->drain();
+        },
+        next - now + jitter);
+}
+
+void
+PresenceScheduler::drain()
+{
+    std::vector<std::function<void()>> jobs;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        drainPending_ = false;
+        drainTask_.reset();
+        lastDrain_ = std::chrono::steady_clock::now();
+        while (jobs.size() < std::max<size_t>(config_.reconnectBurst, 1) and not reconnectQueue_.empty()) {
+            auto node = reconnectJobs_.extract(reconnectQueue_.front());
+            reconnectQueue_.pop_front();
+            if (node)
+                jobs.emplace_back(std::move(node.mapped()));
+        }
+        if (not reconnectQueue_.empty())
+            scheduleDrain();
+    }
+    for (auto& job : jobs)
+        if (job)
+            job();
+}
+
+} // namespace jami
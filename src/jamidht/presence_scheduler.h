@@ -0,0 +1,173 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include "scheduled_executor.h"
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace jami {
+
+/**
+ * Schedule the DHT listens used to track the presence of an account's buddies.
+ *
+ * At most maxListens buddies are listened at once. Buddies are ordered by
+ * presence (online first) then by last activity (most recent conversations
+ * first): the first (maxListens - rotatingListens) are listened permanently
+ * while the remaining slots rotate over the other buddies every
+ * rotationPeriod. A buddy dropped from the listened set has no known presence
+ * anymore and is reported offline.
+ *
+ * Work triggered by buddies coming online (message retries, sync connections,
+ * trust requests) goes through scheduleReconnect(), which coalesces it by key
+ * and runs at most reconnectBurst jobs every reconnectInterval (plus jitter),
+ * so a DHT (re)connection with many online buddies doesn't open every
+ * connection at once.
+ */
+class PresenceScheduler : public std::enable_shared_from_this<PresenceScheduler>
+{
+public:
+    using time_point = std::chrono::system_clock::time_point;
+    using duration = std::chrono::steady_clock::duration;
+
+    struct Config
+    {
+        size_t maxListens {256};
+        size_t rotatingListens {16};
+        duration rotationPeriod {std::chrono::minutes(2)};
+        duration reconnectInterval {std::chrono::milliseconds(100)};
+        duration reconnectJitter {std::chrono::milliseconds(100)};
+        size_t reconnectBurst {4};
+    };
+
+    /** Start listening for device announcements of a buddy, an invalid future means failure */
+    using ListenCb = std::function<std::future<size_t>(const std::string& buddy)>;
+    using CancelListenCb = std::function<void(const std::string& buddy, std::future<size_t>&&)>;
+    using PresenceCb = std::function<void(const std::string& buddy, bool online)>;
+
+    struct Transition
+    {
+        bool wasOnline {false};
+        bool isOnline {false};
+    };
+
+    PresenceScheduler(ScheduledExecutor& executor,
+                      std::string_view name,
+                      ListenCb&& listen,
+                      CancelListenCb&& cancelListen,
+                      PresenceCb&& onPresenceLost,
+                      const Config& config);
+    PresenceScheduler(ScheduledExecutor& executor,
+                      std::string_view name,
+                      ListenCb&& listen,
+                      CancelListenCb&& cancelListen,
+                      PresenceCb&& onPresenceLost)
+        : PresenceScheduler(executor,
+                            name,
+                            std::move(listen),
+                            std::move(cancelListen),
+                            std::move(onPresenceLost),
+                            Config {})
+    {}
+    ~PresenceScheduler();
+
+    /**
+     * Track a buddy, @lastActivity gives its initial priority.
+     * @return false if it was already tracked
+     */
+    bool track(const std::string& buddy, time_point lastActivity = {});
+    void untrack(const std::string& buddy);
+
+    /**
+     * Raise the priority of a buddy after some activity with it (message, call).
+     */
+    void touch(const std::string& buddy, time_point t = std::chrono::system_clock::now());
+
+    /**
+     * Account a device announcement (or expiration) received for a buddy.
+     * @return the presence before and after the announcement, or nullopt if the
+     *         buddy isn't listened anymore
+     */
+    std::optional<Transition> deviceAnnounced(const std::string& buddy, bool expired);
+
+    /**
+     * Listen again for all buddies, needed after the DHT has been restarted
+     * as previous listen tokens are invalid.
+     */
+    void restart();
+
+    /**
+     * Run @job after the buddy-online rate limit. A job submitted with the same
+     * key as a pending one replaces it.
+     */
+    void scheduleReconnect(const std::string& key, std::function<void()>&& job);
+
+    std::map<std::string, bool> presence() const;
+    bool isListening(const std::string& buddy) const;
+    size_t listening() const;
+    size_t pendingReconnects() const;
+
+private:
+    struct Buddy
+    {
+        time_point lastActivity {};
+        uint32_t devices {0};
+        bool listening {false};
+        std::future<size_t> token {};
+    };
+
+    void startRotation();
+    void rotate();
+    void rebalance(std::vector<std::string>& lost);
+    void notifyLost(const std::vector<std::string>& lost);
+    void scheduleDrain();
+    void drain();
+
+    ScheduledExecutor& executor_;
+    const ScheduledExecutor::Key key_;
+    const Config config_;
+    ListenCb listen_;
+    CancelListenCb cancelListen_;
+    PresenceCb onPresenceLost_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Buddy> buddies_;
+    size_t listening_ {0};
+    size_t rotation_ {0};
+    std::shared_ptr<RepeatedTask> rotationTask_;
+
+    std::deque<std::string> reconnectQueue_;
+    std::map<std::string, std::function<void()>> reconnectJobs_;
+    std::shared_ptr<Task> drainTask_;
+    bool drainPending_ {false};
+    std::chrono::steady_clock::time_point lastDrain_ {};
+    std::mt19937_64 rand_ {std::random_device {}()};
+};
+
+} // namespace jami
@@ -0,0 +1,136 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "shared_dht_node.h"
+
+#include "logger.h"
+
+#ifdef OPENDHT_PROXY_SERVER
+#include <opendht/dht_proxy_server.h>
+#endif
+
+#include <cerrno>
+
+namespace jami {
+
+/**
+ * Socket of a proxy client: the local DHT of the runner has no network
+ */
+class ProxyClientSocket : public dht::net::DatagramSocket
+{
+public:
+    int sendTo(const dht::SockAddr&, const uint8_t*, size_t, bool) override
+    {
+        return ENETUNREACH;
+    }
+    bool hasIPv4() const override { return false; }
+    bool hasIPv6() const override { return false; }
+    const dht::SockAddr& getBoundRef(sa_family_t) const override { return bound_; }
+    void stop() override {}
+
+private:
+    const dht::SockAddr bound_ {};
+};
+
+static std::mutex sharedMtx;
+static std::weak_ptr<SharedDhtNode> sharedNode;
+
+std::shared_ptr<SharedDhtNode>
+SharedDhtNode::acquire(const Config& config)
+{
+    std::lock_guard<std::mutex> lk(sharedMtx);
+    auto node = sharedNode.lock();
+    if (not node) {
+        try {
+            node = std::make_shared<SharedDhtNode>(config);
+        } catch (const std::exception& e) {
+            JAMI_ERROR("Unable to start the shared DHT node: {}", e.what());
+            return {};
+        }
+        sharedNode = node;
+    }
+    return node;
+}
+
+std::shared_ptr<SharedDhtNode>
+SharedDhtNode::current()
+{
+    std::lock_guard<std::mutex> lk(sharedMtx);
+    return sharedNode.lock();
+}
+
+std::unique_ptr<dht::net::DatagramSocket>
+SharedDhtNode::clientSocket()
+{
+    return std::make_unique<ProxyClientSocket>();
+}
+
+SharedDhtNode::SharedDhtNode(const Config& config)
+    : config_(config)
+    , node_(std::make_shared<dht::DhtRunner>())
+{
+#ifndef OPENDHT_PROXY_SERVER
+    throw std::runtime_error("OpenDHT was built without proxy server support");
+#else
+    dht::DhtRunner::Config dhtConfig {};
+    dhtConfig.dht_config.node_config.network = 0;
+    dhtConfig.dht_config.node_config.maintain_storage = false;
+    dhtConfig.dht_config.node_config.persist_path = config_.persistPath;
+    dhtConfig.threaded = true;
+    dhtConfig.peer_discovery = config_.peerDiscovery;
+    dhtConfig.peer_publish = config_.peerDiscovery;
+    node_->run(config_.dhtPort, dhtConfig);
+
+    dht::ProxyServerConfig proxyConfig;
+    proxyConfig.address = "127.0.0.1";
+    proxyConfig.port = config_.proxyPort;
+    try {
+        proxy_ = std::make_shared<dht::DhtProxyServer>(node_, proxyConfig);
+    } catch (...) {
+        node_->join();
+        throw;
+    }
+    JAMI_LOG("Shared DHT node started on port {}, serving accounts on {}",
+             node_->getBoundPort(),
+             proxyServer());
+#endif
+}
+
+SharedDhtNode::~SharedDhtNode()
+{
+    proxy_.reset();
+    node_->join();
+    JAMI_LOG("Shared DHT node stopped");
+}
+
+void
+SharedDhtNode::bootstrap(const std::vector<std::string>& nodes)
+{
+    std::lock_guard<std::mutex> lk(bootstrapMtx_);
+    for (const auto& n : nodes)
+        if (bootstrapped_.emplace(n).second)
+            node_->bootstrap(n);
+}
+
+std::string
+SharedDhtNode::proxyServer() const
+{
+    return "127.0.0.1:" + std::to_string(config_.proxyPort);
+}
+
+} // namespace jami
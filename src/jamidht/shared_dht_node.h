@@ -0,0 +1,106 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include <opendht/dhtrunner.h>
+#include <opendht/network_utils.h>
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace dht {
+class DhtProxyServer;
+}
+
+namespace jami {
+
+/**
+ * DHT node shared by the accounts of the daemon.
+ *
+ * Accounts using it don't run their own DHT node (routing table, UDP socket,
+ * bootstrap and maintenance traffic): their DhtRunner is a proxy client of a
+ * proxy server this node exposes on the loopback. Accounts keep their own
+ * identity, values are signed, encrypted and decrypted by their client, while
+ * listens of all accounts are served by the node's searches, one per key.
+ *
+ * Disabled by default, enabled by setting the sharedDhtPort preference to the
+ * port of the loopback proxy server.
+ */
+class SharedDhtNode
+{
+public:
+    struct Config
+    {
+        /** UDP port of the DHT node, 0 for a random one */
+        in_port_t dhtPort {0};
+        /** Loopback port of the proxy server used by accounts */
+        in_port_t proxyPort {0};
+        /** Local peer discovery, done by the node instead of each account */
+        bool peerDiscovery {false};
+        std::string persistPath {};
+    };
+
+    /**
+     * Get the node shared by accounts, started on first use and stopped when
+     * the last account releases it. config is only used to start the node: a
+     * running node is returned as is.
+     * @return nullptr if the node can't be started
+     */
+    static std::shared_ptr<SharedDhtNode> acquire(const Config& config);
+
+    /**
+     * The running node, nullptr if no account uses it
+     */
+    static std::shared_ptr<SharedDhtNode> current();
+
+    /**
+     * Socket for the DhtRunner of accounts using the node. They only talk to
+     * its proxy server: no UDP socket is bound and nothing is sent.
+     */
+    static std::unique_ptr<dht::net::DatagramSocket> clientSocket();
+
+    explicit SharedDhtNode(const Config& config);
+    ~SharedDhtNode();
+
+    /**
+     * Bootstrap the node. Nodes already used are skipped, so accounts sharing
+     * the same bootstrap list don't bootstrap it again.
+     */
+    void bootstrap(const std::vector<std::string>& nodes);
+
+    /**
+     * Address to use as proxy server by accounts
+     */
+    std::string proxyServer() const;
+
+    const std::shared_ptr<dht::DhtRunner>& node() const { return node_; }
+
+private:
+    const Config config_;
+    std::shared_ptr<dht::DhtRunner> node_;
+    std::shared_ptr<dht::DhtProxyServer> proxy_;
+
+    std::mutex bootstrapMtx_;
+    std::set<std::string, std::less<>> bootstrapped_;
+};
+
+} // namespace jami
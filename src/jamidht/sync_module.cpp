@@ -20,12 +20,74 @@
 
 #include "sync_module.h"
 
+#include "archiver.h"
+#include "fileutils.h"
+#include "persistence.h"
 #include "connectivity/multiplexed_socket.h"
 #include "jamidht/conversation_module.h"
 #include "jamidht/archive_account_manager.h"
 
+#include <opendht/thread_pool.h>
+
+#include <cstring>
+#include <set>
+
 namespace jami {
 
+// Keep each message below the max packet size, so older versions,
+// unpacking each received packet separately, can still read it
+static constexpr std::size_t SYNC_BATCH_SIZE = 48 * 1024;
+// Batches bigger than this are compressed for peers supporting it
+static constexpr std::size_t SYNC_COMPRESS_THRESHOLD = 1024;
+// Records keys are prefixed by the field holding them
+static constexpr std::string_view TRUST_REQUEST_PREFIX {"ds.trust_requests:"};
+
+/**
+ * Version of a synced record (a contact, a conversation, a request...)
+ * The version is increased each time the digest of the record changes.
+ */
+struct SyncRecord
+{
+    uint64_t version {0};
+    dht::InfoHash digest {};
+    MSGPACK_DEFINE(version, digest)
+};
+
+/**
+ * Sync progress with another device of the account
+ */
+struct SyncPeer
+{
+    // Last version of our state acknowledged by the peer
+    uint64_t acked {0};
+    // Last version of the peer's state applied locally
+    uint64_t received {0};
+    // If the peer supports incremental sync
+    bool incremental {false};
+    MSGPACK_DEFINE(acked, received, incremental)
+};
+
+struct SyncState
+{
+    uint64_t version {0};
+    std::map<std::string, SyncRecord> records;
+    std::map<std::string, SyncPeer> peers;
+    MSGPACK_DEFINE(version, records, peers)
+};
+
+static std::string
+recordKey(const std::string& key)
+{
+    return key;
+}
+
+template<typename Key>
+static std::string
+recordKey(const Key& key)
+{
+    return key.toString();
+}
+
 class SyncModule::Impl : public std::enable_shared_from_this<Impl>
 {
 public:
@@ -37,6 +99,13 @@ public:
     std::mutex syncConnectionsMtx_;
     std::map<DeviceId /* deviceId */, std::vector<std::shared_ptr<ChannelSocket>>> syncConnections_;
 
+    // Versioned sync state, persisted in the account directory
+    std::mutex stateMtx_;
+    bool stateLoaded_ {false};
+    SyncState state_;
+    // Base version of the last delta sent to each device, waiting for an ack
+    std::map<DeviceId, uint64_t> inFlight_;
+
     std::weak_ptr<Impl> weak() { return std::static_pointer_cast<Impl>(shared_from_this()); }
 
     /**
@@ -45,105 +114,439 @@ public:
      */
     void syncInfos(const std::shared_ptr<ChannelSocket>& socket,
                    const std::shared_ptr<SyncMsg>& syncMsg);
+
+    /**
+     * Send records changed since the last version acknowledged by the device
+     * @param socket
+     */
+    void syncDelta(const std::shared_ptr<ChannelSocket>& socket);
+
+    /**
+     * Handle a SyncMsg received from another device of the account
+     */
+    void onSyncMsg(const std::shared_ptr<ChannelSocket>& socket,
+                   const std::string& peerId,
+                   SyncMsg&& msg);
+
+    void setOnRecv(const std::shared_ptr<ChannelSocket>& socket, const std::string& peerId);
+
+private:
+    /**
+     * Update the version of a record from its current value
+     * @return the version of the record
+     */
+    template<typename T>
+    uint64_t updateRecord(const std::string& key, const T& value, msgpack::sbuffer& buffer);
+
+    /**
+     * Copy entries of `in` changed after `since` in batches, creating a new batch
+     * each time the current one is full
+     * @param field     Returns the map of a batch receiving the entries
+     */
+    template<typename Map, typename Field>
+    void addChanged(const char* prefix,
+                    const Map& in,
+                    Field&& field,
+                    uint64_t since,
+                    std::vector<SyncMsg>& batches,
+                    std::size_t& batchSize);
+
+    bool writeMsg(const std::shared_ptr<ChannelSocket>& socket,
+                  const SyncMsg& msg,
+                  bool compress = false);
+
+    std::string statePath() const;
+    void loadState();
+    void saveState() const;
+
+    std::set<std::string> seen_;
+    msgpack::sbuffer recordBuffer_;
 };
 
 SyncModule::Impl::Impl(std::weak_ptr<JamiAccount>&& account)
     : account_(account)
 {}
 
+std::string
+SyncModule::Impl::statePath() const
+{
+    if (auto acc = account_.lock())
+        return acc->getPath() + DIR_SEPARATOR_STR + "syncState";
+    return {};
+}
+
+void
+SyncModule::Impl::loadState()
+{
+    if (stateLoaded_)
+        return;
+    stateLoaded_ = true;
+    auto path = statePath();
+    if (path.empty())
+        return;
+    try {
+        Persistence::instance().flush(path);
+        auto file = fileutils::loadFile(path);
+        msgpack::object_handle oh = msgpack::unpack((const char*) file.data(), file.size());
+        oh.get().convert(state_);
+    } catch (const std::exception& e) {
+        // No state yet, next sync with each device is a full sync
+        state_ = {};
+    }
+}
+
+void
+SyncModule::Impl::saveState() const
+{
+    auto path = statePath();
+    if (path.empty())
+        return;
+    Persistence::instance().writePacked(path, state_);
+}
+
+template<typename T>
+uint64_t
+SyncModule::Impl::updateRecord(const std::string& key, const T& value, msgpack::sbuffer& buffer)
+{
+    buffer.clear();
+    msgpack::pack(buffer, value);
+    auto digest = dht::InfoHash::get((const uint8_t*) buffer.data(), buffer.size());
+    seen_.emplace(key);
+    auto& record = state_.records[key];
+    if (record.version == 0 or record.digest != digest) {
+        record.version = ++state_.version;
+        record.digest = digest;
+    }
+    return record.version;
+}
+
+template<typename Map, typename Field>
+void
+SyncModule::Impl::addChanged(const char* prefix,
+                             const Map& in,
+                             Field&& field,
+                             uint64_t since,
+                             std::vector<SyncMsg>& batches,
+                             std::size_t& batchSize)
+{
+    for (const auto& [key, value] : in) {
+        if (updateRecord(prefix + recordKey(key), value, recordBuffer_) <= since)
+            continue;
+        if (batches.empty() or batchSize + recordBuffer_.size() > SYNC_BATCH_SIZE) {
+            batches.emplace_back();
+            batchSize = 0;
+        }
+        field(batches.back()).emplace(key, value);
+        batchSize += recordBuffer_.size();
+    }
+}
+
+std::string
+packSyncMsg(const SyncMsg& msg, bool compress)
+{
+    msgpack::sbuffer buffer(UINT16_MAX); // Use max pkt size
+    msgpack::pack(buffer, msg);
+    if (!compress || buffer.size() <= SYNC_COMPRESS_THRESHOLD)
+        return std::string(buffer.data(), buffer.size());
+    SyncMsg compressed;
+    compressed.ds.date = msg.ds.date;
+    compressed.v = msg.v;
+    compressed.s = msg.s;
+    compressed.n = msg.n;
+    compressed.z = archiver::compress(std::string(buffer.data(), buffer.size()));
+    buffer.clear();
+    msgpack::pack(buffer, compressed);
+    return std::string(buffer.data(), buffer.size());
+}
+
+bool
+SyncMsgReader::read(const uint8_t* buf, size_t len, const std::function<void(SyncMsg&&)>& onMsg)
+{
+    unpacker_.reserve_buffer(len);
+    std::memcpy(unpacker_.buffer(), buf, len);
+    unpacker_.buffer_consumed(len);
+
+    msgpack::object_handle oh;
+    while (true) {
+        SyncMsg msg;
+        try {
+            if (!unpacker_.next(oh))
+                break;
+            oh.get().convert(msg);
+        } catch (const std::exception& e) {
+            JAMI_WARNING("[convInfo] error on sync: {:s}", e.what());
+            unpacker_ = msgpack::unpacker();
+            return false;
+        }
+        if (!msg.z.empty()) {
+            try {
+                auto data = archiver::decompress(msg.z);
+                msgpack::object_handle payloadHandle = msgpack::unpack((const char*) data.data(),
+                                                                       data.size());
+                SyncMsg payload;
+                payloadHandle.get().convert(payload);
+                msg.ds = std::move(payload.ds);
+                msg.c = std::move(payload.c);
+                msg.cr = std::move(payload.cr);
+                msg.p = std::move(payload.p);
+                msg.ld = std::move(payload.ld);
+                msg.z.clear();
+            } catch (const std::exception& e) {
+                // The message is complete, only its payload is lost
+                JAMI_WARNING("[convInfo] error on sync: {:s}", e.what());
+                continue;
+            }
+        }
+        onMsg(std::move(msg));
+    }
+    return true;
+}
+
+bool
+SyncModule::Impl::writeMsg(const std::shared_ptr<ChannelSocket>& socket,
+                           const SyncMsg& msg,
+                           bool compress)
+{
+    auto buffer = packSyncMsg(msg, compress);
+    std::error_code ec;
+    socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
+    if (ec) {
+        JAMI_ERROR("{:s}", ec.message());
+        return false;
+    }
+    return true;
+}
+
 void
 SyncModule::Impl::syncInfos(const std::shared_ptr<ChannelSocket>& socket,
                             const std::shared_ptr<SyncMsg>& syncMsg)
+{
+    if (!syncMsg) {
+        syncDelta(socket);
+        return;
+    }
+    writeMsg(socket, *syncMsg);
+}
+
+void
+SyncModule::Impl::syncDelta(const std::shared_ptr<ChannelSocket>& socket)
 {
     auto acc = account_.lock();
     if (!acc)
         return;
-    Json::Value syncValue;
-    msgpack::sbuffer buffer(UINT16_MAX); // Use max pkt size
-    std::error_code ec;
-    if (!syncMsg) {
-        // Send contacts infos
-        // This message can be big. TODO rewrite to only take UINT16_MAX bytes max or split it multiple
-        // messages. For now, write 3 messages (UINT16_MAX*3 should be enough for all informations).
-        if (auto info = acc->accountManager()->getInfo()) {
-            if (info->contacts) {
-                SyncMsg msg;
-                msg.ds = info->contacts->getSyncData();
-                msgpack::pack(buffer, msg);
-                socket->write(reinterpret_cast<const unsigned char*>(buffer.data()),
-                              buffer.size(),
-                              ec);
-                if (ec) {
-                    JAMI_ERROR("{:s}", ec.message());
-                    return;
-                }
-            }
-        }
-        buffer.clear();
-        // Sync conversations
-        auto c = ConversationModule::convInfos(acc->getAccountID());
-        if (!c.empty()) {
-            SyncMsg msg;
-            msg.c = std::move(c);
-            msgpack::pack(buffer, msg);
-            socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
-            if (ec) {
-                JAMI_ERROR("{:s}", ec.message());
-                return;
+    auto deviceId = socket->deviceId();
+
+    // Current state, the same data the legacy full sync was sending
+    DeviceSync ds;
+    ds.date = 0;
+    const ContactList* contacts = nullptr;
+    if (auto info = acc->accountManager()->getInfo())
+        if ((contacts = info->contacts.get()))
+            ds = contacts->getSyncData();
+    auto c = ConversationModule::convInfos(acc->getAccountID());
+    auto cr = ConversationModule::convRequests(acc->getAccountID());
+    std::map<std::string, std::map<std::string, std::string>> p, ld;
+    if (auto convModule = acc->convModule()) {
+        p = convModule->convPreferences();
+        ld = convModule->convDisplayed();
+    }
+
+    std::vector<SyncMsg> batches;
+    bool incremental;
+    {
+        std::lock_guard<std::mutex> lk(stateMtx_);
+        loadState();
+        auto& peer = state_.peers[deviceId.toString()];
+        incremental = peer.incremental;
+        auto base = incremental ? peer.acked : 0;
+        if (base > state_.version)
+            base = 0;
+
+        seen_.clear();
+        std::size_t batchSize = 0;
+        addChanged(
+            "ds.devices_known:",
+            ds.devices_known,
+            [](auto& m) -> auto& { return m.ds.devices_known; },
+            base,
+            batches,
+            batchSize);
+        addChanged(
+            "ds.devices:",
+            ds.devices,
+            [](auto& m) -> auto& { return m.ds.devices; },
+            base,
+            batches,
+            batchSize);
+        addChanged(
+            "ds.peers:",
+            ds.peers,
+            [](auto& m) -> auto& { return m.ds.peers; },
+            base,
+            batches,
+            batchSize);
+        addChanged(
+            TRUST_REQUEST_PREFIX.data(),
+            ds.trust_requests,
+            [](auto& m) -> auto& { return m.ds.trust_requests; },
+            base,
+            batches,
+            batchSize);
+        addChanged(
+            "c:",
+            c,
+            [](auto& m) -> auto& { return m.c; },
+            base,
+            batches,
+            batchSize);
+        addChanged(
+            "cr:",
+            cr,
+            [](auto& m) -> auto& { return m.cr; },
+            base,
+            batches,
+            batchSize);
+        addChanged(
+            "p:",
+            p,
+            [](auto& m) -> auto& { return m.p; },
+            base,
+            batches,
+            batchSize);
+        addChanged(
+            "ld:",
+            ld,
+            [](auto& m) -> auto& { return m.ld; },
+            base,
+            batches,
+            batchSize);
+        // Forget removed records. Only a sample of the trust requests is sent
+        // each time: one missing from the sample is removed only if the
+        // contact list doesn't have it anymore.
+        for (auto it = state_.records.begin(); it != state_.records.end();) {
+            bool removed = seen_.find(it->first) == seen_.end();
+            if (removed && contacts
+                && std::string_view(it->first).substr(0, TRUST_REQUEST_PREFIX.size())
+                       == TRUST_REQUEST_PREFIX) {
+                dht::InfoHash from(it->first.substr(TRUST_REQUEST_PREFIX.size()));
+                removed = contacts->getTrustRequest(from).empty();
             }
+            if (removed)
+                it = state_.records.erase(it);
+            else
+                ++it;
         }
-        buffer.clear();
-        // Sync requests
-        auto cr = ConversationModule::convRequests(acc->getAccountID());
-        if (!cr.empty()) {
-            SyncMsg msg;
-            msg.cr = std::move(cr);
-            msgpack::pack(buffer, msg);
-            socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
-            if (ec) {
-                JAMI_ERROR("{:s}", ec.message());
-                return;
-            }
+        seen_.clear();
+
+        // Always send at least one message so the peer acknowledges our version
+        if (batches.empty())
+            batches.emplace_back();
+        for (std::size_t i = 0; i < batches.size(); i++) {
+            auto& batch = batches[i];
+            batch.ds.date = ds.date;
+            batch.ds.device_name = ds.device_name;
+            batch.v = state_.version;
+            batch.s = base;
+            batch.n = static_cast<uint32_t>(batches.size() - i - 1);
         }
+        inFlight_[deviceId] = base;
+        saveState();
+        JAMI_DEBUG("[Account {}] sync with {}: {:d} batch(es) since version {:d}/{:d}",
+                   acc->getAccountID(),
+                   deviceId.toString(),
+                   batches.size(),
+                   base,
+                   state_.version);
+    }
 
-        auto convModule = acc->convModule();
-        if (!convModule)
+    for (auto& batch : batches)
+        if (!writeMsg(socket, batch, incremental))
             return;
-        // Sync conversation's preferences
-        auto p = convModule->convPreferences();
-        if (!p.empty()) {
-            SyncMsg msg;
-            msg.p = std::move(p);
-            msgpack::pack(buffer, msg);
-            socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
-            if (ec) {
-                JAMI_ERROR("{:s}", ec.message());
-                return;
+}
+
+void
+SyncModule::Impl::onSyncMsg(const std::shared_ptr<ChannelSocket>& socket,
+                            const std::string& peerId,
+                            SyncMsg&& msg)
+{
+    auto acc = account_.lock();
+    if (!acc)
+        return;
+    auto deviceId = socket->deviceId();
+
+    if (msg.ack) {
+        bool resync = false;
+        {
+            std::lock_guard<std::mutex> lk(stateMtx_);
+            loadState();
+            auto& peer = state_.peers[deviceId.toString()];
+            peer.incremental = true;
+            peer.acked = msg.a <= state_.version ? msg.a : 0;
+            // The peer is missing versions we didn't send (e.g. its state was reset)
+            auto it = inFlight_.find(deviceId);
+            if (it != inFlight_.end()) {
+                resync = peer.acked < it->second;
+                inFlight_.erase(it);
             }
+            saveState();
         }
-        buffer.clear();
-        // Sync read's status
-        auto ld = convModule->convDisplayed();
-        if (!ld.empty()) {
-            SyncMsg msg;
-            msg.ld = std::move(ld);
-            msgpack::pack(buffer, msg);
-            socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
-            if (ec) {
-                JAMI_ERROR("{:s}", ec.message());
-                return;
-            }
+        if (resync) {
+            JAMI_DEBUG("[Account {}] {} is missing sync data, resending",
+                       acc->getAccountID(),
+                       deviceId.toString());
+            dht::ThreadPool::io().run([w = weak(), socket] {
+                if (auto shared = w.lock())
+                    shared->syncDelta(socket);
+            });
         }
-        buffer.clear();
+        return;
+    }
+
+    if (auto manager = dynamic_cast<ArchiveAccountManager*>(acc->accountManager()))
+        manager->onSyncData(std::move(msg.ds), false);
 
-    } else {
-        msgpack::pack(buffer, *syncMsg);
-        socket->write(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size(), ec);
-        if (ec)
-            JAMI_ERROR("{:s}", ec.message());
+    if (!msg.c.empty() || !msg.cr.empty() || !msg.p.empty() || !msg.ld.empty())
+        if (auto convModule = acc->convModule())
+            convModule->onSyncData(msg, peerId, deviceId.toString());
+
+    // Acknowledge the last batch of an incremental sync
+    if (msg.v != 0 && msg.n == 0) {
+        SyncMsg ack;
+        ack.ack = true;
+        {
+            std::lock_guard<std::mutex> lk(stateMtx_);
+            loadState();
+            auto& peer = state_.peers[deviceId.toString()];
+            peer.incremental = true;
+            // Records between our last version and the base of the delta are missing
+            if (msg.s <= peer.received)
+                peer.received = msg.v;
+            ack.a = peer.received;
+            saveState();
+        }
+        writeMsg(socket, ack);
     }
 }
 
+void
+SyncModule::Impl::setOnRecv(const std::shared_ptr<ChannelSocket>& socket, const std::string& peerId)
+{
+    socket->setOnRecv([w = weak(),
+                       wsocket = std::weak_ptr<ChannelSocket>(socket),
+                       peerId,
+                       reader = std::make_shared<SyncMsgReader>()](const uint8_t* buf,
+                                                                   size_t len) {
+        auto shared = w.lock();
+        auto socket = wsocket.lock();
+        if (!buf || !shared || !socket)
+            return len;
+        reader->read(buf, len, [&](SyncMsg&& msg) {
+            shared->onSyncMsg(socket, peerId, std::move(msg));
+        });
+        return len;
+    });
+}
+
 ////////////////////////////////////////////////////////////////
 
 SyncModule::SyncModule(std::weak_ptr<JamiAccount>&& account)
@@ -173,28 +576,7 @@ SyncModule::cacheSyncConnection(std::shared_ptr<ChannelSocket>&& socket,
         }
     });
 
-    socket->setOnRecv([acc = pimpl_->account_.lock(), device, peerId](const uint8_t* buf,
-                                                                      size_t len) {
-        if (!buf || !acc)
-            return len;
-
-        SyncMsg msg;
-        try {
-            msgpack::unpacked result;
-            msgpack::object_handle oh = msgpack::unpack(reinterpret_cast<const char*>(buf), len);
-            oh.get().convert(msg);
-        } catch (const std::exception& e) {
-            JAMI_WARNING("[convInfo] error on sync: {:s}", e.what());
-            return len;
-        }
-
-        if (auto manager = dynamic_cast<ArchiveAccountManager*>(acc->accountManager()))
-            manager->onSyncData(std::move(msg.ds), false);
-
-        if (!msg.c.empty() || !msg.cr.empty() || !msg.p.empty() || !msg.ld.empty())
-            acc->convModule()->onSyncData(msg, peerId, device.toString());
-        return len;
-    });
+    pimpl_->setOnRecv(socket, peerId);
 }
 
 void
@@ -226,6 +608,9 @@ SyncModule::syncWith(const DeviceId& deviceId,
         });
         pimpl_->syncConnections_[deviceId].emplace_back(socket);
     }
+    // Receive acknowledgements and sync data from the peer
+    if (auto acc = pimpl_->account_.lock())
+        pimpl_->setOnRecv(socket, acc->getUsername());
     pimpl_->syncInfos(socket, syncMsg);
 }
 
@@ -24,6 +24,30 @@
 
 namespace jami {
 
+/**
+ * Pack a SyncMsg for a sync channel
+ * @param compress  If the payload can be compressed (peer supports incremental sync)
+ */
+std::string packSyncMsg(const SyncMsg& msg, bool compress);
+
+/**
+ * Read SyncMsg from the data received on a sync channel.
+ * Messages can be split or coalesced by the transport, compressed
+ * payloads are expanded before being returned.
+ */
+class SyncMsgReader
+{
+public:
+    /**
+     * @return false if the data is invalid, buffered data is then dropped
+     * and the next packet starts a new message
+     */
+    bool read(const uint8_t* buf, size_t len, const std::function<void(SyncMsg&&)>& onMsg);
+
+private:
+    msgpack::unpacker unpacker_;
+};
+
 class SyncModule
 {
 public:
@@ -42,6 +66,8 @@ public:
 
     /**
      * Send sync informations to connected device
+     * Only records changed since the last version acknowledged by the device
+     * are sent, devices running older versions always get a full sync.
      * @param deviceId      Connected device
      * @param socket        Related socket
      * @param syncMsg       Default message
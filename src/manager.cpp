@@ -40,6 +40,8 @@
 #include "fileutils.h"
 #include "gittransport.h"
 #include "map_utils.h"
+#include "metrics.h"
+#include "persistence.h"
 #include "account.h"
 #include "string_utils.h"
 #include "jamidht/jamiaccount.h"
@@ -361,8 +363,13 @@ struct Manager::ManagerPimpl
     std::shared_ptr<asio::io_context> ioContext_;
     std::thread ioContextRunner_;
 
-    /** Main scheduler */
-    ScheduledExecutor scheduler_ {"manager"};
+    /** Main scheduler, keyed jobs run on the extra worker threads */
+    ScheduledExecutor scheduler_ {"manager",
+                                 std::clamp(std::thread::hardware_concurrency(), 2u, 4u)};
+
+    /** Periodic metrics report */
+    std::mutex metricsReportMtx_ {};
+    std::shared_ptr<RepeatedTask> metricsReportTask_ {};
 
     std::atomic_bool autoAnswer_ {false};
 
@@ -873,8 +880,8 @@ Manager::finish() noexcept
 
         // Hangup all remaining active calls
         JAMI_DBG("Hangup %zu remaining call(s)", callFactory.callCount());
-        for (const auto& call : callFactory.getAllCalls())
-            hangupCall(call->getAccountId(), call->getCallId());
+        callFactory.forEachCall(
+            [&](const auto& call) { hangupCall(call->getAccountId(), call->getCallId()); });
         callFactory.clear();
 
         for (const auto& account : getAllAccounts<JamiAccount>()) {
@@ -900,6 +907,9 @@ Manager::finish() noexcept
         dht::ThreadPool::io().join();
         dht::ThreadPool::computation().join();
 
+        // Write state files still queued
+        Persistence::instance().flush();
+
         // IceTransportFactory should be stopped after the io pool
         // as some ICE are destroyed in a ioPool (see ConnectionManager)
         // Also, it must be called before pj_shutdown to avoid any problem
@@ -950,8 +960,7 @@ Manager::monitor(bool continuous)
 #endif
 #endif
 
-    for (const auto& call : callFactory.getAllCalls())
-        call->monitor();
+    callFactory.forEachCall([](const auto& call) { call->monitor(); });
     for (const auto& account : getAllAccounts())
         if (auto acc = std::dynamic_pointer_cast<JamiAccount>(account))
             acc->monitor();
@@ -968,11 +977,11 @@ Manager::isCurrentCall(const Call& call) const
 bool
 Manager::hasCurrentCall() const
 {
-    for (const auto& call : callFactory.getAllCalls()) {
-        if (!call->isSubcall() && call->getStateStr() == libjami::Call::StateEvent::CURRENT)
-            return true;
-    }
-    return false;
+    return callFactory.findCall([](const auto& call) {
+               return !call->isSubcall()
+                      && call->getStateStr() == libjami::Call::StateEvent::CURRENT;
+           })
+           != nullptr;
 }
 
 std::shared_ptr<Call>
@@ -2506,23 +2515,19 @@ Manager::ManagerPimpl::processIncomingCall(const std::string& accountId, Call& i
         dht::ThreadPool::io().run([this, account, incomCall = incomCall.shared_from_this()] {
             base_.answerCall(*incomCall);
 
-            for (const auto& callId : account->getCallList()) {
-                if (auto call = account->getCall(callId)) {
-                    if (call->getState() != Call::CallState::ACTIVE)
-                        continue;
-                    if (call != incomCall) {
-                        if (auto conf = call->getConference()) {
-                            base_.addParticipant(*incomCall, *conf);
-                        } else {
-                            base_.joinParticipant(account->getAccountID(),
-                                                  incomCall->getCallId(),
-                                                  account->getAccountID(),
-                                                  call->getCallId(),
-                                                  false);
-                        }
-                        return;
-                    }
+            if (auto call = account->findCall([&](const auto& call) {
+                    return call != incomCall && call->getState() == Call::CallState::ACTIVE;
+                })) {
+                if (auto conf = call->getConference()) {
+                    base_.addParticipant(*incomCall, *conf);
+                } else {
+                    base_.joinParticipant(account->getAccountID(),
+                                          incomCall->getCallId(),
+                                          account->getAccountID(),
+                                          call->getCallId(),
+                                          false);
                 }
+                return;
             }
 
             // First call
@@ -2854,10 +2859,12 @@ std::vector<std::string>
 Manager::getCallList() const
 {
     std::vector<std::string> results;
-    for (const auto& call : callFactory.getAllCalls()) {
+    results.reserve(callFactory.callCount());
+    callFactory.forEachCall([&](const auto& call) {
         if (!call->isSubcall())
             results.push_back(call->getCallId());
-    }
+    });
+    std::sort(results.begin(), results.end());
     return results;
 }
 
@@ -3167,6 +3174,27 @@ Manager::getNearbyPeers(const std::string& accountID)
     return {};
 }
 
+void
+Manager::setMetricsReportInterval(std::chrono::milliseconds interval)
+{
+    std::lock_guard<std::mutex> lk(pimpl_->metricsReportMtx_);
+    if (pimpl_->metricsReportTask_) {
+        pimpl_->metricsReportTask_->cancel();
+        pimpl_->metricsReportTask_.reset();
+    }
+    if (interval.count() <= 0)
+        return;
+    static const auto key = ScheduledExecutor::key("metrics");
+    pimpl_->metricsReportTask_ = pimpl_->scheduler_.scheduleAtFixedRate(
+        key,
+        [] {
+            emitSignal<libjami::ConfigurationSignal::MetricsReport>(
+                metrics::Registry::instance().snapshot());
+            return true;
+        },
+        interval);
+}
+
 void
 Manager::setDefaultModerator(const std::string& accountID, const std::string& peerURI, bool state)
 {
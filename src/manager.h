@@ -798,6 +798,12 @@ public:
 
     std::map<std::string, std::string> getNearbyPeers(const std::string& accountID);
 
+    /**
+     * Periodically emit a snapshot of the metrics registry
+     * @param interval  Report period, zero to disable
+     */
+    void setMetricsReportInterval(std::chrono::milliseconds interval);
+
 #ifdef ENABLE_VIDEO
     /**
      * Create a new SinkClient instance, store it in an internal cache as a weak_ptr
@@ -0,0 +1,178 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#include "audio_clock.h"
+
+#include "logger.h"
+#include "metrics.h"
+
+#include <algorithm>
+
+namespace jami {
+
+AudioClock&
+AudioClock::instance()
+{
+    // Intentionally leaked: inputs may be removed during static destruction
+    static AudioClock* audioClock = new AudioClock;
+    return *audioClock;
+}
+
+AudioClock::AudioClock(clock::duration period)
+    : period_(period)
+    , thread_([this] { run(); })
+{}
+
+AudioClock::~AudioClock()
+{
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+AudioClock::Id
+AudioClock::add(std::function<void()>&& tick)
+{
+    if (std::this_thread::get_id() == thread_.get_id()) {
+        // Called from a tick: mutex_ is already held
+        auto id = nextId_++;
+        pending_.emplace_back(Entry {id, std::move(tick)});
+        return id;
+    }
+    Id id;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        id = nextId_++;
+        entries_.emplace_back(Entry {id, std::move(tick)});
+    }
+    cv_.notify_all();
+    return id;
+}
+
+void
+AudioClock::remove(Id id)
+{
+    auto deactivate = [&](std::vector<Entry>& entries) {
+        for (auto& entry : entries) {
+            if (entry.id == id && entry.active) {
+                entry.active = false;
+                removed_ = true;
+                return true;
+            }
+        }
+        return false;
+    };
+    if (std::this_thread::get_id() == thread_.get_id()) {
+        // Called from a tick: the entry may be running, erase it after the tick
+        if (not deactivate(entries_))
+            deactivate(pending_);
+        return;
+    }
+    std::lock_guard<std::mutex> lk(mutex_);
+    entries_.erase(std::remove_if(entries_.begin(),
+                                  entries_.end(),
+                                  [&](const Entry& entry) { return entry.id == id; }),
+                   entries_.end());
+}
+
+std::size_t
+AudioClock::size() const
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    return std::count_if(entries_.begin(), entries_.end(), [](const Entry& entry) {
+        return entry.active;
+    });
+}
+
+void
+AudioClock::tick()
+{
+    // Index based: entries added by ticks go to pending_, so entries_ is not reallocated
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+        auto& entry = entries_[i];
+        if (not entry.active)
+            continue;
+        try {
+            entry.tick();
+        } catch (const std::exception& e) {
+            JAMI_ERROR("Audio clock subscriber failed: {}", e.what());
+        }
+    }
+    if (removed_) {
+        entries_.erase(std::remove_if(entries_.begin(),
+                                      entries_.end(),
+                                      [](const Entry& entry) { return not entry.active; }),
+                       entries_.end());
+        pending_.erase(std::remove_if(pending_.begin(),
+                                      pending_.end(),
+                                      [](const Entry& entry) { return not entry.active; }),
+                       pending_.end());
+        removed_ = false;
+    }
+    if (not pending_.empty()) {
+        std::move(pending_.begin(), pending_.end(), std::back_inserter(entries_));
+        pending_.clear();
+    }
+}
+
+void
+AudioClock::run()
+{
+    static auto& jitter = metrics::histogram("audio.clock.jitter_us");
+    static auto& tickTime = metrics::histogram("audio.clock.tick_us");
+    static auto& overruns = metrics::counter("audio.clock.overruns");
+    static auto& resyncs = metrics::counter("audio.clock.resyncs");
+
+    std::unique_lock<std::mutex> lk(mutex_);
+    auto next = clock::now() + period_;
+    while (running_) {
+        if (entries_.empty()) {
+            cv_.wait(lk, [this] { return not running_ or not entries_.empty(); });
+            next = clock::now() + period_;
+            continue;
+        }
+        // Subscribers can be added or removed while waiting
+        if (cv_.wait_until(lk, next, [this] { return not running_; }))
+            break;
+
+        auto start = clock::now();
+        jitter.recordDuration(std::chrono::duration_cast<std::chrono::microseconds>(start - next));
+        tick();
+        ticks_.fetch_add(1, std::memory_order_relaxed);
+        auto end = clock::now();
+        tickTime.recordDuration(std::chrono::duration_cast<std::chrono::microseconds>(end - start));
+        if (end - start > period_) {
+            overruns_.fetch_add(1, std::memory_order_relaxed);
+            overruns.inc();
+        }
+
+        // Catch up on late ticks to keep the audio rate, unless too far behind
+        next += period_;
+        if (end - next > MAX_LATE_TICKS * period_) {
+            JAMI_WARNING("Audio clock is {} ms late, resynchronizing",
+                         std::chrono::duration_cast<std::chrono::milliseconds>(end - next).count());
+            resyncs.inc();
+            next = end + period_;
+        }
+    }
+}
+
+} // namespace jami
@@ -0,0 +1,107 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jami {
+
+/**
+ * Single clock driving the periodic audio work (mixing and sending).
+ *
+ * Instead of one thread per audio input, each waking up on its own, all
+ * subscribers are ticked one after the other by the same thread, once per
+ * period. The thread is started on first use and sleeps while nothing is
+ * subscribed. It keeps the default scheduling: ticks encode and send, which
+ * has no bounded cost, and must not block (no decoding or file I/O).
+ *
+ * Metrics: audio.clock.jitter_us (wake-up delay), audio.clock.tick_us (work per
+ * tick), audio.clock.overruns (ticks longer than the period) and
+ * audio.clock.resyncs (clock reset after falling too far behind).
+ */
+class AudioClock
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using Id = uint64_t;
+
+    static constexpr std::chrono::milliseconds PERIOD {20};
+    /** Ticks to catch up on before restarting the clock from now */
+    static constexpr unsigned MAX_LATE_TICKS {5};
+
+    static AudioClock& instance();
+
+    explicit AudioClock(clock::duration period = PERIOD);
+    ~AudioClock();
+
+    /**
+     * Call tick once per period, from the clock thread.
+     * @return id to remove the subscriber
+     */
+    Id add(std::function<void()>&& tick);
+
+    /**
+     * Remove a subscriber. Once this returns, its tick is not running and will not
+     * be called again, except when called from the clock thread where the removal
+     * only prevents further calls.
+     */
+    void remove(Id id);
+
+    std::size_t size() const;
+    uint64_t ticks() const { return ticks_.load(std::memory_order_relaxed); }
+    uint64_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+
+private:
+    NON_COPYABLE(AudioClock);
+
+    struct Entry
+    {
+        Id id;
+        std::function<void()> tick;
+        bool active {true};
+    };
+
+    void run();
+    void tick();
+
+    const clock::duration period_;
+    mutable std::mutex mutex_ {};
+    std::condition_variable cv_ {};
+    /** Subscribers, in subscription order */
+    std::vector<Entry> entries_ {};
+    /** Subscribers added from the clock thread during a tick */
+    std::vector<Entry> pending_ {};
+    bool removed_ {false};
+    Id nextId_ {1};
+    bool running_ {true};
+
+    std::atomic<uint64_t> ticks_ {0};
+    std::atomic<uint64_t> overruns_ {0};
+    std::thread thread_;
+};
+
+} // namespace jami
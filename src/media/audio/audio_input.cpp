@@ -19,6 +19,7 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
  */
 
+#include "audio_clock.h"
 #include "audio_frame_resizer.h"
 #include "audio_input.h"
 #include "jami/media_const.h"
@@ -35,7 +36,9 @@
 
 namespace jami {
 
-static constexpr auto MS_PER_PACKET = std::chrono::milliseconds(20);
+static constexpr auto MS_PER_PACKET = AudioClock::PERIOD;
+/** Frames of a file decoded ahead of the audio clock */
+static constexpr std::size_t FILE_READ_AHEAD {3};
 
 AudioInput::AudioInput(const std::string& id)
     : id_(id)
@@ -65,13 +68,44 @@ AudioInput::~AudioInput()
     if (playingFile_) {
         Manager::instance().getRingBufferPool().unBindHalfDuplexOut(RingBufferPool::DEFAULT_ID, id_);
     }
+    {
+        std::lock_guard<std::mutex> lk(clockMutex_);
+        if (auto id = clockId_.exchange(0))
+            AudioClock::instance().remove(id);
+    }
+    loop_.stop();
+    fileCv_.notify_all();
     loop_.join();
 }
 
+void
+AudioInput::start()
+{
+    if (playingFile_) {
+        loop_.start();
+        return;
+    }
+    // Files are decoded by loop_, the audio clock only mixes them
+    if (decodingFile_ and not loop_.isRunning())
+        loop_.start();
+    std::lock_guard<std::mutex> lk(clockMutex_);
+    if (clockId_ == 0)
+        clockId_ = AudioClock::instance().add([this] { readFromDevice(); });
+}
+
 void
 AudioInput::process()
 {
-    readFromDevice();
+    std::unique_lock<std::mutex> lk(resourceMutex_);
+    if (playingFile_) {
+        readFromQueue();
+        return;
+    }
+    // Keep a few frames ahead, woken up by the audio clock as they are mixed
+    if (decodingFile_ and fileBuf_ and fileBuf_->putLength() < FILE_READ_AHEAD)
+        readFromFile();
+    else
+        fileCv_.wait_for(lk, MS_PER_PACKET);
 }
 
 void
@@ -103,27 +137,19 @@ AudioInput::setSeekTime(int64_t time)
 void
 AudioInput::readFromDevice()
 {
-    {
-        std::lock_guard<std::mutex> lk(resourceMutex_);
-        if (decodingFile_)
-            while (fileBuf_->isEmpty())
-                readFromFile();
-        if (playingFile_) {
-            readFromQueue();
-            return;
-        }
-    }
+    // Played by loop_
+    if (playingFile_)
+        return;
 
-    // Note: read for device is called in an audio thread and we don't
-    // want to have a loop which takes 100% of the CPU.
-    // Here, we basically want to mix available data without any glitch
-    // and even if one buffer doesn't have audio data (call in hold,
-    // connections issues, etc). So mix every MS_PER_PACKET
-    std::this_thread::sleep_until(wakeUp_);
-    wakeUp_ += MS_PER_PACKET;
+    // Called by the audio clock every MS_PER_PACKET, so that available data is
+    // mixed without any glitch, even if one buffer doesn't have audio data (call
+    // in hold, connections issues, etc).
+    // Never blocks on resourceMutex_: loop_ holds it while decoding.
 
     auto& bufferPool = Manager::instance().getRingBufferPool();
     auto audioFrame = bufferPool.getData(id_);
+    if (decodingFile_)
+        fileCv_.notify_one();
     if (not audioFrame)
         return;
 
@@ -278,6 +304,8 @@ AudioInput::switchInput(const std::string& resource)
     decoder_.reset();
     if (decodingFile_) {
         decodingFile_ = false;
+        loop_.stop();
+        fileCv_.notify_all();
         Manager::instance().getRingBufferPool().unBindHalfDuplexOut(id_, fileId_);
         Manager::instance().getRingBufferPool().unBindHalfDuplexOut(RingBufferPool::DEFAULT_ID,
                                                                     fileId_);
@@ -316,9 +344,8 @@ AudioInput::switchInput(const std::string& resource)
     }
 
     futureDevOpts_ = foundDevOpts_.get_future().share();
-    wakeUp_ = std::chrono::high_resolution_clock::now() + MS_PER_PACKET;
     lk.unlock();
-    loop_.start();
+    start();
     if (onSuccessfulSetup_)
         onSuccessfulSetup_(MEDIA_AUDIO, 0);
     return futureDevOpts_;
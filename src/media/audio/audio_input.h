@@ -25,6 +25,7 @@
 #include <future>
 #include <mutex>
 #include <chrono>
+#include <condition_variable>
 
 #include "audio/audiobuffer.h"
 #include "media_device.h"
@@ -51,9 +52,13 @@ public:
     ~AudioInput();
 
     std::shared_future<DeviceParams> switchInput(const std::string& resource);
-    void start() { loop_.start(); };
+    /**
+     * Start reading: files played by a media player are read by a dedicated thread,
+     * other inputs are ticked by the audio clock.
+     */
+    void start();
 
-    bool isCapturing() const { return loop_.isRunning(); }
+    bool isCapturing() const { return loop_.isRunning() or clockId_ != 0; }
     void setFormat(const AudioFormat& fmt);
     void setMuted(bool isMuted);
     MediaStream getInfo() const;
@@ -110,10 +115,15 @@ private:
     std::atomic_bool playingFile_ {false};
     std::unique_ptr<AudioDeviceGuard> deviceGuard_;
 
+    /** Plays files, or decodes them for the audio clock */
     ThreadLoop loop_;
+    /** Notified by the audio clock when file frames are mixed */
+    std::condition_variable fileCv_ {};
     void process();
 
-    std::chrono::time_point<std::chrono::high_resolution_clock> wakeUp_;
+    /** Audio clock subscription, 0 if none */
+    std::atomic<uint64_t> clockId_ {0};
+    std::mutex clockMutex_ {};
 
     std::function<void(MediaType, bool)> onSuccessfulSetup_;
     std::function<void(const MediaStream& ms)> recorderCallback_;
@@ -0,0 +1,745 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#include "audio_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define JAMI_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC emits any instruction set without per-function flags
+#define JAMI_TARGET_AVX2
+#else
+#define JAMI_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define JAMI_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace jami {
+namespace kernels {
+
+/*
+ * Scalar versions, also the reference for the others.
+ * Clamping is written as std::min(v, hi) then std::max(lo, v), which maps NaN to
+ * lo, as the vector versions do.
+ */
+
+static inline int16_t
+saturate(int32_t v)
+{
+    return static_cast<int16_t>(std::clamp<int32_t>(v,
+                                                    std::numeric_limits<int16_t>::min(),
+                                                    std::numeric_limits<int16_t>::max()));
+}
+
+static inline int16_t
+truncateToS16(float v)
+{
+    return saturate(static_cast<int32_t>(std::max(-32768.f, std::min(v, 32767.f))));
+}
+
+static void
+mixS16Scalar(int16_t* out, const int16_t* in, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = saturate(int32_t(out[i]) + int32_t(in[i]));
+}
+
+static void
+mixFloatScalar(float* out, const float* in, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] += in[i];
+}
+
+static void
+gainS16Scalar(int16_t* samples, std::size_t n, float gain)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        samples[i] = truncateToS16(samples[i] * gain);
+}
+
+static void
+s16ToFloatScalar(float* out, const int16_t* in, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = in[i] * (1.f / 32768.f);
+}
+
+static void
+floatToS16Scalar(int16_t* out, const float* in, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = truncateToS16(std::max(-1.f, std::min(in[i], 1.f)) * 32768.f);
+}
+
+static void
+interleaveS16Scalar(int16_t* out, const int16_t* const* in, unsigned channels, std::size_t frames)
+{
+    if (channels == 1) {
+        std::memcpy(out, in[0], frames * sizeof(*out));
+        return;
+    }
+    for (std::size_t i = 0; i < frames; ++i)
+        for (unsigned c = 0; c < channels; ++c)
+            *out++ = in[c][i];
+}
+
+static void
+deinterleaveS16Scalar(int16_t* const* out, const int16_t* in, unsigned channels, std::size_t frames)
+{
+    if (channels == 1) {
+        std::memcpy(out[0], in, frames * sizeof(*in));
+        return;
+    }
+    for (std::size_t i = 0; i < frames; ++i)
+        for (unsigned c = 0; c < channels; ++c)
+            out[c][i] = *in++;
+}
+
+static uint64_t
+sumSquaresS16Scalar(const int16_t* in, std::size_t n)
+{
+    uint64_t sum = 0;
+    for (std::size_t i = 0; i < n; ++i)
+        sum += uint64_t(int32_t(in[i]) * int32_t(in[i]));
+    return sum;
+}
+
+static double
+combineLanes(const double* lanes)
+{
+    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]))
+           + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+static double
+sumSquaresFloatTail(double sum, const float* in, std::size_t i, std::size_t n)
+{
+    for (; i < n; ++i)
+        sum += double(in[i]) * in[i];
+    return sum;
+}
+
+static double
+sumSquaresFloatScalar(const float* in, std::size_t n)
+{
+    double lanes[8] {};
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        for (unsigned k = 0; k < 8; ++k)
+            lanes[k] += double(in[i + k]) * in[i + k];
+    return sumSquaresFloatTail(combineLanes(lanes), in, i, n);
+}
+
+static void
+dcBlockS16Scalar(int16_t* out, const int16_t* in, std::size_t n, DcBlockerState& state)
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        int16_t x = in[i];
+        double y = ((float) x - (float) state.xm1) + 0.9999 * (float) state.y;
+        state.y = saturate(static_cast<int32_t>(std::max(-32768., std::min(y, 32767.))));
+        state.xm1 = x;
+        out[i] = state.y;
+    }
+}
+
+static const Kernels SCALAR_KERNELS {Isa::SCALAR,
+                                     "scalar",
+                                     mixS16Scalar,
+                                     mixFloatScalar,
+                                     gainS16Scalar,
+                                     s16ToFloatScalar,
+                                     floatToS16Scalar,
+                                     interleaveS16Scalar,
+                                     deinterleaveS16Scalar,
+                                     sumSquaresS16Scalar,
+                                     sumSquaresFloatScalar,
+                                     dcBlockS16Scalar};
+
+#ifdef JAMI_KERNELS_X86
+
+/*
+ * SSE2. _mm_min_ps(hi, v) and _mm_max_ps(v, lo) return their second operand
+ * for NaN, matching the scalar clamping.
+ */
+
+static inline __m128
+clampSse(__m128 v, __m128 lo, __m128 hi)
+{
+    return _mm_max_ps(_mm_min_ps(hi, v), lo);
+}
+
+/** Truncate 8 floats to saturated int16 */
+static inline __m128i
+truncateToS16Sse(__m128 a, __m128 b)
+{
+    const auto lo = _mm_set1_ps(-32768.f);
+    const auto hi = _mm_set1_ps(32767.f);
+    return _mm_packs_epi32(_mm_cvttps_epi32(clampSse(a, lo, hi)),
+                           _mm_cvttps_epi32(clampSse(b, lo, hi)));
+}
+
+static void
+mixS16Sse2(int16_t* out, const int16_t* in, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_adds_epi16(a, b));
+    }
+    mixS16Scalar(out + i, in + i, n - i);
+}
+
+static void
+mixFloatSse2(float* out, const float* in, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_loadu_ps(in + i)));
+    mixFloatScalar(out + i, in + i, n - i);
+}
+
+/** Sign extend 8 int16 to two vectors of 4 floats */
+static inline void
+s16ToPsSse(__m128i v, __m128& a, __m128& b)
+{
+    a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+    b = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+}
+
+static void
+gainS16Sse2(int16_t* samples, std::size_t n, float gain)
+{
+    const auto g = _mm_set1_ps(gain);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 a, b;
+        s16ToPsSse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i)), a, b);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i),
+                         truncateToS16Sse(_mm_mul_ps(a, g), _mm_mul_ps(b, g)));
+    }
+    gainS16Scalar(samples + i, n - i, gain);
+}
+
+static void
+s16ToFloatSse2(float* out, const int16_t* in, std::size_t n)
+{
+    const auto scale = _mm_set1_ps(1.f / 32768.f);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 a, b;
+        s16ToPsSse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), a, b);
+        _mm_storeu_ps(out + i, _mm_mul_ps(a, scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(b, scale));
+    }
+    s16ToFloatScalar(out + i, in + i, n - i);
+}
+
+static void
+floatToS16Sse2(int16_t* out, const float* in, std::size_t n)
+{
+    const auto lo = _mm_set1_ps(-1.f);
+    const auto hi = _mm_set1_ps(1.f);
+    const auto scale = _mm_set1_ps(32768.f);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto a = _mm_mul_ps(clampSse(_mm_loadu_ps(in + i), lo, hi), scale);
+        auto b = _mm_mul_ps(clampSse(_mm_loadu_ps(in + i + 4), lo, hi), scale);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), truncateToS16Sse(a, b));
+    }
+    floatToS16Scalar(out + i, in + i, n - i);
+}
+
+static void
+interleaveS16Sse2(int16_t* out, const int16_t* const* in, unsigned channels, std::size_t frames)
+{
+    if (channels != 2)
+        return interleaveS16Scalar(out, in, channels, frames);
+    std::size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        auto l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in[0] + i));
+        auto r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in[1] + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 8), _mm_unpackhi_epi16(l, r));
+    }
+    const int16_t* tail[2] {in[0] + i, in[1] + i};
+    interleaveS16Scalar(out + 2 * i, tail, 2, frames - i);
+}
+
+static void
+deinterleaveS16Sse2(int16_t* const* out, const int16_t* in, unsigned channels, std::size_t frames)
+{
+    if (channels != 2)
+        return deinterleaveS16Scalar(out, in, channels, frames);
+    std::size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i + 8));
+        // Values fit in 16 bits: packing does not saturate
+        auto l = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                                 _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+        auto r = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out[0] + i), l);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out[1] + i), r);
+    }
+    int16_t* tail[2] {out[0] + i, out[1] + i};
+    deinterleaveS16Scalar(tail, in + 2 * i, 2, frames - i);
+}
+
+static void
+addUnsigned32To64Sse(__m128i& acc, __m128i v)
+{
+    // Each pair of squares fits in 32 unsigned bits, including 2 * 32768^2
+    const auto zero = _mm_setzero_si128();
+    acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, zero));
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, zero));
+}
+
+static uint64_t
+sumSquaresS16Sse2(const int16_t* in, std::size_t n)
+{
+    auto acc = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        addUnsigned32To64Sse(acc, _mm_madd_epi16(v, v));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    return lanes[0] + lanes[1] + sumSquaresS16Scalar(in + i, n - i);
+}
+
+static double
+sumSquaresFloatSse2(const float* in, std::size_t n)
+{
+    __m128d acc[4] {_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd()};
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto a = _mm_loadu_ps(in + i);
+        auto b = _mm_loadu_ps(in + i + 4);
+        __m128d d[4] {_mm_cvtps_pd(a),
+                      _mm_cvtps_pd(_mm_movehl_ps(a, a)),
+                      _mm_cvtps_pd(b),
+                      _mm_cvtps_pd(_mm_movehl_ps(b, b))};
+        for (unsigned k = 0; k < 4; ++k)
+            acc[k] = _mm_add_pd(acc[k], _mm_mul_pd(d[k], d[k]));
+    }
+    double lanes[8];
+    for (unsigned k = 0; k < 4; ++k)
+        _mm_storeu_pd(lanes + 2 * k, acc[k]);
+    return sumSquaresFloatTail(combineLanes(lanes), in, i, n);
+}
+
+static const Kernels SSE2_KERNELS {Isa::SSE2,
+                                   "sse2",
+                                   mixS16Sse2,
+                                   mixFloatSse2,
+                                   gainS16Sse2,
+                                   s16ToFloatSse2,
+                                   floatToS16Sse2,
+                                   interleaveS16Sse2,
+                                   deinterleaveS16Sse2,
+                                   sumSquaresS16Sse2,
+                                   sumSquaresFloatSse2,
+                                   dcBlockS16Scalar};
+
+/*
+ * AVX2. Interleaving stays on SSE2: 256 bit unpacking works per 128 bit lane,
+ * and the extra permutes cancel the gain on such a memory bound loop.
+ */
+
+JAMI_TARGET_AVX2 static inline __m256
+clampAvx(__m256 v, __m256 lo, __m256 hi)
+{
+    return _mm256_max_ps(_mm256_min_ps(hi, v), lo);
+}
+
+/** Truncate 8 floats to saturated int16 */
+JAMI_TARGET_AVX2 static inline __m128i
+truncateToS16Avx(__m256 v)
+{
+    auto i = _mm256_cvttps_epi32(
+        clampAvx(v, _mm256_set1_ps(-32768.f), _mm256_set1_ps(32767.f)));
+    return _mm_packs_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+}
+
+JAMI_TARGET_AVX2 static void
+mixS16Avx2(int16_t* out, const int16_t* in, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out + i));
+        auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_adds_epi16(a, b));
+    }
+    mixS16Scalar(out + i, in + i, n - i);
+}
+
+JAMI_TARGET_AVX2 static void
+mixFloatAvx2(float* out, const float* in, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i,
+                         _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_loadu_ps(in + i)));
+    mixFloatScalar(out + i, in + i, n - i);
+}
+
+JAMI_TARGET_AVX2 static inline __m256
+s16ToPsAvx(const int16_t* in)
+{
+    return _mm256_cvtepi32_ps(
+        _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))));
+}
+
+JAMI_TARGET_AVX2 static void
+gainS16Avx2(int16_t* samples, std::size_t n, float gain)
+{
+    const auto g = _mm256_set1_ps(gain);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i),
+                         truncateToS16Avx(_mm256_mul_ps(s16ToPsAvx(samples + i), g)));
+    gainS16Scalar(samples + i, n - i, gain);
+}
+
+JAMI_TARGET_AVX2 static void
+s16ToFloatAvx2(float* out, const int16_t* in, std::size_t n)
+{
+    const auto scale = _mm256_set1_ps(1.f / 32768.f);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(s16ToPsAvx(in + i), scale));
+    s16ToFloatScalar(out + i, in + i, n - i);
+}
+
+JAMI_TARGET_AVX2 static void
+floatToS16Avx2(int16_t* out, const float* in, std::size_t n)
+{
+    const auto lo = _mm256_set1_ps(-1.f);
+    const auto hi = _mm256_set1_ps(1.f);
+    const auto scale = _mm256_set1_ps(32768.f);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         truncateToS16Avx(
+                             _mm256_mul_ps(clampAvx(_mm256_loadu_ps(in + i), lo, hi), scale)));
+    floatToS16Scalar(out + i, in + i, n - i);
+}
+
+JAMI_TARGET_AVX2 static uint64_t
+sumSquaresS16Avx2(const int16_t* in, std::size_t n)
+{
+    const auto zero = _mm256_setzero_si256();
+    auto acc = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        auto sq = _mm256_madd_epi16(v, v);
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(sq, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(sq, zero));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumSquaresS16Scalar(in + i, n - i);
+}
+
+JAMI_TARGET_AVX2 static double
+sumSquaresFloatAvx2(const float* in, std::size_t n)
+{
+    auto acc0 = _mm256_setzero_pd();
+    auto acc1 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto a = _mm256_cvtps_pd(_mm_loadu_ps(in + i));
+        auto b = _mm256_cvtps_pd(_mm_loadu_ps(in + i + 4));
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(a, a));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(b, b));
+    }
+    double lanes[8];
+    _mm256_storeu_pd(lanes, acc0);
+    _mm256_storeu_pd(lanes + 4, acc1);
+    return sumSquaresFloatTail(combineLanes(lanes), in, i, n);
+}
+
+static const Kernels AVX2_KERNELS {Isa::AVX2,
+                                   "avx2",
+                                   mixS16Avx2,
+                                   mixFloatAvx2,
+                                   gainS16Avx2,
+                                   s16ToFloatAvx2,
+                                   floatToS16Avx2,
+                                   interleaveS16Sse2,
+                                   deinterleaveS16Sse2,
+                                   sumSquaresS16Avx2,
+                                   sumSquaresFloatAvx2,
+                                   dcBlockS16Scalar};
+
+static bool
+cpuSupports(Isa isa)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    if (isa == Isa::SSE2)
+        return info[3] & (1 << 26);
+    // AVX2 also needs the OS to save the AVX registers
+    bool osxsave = info[2] & (1 << 27);
+    if (isa != Isa::AVX2 or not osxsave or maxLeaf < 7 or (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    __builtin_cpu_init();
+    if (isa == Isa::SSE2)
+        return __builtin_cpu_supports("sse2");
+    if (isa == Isa::AVX2)
+        return __builtin_cpu_supports("avx2");
+    return false;
+#endif
+}
+
+#endif // JAMI_KERNELS_X86
+
+#ifdef JAMI_KERNELS_NEON
+
+/*
+ * NEON. vminq_f32 and vmaxq_f32 propagate NaN: clamping uses comparisons to
+ * match the scalar versions.
+ */
+
+static inline float32x4_t
+clampNeon(float32x4_t v, float32x4_t lo, float32x4_t hi)
+{
+    v = vbslq_f32(vcltq_f32(hi, v), hi, v);
+    return vbslq_f32(vcltq_f32(lo, v), v, lo);
+}
+
+/** Truncate 8 floats to saturated int16 */
+static inline int16x8_t
+truncateToS16Neon(float32x4_t a, float32x4_t b)
+{
+    const auto lo = vdupq_n_f32(-32768.f);
+    const auto hi = vdupq_n_f32(32767.f);
+    return vcombine_s16(vqmovn_s32(vcvtq_s32_f32(clampNeon(a, lo, hi))),
+                        vqmovn_s32(vcvtq_s32_f32(clampNeon(b, lo, hi))));
+}
+
+static void
+mixS16Neon(int16_t* out, const int16_t* in, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        vst1q_s16(out + i, vqaddq_s16(vld1q_s16(out + i), vld1q_s16(in + i)));
+    mixS16Scalar(out + i, in + i, n - i);
+}
+
+static void
+mixFloatNeon(float* out, const float* in, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(out + i, vaddq_f32(vld1q_f32(out + i), vld1q_f32(in + i)));
+    mixFloatScalar(out + i, in + i, n - i);
+}
+
+static void
+gainS16Neon(int16_t* samples, std::size_t n, float gain)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto v = vld1q_s16(samples + i);
+        auto a = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), gain);
+        auto b = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), gain);
+        vst1q_s16(samples + i, truncateToS16Neon(a, b));
+    }
+    gainS16Scalar(samples + i, n - i, gain);
+}
+
+static void
+s16ToFloatNeon(float* out, const int16_t* in, std::size_t n)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto v = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), 1.f / 32768.f));
+        vst1q_f32(out + i + 4,
+                  vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), 1.f / 32768.f));
+    }
+    s16ToFloatScalar(out + i, in + i, n - i);
+}
+
+static void
+floatToS16Neon(int16_t* out, const float* in, std::size_t n)
+{
+    const auto lo = vdupq_n_f32(-1.f);
+    const auto hi = vdupq_n_f32(1.f);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto a = vmulq_n_f32(clampNeon(vld1q_f32(in + i), lo, hi), 32768.f);
+        auto b = vmulq_n_f32(clampNeon(vld1q_f32(in + i + 4), lo, hi), 32768.f);
+        vst1q_s16(out + i, truncateToS16Neon(a, b));
+    }
+    floatToS16Scalar(out + i, in + i, n - i);
+}
+
+static void
+interleaveS16Neon(int16_t* out, const int16_t* const* in, unsigned channels, std::size_t frames)
+{
+    if (channels != 2)
+        return interleaveS16Scalar(out, in, channels, frames);
+    std::size_t i = 0;
+    for (; i + 8 <= frames; i += 8)
+        vst2q_s16(out + 2 * i, int16x8x2_t {{vld1q_s16(in[0] + i), vld1q_s16(in[1] + i)}});
+    const int16_t* tail[2] {in[0] + i, in[1] + i};
+    interleaveS16Scalar(out + 2 * i, tail, 2, frames - i);
+}
+
+static void
+deinterleaveS16Neon(int16_t* const* out, const int16_t* in, unsigned channels, std::size_t frames)
+{
+    if (channels != 2)
+        return deinterleaveS16Scalar(out, in, channels, frames);
+    std::size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        auto v = vld2q_s16(in + 2 * i);
+        vst1q_s16(out[0] + i, v.val[0]);
+        vst1q_s16(out[1] + i, v.val[1]);
+    }
+    int16_t* tail[2] {out[0] + i, out[1] + i};
+    deinterleaveS16Scalar(tail, in + 2 * i, 2, frames - i);
+}
+
+static uint64_t
+sumSquaresS16Neon(const int16_t* in, std::size_t n)
+{
+    // Squares fit in 31 bits, pairs are accumulated in 64 bits
+    auto acc = vdupq_n_u64(0);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto v = vld1q_s16(in + i);
+        auto lo = vreinterpretq_u32_s32(vmull_s16(vget_low_s16(v), vget_low_s16(v)));
+        auto hi = vreinterpretq_u32_s32(vmull_s16(vget_high_s16(v), vget_high_s16(v)));
+        acc = vpadalq_u32(acc, lo);
+        acc = vpadalq_u32(acc, hi);
+    }
+    return vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1) + sumSquaresS16Scalar(in + i, n - i);
+}
+
+#ifdef __aarch64__
+static double
+sumSquaresFloatNeon(const float* in, std::size_t n)
+{
+    float64x2_t acc[4] {vdupq_n_f64(0), vdupq_n_f64(0), vdupq_n_f64(0), vdupq_n_f64(0)};
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto a = vld1q_f32(in + i);
+        auto b = vld1q_f32(in + i + 4);
+        float64x2_t d[4] {vcvt_f64_f32(vget_low_f32(a)),
+                          vcvt_high_f64_f32(a),
+                          vcvt_f64_f32(vget_low_f32(b)),
+                          vcvt_high_f64_f32(b)};
+        // Squares of floats are exact in double: fused or not, the sums are the same
+        for (unsigned k = 0; k < 4; ++k)
+            acc[k] = vaddq_f64(acc[k], vmulq_f64(d[k], d[k]));
+    }
+    double lanes[8];
+    for (unsigned k = 0; k < 4; ++k)
+        vst1q_f64(lanes + 2 * k, acc[k]);
+    return sumSquaresFloatTail(combineLanes(lanes), in, i, n);
+}
+#else
+// No double precision vectors on 32 bit ARM
+#define sumSquaresFloatNeon sumSquaresFloatScalar
+#endif
+
+static const Kernels NEON_KERNELS {Isa::NEON,
+                                   "neon",
+                                   mixS16Neon,
+                                   mixFloatNeon,
+                                   gainS16Neon,
+                                   s16ToFloatNeon,
+                                   floatToS16Neon,
+                                   interleaveS16Neon,
+                                   deinterleaveS16Neon,
+                                   sumSquaresS16Neon,
+                                   sumSquaresFloatNeon,
+                                   dcBlockS16Scalar};
+
+#endif // JAMI_KERNELS_NEON
+
+const Kernels&
+scalar()
+{
+    return SCALAR_KERNELS;
+}
+
+const Kernels*
+get(Isa isa)
+{
+    switch (isa) {
+    case Isa::SCALAR:
+        return &SCALAR_KERNELS;
+#ifdef JAMI_KERNELS_X86
+    case Isa::SSE2: {
+        static const bool supported = cpuSupports(Isa::SSE2);
+        return supported ? &SSE2_KERNELS : nullptr;
+    }
+    case Isa::AVX2: {
+        static const bool supported = cpuSupports(Isa::AVX2);
+        return supported ? &AVX2_KERNELS : nullptr;
+    }
+#endif
+#ifdef JAMI_KERNELS_NEON
+    case Isa::NEON:
+        return &NEON_KERNELS;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+std::vector<Isa>
+supported()
+{
+    std::vector<Isa> isas;
+    for (auto isa : {Isa::SCALAR, Isa::SSE2, Isa::AVX2, Isa::NEON})
+        if (get(isa))
+            isas.emplace_back(isa);
+    return isas;
+}
+
+const Kernels&
+active()
+{
+    static const Kernels& kernels = *get(supported().back());
+    return kernels;
+}
+
+} // namespace kernels
+} // namespace jami
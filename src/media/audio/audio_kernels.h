@@ -0,0 +1,149 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace jami {
+
+/**
+ * Sample processing kernels used by the audio buffers and frames.
+ *
+ * Each kernel has a portable scalar version and, where it pays off, versions
+ * for SSE2, AVX2 and NEON. The best version supported by the CPU is selected at
+ * runtime. Every version gives exactly the same result as the scalar one.
+ */
+namespace kernels {
+
+enum class Isa { SCALAR, SSE2, AVX2, NEON };
+
+struct DcBlockerState
+{
+    int16_t xm1 {0};
+    int16_t y {0};
+};
+
+struct Kernels
+{
+    Isa isa;
+    const char* name;
+
+    /** out[i] = in[i] + out[i], saturated */
+    void (*mixS16)(int16_t* out, const int16_t* in, std::size_t n);
+    void (*mixFloat)(float* out, const float* in, std::size_t n);
+    /** Multiply by gain, truncated and saturated */
+    void (*gainS16)(int16_t* samples, std::size_t n, float gain);
+    /** Samples scaled to [-1, 1) */
+    void (*s16ToFloat)(float* out, const int16_t* in, std::size_t n);
+    /** Samples clamped to [-1, 1], scaled and truncated */
+    void (*floatToS16)(int16_t* out, const float* in, std::size_t n);
+    /** Planar channels to interleaved frames */
+    void (*interleaveS16)(int16_t* out,
+                          const int16_t* const* in,
+                          unsigned channels,
+                          std::size_t frames);
+    /** Interleaved frames to planar channels */
+    void (*deinterleaveS16)(int16_t* const* out,
+                            const int16_t* in,
+                            unsigned channels,
+                            std::size_t frames);
+    uint64_t (*sumSquaresS16)(const int16_t* in, std::size_t n);
+    /**
+     * Sum of squares, accumulated in double precision over 8 interleaved partial
+     * sums added in a fixed order, so that every version rounds the same way.
+     */
+    double (*sumSquaresFloat)(const float* in, std::size_t n);
+    /**
+     * DC blocking filter, y[n] = x[n] - x[n-1] + 0.9999 y[n-1]. The recursion is
+     * serial: the same scalar version is used everywhere.
+     */
+    void (*dcBlockS16)(int16_t* out, const int16_t* in, std::size_t n, DcBlockerState& state);
+};
+
+const Kernels& scalar();
+
+/**
+ * @return the kernels for isa, null if not supported by this CPU or build
+ */
+const Kernels* get(Isa isa);
+
+/**
+ * Best kernels supported by this CPU
+ */
+const Kernels& active();
+
+/**
+ * Instruction sets supported by this CPU and build, scalar first
+ */
+std::vector<Isa> supported();
+
+inline void
+mixS16(int16_t* out, const int16_t* in, std::size_t n)
+{
+    active().mixS16(out, in, n);
+}
+inline void
+mixFloat(float* out, const float* in, std::size_t n)
+{
+    active().mixFloat(out, in, n);
+}
+inline void
+gainS16(int16_t* samples, std::size_t n, float gain)
+{
+    active().gainS16(samples, n, gain);
+}
+inline void
+s16ToFloat(float* out, const int16_t* in, std::size_t n)
+{
+    active().s16ToFloat(out, in, n);
+}
+inline void
+floatToS16(int16_t* out, const float* in, std::size_t n)
+{
+    active().floatToS16(out, in, n);
+}
+inline void
+interleaveS16(int16_t* out, const int16_t* const* in, unsigned channels, std::size_t frames)
+{
+    active().interleaveS16(out, in, channels, frames);
+}
+inline void
+deinterleaveS16(int16_t* const* out, const int16_t* in, unsigned channels, std::size_t frames)
+{
+    active().deinterleaveS16(out, in, channels, frames);
+}
+inline uint64_t
+sumSquaresS16(const int16_t* in, std::size_t n)
+{
+    return active().sumSquaresS16(in, n);
+}
+inline double
+sumSquaresFloat(const float* in, std::size_t n)
+{
+    return active().sumSquaresFloat(in, n);
+}
+inline void
+dcBlockS16(int16_t* out, const int16_t* in, std::size_t n, DcBlockerState& state)
+{
+    active().dcBlockS16(out, in, n, state);
+}
+
+} // namespace kernels
+} // namespace jami
@@ -133,6 +133,8 @@ void
 AudioReceiveThread::addIOContext(SocketPair& socketPair)
 {
     demuxContext_.reset(socketPair.createIOContext(mtu_));
+    // Reordering is done by the jitter buffer
+    args_.reorder_packets = not socketPair.hasJitterBuffer();
 }
 
 void
@@ -174,6 +174,13 @@ AudioRtpSession::startReceiver()
                                                 receive_.receiving_sdp,
                                                 mtu_));
 
+    // G.722 RTP clock rate is 8 kHz, for historical reasons (RFC 3551)
+    auto clockRate = accountAudioCodec->systemCodecInfo.name == "G722"
+                         ? 8000u
+                         : accountAudioCodec->audioformat.sample_rate;
+    if (not socketPair_->enableJitterBuffer(clockRate))
+        JAMI_DBG("[%p] Jitter buffer not supported by the sockets", this);
+
     receiveThread_->setRecorderCallback([this](const MediaStream& ms) { attachRemoteRecorder(ms); });
     receiveThread_->addIOContext(*socketPair_);
     receiveThread_->setSuccessfulSetupCb(onSuccessfulSetup_);
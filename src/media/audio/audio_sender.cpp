@@ -20,12 +20,15 @@
  */
 
 #include "audio_sender.h"
+#include "audio_clock.h"
 #include "client/videomanager.h"
+#include "encoded_audio_cache.h"
 #include "libav_deps.h"
 #include "logger.h"
 #include "media_encoder.h"
 #include "media_io_handle.h"
 #include "media_stream.h"
+#include "metrics.h"
 #include "resampler.h"
 
 #include <memory>
@@ -101,8 +104,52 @@ AudioSender::update(Observable<std::shared_ptr<jami::MediaFrame>>* /*obs*/,
         }
     }
 
-    if (audioEncoder_->encodeAudio(*std::static_pointer_cast<AudioFrame>(framePtr)) < 0)
+    // Participants receiving the same mix during this period share one encoding
+    static auto& sharedFrames = metrics::counter("audio_sender.shared_frames");
+    auto audioFrame = std::static_pointer_cast<AudioFrame>(framePtr);
+    auto& cache = EncodedAudioCache::instance();
+    auto config = encoderConfig();
+    auto period = AudioClock::instance().ticks();
+    auto hash = EncodedAudioCache::hash(frame);
+    // Packets carry audio of the previous frame too: only share them between senders
+    // that sent the same frame during the previous period
+    bool continuous = lastPeriod_ != NO_PERIOD && period == lastPeriod_ + 1;
+    auto previous = lastHash_;
+    lastPeriod_ = period;
+    lastHash_ = hash;
+    if (continuous) {
+        if (auto encoded = cache.get(config, period, previous, hash, frame)) {
+            if (audioEncoder_->sendAudio(encoded->packets, encoded->pts, frame->nb_samples) < 0)
+                JAMI_ERR("sending shared packets failed");
+            sharedFrames.inc();
+            shared_ = true;
+            return;
+        }
+    }
+    if (shared_) {
+        // Diverging: our encoder history is older than what the peer decoded
+        audioEncoder_->resetAudioEncoder();
+        shared_ = false;
+    }
+
+    std::vector<libjami::PacketBuffer> packets;
+    if (audioEncoder_->encodeAudio(*audioFrame, &packets) < 0)
         JAMI_ERR("encoding failed");
+    else if (continuous and not packets.empty())
+        cache.put(config, period, previous, hash, audioFrame, frame->pts, std::move(packets));
+}
+
+std::string
+AudioSender::encoderConfig() const
+{
+    auto codec = std::static_pointer_cast<AccountAudioCodecInfo>(args_.codec);
+    return fmt::format("{}/{}/{}/{}/{}/{}",
+                       codec->systemCodecInfo.name,
+                       codec->audioformat.toString(),
+                       codec->bitrate,
+                       args_.fecEnabled,
+                       args_.parameters,
+                       packetLoss_.load());
 }
 
 void
@@ -129,6 +176,7 @@ AudioSender::setPacketLoss(uint64_t pl)
     if (!audioEncoder_)
         return -1; // NOK
 
+    packetLoss_ = pl;
     return audioEncoder_->setPacketLoss(pl);
 }
 
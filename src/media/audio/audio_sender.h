@@ -27,6 +27,9 @@
 #include "observer.h"
 #include "socket_pair.h"
 
+#include <atomic>
+#include <limits>
+
 namespace jami {
 
 class AudioInput;
@@ -56,6 +59,8 @@ private:
     NON_COPYABLE(AudioSender);
 
     bool setup(SocketPair& socketPair);
+    /** Encoder settings: senders with the same configuration may share encoded packets */
+    std::string encoderConfig() const;
 
     std::string dest_;
     MediaDescription args_;
@@ -70,6 +75,14 @@ private:
     const uint16_t seqVal_;
     uint16_t mtu_;
 
+    std::atomic<uint64_t> packetLoss_ {0};
+    /** Last frame was sent from another sender's packets */
+    bool shared_ {false};
+    /** Audio clock period and hash of the last frame sent */
+    static constexpr uint64_t NO_PERIOD = std::numeric_limits<uint64_t>::max();
+    uint64_t lastPeriod_ {NO_PERIOD};
+    std::size_t lastHash_ {0};
+
     // last voice activity state
     bool voice_ {false};
     std::function<void(bool)> voiceCallback_;
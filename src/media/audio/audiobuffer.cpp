@@ -20,13 +20,22 @@
 
 #include "libav_deps.h"
 #include "audiobuffer.h"
+#include "audio_kernels.h"
 #include "logger.h"
 #include <string.h>
 #include <cstring> // memset
 #include <algorithm>
+#include <array>
 
 namespace jami {
 
+// Channel pointers handed to the kernels live on the stack. Wider layouts
+// (never met in practice) use plain loops.
+static constexpr unsigned MAX_KERNEL_CHANNELS = 8;
+
+// Samples converted per pass by interleaveFloat
+static constexpr size_t FLOAT_BLOCK = 1024;
+
 std::ostream&
 operator<<(std::ostream& stream, const AudioFormat& f)
 {
@@ -158,26 +167,36 @@ AudioBuffer::applyGain(double gain)
         JAMI_DBG("Normalizing %f to [-1.0, 1.0]", gain);
 
     for (auto& channel : samples_)
-        for (auto& sample : channel)
-            sample *= g;
+        kernels::gainS16(channel.data(), channel.size(), static_cast<float>(g));
 }
 
 size_t
 AudioBuffer::channelToFloat(float* out, const int& channel) const
 {
-    for (int i = 0, f = frames(); i < f; i++)
-        *out++ = (float) samples_[channel][i] * .000030517578125f;
-
+    kernels::s16ToFloat(out, samples_[channel].data(), frames());
     return frames() * samples_.size();
 }
 
+void
+AudioBuffer::interleaveAt(AudioSample* out, size_t offset, size_t count) const
+{
+    const unsigned c = channels();
+    if (c > MAX_KERNEL_CHANNELS) {
+        for (size_t i = 0; i < count; i++)
+            for (unsigned j = 0; j < c; j++)
+                out[i * c + j] = samples_[j][offset + i];
+        return;
+    }
+    std::array<const AudioSample*, MAX_KERNEL_CHANNELS> in;
+    for (unsigned j = 0; j < c; ++j)
+        in[j] = samples_[j].data() + offset;
+    kernels::interleaveS16(out, in.data(), c, count);
+}
+
 size_t
 AudioBuffer::interleave(AudioSample* out) const
 {
-    for (unsigned i = 0, f = frames(), c = channels(); i < f; ++i)
-        for (unsigned j = 0; j < c; ++j)
-            *out++ = samples_[j][i];
-
+    interleaveAt(out, 0, frames());
     return frames() * channels();
 }
 
@@ -207,11 +226,23 @@ AudioBuffer::interleave() const
 size_t
 AudioBuffer::interleaveFloat(float* out) const
 {
-    for (unsigned i = 0, f = frames(), c = channels(); i < f; i++)
-        for (unsigned j = 0; j < c; j++)
-            *out++ = (float) samples_[j][i] * .000030517578125f;
-
-    return frames() * samples_.size();
+    // Interleave then convert by blocks through the stack: both passes vectorize
+    const unsigned c = channels();
+    const size_t f = frames();
+    const size_t blockFrames = FLOAT_BLOCK / c;
+    if (blockFrames == 0) {
+        for (size_t i = 0; i < f; i++)
+            for (unsigned j = 0; j < c; j++)
+                kernels::s16ToFloat(out + i * c + j, &samples_[j][i], 1);
+        return f * c;
+    }
+    std::array<AudioSample, FLOAT_BLOCK> block;
+    for (size_t i = 0; i < f; i += blockFrames) {
+        const auto n = std::min(blockFrames, f - i);
+        interleaveAt(block.data(), i, n);
+        kernels::s16ToFloat(out + i * c, block.data(), n * c);
+    }
+    return f * c;
 }
 
 void
@@ -224,9 +255,7 @@ AudioBuffer::deinterleave(const AudioSample* in, size_t frame_num, unsigned nb_c
     setChannelNum(nb_channels);
     resize(frame_num);
 
-    for (unsigned i = 0, f = frames(), c = channels(); i < f; i++)
-        for (unsigned j = 0; j < c; j++)
-            samples_[j][i] = *in++;
+    deinterleaveAt(in, 0);
 }
 
 void
@@ -248,15 +277,9 @@ AudioBuffer::convertFloatPlanarToSigned16(uint8_t** extended_data,
     setChannelNum(nb_channels);
     resize(frame_num);
 
-    for (unsigned j = 0, c = channels(); j < c; j++) {
-        float* inputChannel = (float*) extended_data[j];
-        for (unsigned i = 0, f = frames(); i < f; i++) {
-            float inputChannelVal = *inputChannel++;
-            // avoid saturation: limit val between -1 and 1
-            inputChannelVal = std::max(-1.0f, std::min(inputChannelVal, 1.0f));
-            samples_[j][i] = (int16_t)(inputChannelVal * 32768.0f);
-        }
-    }
+    // Values are limited to [-1, 1] to avoid saturation
+    for (unsigned j = 0, c = channels(); j < c; j++)
+        kernels::floatToS16(samples_[j].data(), (const float*) extended_data[j], frames());
 }
 
 size_t
@@ -269,18 +292,8 @@ AudioBuffer::mix(const AudioBuffer& other, bool up /* = true */)
 
     for (unsigned i = 0; i < chan_num; i++) {
         unsigned src_chan = upmix ? std::min<unsigned>(i, other.samples_.size() - 1) : i;
-
-        for (unsigned j = 0; j < samp_num; j++) {
-            // clamp result to min/max
-            // result must be larger than 16 bits to check for over/underflow
-            int32_t n = static_cast<int32_t>(samples_[i][j])
-                        + static_cast<int32_t>(other.samples_[src_chan][j]);
-            if (n < std::numeric_limits<AudioSample>::min())
-                n = std::numeric_limits<AudioSample>::min();
-            else if (n > std::numeric_limits<AudioSample>::max())
-                n = std::numeric_limits<AudioSample>::max();
-            samples_[i][j] = n;
-        }
+        // Sums are clamped to min/max
+        kernels::mixS16(samples_[i].data(), other.samples_[src_chan].data(), samp_num);
     }
 
     return samp_num;
@@ -358,12 +371,25 @@ AudioBuffer::append(const AudioFrame& audioFrame)
     auto newSize = f + frame->nb_samples;
     resize(newSize);
 
-    auto in = reinterpret_cast<const AudioSample*>(frame->extended_data[0]);
-    for (unsigned c = channels(); f < newSize; f++)
-        for (unsigned j = 0; j < c; j++)
-            samples_[j][f] = *in++;
-
+    deinterleaveAt(reinterpret_cast<const AudioSample*>(frame->extended_data[0]), f);
     return 0;
 }
 
+void
+AudioBuffer::deinterleaveAt(const AudioSample* in, size_t offset)
+{
+    const unsigned c = channels();
+    const size_t count = frames() - offset;
+    if (c > MAX_KERNEL_CHANNELS) {
+        for (size_t i = 0; i < count; i++)
+            for (unsigned j = 0; j < c; j++)
+                samples_[j][offset + i] = in[i * c + j];
+        return;
+    }
+    std::array<AudioSample*, MAX_KERNEL_CHANNELS> out;
+    for (unsigned j = 0; j < c; ++j)
+        out[j] = samples_[j].data() + offset;
+    kernels::deinterleaveS16(out.data(), in, c, count);
+}
+
 } // namespace jami
@@ -362,6 +362,16 @@ public:
     int append(const AudioFrame& frame);
 
 private:
+    /**
+     * Interleave count frames starting at offset into out
+     */
+    void interleaveAt(AudioSample* out, size_t offset, size_t count) const;
+
+    /**
+     * Deinterleave in into the frames from offset to the end
+     */
+    void deinterleaveAt(const AudioSample* in, size_t offset);
+
     int sampleRate_;
 
     // buffers holding data for each channels
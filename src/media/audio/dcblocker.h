@@ -24,6 +24,7 @@
 
 #include "ring_types.h"
 #include "audiobuffer.h"
+#include "audio_kernels.h"
 
 namespace jami {
 
@@ -41,14 +42,7 @@ public:
     void process(AudioBuffer& buf);
 
 private:
-    struct StreamState
-    {
-        AudioSample y_, x_, xm1_, ym1_;
-    };
-
-    void doProcess(AudioSample* out, AudioSample* in, unsigned samples, struct StreamState* state);
-
-    std::vector<StreamState> states;
+    std::vector<kernels::DcBlockerState> states;
 };
 
 } // namespace jami
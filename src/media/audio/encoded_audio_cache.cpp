@@ -0,0 +1,118 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#include "encoded_audio_cache.h"
+
+#include "libav_deps.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+namespace jami {
+
+/**
+ * Size in bytes of each plane of an audio frame
+ */
+static std::size_t
+planeSize(const AVFrame* frame)
+{
+    auto format = static_cast<AVSampleFormat>(frame->format);
+    auto channels = av_sample_fmt_is_planar(format) ? 1 : frame->ch_layout.nb_channels;
+    return (std::size_t) frame->nb_samples * channels * av_get_bytes_per_sample(format);
+}
+
+static int
+planeCount(const AVFrame* frame)
+{
+    return av_sample_fmt_is_planar(static_cast<AVSampleFormat>(frame->format))
+               ? frame->ch_layout.nb_channels
+               : 1;
+}
+
+static bool
+sameSamples(const AVFrame* a, const AVFrame* b)
+{
+    if (a->format != b->format || a->nb_samples != b->nb_samples
+        || a->sample_rate != b->sample_rate
+        || a->ch_layout.nb_channels != b->ch_layout.nb_channels)
+        return false;
+    auto size = planeSize(a);
+    for (int i = 0; i < planeCount(a); ++i)
+        if (std::memcmp(a->extended_data[i], b->extended_data[i], size) != 0)
+            return false;
+    return true;
+}
+
+EncodedAudioCache&
+EncodedAudioCache::instance()
+{
+    // Intentionally leaked: senders may be destroyed during static destruction
+    static EncodedAudioCache* cache = new EncodedAudioCache;
+    return *cache;
+}
+
+std::size_t
+EncodedAudioCache::hash(const AVFrame* frame)
+{
+    auto size = planeSize(frame);
+    std::size_t h = 0;
+    for (int i = 0; i < planeCount(frame); ++i) {
+        auto data = reinterpret_cast<const char*>(frame->extended_data[i]);
+        h = h * 31 + std::hash<std::string_view>()(std::string_view(data, size));
+    }
+    return h;
+}
+
+std::shared_ptr<const EncodedAudioCache::Entry>
+EncodedAudioCache::get(const std::string& config,
+                       uint64_t period,
+                       std::size_t previous,
+                       std::size_t hash,
+                       const AVFrame* frame) const
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (const auto& entry : entries_) {
+        if (entry->period == period && entry->hash == hash && entry->previous == previous
+            && entry->config == config && sameSamples(entry->frame->pointer(), frame))
+            return entry;
+    }
+    return {};
+}
+
+void
+EncodedAudioCache::put(const std::string& config,
+                       uint64_t period,
+                       std::size_t previous,
+                       std::size_t hash,
+                       std::shared_ptr<AudioFrame> frame,
+                       int64_t pts,
+                       std::vector<libjami::PacketBuffer>&& packets)
+{
+    auto entry = std::make_shared<Entry>(
+        Entry {period, config, previous, hash, std::move(frame), pts, std::move(packets)});
+    std::lock_guard<std::mutex> lk(mutex_);
+    entries_.erase(std::remove_if(entries_.begin(),
+                                  entries_.end(),
+                                  [&](const auto& e) { return e->period != period; }),
+                   entries_.end());
+    // Many distinct frames: most participants are speaking, not worth comparing
+    if (entries_.size() < MAX_ENTRIES)
+        entries_.emplace_back(std::move(entry));
+}
+
+} // namespace jami
@@ -0,0 +1,101 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#pragma once
+
+#include "media_buffer.h"
+#include "noncopyable.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace jami {
+
+/**
+ * Packets encoded during the current audio period, shared between audio senders.
+ *
+ * In a conference, participants that did not contribute audio during a period
+ * receive the same mix. The first sender to encode a frame stores the encoded
+ * packets, and senders with the same encoder configuration and a bit-identical
+ * frame send copies of these packets through their own RTP muxer and SRTP
+ * context instead of encoding the frame again.
+ *
+ * Packets also depend on the encoder history (Opus lookahead and in-band FEC
+ * carry audio of the previous frame): entries are keyed on the hash of the
+ * frame sent during the previous period as well.
+ */
+class EncodedAudioCache
+{
+public:
+    /** Distinct frames kept per period */
+    static constexpr std::size_t MAX_ENTRIES {16};
+
+    struct Entry
+    {
+        uint64_t period;
+        std::string config;
+        /** Hash of the frame encoded during the previous period */
+        std::size_t previous;
+        std::size_t hash;
+        /** Encoded frame, kept to compare samples */
+        std::shared_ptr<AudioFrame> frame;
+        /** pts of the encoded frame, in samples */
+        int64_t pts;
+        std::vector<libjami::PacketBuffer> packets;
+    };
+
+    static EncodedAudioCache& instance();
+
+    /**
+     * Hash of the samples of a frame
+     */
+    static std::size_t hash(const AVFrame* frame);
+
+    /**
+     * @return packets encoded during this period for the same configuration,
+     *         previous frame and samples, null if none
+     */
+    std::shared_ptr<const Entry> get(const std::string& config,
+                                     uint64_t period,
+                                     std::size_t previous,
+                                     std::size_t hash,
+                                     const AVFrame* frame) const;
+
+    /**
+     * Share the packets encoded for a frame. Entries of previous periods are dropped.
+     */
+    void put(const std::string& config,
+             uint64_t period,
+             std::size_t previous,
+             std::size_t hash,
+             std::shared_ptr<AudioFrame> frame,
+             int64_t pts,
+             std::vector<libjami::PacketBuffer>&& packets);
+
+    EncodedAudioCache() = default;
+
+private:
+    NON_COPYABLE(EncodedAudioCache);
+
+    mutable std::mutex mutex_ {};
+    std::vector<std::shared_ptr<const Entry>> entries_ {};
+};
+
+} // namespace jami
@@ -0,0 +1,179 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#include "jitter_buffer.h"
+#include "logger.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace jami {
+
+static constexpr std::size_t RTP_HEADER_SIZE {12};
+/** Fraction of the excess transit time followed by the base at each packet */
+static constexpr int BASE_DRIFT {1024};
+
+JitterBuffer::JitterBuffer(unsigned clockRate)
+    : clockRate_(clockRate)
+{}
+
+void
+JitterBuffer::reset()
+{
+    packets_.clear();
+    started_ = false;
+}
+
+JitterBuffer::clock::duration
+JitterBuffer::mediaTime(int64_t timestamp) const
+{
+    return std::chrono::microseconds(timestamp * 1000000 / clockRate_);
+}
+
+JitterBuffer::clock::time_point
+JitterBuffer::playout(int64_t timestamp) const
+{
+    return clock::time_point(base_ + mediaTime(timestamp)) + delay_;
+}
+
+std::chrono::microseconds
+JitterBuffer::jitter() const
+{
+    return std::chrono::microseconds(static_cast<int64_t>(jitterUs_));
+}
+
+std::chrono::microseconds
+JitterBuffer::targetDelay() const
+{
+    return std::clamp(std::chrono::microseconds(static_cast<int64_t>(JITTER_FACTOR * jitterUs_)),
+                      std::chrono::microseconds(MIN_DELAY),
+                      std::chrono::microseconds(MAX_DELAY));
+}
+
+bool
+JitterBuffer::push(const uint8_t* data, std::size_t size, clock::time_point now)
+{
+    if (size < RTP_HEADER_SIZE or (data[0] >> 6) != 2) {
+        ++stats_.dropped;
+        return false;
+    }
+    uint16_t seq = data[2] << 8 | data[3];
+    uint32_t ts = uint32_t(data[4]) << 24 | data[5] << 16 | data[6] << 8 | data[7];
+
+    if (not started_) {
+        started_ = true;
+        highestSeq_ = nextSeq_ = seq;
+        highestTimestamp_ = ts;
+        base_ = lastTransit_ = now.time_since_epoch() - mediaTime(ts);
+    }
+    auto extSeq = highestSeq_ + static_cast<int16_t>(seq - static_cast<uint16_t>(highestSeq_));
+    auto extTs = highestTimestamp_
+                 + static_cast<int32_t>(ts - static_cast<uint32_t>(highestTimestamp_));
+    if (std::abs(extSeq - highestSeq_) > MAX_SEQ_JUMP) {
+        JAMI_DEBUG("[jitter buffer {}] New stream, sequence number {} after {}",
+                   fmt::ptr(this),
+                   seq,
+                   highestSeq_);
+        reset();
+        return push(data, size, now);
+    }
+
+    // RFC 3550 inter-arrival jitter
+    auto transit = now.time_since_epoch() - mediaTime(extTs);
+    auto d = std::chrono::duration<double, std::micro>(transit - lastTransit_).count();
+    jitterUs_ += (std::abs(d) - jitterUs_) / 16.;
+    lastTransit_ = transit;
+    if (transit < base_)
+        base_ = transit;
+    else
+        base_ += (transit - base_) / BASE_DRIFT;
+
+    if (extSeq == highestSeq_ + 1 and extTs > highestTimestamp_)
+        packetDuration_ = mediaTime(extTs - highestTimestamp_);
+    if (extSeq > highestSeq_) {
+        highestSeq_ = extSeq;
+        highestTimestamp_ = extTs;
+    }
+
+    if (extSeq < nextSeq_) {
+        // Its playout time is past, and the gap was already left to the decoder
+        static auto& late = metrics::counter("audio.jitter_buffer.late");
+        late.inc();
+        ++stats_.late;
+        auto lateness = std::chrono::duration_cast<std::chrono::microseconds>(
+            now - playout(extTs));
+        delay_ = std::min(std::max(delay_ + lateness, targetDelay()),
+                          std::chrono::microseconds(MAX_DELAY));
+        return false;
+    }
+    if (not packets_.emplace(extSeq, Packet {{data, data + size}, extTs, now}).second) {
+        ++stats_.dropped;
+        return false;
+    }
+    if (packets_.size() > MAX_PACKETS) {
+        packets_.erase(packets_.begin());
+        ++stats_.dropped;
+    }
+    delay_ = std::max(delay_, targetDelay());
+    return true;
+}
+
+JitterBuffer::clock::time_point
+JitterBuffer::nextPlayout() const
+{
+    if (packets_.empty())
+        return clock::time_point::max();
+    return playout(packets_.begin()->second.timestamp);
+}
+
+bool
+JitterBuffer::pop(std::vector<uint8_t>& packet, clock::time_point now)
+{
+    static auto& released = metrics::counter("audio.jitter_buffer.packets");
+    static auto& concealed = metrics::counter("audio.jitter_buffer.concealed");
+    static auto& delay = metrics::histogram("audio.jitter_buffer.delay_ms");
+    static auto& mouthToEar = metrics::histogram("audio.jitter_buffer.mouth_to_ear_ms");
+
+    if (packets_.empty())
+        return false;
+    auto it = packets_.begin();
+    if (playout(it->second.timestamp) > now)
+        return false;
+
+    if (auto lost = it->first - nextSeq_; lost > 0) {
+        concealed.inc(lost);
+        stats_.concealed += lost;
+    }
+    nextSeq_ = it->first + 1;
+    released.inc();
+    ++stats_.released;
+    delay.recordDuration(std::chrono::duration_cast<std::chrono::milliseconds>(delay_));
+    mouthToEar.recordDuration(std::chrono::duration_cast<std::chrono::milliseconds>(
+        packetDuration_ + (now - it->second.arrival)));
+
+    packet = std::move(it->second.data);
+    packets_.erase(it);
+
+    // Shrink slowly, a few samples at a time
+    auto target = targetDelay();
+    if (delay_ > target)
+        delay_ -= std::min(std::chrono::microseconds(DELAY_STEP), delay_ - target);
+    return true;
+}
+
+} // namespace jami
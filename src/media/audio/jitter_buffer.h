@@ -0,0 +1,136 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#pragma once
+
+#include "noncopyable.h"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace jami {
+
+/**
+ * Adaptive jitter buffer for received RTP audio packets.
+ *
+ * Packets are reordered by sequence number and released at their playout time:
+ * the RTP timestamp mapped to the local clock, plus a playout delay sized from
+ * the measured inter-arrival jitter (RFC 3550). The delay grows as soon as jitter
+ * increases or a packet arrives too late, and shrinks slowly when the network is
+ * stable. A missing packet does not hold back the next ones past their playout
+ * time: the gap is left to the decoder (Opus FEC or loss concealment).
+ *
+ * Not thread-safe.
+ *
+ * Metrics: audio.jitter_buffer.packets (released), audio.jitter_buffer.concealed
+ * (missing packets skipped), audio.jitter_buffer.late (dropped, arrived after their
+ * playout time), audio.jitter_buffer.delay_ms (playout delay), and
+ * audio.jitter_buffer.mouth_to_ear_ms (receive side only: packet duration plus
+ * time spent in the buffer; the one-way network delay is not included, it is
+ * unknown without synchronized clocks).
+ */
+class JitterBuffer
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds MIN_DELAY {20};
+    static constexpr std::chrono::milliseconds MAX_DELAY {300};
+    /** Delay removed per released packet when shrinking */
+    static constexpr std::chrono::microseconds DELAY_STEP {500};
+    /** Playout delay, in units of measured jitter */
+    static constexpr unsigned JITTER_FACTOR {4};
+    static constexpr std::size_t MAX_PACKETS {128};
+    /** Sequence number jump considered as a new stream */
+    static constexpr int64_t MAX_SEQ_JUMP {1000};
+
+    struct Stats
+    {
+        uint64_t released {0};
+        uint64_t concealed {0};
+        uint64_t late {0};
+        uint64_t dropped {0};
+    };
+
+    /**
+     * @param clockRate  RTP clock rate of the stream
+     */
+    explicit JitterBuffer(unsigned clockRate);
+
+    unsigned clockRate() const { return clockRate_; }
+
+    /**
+     * Queue a received RTP packet.
+     * @return false if the packet was dropped (invalid, duplicate or late)
+     */
+    bool push(const uint8_t* data, std::size_t size, clock::time_point now = clock::now());
+
+    /**
+     * @return playout time of the next packet, time_point::max() if empty
+     */
+    clock::time_point nextPlayout() const;
+
+    /**
+     * Release the next packet if its playout time is reached.
+     * @return false if no packet is due
+     */
+    bool pop(std::vector<uint8_t>& packet, clock::time_point now = clock::now());
+
+    std::chrono::microseconds delay() const { return delay_; }
+    std::chrono::microseconds jitter() const;
+    std::size_t size() const { return packets_.size(); }
+    const Stats& stats() const { return stats_; }
+
+private:
+    NON_COPYABLE(JitterBuffer);
+
+    struct Packet
+    {
+        std::vector<uint8_t> data;
+        int64_t timestamp;
+        clock::time_point arrival;
+    };
+
+    void reset();
+    std::chrono::microseconds targetDelay() const;
+    clock::duration mediaTime(int64_t timestamp) const;
+    clock::time_point playout(int64_t timestamp) const;
+
+    const unsigned clockRate_;
+    /** Packets by extended sequence number */
+    std::map<int64_t, Packet> packets_;
+
+    bool started_ {false};
+    int64_t highestSeq_ {0};
+    int64_t highestTimestamp_ {0};
+    /** Sequence number of the next packet to release */
+    int64_t nextSeq_ {0};
+    /** Smallest transit time (arrival minus media time), slowly following clock drift */
+    clock::duration base_ {};
+    clock::duration lastTransit_ {};
+    /** RFC 3550 inter-arrival jitter, in microseconds */
+    double jitterUs_ {0};
+    /** Packet duration, from timestamps of consecutive packets */
+    clock::duration packetDuration_ {};
+    std::chrono::microseconds delay_ {MIN_DELAY};
+
+    Stats stats_ {};
+};
+
+} // namespace jami
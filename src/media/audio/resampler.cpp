@@ -23,6 +23,10 @@
 #include "libav_deps.h"
 #include "logger.h"
 #include "resampler.h"
+#include "frame_pool.h"
+#include "metrics.h"
+
+#include <algorithm>
 
 extern "C" {
 #include <libswresample/swresample.h>
@@ -30,18 +34,78 @@ extern "C" {
 
 namespace jami {
 
-Resampler::Resampler()
-    : swrCtx_(swr_alloc())
-    , initCount_(0)
+Resampler::ContextKey::ContextKey(const AVFrame* in, const AVFrame* out, std::size_t s)
+    : inRate(in->sample_rate)
+    , inChannels(in->ch_layout.nb_channels)
+    , inFormat(in->format)
+    , inOrder(in->ch_layout.order)
+    , inMask(in->ch_layout.order == AV_CHANNEL_ORDER_NATIVE ? in->ch_layout.u.mask : 0)
+    , outRate(out->sample_rate)
+    , outChannels(out->ch_layout.nb_channels)
+    , outFormat(out->format)
+    , outOrder(out->ch_layout.order)
+    , outMask(out->ch_layout.order == AV_CHANNEL_ORDER_NATIVE ? out->ch_layout.u.mask : 0)
+    , stream(s)
 {}
 
+bool
+Resampler::ContextKey::operator==(const ContextKey& o) const
+{
+    return inRate == o.inRate && inChannels == o.inChannels && inFormat == o.inFormat
+           && inOrder == o.inOrder && inMask == o.inMask && outRate == o.outRate
+           && outChannels == o.outChannels && outFormat == o.outFormat
+           && outOrder == o.outOrder && outMask == o.outMask && stream == o.stream;
+}
+
+Resampler::Resampler() {}
+
 Resampler::~Resampler()
 {
-    swr_free(&swrCtx_);
+    for (auto& ctx : contexts_)
+        swr_free(&ctx.swrCtx);
+}
+
+Resampler::Context&
+Resampler::getContext(const AVFrame* in, const AVFrame* out, std::size_t stream)
+{
+    ContextKey key(in, out, stream);
+    auto it = std::find_if(contexts_.begin(), contexts_.end(), [&](const Context& ctx) {
+        return ctx.key == key;
+    });
+    if (it != contexts_.end()) {
+        // Samples still buffered by a context this stream switched away from belong to its
+        // past: drop them instead of prepending them to the new input
+        auto last = std::find_if(contexts_.begin(), it, [&](const Context& ctx) {
+            return ctx.key.stream == stream;
+        });
+        if (last != it && swr_init(it->swrCtx) < 0) {
+            swr_free(&it->swrCtx);
+            contexts_.erase(it);
+            return getContext(in, out, stream);
+        }
+        std::rotate(contexts_.begin(), it, std::next(it));
+        return contexts_.front();
+    }
+
+    auto maxContexts = MAX_CONTEXTS + streams_;
+    while (contexts_.size() >= maxContexts) {
+        swr_free(&contexts_.back().swrCtx);
+        contexts_.pop_back();
+    }
+    contexts_.insert(contexts_.begin(), Context {key});
+    try {
+        reinit(contexts_.front(), in, out);
+    } catch (...) {
+        contexts_.erase(contexts_.begin());
+        throw;
+    }
+    static auto& created = metrics::counter("resampler.contexts.created");
+    created.inc();
+    return contexts_.front();
 }
 
 void
-Resampler::reinit(const AVFrame* in, const AVFrame* out)
+Resampler::reinit(Context& ctx, const AVFrame* in, const AVFrame* out)
 {
     // NOTE swr_set_matrix should be called on an uninitialized context
     auto swrCtx = swr_alloc();
@@ -103,9 +167,10 @@ Resampler::reinit(const AVFrame* in, const AVFrame* out)
     }
 
     if (swr_init(swrCtx) >= 0) {
-        std::swap(swrCtx_, swrCtx);
+        std::swap(ctx.swrCtx, swrCtx);
         swr_free(&swrCtx);
-        ++initCount_;
+        ctx.key = ContextKey(in, out, ctx.key.stream);
+        ++ctx.initCount;
     } else {
         std::string msg = "Failed to initialize resampler context";
         JAMI_ERR() << msg;
@@ -116,29 +181,58 @@ Resampler::reinit(const AVFrame* in, const AVFrame* out)
 int
 Resampler::resample(const AVFrame* input, AVFrame* output)
 {
-    if (!initCount_)
-        reinit(input, output);
+    return resample(input, output, 0);
+}
+
+int
+Resampler::resample(const AVFrame* input, AVFrame* output, std::size_t stream)
+{
+    // A null input flushes the context last used for this stream
+    Context* found = nullptr;
+    if (input)
+        found = &getContext(input, output, stream);
+    else
+        for (auto& c : contexts_)
+            if (c.key.stream == stream) {
+                found = &c;
+                break;
+            }
+    if (!found)
+        return 0;
+    auto& ctx = *found;
 
-    int ret = swr_convert_frame(swrCtx_, output, input);
+    bool pooled = false;
+    if (input && !output->data[0]) {
+        // Let the frame pool provide the output buffer instead of swresample
+        output->nb_samples = swr_get_out_samples(ctx.swrCtx, input->nb_samples);
+        if (output->nb_samples > 0 && frame_pool::getAudioBuffer(output) >= 0)
+            pooled = true;
+        else
+            output->nb_samples = 0;
+    }
+
+    int ret = swr_convert_frame(ctx.swrCtx, output, input);
     if (ret & AVERROR_INPUT_CHANGED || ret & AVERROR_OUTPUT_CHANGED) {
         // Under certain conditions, the resampler reinits itself in an infinite loop. This is
         // indicative of an underlying problem in the code. This check is so the backtrace
         // doesn't get mangled with a bunch of calls to Resampler::resample
-        if (initCount_ > 1) {
+        if (ctx.initCount > 1) {
             std::string msg = "Infinite loop detected in audio resampler, please open an issue on "
                               "https://git.jami.net";
             JAMI_ERR() << msg;
             throw std::runtime_error(msg);
         }
-        reinit(input, output);
-        return resample(input, output);
+        if (pooled)
+            frame_pool::releaseBuffers(output);
+        reinit(ctx, input, output);
+        return resample(input, output, stream);
     } else if (ret < 0) {
         JAMI_ERR() << "Failed to resample frame";
         return -1;
     }
 
     // Resampling worked, reset count to 1 so reinit isn't called again
-    initCount_ = 1;
+    ctx.initCount = 1;
     return 0;
 }
 
@@ -178,6 +272,14 @@ Resampler::resample(std::unique_ptr<AudioFrame>&& in, const AudioFormat& format)
 
 std::shared_ptr<AudioFrame>
 Resampler::resample(std::shared_ptr<AudioFrame>&& in, const AudioFormat& format)
+{
+    return resample(in, format, 0);
+}
+
+std::shared_ptr<AudioFrame>
+Resampler::resample(const std::shared_ptr<AudioFrame>& in,
+                    const AudioFormat& format,
+                    std::size_t stream)
 {
     if (not in) {
         return {};
@@ -190,16 +292,27 @@ Resampler::resample(std::shared_ptr<AudioFrame>&& in, const AudioFormat& format)
     if (inPtr->sample_rate == (int) format.sample_rate
         && inPtr->ch_layout.nb_channels == (int) format.nb_channels
         && (AVSampleFormat) inPtr->format == format.sampleFormat) {
-        return std::move(in);
+        return in;
     }
 
     auto output = std::make_shared<AudioFrame>(format);
     if (auto outPtr = output->pointer()) {
-        resample(inPtr, outPtr);
+        resample(inPtr, outPtr, stream);
         output->has_voice = in->has_voice;
         return output;
     }
     return {};
 }
 
+void
+Resampler::resample(const std::vector<std::shared_ptr<AudioFrame>>& inputs,
+                    const AudioFormat& format,
+                    std::vector<std::shared_ptr<AudioFrame>>& outputs)
+{
+    streams_ = std::max(streams_, inputs.size());
+    outputs.resize(inputs.size());
+    for (std::size_t i = 0; i < inputs.size(); ++i)
+        outputs[i] = resample(inputs[i], format, i);
+}
+
 } // namespace jami
@@ -26,6 +26,8 @@
 #include "media_buffer.h"
 #include "noncopyable.h"
 
+#include <vector>
+
 extern "C" {
 struct AVFrame;
 struct SwrContext;
@@ -35,10 +37,17 @@ namespace jami {
 
 /**
  * @brief Wrapper class for libswresample
+ *
+ * Keeps a small cache of resampler contexts, one per conversion and stream, so that
+ * alternating between formats (ringtones, tones, calls...) or between the streams of a
+ * batch does not reinitialize a context on each frame.
  */
 class Resampler
 {
 public:
+    /** Number of contexts kept, in addition to one per stream of the largest batch */
+    static constexpr std::size_t MAX_CONTEXTS {8};
+
     Resampler();
     ~Resampler();
 
@@ -66,32 +75,76 @@ public:
      */
     std::shared_ptr<AudioFrame> resample(std::shared_ptr<AudioFrame>&& in, const AudioFormat& out);
 
-private:
-    NON_COPYABLE(Resampler);
-
     /**
-     * @brief Reinitializes filter according to new format.
+     * @brief Resample several streams to the same format.
      *
-     * Reinitializes the resampler when new settings are detected. As long as both input and
-     * output formats don't change, this will only be called once.
+     * Each input index is an independent stream with its own context, so that the
+     * samples buffered by libswresample are not mixed between streams: callers should
+     * keep the same index for the same stream between calls.
+     * Frames already in @out format are passed through, others are resampled into frames
+     * from the frame pool. @outputs is resized to the number of inputs, null inputs giving
+     * null outputs.
      */
-    void reinit(const AVFrame* in, const AVFrame* out);
+    void resample(const std::vector<std::shared_ptr<AudioFrame>>& inputs,
+                  const AudioFormat& out,
+                  std::vector<std::shared_ptr<AudioFrame>>& outputs);
+
+    /** Number of cached contexts */
+    std::size_t contextCount() const { return contexts_.size(); }
+
+private:
+    NON_COPYABLE(Resampler);
+
+    struct ContextKey
+    {
+        int inRate, inChannels, inFormat, inOrder;
+        uint64_t inMask;
+        int outRate, outChannels, outFormat, outOrder;
+        uint64_t outMask;
+        std::size_t stream;
+
+        ContextKey(const AVFrame* in, const AVFrame* out, std::size_t stream);
+        bool operator==(const ContextKey& o) const;
+    };
+
+    struct Context
+    {
+        ContextKey key;
+        /**
+         * @brief Libswresample resampler context.
+         *
+         * NOTE SwrContext is an imcomplete type and cannot be stored in a smart pointer.
+         */
+        SwrContext* swrCtx {nullptr};
+        /**
+         * @brief Number of times @swrCtx has been initialized with no successful audio resampling.
+         *
+         * 1: Initialized
+         * >1: Invalid frames or formats, reinit is going to be called in an infinite loop
+         */
+        unsigned initCount {0};
+    };
+
+    int resample(const AVFrame* input, AVFrame* output, std::size_t stream);
+    std::shared_ptr<AudioFrame> resample(const std::shared_ptr<AudioFrame>& in,
+                                         const AudioFormat& format,
+                                         std::size_t stream);
 
     /**
-     * @brief Libswresample resampler context.
+     * @brief Context for this conversion, most recently used first.
      *
-     * NOTE SwrContext is an imcomplete type and cannot be stored in a smart pointer.
+     * Creates it if needed, evicting the least recently used contexts.
      */
-    SwrContext* swrCtx_;
+    Context& getContext(const AVFrame* in, const AVFrame* out, std::size_t stream);
 
     /**
-     * @brief Number of times @swrCtx_ has been initialized with no successful audio resampling.
-     *
-     * 0: Uninitialized
-     * 1: Initialized
-     * >1: Invalid frames or formats, reinit is going to be called in an infinite loop
+     * @brief Reinitializes a context according to new formats.
      */
-    unsigned initCount_;
+    void reinit(Context& ctx, const AVFrame* in, const AVFrame* out);
+
+    std::vector<Context> contexts_ {};
+    /** Number of streams of the largest batch */
+    std::size_t streams_ {0};
 };
 
 } // namespace jami
@@ -28,6 +28,7 @@
 #include "client/ring_signal.h"
 #include "media_buffer.h"
 #include "libav_deps.h"
+#include "metrics.h"
 
 #include <chrono>
 #include <cstdlib>
@@ -69,8 +70,10 @@ RingBuffer::flush(const std::string& call_id)
 void
 RingBuffer::flushAll()
 {
-    for (auto& offset : readoffsets_)
+    for (auto& offset : readoffsets_) {
         offset.second.offset = endPos_;
+        offset.second.playing = false;
+    }
 }
 
 size_t
@@ -177,8 +180,11 @@ RingBuffer::putToBuffer(std::shared_ptr<AudioFrame>&& data)
         return;
 
     size_t len = buffer_size - putLength();
-    if (len == 0)
+    if (len == 0) {
+        static auto& overruns = metrics::counter("ringbuffer.overruns");
+        overruns.inc();
         discard(1);
+    }
 
     size_t pos = endPos_;
 
@@ -232,11 +238,19 @@ RingBuffer::get(const std::string& call_id)
 
     size_t startPos = offset->second.offset;
     size_t len = (endPos_ + buffer_size - startPos) % buffer_size;
-    if (len == 0)
+    if (len == 0) {
+        // Readers poll until data comes: only count starvation during playback
+        if (offset->second.playing) {
+            static auto& underruns = metrics::counter("ringbuffer.underruns");
+            underruns.inc();
+            offset->second.playing = false;
+        }
         return {};
+    }
 
     auto ret = buffer_[startPos];
     offset->second.offset = (startPos + 1) % buffer_size;
+    offset->second.playing = true;
     return ret;
 }
 
@@ -158,6 +158,8 @@ private:
     {
         size_t offset;
         FrameCallback callback;
+        /** Frames were read since the last underrun or flush */
+        bool playing {false};
     };
     using ReadOffsetMap = std::map<std::string, ReadOffset>;
     NON_COPYABLE(RingBuffer);
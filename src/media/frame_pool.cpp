@@ -0,0 +1,339 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include "libav_deps.h" // MUST BE INCLUDED FIRST
+#include "frame_pool.h"
+#include "metrics.h"
+
+extern "C" {
+#include <libavutil/cpu.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace jami {
+namespace frame_pool {
+
+// Extra bytes at the end of buffers, as av_frame_get_buffer does for SIMD readers
+static constexpr std::size_t PADDING = 64;
+// Max bytes kept in the freelist of each thread
+static constexpr std::size_t LOCAL_MAX_BYTES = 4 * 1024 * 1024;
+// Max bytes kept in the shared freelist
+static constexpr std::size_t GLOBAL_MAX_BYTES = 32 * 1024 * 1024;
+// Max bytes kept by all freelists together, whatever the number of threads
+static constexpr std::size_t TOTAL_MAX_BYTES = 64 * 1024 * 1024;
+// Lines added to video frames, as av_frame_get_buffer does for codecs reading whole blocks
+static constexpr int HEIGHT_ALIGN = 32;
+
+static std::atomic<std::size_t> pooledBytes {0};
+
+static metrics::Gauge&
+pooledGauge()
+{
+    static auto& gauge = metrics::gauge("media.frame_pool.pooled_bytes");
+    return gauge;
+}
+
+/**
+ * Account for a buffer entering a freelist
+ * @return false if the pool is full
+ */
+static bool
+reserve(std::size_t cls)
+{
+    auto bytes = pooledBytes.load(std::memory_order_relaxed);
+    do {
+        if (bytes + cls > TOTAL_MAX_BYTES)
+            return false;
+    } while (not pooledBytes.compare_exchange_weak(bytes, bytes + cls, std::memory_order_relaxed));
+    pooledGauge().add(cls);
+    return true;
+}
+
+static void
+unreserve(std::size_t cls)
+{
+    pooledBytes.fetch_sub(cls, std::memory_order_relaxed);
+    pooledGauge().sub(cls);
+}
+
+/**
+ * Size classes: powers of two up to 64 KiB (audio), then multiples of 64 KiB (video)
+ */
+static std::size_t
+sizeClass(std::size_t size)
+{
+    static constexpr std::size_t LARGE = 64 * 1024;
+    if (size > LARGE)
+        return (size + LARGE - 1) / LARGE * LARGE;
+    std::size_t c = 4096;
+    while (c < size)
+        c <<= 1;
+    return c;
+}
+
+struct FreeList
+{
+    std::map<std::size_t, std::vector<uint8_t*>> buffers;
+    std::size_t bytes {0};
+
+    uint8_t* pop(std::size_t cls)
+    {
+        auto it = buffers.find(cls);
+        if (it == buffers.end() or it->second.empty())
+            return nullptr;
+        auto data = it->second.back();
+        it->second.pop_back();
+        bytes -= cls;
+        unreserve(cls);
+        return data;
+    }
+
+    bool push(std::size_t cls, uint8_t* data, std::size_t maxBytes)
+    {
+        if (bytes + cls > maxBytes or not reserve(cls))
+            return false;
+        buffers[cls].emplace_back(data);
+        bytes += cls;
+        return true;
+    }
+};
+
+struct GlobalFreeList
+{
+    std::mutex mutex;
+    FreeList list;
+};
+
+static GlobalFreeList&
+globalFreeList()
+{
+    // Intentionally leaked: frames may be released after static destruction
+    static auto* list = new GlobalFreeList;
+    return *list;
+}
+
+static void releaseToGlobal(std::size_t cls, uint8_t* data);
+
+// Trivially destructible, so it can be checked while the thread exits
+enum class LocalState : uint8_t { Unused, Alive, Destroyed };
+static thread_local LocalState localState {LocalState::Unused};
+
+struct LocalFreeList
+{
+    FreeList list;
+
+    LocalFreeList() { localState = LocalState::Alive; }
+    ~LocalFreeList()
+    {
+        localState = LocalState::Destroyed;
+        for (auto& [cls, buffers] : list.buffers)
+            for (auto data : buffers) {
+                unreserve(cls);
+                releaseToGlobal(cls, data);
+            }
+    }
+};
+
+static FreeList*
+localFreeList()
+{
+    if (localState == LocalState::Destroyed)
+        return nullptr;
+    static thread_local LocalFreeList local;
+    return &local.list;
+}
+
+static metrics::Counter&
+allocatedCounter()
+{
+    static auto& counter = metrics::counter("media.frame_pool.allocated");
+    return counter;
+}
+
+static metrics::Counter&
+reusedCounter()
+{
+    static auto& counter = metrics::counter("media.frame_pool.reused");
+    return counter;
+}
+
+static void
+releaseToGlobal(std::size_t cls, uint8_t* data)
+{
+    auto& global = globalFreeList();
+    {
+        std::lock_guard<std::mutex> lk(global.mutex);
+        if (global.list.push(cls, data, GLOBAL_MAX_BYTES))
+            return;
+    }
+    av_free(data);
+}
+
+static void
+releaseBuffer(void* opaque, uint8_t* data)
+{
+    auto cls = static_cast<std::size_t>(reinterpret_cast<uintptr_t>(opaque));
+    if (auto local = localFreeList())
+        if (local->push(cls, data, LOCAL_MAX_BYTES))
+            return;
+    releaseToGlobal(cls, data);
+}
+
+AVBufferRef*
+getBuffer(std::size_t size)
+{
+    auto cls = sizeClass(size + PADDING);
+    uint8_t* data = nullptr;
+    if (auto local = localFreeList())
+        data = local->pop(cls);
+    if (not data) {
+        auto& global = globalFreeList();
+        std::lock_guard<std::mutex> lk(global.mutex);
+        data = global.list.pop(cls);
+    }
+    if (data) {
+        reusedCounter().inc();
+    } else {
+        data = static_cast<uint8_t*>(av_malloc(cls));
+        if (not data)
+            return nullptr;
+        allocatedCounter().inc();
+    }
+    auto buf = av_buffer_create(data,
+                                static_cast<int>(cls),
+                                releaseBuffer,
+                                reinterpret_cast<void*>(static_cast<uintptr_t>(cls)),
+                                0);
+    if (not buf)
+        releaseBuffer(reinterpret_cast<void*>(static_cast<uintptr_t>(cls)), data);
+    return buf;
+}
+
+int
+getAudioBuffer(AVFrame* frame)
+{
+    auto format = static_cast<AVSampleFormat>(frame->format);
+    int channels = frame->ch_layout.nb_channels;
+    int planes = av_sample_fmt_is_planar(format) ? channels : 1;
+    if (channels <= 0 or frame->nb_samples <= 0 or planes > AV_NUM_DATA_POINTERS)
+        return av_frame_get_buffer(frame, 0);
+
+    int size = av_samples_get_buffer_size(nullptr, channels, frame->nb_samples, format, 0);
+    if (size < 0)
+        return size;
+    auto buf = getBuffer(size);
+    if (not buf)
+        return AVERROR(ENOMEM);
+    int ret = av_samples_fill_arrays(frame->data,
+                                     &frame->linesize[0],
+                                     buf->data,
+                                     channels,
+                                     frame->nb_samples,
+                                     format,
+                                     0);
+    if (ret < 0) {
+        av_buffer_unref(&buf);
+        return ret;
+    }
+    frame->buf[0] = buf;
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+int
+getVideoBuffer(AVFrame* frame, int align)
+{
+    auto format = static_cast<AVPixelFormat>(frame->format);
+    auto desc = av_pix_fmt_desc_get(format);
+    if (not desc or (desc->flags & AV_PIX_FMT_FLAG_HWACCEL) or frame->width <= 0
+        or frame->height <= 0)
+        return av_frame_get_buffer(frame, align);
+    int ret = av_image_check_size(frame->width, frame->height, 0, nullptr);
+    if (ret < 0)
+        return ret;
+
+    // Same layout as av_frame_get_buffer: aligned line sizes, height padded
+    // and padding between planes, for SIMD code reading past the visible area
+    if (align <= 0)
+        align = static_cast<int>(av_cpu_max_align());
+    for (int i = 1; i <= align; i += i) {
+        ret = av_image_fill_linesizes(frame->linesize, format, FFALIGN(frame->width, i));
+        if (ret < 0)
+            return ret;
+        if (not(frame->linesize[0] & (align - 1)))
+            break;
+    }
+    for (int i = 0; i < 4 and frame->linesize[i]; i++)
+        frame->linesize[i] = FFALIGN(frame->linesize[i], align);
+
+    int paddedHeight = FFALIGN(frame->height, HEIGHT_ALIGN);
+    std::size_t sizes[4];
+    ptrdiff_t linesizes[4];
+    for (int i = 0; i < 4; i++)
+        linesizes[i] = frame->linesize[i];
+    ret = av_image_fill_plane_sizes(sizes, format, paddedHeight, linesizes);
+    if (ret < 0)
+        return ret;
+    std::size_t planePadding = std::max(16 + 16 - 1, align);
+    std::size_t size = 4 * planePadding;
+    for (auto planeSize : sizes)
+        size += planeSize;
+
+    auto buf = getBuffer(size);
+    if (not buf)
+        return AVERROR(ENOMEM);
+    ret = av_image_fill_pointers(frame->data, format, paddedHeight, buf->data, frame->linesize);
+    if (ret < 0) {
+        av_buffer_unref(&buf);
+        return ret;
+    }
+    for (int i = 1; i < 4; i++)
+        if (frame->data[i])
+            frame->data[i] += i * planePadding;
+    frame->buf[0] = buf;
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+void
+releaseBuffers(AVFrame* frame)
+{
+    for (auto& buf : frame->buf)
+        av_buffer_unref(&buf);
+    for (int i = 0; i < frame->nb_extended_buf; i++)
+        av_buffer_unref(&frame->extended_buf[i]);
+    av_freep(&frame->extended_buf);
+    frame->nb_extended_buf = 0;
+    if (frame->extended_data != frame->data)
+        av_freep(&frame->extended_data);
+    for (int i = 0; i < AV_NUM_DATA_POINTERS; i++) {
+        frame->data[i] = nullptr;
+        frame->linesize[i] = 0;
+    }
+    frame->extended_data = nullptr;
+    frame->nb_samples = 0;
+}
+
+} // namespace frame_pool
+} // namespace jami
@@ -0,0 +1,70 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+extern "C" {
+struct AVFrame;
+struct AVBufferRef;
+}
+
+namespace jami {
+
+/**
+ * Recycled buffers for audio and video frames.
+ *
+ * Buffers are grouped by size class. Released buffers go to a freelist owned
+ * by the releasing thread, then to a shared freelist once the thread's list
+ * is full, so steady-state media paths stop hitting the allocator. The bytes
+ * kept by all freelists are bounded, whatever the number of threads.
+ * Allocations, reuses and kept bytes are reported as the
+ * media.frame_pool.allocated, media.frame_pool.reused and
+ * media.frame_pool.pooled_bytes metrics.
+ */
+namespace frame_pool {
+
+/**
+ * @return a buffer of at least size bytes (plus padding), nullptr on failure
+ */
+AVBufferRef* getBuffer(std::size_t size);
+
+/**
+ * Allocate the buffers of an audio frame.
+ * Format, channel layout and nb_samples must be set.
+ * @return 0 on success, a negative AVERROR code otherwise
+ */
+int getAudioBuffer(AVFrame* frame);
+
+/**
+ * Allocate the buffers of a video frame, with the layout of av_frame_get_buffer
+ * (padded height, padding between planes).
+ * Format, width and height must be set.
+ * @param align     Line size alignment, 0 for the CPU alignment
+ * @return 0 on success, a negative AVERROR code otherwise
+ */
+int getVideoBuffer(AVFrame* frame, int align);
+
+/**
+ * Release the buffers of a frame, keeping its format and geometry
+ */
+void releaseBuffers(AVFrame* frame);
+
+} // namespace frame_pool
+} // namespace jami
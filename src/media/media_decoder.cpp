@@ -53,6 +53,8 @@ const unsigned jitterBufferMaxSize_ {1500};
 const constexpr auto jitterBufferMaxDelay_ = std::chrono::milliseconds(50);
 // maximum number of times accelerated decoding can fail in a row before falling back to software
 const constexpr unsigned MAX_ACCEL_FAILURES {5};
+// smallest MJPEG frame size (720p) decoded with several threads
+const constexpr int MJPEG_THREADING_MIN_PIXELS {1280 * 720};
 
 MediaDemuxer::MediaDemuxer()
     : inputCtx_(avformat_alloc_context())
@@ -130,9 +132,18 @@ MediaDemuxer::openInput(const DeviceParams& params)
     av_dict_set(&options_, "sdp_flags", params.sdp_flags.c_str(), 0);
 
     // Set jitter buffer options
-    av_dict_set(&options_, "reorder_queue_size", std::to_string(jitterBufferMaxSize_).c_str(), 0);
-    auto us = std::chrono::duration_cast<std::chrono::microseconds>(jitterBufferMaxDelay_).count();
-    av_dict_set(&options_, "max_delay", std::to_string(us).c_str(), 0);
+    if (params.reorder_packets) {
+        av_dict_set(&options_,
+                    "reorder_queue_size",
+                    std::to_string(jitterBufferMaxSize_).c_str(),
+                    0);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(jitterBufferMaxDelay_)
+                      .count();
+        av_dict_set(&options_, "max_delay", std::to_string(us).c_str(), 0);
+    } else {
+        // Packets come in order, do not hold them back waiting for lost ones
+        av_dict_set(&options_, "reorder_queue_size", "0", 0);
+    }
 
     if (!params.pixel_format.empty()) {
         av_dict_set(&options_, "pixel_format", params.pixel_format.c_str(), 0);
@@ -550,6 +561,16 @@ MediaDecoder::setupStream()
              inputDecoder_->name,
              av_get_media_type_string(avStream_->codecpar->codec_type));
     decoderCtx_->thread_count = std::max(1u, std::min(8u, std::thread::hardware_concurrency() / 2));
+    if (decoderCtx_->codec_id == AV_CODEC_ID_MJPEG) {
+        // Camera MJPEG frames are all intra: decode them in parallel, but only when
+        // large enough to need it, as each frame thread adds a frame of latency
+        if (width_ * height_ >= MJPEG_THREADING_MIN_PIXELS) {
+            decoderCtx_->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            decoderCtx_->thread_count = std::min(decoderCtx_->thread_count, 4);
+        } else {
+            decoderCtx_->thread_count = 1;
+        }
+    }
     if (emulateRate_)
         JAMI_DBG() << "Using framerate emulation";
     startTime_ = av_gettime(); // used to set pts after decoding, and for rate emulation
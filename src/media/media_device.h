@@ -48,6 +48,7 @@ struct DeviceParams
     unsigned channel {}; // Channel number
     std::string loop {};
     std::string sdp_flags {};
+    bool reorder_packets {true}; // RTP demuxer reordering, false if done upstream
     int offset_x {};
     int offset_y {};
     int orientation {};
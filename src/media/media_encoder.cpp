@@ -23,6 +23,7 @@
 #include "fileutils.h"
 #include "logger.h"
 #include "manager.h"
+#include "metrics.h"
 #include "string_utils.h"
 #include "system_codec_container.h"
 
@@ -64,6 +65,9 @@ MediaEncoder::MediaEncoder()
 
 MediaEncoder::~MediaEncoder()
 {
+#ifdef ENABLE_VIDEO
+    setRenditions({});
+#endif
     if (outputCtx_) {
         if (outputCtx_->priv_data && outputCtx_->pb)
             av_write_trailer(outputCtx_);
@@ -434,7 +438,7 @@ MediaEncoder::encode(const std::shared_ptr<VideoFrame>& input,
         return -1;
     }
 #else
-    output = getScaledSWFrame(*input.get());
+    output = getScaledSWFrame(input);
 #endif // RING_ACCEL
 
     if (!output) {
@@ -462,7 +466,7 @@ MediaEncoder::encode(const std::shared_ptr<VideoFrame>& input,
 #endif // ENABLE_VIDEO
 
 int
-MediaEncoder::encodeAudio(AudioFrame& frame)
+MediaEncoder::encodeAudio(AudioFrame& frame, std::vector<libjami::PacketBuffer>* packets)
 {
     if (!initialized_) {
         // Initialize on first video frame, or first audio frame if no video stream
@@ -473,10 +477,49 @@ MediaEncoder::encodeAudio(AudioFrame& frame)
     }
     frame.pointer()->pts = sent_samples;
     sent_samples += frame.pointer()->nb_samples;
+    capturedPackets_ = packets;
     encode(frame.pointer(), currentStreamIdx_);
+    capturedPackets_ = nullptr;
+    return 0;
+}
+
+int
+MediaEncoder::sendAudio(const std::vector<libjami::PacketBuffer>& packets,
+                        int64_t pts,
+                        int nbSamples)
+{
+    if (!initialized_) {
+        if (not videoOpts_.isValid())
+            startIO();
+        else
+            return 0;
+    }
+    // Keep the packets' offset to the frame, in our own timeline
+    auto offset = (int64_t) sent_samples - pts;
+    sent_samples += nbSamples;
+    for (const auto& packet : packets) {
+        libjami::PacketBuffer pkt(av_packet_clone(packet.get()));
+        if (not pkt)
+            return -1;
+        if (pkt->pts != AV_NOPTS_VALUE)
+            pkt->pts += offset;
+        if (pkt->dts != AV_NOPTS_VALUE)
+            pkt->dts += offset;
+        if (not send(*pkt, currentStreamIdx_))
+            return -1;
+    }
     return 0;
 }
 
+void
+MediaEncoder::resetAudioEncoder()
+{
+    std::lock_guard<std::mutex> lk(encMutex_);
+    auto encoderCtx = getCurrentAudioAVCtx();
+    if (encoderCtx and encoderCtx->codec->capabilities & AV_CODEC_CAP_ENCODER_FLUSH)
+        avcodec_flush_buffers(encoderCtx);
+}
+
 int
 MediaEncoder::encode(AVFrame* frame, int streamIdx)
 {
@@ -506,6 +549,15 @@ MediaEncoder::encode(AVFrame* frame, int streamIdx)
     if (!encoderCtx)
         return -1;
 
+    bool isVideo = encoderCtx->codec_type == AVMEDIA_TYPE_VIDEO;
+    static auto& videoFrames = metrics::counter("media_encoder.video_frames");
+    static auto& audioFrames = metrics::counter("media_encoder.audio_frames");
+    static auto& videoEncodeTime = metrics::histogram("media_encoder.video_encode_us");
+    static auto& audioEncodeTime = metrics::histogram("media_encoder.audio_encode_us");
+    metrics::ScopedTimer<> encodeTimer(isVideo ? videoEncodeTime : audioEncodeTime);
+    if (frame)
+        (isVideo ? videoFrames : audioFrames).inc();
+
     ret = avcodec_send_frame(encoderCtx, frame);
     if (ret < 0)
         return -1;
@@ -536,6 +588,8 @@ MediaEncoder::send(AVPacket& pkt, int streamIdx)
         streamIdx = initStream(videoCodec_);
         startIO();
     }
+    if (capturedPackets_)
+        capturedPackets_->emplace_back(av_packet_clone(&pkt));
     if (streamIdx < 0)
         streamIdx = currentStreamIdx_;
     if (streamIdx >= 0 and static_cast<size_t>(streamIdx) < encoders_.size()
@@ -1266,7 +1320,7 @@ MediaEncoder::getHWFrame(const std::shared_ptr<VideoFrame>& input,
                 output = input;
             }
         } else {
-            output = getScaledSWFrame(*input.get());
+            output = getScaledSWFrame(input);
         }
 #elif !defined(__APPLE__) && defined(RING_ACCEL)
         // Other Platforms
@@ -1284,11 +1338,11 @@ MediaEncoder::getHWFrame(const std::shared_ptr<VideoFrame>& input,
             // Software decoded frame with a hardware encoder, convert to accepted format first
             output = getHWFrameFromSWFrame(*input.get());
         } else {
-            output = getScaledSWFrame(*input.get());
+            output = getScaledSWFrame(input);
         }
 #else
         // macOS
-        output = getScaledSWFrame(*input.get());
+        output = getScaledSWFrame(input);
 #endif
     } catch (const std::runtime_error& e) {
         JAMI_ERR("Accel failure: %s", e.what());
@@ -1327,11 +1381,39 @@ MediaEncoder::getHWFrameFromSWFrame(const VideoFrame& input)
 }
 #endif
 
+void
+MediaEncoder::setRenditions(std::shared_ptr<video::VideoRenditions> renditions)
+{
+    if (renditions == renditions_)
+        return;
+    if (renditions_ and renditionFormat_.width)
+        renditions_->unsubscribe(renditionFormat_);
+    renditionFormat_ = {};
+    renditions_ = std::move(renditions);
+}
+
 std::shared_ptr<VideoFrame>
-MediaEncoder::getScaledSWFrame(const VideoFrame& input)
+MediaEncoder::getScaledSWFrame(const std::shared_ptr<VideoFrame>& input)
 {
+    if (renditions_) {
+        video::VideoRenditions::Format format {scaledFrame_->width(),
+                                               scaledFrame_->height(),
+                                               (AVPixelFormat) scaledFrame_->format()};
+        if (format != renditionFormat_) {
+            if (renditionFormat_.width)
+                renditions_->unsubscribe(renditionFormat_);
+            renditionFormat_ = renditions_->subscribe(format) ? format
+                                                              : video::VideoRenditions::Format {};
+        }
+        if (auto rendition = renditions_->get(input, format)) {
+            // Shared with other encoders: only reference it, the caller sets frame properties
+            auto frame = std::make_shared<VideoFrame>();
+            frame->copyFrom(*rendition);
+            return frame;
+        }
+    }
     libav_utils::fillWithBlack(scaledFrame_->pointer());
-    scaler_.scale_with_aspect(input, *scaledFrame_);
+    scaler_.scale_with_aspect(*input, *scaledFrame_);
     return scaledFrame_;
 }
 #endif
@@ -28,6 +28,7 @@
 #ifdef ENABLE_VIDEO
 #include "video/video_base.h"
 #include "video/video_scaler.h"
+#include "video/video_renditions.h"
 #endif
 
 #include "noncopyable.h"
@@ -84,9 +85,31 @@ public:
 
 #ifdef ENABLE_VIDEO
     int encode(const std::shared_ptr<VideoFrame>& input, bool is_keyframe, int64_t frame_number);
+
+    /**
+     * Use the scaled frames of the input source when they match the encoder format,
+     * instead of scaling each frame.
+     */
+    void setRenditions(std::shared_ptr<video::VideoRenditions> renditions);
 #endif // ENABLE_VIDEO
 
-    int encodeAudio(AudioFrame& frame);
+    /**
+     * @param packets  if not null, receives a copy of the encoded packets, in the
+     *                 encoder time base
+     */
+    int encodeAudio(AudioFrame& frame, std::vector<libjami::PacketBuffer>* packets = nullptr);
+
+    /**
+     * Send packets encoded by an encoder with the same configuration, instead of
+     * encoding a frame of nbSamples samples. pts is the pts given to that frame.
+     */
+    int sendAudio(const std::vector<libjami::PacketBuffer>& packets, int64_t pts, int nbSamples);
+
+    /**
+     * Reset the audio encoder history, if supported, before encoding again
+     * after packets were sent with sendAudio.
+     */
+    void resetAudioEncoder();
 
     // frame should be ready to be sent to the encoder at this point
     int encode(AVFrame* frame, int streamIdx);
@@ -144,7 +167,7 @@ private:
     int getHWFrame(const std::shared_ptr<VideoFrame>& input, std::shared_ptr<VideoFrame>& output);
     std::shared_ptr<VideoFrame> getUnlinkedHWFrame(const VideoFrame& input);
     std::shared_ptr<VideoFrame> getHWFrameFromSWFrame(const VideoFrame& input);
-    std::shared_ptr<VideoFrame> getScaledSWFrame(const VideoFrame& input);
+    std::shared_ptr<VideoFrame> getScaledSWFrame(const std::shared_ptr<VideoFrame>& input);
 #endif
 
     std::vector<AVCodecContext*> encoders_;
@@ -160,10 +183,13 @@ private:
     bool linkableHW_ {false};
     RateMode mode_ {RateMode::CRF_CONSTRAINED};
     bool fecEnabled_ {false};
+    std::vector<libjami::PacketBuffer>* capturedPackets_ {nullptr};
 
 #ifdef ENABLE_VIDEO
     video::VideoScaler scaler_;
     std::shared_ptr<VideoFrame> scaledFrame_;
+    std::shared_ptr<video::VideoRenditions> renditions_;
+    video::VideoRenditions::Format renditionFormat_ {};
 #endif // ENABLE_VIDEO
 
     std::vector<uint8_t> scaledFrameBuffer_;
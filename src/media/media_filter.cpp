@@ -169,7 +169,9 @@ MediaFilter::feedInput(AVFrame* frame, const std::string& inputName)
             continue;
 
         if (ms.format != frame->format
-            || (ms.isVideo && (ms.width != frame->width || ms.height != frame->height))
+            || (ms.isVideo
+                && (ms.width != frame->width || ms.height != frame->height
+                    || !ms.sameHwFramesCtx(frame->hw_frames_ctx)))
             || (!ms.isVideo
                 && (ms.sampleRate != frame->sample_rate || ms.nbChannels != frame->ch_layout.nb_channels))) {
             ms.update(frame);
@@ -280,6 +282,9 @@ MediaFilter::initInputFilter(AVFilterInOut* in, const MediaStream& msp)
         params->width = msp.width;
         params->height = msp.height;
         params->frame_rate = msp.frameRate;
+        // Hardware filters need the frames context of their inputs
+        if (msp.hwFramesCtx)
+            params->hw_frames_ctx = msp.hwFramesCtx.get();
         buffersrc = avfilter_get_by_name("buffer");
     } else {
         params->sample_rate = msp.sampleRate;
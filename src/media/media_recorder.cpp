@@ -26,11 +26,8 @@
 #include "media_io_handle.h"
 #include "media_recorder.h"
 #include "system_codec_container.h"
-#include "video/filter_transpose.h"
 #ifdef ENABLE_VIDEO
-#ifdef RING_ACCEL
-#include "video/accel.h"
-#endif
+#include "video/frame_cache.h"
 #endif
 
 #include <opendht/thread_pool.h>
@@ -43,8 +40,6 @@
 
 namespace jami {
 
-const constexpr char ROTATION_FILTER_INPUT_NAME[] = "in";
-
 // Replaces every occurrence of @from with @to in @str
 static std::string
 replaceAll(const std::string& str, const std::string& from, const std::string& to)
@@ -81,39 +76,22 @@ struct MediaRecorder::StreamObserver : public Observer<std::shared_ptr<MediaFram
     {
 #ifdef ENABLE_VIDEO
         if (info.isVideo) {
-            std::shared_ptr<VideoFrame> framePtr;
-#ifdef RING_ACCEL
-            auto desc = av_pix_fmt_desc_get(
-                (AVPixelFormat) (std::static_pointer_cast<VideoFrame>(m))->format());
-            if (desc && (desc->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
-                try {
-                    framePtr = jami::video::HardwareAccel::transferToMainMemory(
-                        *std::static_pointer_cast<VideoFrame>(m), AV_PIX_FMT_NV12);
-                } catch (const std::runtime_error& e) {
-                    JAMI_ERR("Accel failure: %s", e.what());
-                    return;
-                }
-            } else
-#endif
-                framePtr = std::static_pointer_cast<VideoFrame>(m);
-            int angle = framePtr->getOrientation();
-            if (angle != rotation_) {
-                videoRotationFilter_ = jami::video::getTransposeFilter(angle,
-                                                                       ROTATION_FILTER_INPUT_NAME,
-                                                                       framePtr->width(),
-                                                                       framePtr->height(),
-                                                                       framePtr->format(),
-                                                                       true);
-                rotation_ = angle;
-            }
-            if (videoRotationFilter_) {
-                videoRotationFilter_->feedInput(framePtr->pointer(), ROTATION_FILTER_INPUT_NAME);
-                auto rotated = videoRotationFilter_->readOutput();
-                av_frame_remove_side_data(rotated->pointer(), AV_FRAME_DATA_DISPLAYMATRIX);
-                cb_(std::move(rotated));
-            } else {
+            if (std::static_pointer_cast<VideoFrame>(m)->getOrientation() == 0) {
                 cb_(m);
+                return;
+            }
+            std::shared_ptr<VideoFrame> framePtr;
+            try {
+                framePtr = transposer_.transpose(jami::video::softwareFrame(m));
+            } catch (const std::runtime_error& e) {
+                JAMI_ERR("Accel failure: %s", e.what());
+                return;
             }
+            // Rotated frames are shared, remove the rotation from our own reference
+            auto rotated = std::make_shared<VideoFrame>();
+            rotated->copyFrom(*framePtr);
+            av_frame_remove_side_data(rotated->pointer(), AV_FRAME_DATA_DISPLAYMATRIX);
+            cb_(std::move(rotated));
         } else {
 #endif
             cb_(m);
@@ -136,8 +114,9 @@ struct MediaRecorder::StreamObserver : public Observer<std::shared_ptr<MediaFram
 
 private:
     std::function<void(const std::shared_ptr<MediaFrame>&)> cb_;
-    std::unique_ptr<MediaFilter> videoRotationFilter_ {};
-    int rotation_ = 0;
+#ifdef ENABLE_VIDEO
+    video::FrameTransposer transposer_ {true};
+#endif
     std::set<Observable<std::shared_ptr<MediaFrame>>*> observablesFrames_;
 };
 
@@ -318,32 +297,21 @@ MediaRecorder::onFrame(const std::string& name, const std::shared_ptr<MediaFrame
     std::lock_guard<std::mutex> lk(mutexStreamSetup_);
 
     // copy frame to not mess with the original frame's pts (does not actually copy frame data)
-    std::unique_ptr<MediaFrame> clone;
+    auto clone = std::make_unique<MediaFrame>();
     const auto& ms = streams_[name]->info;
-#if defined(ENABLE_VIDEO) && defined(RING_ACCEL)
+#ifdef ENABLE_VIDEO
     if (ms.isVideo) {
-        auto desc = av_pix_fmt_desc_get(
-            (AVPixelFormat) (std::static_pointer_cast<VideoFrame>(frame))->format());
-        if (desc && (desc->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
-            try {
-                clone = video::HardwareAccel::transferToMainMemory(
-                    *std::static_pointer_cast<VideoFrame>(frame),
-                    static_cast<AVPixelFormat>(ms.format));
-            } catch (const std::runtime_error& e) {
-                JAMI_ERR("Accel failure: %s", e.what());
-                return;
-            }
-        } else {
-            clone = std::make_unique<MediaFrame>();
-            clone->copyFrom(*frame);
+        // Hardware frames are only downloaded once for all consumers
+        try {
+            clone->copyFrom(
+                *video::softwareFrame(frame, static_cast<AVPixelFormat>(ms.format)));
+        } catch (const std::runtime_error& e) {
+            JAMI_ERR("Accel failure: %s", e.what());
+            return;
         }
-    } else {
-#endif // ENABLE_VIDEO && RING_ACCEL
-        clone = std::make_unique<MediaFrame>();
+    } else
+#endif // ENABLE_VIDEO
         clone->copyFrom(*frame);
-#if defined(ENABLE_VIDEO) && defined(RING_ACCEL)
-    }
-#endif // ENABLE_VIDEO && RING_ACCEL
     clone->pointer()->pts = av_rescale_q_rnd(av_gettime() - startTimeStamp_,
                                              {1, AV_TIME_BASE},
                                              ms.timeBase,
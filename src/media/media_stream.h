@@ -25,6 +25,7 @@
 #include "rational.h"
 #include "audio/audiobuffer.h"
 
+#include <memory>
 #include <string>
 
 namespace jami {
@@ -43,6 +44,8 @@ struct MediaStream
     int sampleRate {0};
     int nbChannels {0};
     int frameSize {0};
+    /** Frames context of hardware video frames, null for software frames */
+    std::shared_ptr<AVBufferRef> hwFramesCtx {};
 
     MediaStream() {}
 
@@ -142,6 +145,7 @@ struct MediaStream
         if (isVideo) {
             width = f->width;
             height = f->height;
+            setHwFramesCtx(f->hw_frames_ctx);
         } else {
             sampleRate = f->sample_rate;
             nbChannels = f->ch_layout.nb_channels;
@@ -150,6 +154,19 @@ struct MediaStream
                 frameSize = f->nb_samples;
         }
     }
+
+    void setHwFramesCtx(AVBufferRef* ctx)
+    {
+        if (ctx)
+            hwFramesCtx = {av_buffer_ref(ctx), [](AVBufferRef* r) { av_buffer_unref(&r); }};
+        else
+            hwFramesCtx.reset();
+    }
+
+    bool sameHwFramesCtx(const AVBufferRef* ctx) const
+    {
+        return (hwFramesCtx ? hwFramesCtx->data : nullptr) == (ctx ? ctx->data : nullptr);
+    }
 };
 
 inline std::ostream&
@@ -24,6 +24,7 @@
 #include "libav_deps.h" // THEN THIS ONE AFTER
 
 #include "socket_pair.h"
+#include "audio/jitter_buffer.h"
 #include "connectivity/ice_socket.h"
 #include "libav_utils.h"
 #include "logger.h"
@@ -196,7 +197,10 @@ SocketPair::SocketPair(std::unique_ptr<IceSocket> rtp_sock, std::unique_ptr<IceS
 
     rtp_sock_->setOnRecv([this](uint8_t* buf, size_t len) {
         std::lock_guard<std::mutex> l(dataBuffMutex_);
-        rtpDataBuff_.emplace_back(buf, buf + len);
+        if (jitterBuffer_)
+            jitterBuffer_->push(buf, len);
+        else
+            rtpDataBuff_.emplace_back(buf, buf + len);
         cv_.notify_one();
         return len;
     });
@@ -215,6 +219,28 @@ SocketPair::~SocketPair()
     JAMI_DBG("[%p] Instance destroyed", this);
 }
 
+bool
+SocketPair::enableJitterBuffer(unsigned clockRate)
+{
+    if (not rtp_sock_ or clockRate == 0)
+        return false;
+    std::lock_guard<std::mutex> l(dataBuffMutex_);
+    if (jitterBuffer_ and jitterBuffer_->clockRate() == clockRate)
+        return true;
+    jitterBuffer_ = std::make_unique<JitterBuffer>(clockRate);
+    for (const auto& pkt : rtpDataBuff_)
+        jitterBuffer_->push(pkt.data(), pkt.size());
+    rtpDataBuff_.clear();
+    return true;
+}
+
+bool
+SocketPair::hasJitterBuffer()
+{
+    std::lock_guard<std::mutex> l(dataBuffMutex_);
+    return static_cast<bool>(jitterBuffer_);
+}
+
 bool
 SocketPair::waitForRTCP(std::chrono::seconds interval)
 {
@@ -422,10 +448,23 @@ SocketPair::waitForData()
     // work with IceSocket
     {
         std::unique_lock<std::mutex> lk(dataBuffMutex_);
-        cv_.wait(lk, [this] {
-            return interrupted_ or not rtpDataBuff_.empty() or not rtcpDataBuff_.empty()
-                   or not readBlockingMode_;
-        });
+        if (jitterBuffer_) {
+            // Wait for the playout time of the next packet, new packets may change it
+            while (not interrupted_ and rtcpDataBuff_.empty() and readBlockingMode_) {
+                auto next = jitterBuffer_->nextPlayout();
+                if (next <= std::chrono::steady_clock::now())
+                    break;
+                if (next == std::chrono::steady_clock::time_point::max())
+                    cv_.wait(lk);
+                else
+                    cv_.wait_until(lk, next);
+            }
+        } else {
+            cv_.wait(lk, [this] {
+                return interrupted_ or not rtpDataBuff_.empty() or not rtcpDataBuff_.empty()
+                       or not readBlockingMode_;
+            });
+        }
     }
 
     if (interrupted_) {
@@ -453,6 +492,14 @@ SocketPair::readRtpData(void* buf, int buf_size)
 
     // handle ICE
     std::unique_lock<std::mutex> lk(dataBuffMutex_);
+    if (jitterBuffer_) {
+        if (not jitterBuffer_->pop(rtpPacket_))
+            return 0;
+        lk.unlock();
+        int len = std::min(static_cast<int>(rtpPacket_.size()), buf_size);
+        std::copy_n(rtpPacket_.begin(), len, static_cast<char*>(buf));
+        return len;
+    }
     if (not rtpDataBuff_.empty()) {
         auto pkt = std::move(rtpDataBuff_.front());
         rtpDataBuff_.pop_front();
@@ -51,6 +51,7 @@ namespace jami {
 
 class IceSocket;
 class SRTPProtoContext;
+class JitterBuffer;
 
 typedef struct
 {
@@ -145,6 +146,15 @@ public:
     // to read (if the peer mutes/stops the media/RTP stream).
     void setReadBlockingMode(bool blocking);
 
+    /**
+     * Reorder and pace received RTP packets with an adaptive jitter buffer.
+     * Only supported with ICE sockets.
+     * @param clockRate  RTP clock rate of the received stream
+     * @return false if not supported
+     */
+    bool enableJitterBuffer(unsigned clockRate);
+    bool hasJitterBuffer();
+
     MediaIOHandle* createIOContext(const uint16_t mtu);
 
     void openSockets(const char* uri, int localPort);
@@ -206,6 +216,9 @@ private:
     std::condition_variable cv_;
     std::list<std::vector<uint8_t>> rtpDataBuff_;
     std::list<std::vector<uint8_t>> rtcpDataBuff_;
+    std::unique_ptr<JitterBuffer> jitterBuffer_;
+    // Packet released by the jitter buffer, read thread only
+    std::vector<uint8_t> rtpPacket_;
 
     std::unique_ptr<IceSocket> rtp_sock_;
     std::unique_ptr<IceSocket> rtcp_sock_;
@@ -0,0 +1,166 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "frame_cache.h"
+#include "filter_transpose.h"
+#include "logger.h"
+
+#ifdef RING_ACCEL
+#include "accel.h"
+#endif
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include <algorithm>
+
+namespace jami {
+namespace video {
+
+// Bound the number of frames tracked if consumers keep frames alive longer than usual
+static constexpr std::size_t MAX_ENTRIES = 64;
+
+const constexpr char FILTER_INPUT_NAME[] = "in";
+
+FrameCache&
+FrameCache::instance()
+{
+    // Intentionally leaked: frames may be released by threads outliving static destruction
+    static FrameCache* cache = new FrameCache;
+    return *cache;
+}
+
+FrameCache::FrameCache()
+    : hits_(metrics::counter("video.frame_cache.hits"))
+    , misses_(metrics::counter("video.frame_cache.misses"))
+{}
+
+std::shared_ptr<FrameCache::Entry>
+FrameCache::getEntry(const std::shared_ptr<MediaFrame>& source)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    // Entries keep a weak reference to their source, so the control block of an
+    // expired source can't be reused by a new frame while the entry exists
+    entries_.erase(std::remove_if(entries_.begin(),
+                                  entries_.end(),
+                                  [](const auto& e) { return e->source.expired(); }),
+                   entries_.end());
+    for (const auto& entry : entries_)
+        if (not entry->source.owner_before(source) and not source.owner_before(entry->source))
+            return entry;
+    if (entries_.size() >= MAX_ENTRIES)
+        entries_.erase(entries_.begin());
+    auto entry = std::make_shared<Entry>();
+    entry->source = source;
+    entries_.emplace_back(entry);
+    return entry;
+}
+
+std::shared_ptr<VideoFrame>
+FrameCache::get(const std::shared_ptr<MediaFrame>& source,
+                const std::string& key,
+                const Compute& compute)
+{
+    auto entry = getEntry(source);
+    // Held while computing, so concurrent consumers wait for the result
+    std::lock_guard<std::mutex> lk(entry->mutex);
+    auto it = entry->variants.find(key);
+    if (it != entry->variants.end()) {
+        hits_.inc();
+        return it->second;
+    }
+    misses_.inc();
+    auto variant = compute();
+    if (variant)
+        entry->variants.emplace(key, variant);
+    return variant;
+}
+
+std::shared_ptr<VideoFrame>
+softwareFrame(const std::shared_ptr<MediaFrame>& frame, AVPixelFormat format)
+{
+    auto videoFrame = std::static_pointer_cast<VideoFrame>(frame);
+#ifdef RING_ACCEL
+    auto desc = av_pix_fmt_desc_get((AVPixelFormat) videoFrame->format());
+    if (desc && (desc->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+        std::string error;
+        auto ret = FrameCache::instance().get(frame,
+                                              "sw:" + std::to_string(format),
+                                              [&]() -> std::shared_ptr<VideoFrame> {
+                                                  try {
+                                                      return HardwareAccel::transferToMainMemory(
+                                                          *videoFrame, format);
+                                                  } catch (const std::runtime_error& e) {
+                                                      error = e.what();
+                                                      return {};
+                                                  }
+                                              });
+        if (not ret)
+            throw std::runtime_error(error.empty() ? "Cannot transfer the frame from GPU" : error);
+        return ret;
+    }
+#else
+    (void) format;
+#endif
+    return videoFrame;
+}
+
+FrameTransposer::FrameTransposer(bool rescale)
+    : rescale_(rescale)
+{}
+
+std::shared_ptr<VideoFrame>
+FrameTransposer::transpose(const std::shared_ptr<VideoFrame>& frame)
+{
+    int angle = frame->getOrientation();
+    if (angle == 0)
+        return frame;
+    auto rotated = FrameCache::instance().get(
+        frame,
+        "transpose:" + std::to_string(angle) + (rescale_ ? ":rescale" : ""),
+        [&]() -> std::shared_ptr<VideoFrame> {
+            if (angle != rotation_ or frame->width() != width_ or frame->height() != height_
+                or frame->format() != format_) {
+                filter_ = getTransposeFilter(angle,
+                                             FILTER_INPUT_NAME,
+                                             frame->width(),
+                                             frame->height(),
+                                             frame->format(),
+                                             rescale_);
+                rotation_ = angle;
+                width_ = frame->width();
+                height_ = frame->height();
+                format_ = frame->format();
+            }
+            if (not filter_)
+                return {};
+            filter_->feedInput(frame->pointer(), FILTER_INPUT_NAME);
+            return std::static_pointer_cast<VideoFrame>(
+                std::shared_ptr<MediaFrame>(filter_->readOutput()));
+        });
+    return rotated ? rotated : frame;
+}
+
+} // namespace video
+} // namespace jami
@@ -0,0 +1,123 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#pragma once
+
+#include "../media_buffer.h"
+#include "../media_filter.h"
+#include "metrics.h"
+#include "noncopyable.h"
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace jami {
+namespace video {
+
+/**
+ * Variants (system memory copy, rotated frame...) of published frames.
+ *
+ * A frame published by a stream is usually consumed by several observers
+ * (conference mixer, client sink, recorder). Each variant is computed once,
+ * by the first consumer needing it, and shared by reference with the others.
+ * Variants must be considered read-only. They are released with their
+ * source frame.
+ */
+class FrameCache
+{
+public:
+    using Compute = std::function<std::shared_ptr<VideoFrame>()>;
+
+    static FrameCache& instance();
+
+    /**
+     * @param source    Published frame
+     * @param key       Identifies the variant
+     * @param compute   Called to build the variant if not already cached
+     * @return the variant, nullptr if compute failed
+     */
+    std::shared_ptr<VideoFrame> get(const std::shared_ptr<MediaFrame>& source,
+                                    const std::string& key,
+                                    const Compute& compute);
+
+private:
+    FrameCache();
+    NON_COPYABLE(FrameCache);
+
+    struct Entry
+    {
+        std::weak_ptr<MediaFrame> source;
+        std::mutex mutex;
+        std::map<std::string, std::shared_ptr<VideoFrame>> variants;
+    };
+
+    std::shared_ptr<Entry> getEntry(const std::shared_ptr<MediaFrame>& source);
+
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<Entry>> entries_;
+    metrics::Counter& hits_;
+    metrics::Counter& misses_;
+};
+
+/**
+ * Frame in system memory. Hardware frames are downloaded once per
+ * frame and format, other frames are returned as is.
+ * @throw std::runtime_error if the transfer fails
+ */
+std::shared_ptr<VideoFrame> softwareFrame(const std::shared_ptr<MediaFrame>& frame,
+                                          AVPixelFormat format = AV_PIX_FMT_NV12);
+
+/**
+ * Rotate frames according to their orientation.
+ * Each consumer owns its transposer (the filter is stateful), but the filter
+ * only runs if no other consumer already rotated the same frame.
+ */
+class FrameTransposer
+{
+public:
+    /**
+     * @param rescale   Scale and pad rotated frames to the original size
+     */
+    FrameTransposer(bool rescale = false);
+
+    /**
+     * @return the upright frame, or frame itself if not rotated or if rotation failed
+     */
+    std::shared_ptr<VideoFrame> transpose(const std::shared_ptr<VideoFrame>& frame);
+
+private:
+    NON_COPYABLE(FrameTransposer);
+
+    const bool rescale_;
+    int rotation_ {0};
+    int width_ {0};
+    int height_ {0};
+    int format_ {-1};
+    std::unique_ptr<MediaFilter> filter_;
+};
+
+} // namespace video
+} // namespace jami
@@ -38,11 +38,6 @@
 #include "libav_utils.h"
 #include "video_scaler.h"
 #include "media_filter.h"
-#include "filter_transpose.h"
-
-#ifdef RING_ACCEL
-#include "accel.h"
-#endif
 
 #ifndef _WIN32
 #include <sys/mman.h>
@@ -60,8 +55,6 @@
 namespace jami {
 namespace video {
 
-const constexpr char FILTER_INPUT_NAME[] = "in";
-
 #ifdef ENABLE_SHM
 // RAII class helper on sem_wait/sem_post sempahore operations
 class SemGuardLock
@@ -368,47 +361,29 @@ SinkClient::sendFrameTransformed(AVFrame* frame)
 }
 
 std::shared_ptr<VideoFrame>
-SinkClient::applyTransform(VideoFrame& frame_p)
+SinkClient::applyTransform(const std::shared_ptr<MediaFrame>& frame_p)
 {
-    std::shared_ptr<VideoFrame> frame = std::make_shared<VideoFrame>();
-#ifdef RING_ACCEL
-    auto desc = av_pix_fmt_desc_get((AVPixelFormat) frame_p.format());
-    if (desc && (desc->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
-        try {
-            frame = HardwareAccel::transferToMainMemory(frame_p, AV_PIX_FMT_NV12);
-        } catch (const std::runtime_error& e) {
-            JAMI_ERR("[Sink:%p] Transfert to hardware acceleration memory failed: %s",
-                     this,
-                     e.what());
-            return {};
-        }
-    } else
-#endif
-        frame->copyFrom(frame_p);
-
-    int angle = frame->getOrientation();
-    if (angle != rotation_) {
-        filter_ = getTransposeFilter(angle,
-                                     FILTER_INPUT_NAME,
-                                     frame->width(),
-                                     frame->height(),
-                                     frame->format(),
-                                     false);
-        rotation_ = angle;
-    }
-    if (filter_) {
-        filter_->feedInput(frame->pointer(), FILTER_INPUT_NAME);
-        frame = std::static_pointer_cast<VideoFrame>(
-            std::shared_ptr<MediaFrame>(filter_->readOutput()));
+    std::shared_ptr<VideoFrame> frame;
+    try {
+        frame = transposer_.transpose(softwareFrame(frame_p));
+    } catch (const std::runtime_error& e) {
+        JAMI_ERR("[Sink:%p] Transfert to hardware acceleration memory failed: %s",
+                 this,
+                 e.what());
+        return {};
     }
+
+    // The transformed frame may be shared, give observers their own reference
+    auto ret = std::make_shared<VideoFrame>();
+    ret->copyFrom(*frame);
     if (crop_.w || crop_.h) {
-        frame->pointer()->crop_top = crop_.y;
-        frame->pointer()->crop_bottom = (size_t) frame->height() - crop_.y - crop_.h;
-        frame->pointer()->crop_left = crop_.x;
-        frame->pointer()->crop_right = (size_t) frame->width() - crop_.x - crop_.w;
-        av_frame_apply_cropping(frame->pointer(), AV_FRAME_CROP_UNALIGNED);
+        ret->pointer()->crop_top = crop_.y;
+        ret->pointer()->crop_bottom = (size_t) ret->height() - crop_.y - crop_.h;
+        ret->pointer()->crop_left = crop_.x;
+        ret->pointer()->crop_right = (size_t) ret->width() - crop_.x - crop_.w;
+        av_frame_apply_cropping(ret->pointer(), AV_FRAME_CROP_UNALIGNED);
     }
-    return frame;
+    return ret;
 }
 
 void
@@ -443,7 +418,7 @@ SinkClient::update(Observable<std::shared_ptr<MediaFrame>>* /*obs*/,
 #endif
 
     if (doTransfer) {
-        auto frame = applyTransform(*std::static_pointer_cast<VideoFrame>(frame_p));
+        auto frame = applyTransform(frame_p);
         if (not frame)
             return;
 
@@ -27,6 +27,7 @@
 #endif
 
 #include "video_base.h"
+#include "frame_cache.h"
 #include <videomanager_interface.h>
 
 #include <string>
@@ -100,10 +101,9 @@ private:
     Rect crop_ {};
 
     bool started_ {false}; // used to arbitrate client's stop signal.
-    int rotation_ {0};
     libjami::SinkTarget target_;
     std::unique_ptr<VideoScaler> scaler_;
-    std::unique_ptr<MediaFilter> filter_;
+    FrameTransposer transposer_;
     std::mutex mtx_;
 
     void sendFrameDirect(const std::shared_ptr<jami::MediaFrame>&);
@@ -114,8 +114,9 @@ private:
      * - Transfer the frame from gpu to main memory, if needed.
      * - Rotate the frame as needed.
      * - Apply cropping as needed
+     * Transfer and rotation are shared with other consumers of the frame.
      */
-    std::shared_ptr<VideoFrame> applyTransform(VideoFrame& frame);
+    std::shared_ptr<VideoFrame> applyTransform(const std::shared_ptr<MediaFrame>& frame);
 
 #ifdef DEBUG_FPS
     unsigned frameCount_;
@@ -21,6 +21,7 @@
 
 #include "libav_deps.h" // MUST BE INCLUDED FIRST
 #include "video_base.h"
+#include "video_renditions.h"
 #include "media_buffer.h"
 #include "string_utils.h"
 #include "logger.h"
@@ -32,6 +33,10 @@ namespace video {
 
 /*=== VideoGenerator =========================================================*/
 
+VideoGenerator::VideoGenerator()
+    : renditions_(std::make_shared<VideoRenditions>())
+{}
+
 VideoFrame&
 VideoGenerator::getNewFrame()
 {
@@ -61,6 +61,8 @@ using VideoFrame = libjami::VideoFrame;
 namespace jami {
 namespace video {
 
+class VideoRenditions;
+
 struct VideoFrameActiveWriter : Observable<std::shared_ptr<MediaFrame>>
 {};
 struct VideoFramePassiveReader : Observer<std::shared_ptr<MediaFrame>>
@@ -71,7 +73,7 @@ struct VideoFramePassiveReader : Observer<std::shared_ptr<MediaFrame>>
 class VideoGenerator : public VideoFrameActiveWriter
 {
 public:
-    VideoGenerator() {}
+    VideoGenerator();
 
     virtual int getWidth() const = 0;
     virtual int getHeight() const = 0;
@@ -79,6 +81,11 @@ public:
 
     std::shared_ptr<VideoFrame> obtainLastFrame();
 
+    /**
+     * Scaled copies of the published frames, shared by the consumers of this generator
+     */
+    const std::shared_ptr<VideoRenditions>& renditions() const { return renditions_; }
+
 public:
     // getNewFrame and publishFrame must be called by the same thread only
     VideoFrame& getNewFrame();
@@ -90,6 +97,7 @@ private:
     std::shared_ptr<VideoFrame> writableFrame_ = nullptr;
     std::shared_ptr<VideoFrame> lastFrame_ = nullptr;
     std::mutex mutex_ {}; // lock writableFrame_/lastFrame_ access
+    const std::shared_ptr<VideoRenditions> renditions_;
 };
 
 struct VideoSettings
@@ -0,0 +1,290 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#include "libav_deps.h" // MUST BE INCLUDED FIRST
+
+#include "video_compositor.h"
+#include "media_stream.h"
+#include "metrics.h"
+#include "logger.h"
+
+#include <algorithm>
+
+#ifdef RING_ACCEL
+extern "C" {
+#include <libavutil/hwcontext.h>
+}
+#endif
+
+namespace jami {
+namespace video {
+
+#ifdef RING_ACCEL
+/** Inputs of a composition share a timestamp, one unit per composed frame */
+static const rational<int> COMPOSITOR_TIME_BASE {1, 30};
+static const rational<int> COMPOSITOR_FRAME_RATE {30, 1};
+static constexpr const char BACKGROUND_INPUT[] = "bg";
+
+static std::string
+inputName(std::size_t index)
+{
+    return fmt::format("in{}", index);
+}
+
+/**
+ * Input scaled into its cell keeping its aspect ratio and centered, as done by
+ * VideoScaler::scale_and_pad in software. NV12 surfaces have even sizes.
+ */
+static VideoCompositor::Input
+fitInCell(const VideoCompositor::Input& input)
+{
+    auto fitted = input;
+    auto frame = input.frame->pointer();
+    const float cellRatio = (float) input.w / input.h;
+    const float inputRatio = (float) frame->width / frame->height;
+    if (cellRatio > inputRatio)
+        fitted.w = input.h * inputRatio;
+    else
+        fitted.h = input.w / inputRatio;
+    fitted.w = std::max(2, fitted.w & ~1);
+    fitted.h = std::max(2, fitted.h & ~1);
+    fitted.x += (input.w - fitted.w) / 2;
+    fitted.y += (input.h - fitted.h) / 2;
+    return fitted;
+}
+#endif
+
+VideoCompositor::~VideoCompositor() = default;
+
+bool
+VideoCompositor::hardwareSupported()
+{
+#ifdef RING_ACCEL
+    static const bool supported = avfilter_get_by_name("scale_vaapi")
+                                  and avfilter_get_by_name("overlay_vaapi");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+bool
+VideoCompositor::canComposeInHardware(const std::vector<Input>& inputs) const
+{
+#ifdef RING_ACCEL
+    if (hardwareFailed_ or inputs.empty() or not hardwareSupported())
+        return false;
+    const uint8_t* device = nullptr;
+    for (const auto& input : inputs) {
+        auto frame = input.frame->pointer();
+        // Rotation is done by the software path
+        if (frame->format != AV_PIX_FMT_VAAPI or not frame->hw_frames_ctx
+            or input.frame->getOrientation() != 0 or input.w <= 0 or input.h <= 0)
+            return false;
+        auto framesCtx = reinterpret_cast<AVHWFramesContext*>(frame->hw_frames_ctx->data);
+        if (device and framesCtx->device_ref->data != device)
+            return false;
+        device = framesCtx->device_ref->data;
+    }
+    return true;
+#else
+    (void) inputs;
+    return false;
+#endif
+}
+
+std::shared_ptr<VideoFrame>
+VideoCompositor::composeInHardware(const std::vector<Input>& inputs, int width, int height)
+{
+#ifdef RING_ACCEL
+    if (not canComposeInHardware(inputs))
+        return {};
+    auto device = reinterpret_cast<AVHWFramesContext*>(
+                      inputs.front().frame->pointer()->hw_frames_ctx->data)
+                      ->device_ref;
+    if (not setupBackground(device, width, height) or not setupFilter(inputs))
+        return {};
+
+    static auto& composed = metrics::counter("video.compositor.hardware_frames");
+    auto pts = pts_++;
+    // Inputs are shared with other consumers: timestamps are set on new references
+    auto feed = [&](const VideoFrame& frame, const std::string& name) {
+        VideoFrame ref;
+        ref.copyFrom(frame);
+        ref.pointer()->pts = pts;
+        return filter_->feedInput(ref.pointer(), name);
+    };
+    int ret = feed(*background_, BACKGROUND_INPUT);
+    for (std::size_t i = 0; ret >= 0 and i < inputs.size(); ++i)
+        ret = feed(*inputs[i].frame, inputName(i));
+    if (ret < 0) {
+        disableHardware("Unable to feed the compositing filters", ret);
+        return {};
+    }
+
+    // Only keep the latest composition, the filters may also hold the first one
+    std::unique_ptr<MediaFrame> output;
+    while (auto frame = filter_->readOutput())
+        output = std::move(frame);
+    if (not output)
+        return {};
+    composed.inc();
+    return std::static_pointer_cast<VideoFrame>(std::shared_ptr<MediaFrame>(std::move(output)));
+#else
+    (void) inputs;
+    (void) width;
+    (void) height;
+    return {};
+#endif
+}
+
+void
+VideoCompositor::composeInSoftware(const std::vector<Input>& inputs, VideoFrame& output)
+{
+    static auto& composed = metrics::counter("video.compositor.software_frames");
+    for (const auto& input : inputs)
+        scaler_.scale_and_pad(*input.frame, output, input.x, input.y, input.w, input.h, true);
+    composed.inc();
+}
+
+#ifdef RING_ACCEL
+
+bool
+VideoCompositor::setupBackground(AVBufferRef* device, int width, int height)
+{
+    if (background_) {
+        auto framesCtx = reinterpret_cast<AVHWFramesContext*>(backgroundFramesCtx_->data);
+        if (framesCtx->device_ref->data == device->data and framesCtx->width == width
+            and framesCtx->height == height)
+            return true;
+    }
+    background_.reset();
+    backgroundFramesCtx_.reset();
+    // The filters are linked to the background frames context
+    filter_.reset();
+    filterKey_.clear();
+
+    std::shared_ptr<AVBufferRef> framesRef {av_hwframe_ctx_alloc(device),
+                                            [](AVBufferRef* r) { av_buffer_unref(&r); }};
+    if (not framesRef) {
+        disableHardware("Unable to allocate the background frames", AVERROR(ENOMEM));
+        return false;
+    }
+    auto framesCtx = reinterpret_cast<AVHWFramesContext*>(framesRef->data);
+    framesCtx->format = AV_PIX_FMT_VAAPI;
+    framesCtx->sw_format = AV_PIX_FMT_NV12;
+    framesCtx->width = width;
+    framesCtx->height = height;
+    framesCtx->initial_pool_size = 1;
+    int ret = av_hwframe_ctx_init(framesRef.get());
+    if (ret < 0) {
+        disableHardware("Unable to initialize the background frames", ret);
+        return false;
+    }
+
+    // Uploaded once, then reused by every composition
+    VideoFrame black;
+    black.reserve(AV_PIX_FMT_NV12, width, height);
+    libav_utils::fillWithBlack(black.pointer());
+    auto background = std::make_unique<VideoFrame>();
+    if ((ret = av_hwframe_get_buffer(framesRef.get(), background->pointer(), 0)) < 0
+        or (ret = av_hwframe_transfer_data(background->pointer(), black.pointer(), 0)) < 0) {
+        disableHardware("Unable to upload the background", ret);
+        return false;
+    }
+    background_ = std::move(background);
+    backgroundFramesCtx_ = std::move(framesRef);
+    return true;
+}
+
+bool
+VideoCompositor::setupFilter(const std::vector<Input>& inputs)
+{
+    // Each input is scaled to its cell, then overlaid on the previous composition
+    std::vector<MediaStream> streams;
+    streams.reserve(inputs.size() + 1);
+    streams.emplace_back(BACKGROUND_INPUT,
+                         background_->format(),
+                         COMPOSITOR_TIME_BASE,
+                         background_->width(),
+                         background_->height(),
+                         0,
+                         COMPOSITOR_FRAME_RATE);
+    streams.back().setHwFramesCtx(backgroundFramesCtx_.get());
+    std::string desc;
+    std::string previous = BACKGROUND_INPUT;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        const auto& input = inputs[i];
+        auto name = inputName(i);
+        auto frame = input.frame->pointer();
+        streams.emplace_back(name,
+                             frame->format,
+                             COMPOSITOR_TIME_BASE,
+                             frame->width,
+                             frame->height,
+                             0,
+                             COMPOSITOR_FRAME_RATE);
+        streams.back().setHwFramesCtx(frame->hw_frames_ctx);
+        // The aspect ratio is also kept if the input size changes without a new graph
+        auto cell = fitInCell(input);
+        desc += fmt::format("[{}] scale_vaapi=w={}:h={}:force_original_aspect_ratio=decrease:"
+                            "format=nv12 [s{}]; "
+                            "[{}] [s{}] overlay_vaapi=x={}:y={}",
+                            name,
+                            cell.w,
+                            cell.h,
+                            i,
+                            previous,
+                            i,
+                            cell.x,
+                            cell.y);
+        if (i + 1 < inputs.size()) {
+            previous = fmt::format("c{}", i);
+            desc += fmt::format(" [{}]; ", previous);
+        }
+    }
+
+    // Input sizes and frames contexts may change without rebuilding the graph,
+    // MediaFilter reinitializes itself
+    if (filter_ and desc == filterKey_)
+        return true;
+    filter_ = std::make_unique<MediaFilter>();
+    filterKey_.clear();
+    int ret = filter_->initialize(desc, streams);
+    if (ret < 0) {
+        disableHardware("Unable to set up the compositing filters", ret);
+        return false;
+    }
+    filterKey_ = std::move(desc);
+    return true;
+}
+
+void
+VideoCompositor::disableHardware(std::string_view reason, int err)
+{
+    JAMI_WARNING("[compositor] {}, composing in software: {}", reason, libav_utils::getError(err));
+    hardwareFailed_ = true;
+    filter_.reset();
+    filterKey_.clear();
+    background_.reset();
+    backgroundFramesCtx_.reset();
+}
+
+#endif // RING_ACCEL
+
+} // namespace video
+} // namespace jami
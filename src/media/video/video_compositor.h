@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#pragma once
+
+#include "video_base.h"
+#include "video_scaler.h"
+#include "media_filter.h"
+#include "noncopyable.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace jami {
+namespace video {
+
+/**
+ * Composition of conference layouts.
+ *
+ * When all the inputs are upright hardware frames of the same VAAPI device,
+ * they are scaled and overlaid on the GPU with the VAAPI filters, and the output
+ * stays in the GPU memory: a hardware encoder then uses it without any transfer.
+ * Otherwise inputs are composed in system memory with the software scaler.
+ */
+class VideoCompositor
+{
+public:
+    struct Input
+    {
+        std::shared_ptr<VideoFrame> frame;
+        int x {0};
+        int y {0};
+        int w {0};
+        int h {0};
+    };
+
+    VideoCompositor() = default;
+    ~VideoCompositor();
+
+    /**
+     * Whether this build and libavfilter provide the hardware compositing filters
+     */
+    static bool hardwareSupported();
+
+    /**
+     * @return true if inputs can be composed in GPU memory
+     */
+    bool canComposeInHardware(const std::vector<Input>& inputs) const;
+
+    /**
+     * Compose hardware inputs on a black background.
+     * Failing to set up the filters disables hardware compositing for this compositor.
+     * @return a hardware frame of width x height, null on failure
+     */
+    std::shared_ptr<VideoFrame> composeInHardware(const std::vector<Input>& inputs,
+                                                  int width,
+                                                  int height);
+
+    /**
+     * Compose software inputs on output, usually filled with black
+     */
+    void composeInSoftware(const std::vector<Input>& inputs, VideoFrame& output);
+
+private:
+    NON_COPYABLE(VideoCompositor);
+
+#ifdef RING_ACCEL
+    bool setupBackground(AVBufferRef* device, int width, int height);
+    bool setupFilter(const std::vector<Input>& inputs);
+    void disableHardware(std::string_view reason, int err);
+#endif
+
+    VideoScaler scaler_;
+
+#ifdef RING_ACCEL
+    bool hardwareFailed_ {false};
+    int64_t pts_ {0};
+    std::unique_ptr<MediaFilter> filter_;
+    std::string filterKey_;
+    /** Black frame in GPU memory, the bottom of the overlays */
+    std::unique_ptr<VideoFrame> background_;
+    std::shared_ptr<AVBufferRef> backgroundFramesCtx_;
+#endif
+};
+
+} // namespace video
+} // namespace jami
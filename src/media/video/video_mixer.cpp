@@ -28,10 +28,7 @@
 #include "media_filter.h"
 #include "sinkclient.h"
 #include "logger.h"
-#include "filter_transpose.h"
-#ifdef RING_ACCEL
-#include "accel.h"
-#endif
+#include "frame_cache.h"
 #include "connectivity/sip_utils.h"
 
 #include <cmath>
@@ -51,14 +48,14 @@ struct VideoMixer::VideoMixerSource
 {
     Observable<std::shared_ptr<MediaFrame>>* source {nullptr};
     int rotation {0};
-    std::unique_ptr<MediaFilter> rotationFilter {nullptr};
+    FrameTransposer transposer {};
     std::shared_ptr<VideoFrame> render_frame;
-    void atomic_copy(const VideoFrame& other)
+    // Frames are shared with other consumers of the source and never modified.
+    // Hardware frames are kept in GPU memory until rendering needs them in system memory.
+    void atomic_set(std::shared_ptr<VideoFrame> frame)
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        auto newFrame = std::make_shared<VideoFrame>();
-        newFrame->copyFrom(other);
-        render_frame = newFrame;
+        render_frame = std::move(frame);
     }
 
     std::shared_ptr<VideoFrame> getRenderFrame()
@@ -251,20 +248,7 @@ VideoMixer::update(Observable<std::shared_ptr<MediaFrame>>* ob,
 
     for (const auto& x : sources_) {
         if (x->source == ob) {
-#ifdef RING_ACCEL
-            std::shared_ptr<VideoFrame> frame;
-            try {
-                frame = HardwareAccel::transferToMainMemory(*std::static_pointer_cast<VideoFrame>(
-                                                                frame_p),
-                                                            AV_PIX_FMT_NV12);
-                x->atomic_copy(*std::static_pointer_cast<VideoFrame>(frame));
-            } catch (const std::runtime_error& e) {
-                JAMI_ERR("[mixer:%s] Accel failure: %s", id_.c_str(), e.what());
-                return;
-            }
-#else
-            x->atomic_copy(*std::static_pointer_cast<VideoFrame>(frame_p));
-#endif
+            x->atomic_set(std::static_pointer_cast<VideoFrame>(frame_p));
             return;
         }
     }
@@ -283,19 +267,12 @@ VideoMixer::process()
         return;
     }
 
-    VideoFrame& output = getNewFrame();
-    try {
-        output.reserve(format_, width_, height_);
-    } catch (const std::bad_alloc& e) {
-        JAMI_ERR("[mixer:%s] VideoFrame::allocBuffer() failed", id_.c_str());
-        return;
-    }
-
-    libav_utils::fillWithBlack(output.pointer());
-
+    std::shared_ptr<VideoFrame> output;
     {
         std::lock_guard<std::mutex> lk(audioOnlySourcesMtx_);
         std::shared_lock lock(rwMutex_);
+        inputs_.clear();
+        inputSources_.clear();
 
         int i = 0;
         bool activeFound = false;
@@ -368,7 +345,7 @@ VideoMixer::process()
 
                 if (!blackFrame) {
                     if (fooInput)
-                        successfullyRendered |= render_frame(output, fooInput, x);
+                        successfullyRendered |= add_input(fooInput, x);
                     else
                         JAMI_WARN("[mixer:%s] Nothing to render for %p", id_.c_str(), x->source);
                 }
@@ -388,6 +365,11 @@ VideoMixer::process()
 
             ++i;
         }
+
+        output = render_frame();
+        if (!output)
+            return;
+
         if (needsUpdate and successfullyRendered) {
             layoutUpdated_ -= 1;
             if (layoutUpdated_ == 0) {
@@ -408,50 +390,62 @@ VideoMixer::process()
         }
     }
 
-    output.pointer()->pts = av_rescale_q_rnd(av_gettime() - startTime_,
-                                             {1, AV_TIME_BASE},
-                                             {1, MIXER_FRAMERATE},
-                                             static_cast<AVRounding>(AV_ROUND_NEAR_INF
-                                                                     | AV_ROUND_PASS_MINMAX));
-    lastTimestamp_ = output.pointer()->pts;
-    publishFrame();
+    output->pointer()->pts = av_rescale_q_rnd(av_gettime() - startTime_,
+                                              {1, AV_TIME_BASE},
+                                              {1, MIXER_FRAMERATE},
+                                              static_cast<AVRounding>(AV_ROUND_NEAR_INF
+                                                                      | AV_ROUND_PASS_MINMAX));
+    lastTimestamp_ = output->pointer()->pts;
+    publishFrame(std::move(output));
 }
 
 bool
-VideoMixer::render_frame(VideoFrame& output,
-                         const std::shared_ptr<VideoFrame>& input,
-                         std::unique_ptr<VideoMixerSource>& source)
+VideoMixer::add_input(const std::shared_ptr<VideoFrame>& input,
+                      std::unique_ptr<VideoMixerSource>& source)
 {
     if (!width_ or !height_ or !input->pointer() or input->pointer()->format == -1)
         return false;
 
-    int cell_width = source->w;
-    int cell_height = source->h;
-    int xoff = source->x;
-    int yoff = source->y;
-
-    int angle = input->getOrientation();
-    const constexpr char filterIn[] = "mixin";
-    if (angle != source->rotation) {
-        source->rotationFilter = video::getTransposeFilter(angle,
-                                                           filterIn,
-                                                           input->width(),
-                                                           input->height(),
-                                                           input->format(),
-                                                           false);
-        source->rotation = angle;
-    }
-    std::shared_ptr<VideoFrame> frame;
-    if (source->rotationFilter) {
-        source->rotationFilter->feedInput(input->pointer(), filterIn);
-        frame = std::static_pointer_cast<VideoFrame>(
-            std::shared_ptr<MediaFrame>(source->rotationFilter->readOutput()));
-    } else {
-        frame = input;
+    source->rotation = input->getOrientation();
+    inputs_.emplace_back(VideoCompositor::Input {input, source->x, source->y, source->w, source->h});
+    inputSources_.emplace_back(source.get());
+    return true;
+}
+
+std::shared_ptr<VideoFrame>
+VideoMixer::render_frame()
+{
+    auto inputs = std::move(inputs_);
+    const auto sources = std::move(inputSources_);
+
+    // Hardware decoded inputs sharing a device are composed without leaving the GPU
+    if (compositor_.canComposeInHardware(inputs)) {
+        if (auto frame = compositor_.composeInHardware(inputs, width_, height_))
+            return frame;
     }
 
-    scaler_.scale_and_pad(*frame, output, xoff, yoff, cell_width, cell_height, true);
-    return true;
+    auto output = std::make_shared<VideoFrame>();
+    try {
+        output->reserve(format_, width_, height_);
+    } catch (const std::bad_alloc& e) {
+        JAMI_ERR("[mixer:%s] VideoFrame::allocBuffer() failed", id_.c_str());
+        return {};
+    }
+    libav_utils::fillWithBlack(output->pointer());
+
+    std::vector<VideoCompositor::Input> softwareInputs;
+    softwareInputs.reserve(inputs.size());
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        try {
+            // Downloads and rotations are cached, the mixer may render the same input several times
+            inputs[i].frame = sources[i]->transposer.transpose(softwareFrame(inputs[i].frame));
+            softwareInputs.emplace_back(std::move(inputs[i]));
+        } catch (const std::runtime_error& e) {
+            JAMI_ERR("[mixer:%s] Accel failure: %s", id_.c_str(), e.what());
+        }
+    }
+    compositor_.composeInSoftware(softwareInputs, *output);
+    return output;
 }
 
 void
@@ -548,7 +542,7 @@ VideoMixer::setParameters(int width, int height, AVPixelFormat format)
 
     // cleanup the previous frame to have a nice copy in rendering method
     std::shared_ptr<VideoFrame> previous_p(obtainLastFrame());
-    if (previous_p)
+    if (previous_p and not previous_p->pointer()->hw_frames_ctx)
         libav_utils::fillWithBlack(previous_p->pointer());
 
     startSink();
@@ -23,7 +23,7 @@
 
 #include "noncopyable.h"
 #include "video_base.h"
-#include "video_scaler.h"
+#include "video_compositor.h"
 #include "threadloop.h"
 #include "media_stream.h"
 
@@ -156,9 +156,13 @@ private:
     NON_COPYABLE(VideoMixer);
     struct VideoMixerSource;
 
-    bool render_frame(VideoFrame& output,
-                      const std::shared_ptr<VideoFrame>& input,
-                      std::unique_ptr<VideoMixerSource>& source);
+    bool add_input(const std::shared_ptr<VideoFrame>& input,
+                   std::unique_ptr<VideoMixerSource>& source);
+    /**
+     * Compose the inputs added since the last call
+     * @return the output frame, null on failure
+     */
+    std::shared_ptr<VideoFrame> render_frame();
 
     void calc_position(std::unique_ptr<VideoMixerSource>& source,
                        const std::shared_ptr<VideoFrame>& input,
@@ -182,7 +186,10 @@ private:
     std::vector<std::shared_ptr<VideoFrameActiveWriter>> localInputs_ {};
     void stopInput(const std::shared_ptr<VideoFrameActiveWriter>& input);
 
-    VideoScaler scaler_;
+    VideoCompositor compositor_;
+    // Inputs of the frame being rendered, and their sources
+    std::vector<VideoCompositor::Input> inputs_;
+    std::vector<VideoMixerSource*> inputSources_;
 
     ThreadLoop loop_; // as to be last member
 
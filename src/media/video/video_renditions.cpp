@@ -0,0 +1,115 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#include "video_renditions.h"
+#include "libav_utils.h"
+#include "logger.h"
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#include <algorithm>
+
+namespace jami {
+namespace video {
+
+bool
+VideoRenditions::subscribe(const Format& format)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = std::find_if(renditions_.begin(), renditions_.end(), [&](const auto& r) {
+        return r->format == format;
+    });
+    if (it == renditions_.end()) {
+        if (renditions_.size() >= MAX_RENDITIONS)
+            return false;
+        JAMI_DEBUG("Adding {}x{} rendition", format.width, format.height);
+        it = renditions_.emplace(renditions_.end(), std::make_shared<Rendition>());
+        (*it)->format = format;
+    }
+    ++(*it)->refs;
+    return true;
+}
+
+void
+VideoRenditions::unsubscribe(const Format& format)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = std::find_if(renditions_.begin(), renditions_.end(), [&](const auto& r) {
+        return r->format == format;
+    });
+    if (it != renditions_.end() and --(*it)->refs == 0)
+        renditions_.erase(it);
+}
+
+void
+VideoRenditions::scale(const VideoFrame& source, Rendition& rendition)
+{
+    auto frame = std::make_shared<VideoFrame>();
+    frame->reserve(rendition.format.format, rendition.format.width, rendition.format.height);
+    libav_utils::fillWithBlack(frame->pointer());
+    rendition.scaler.scale_with_aspect(source, *frame);
+    rendition.frame = std::move(frame);
+}
+
+std::shared_ptr<VideoFrame>
+VideoRenditions::get(const std::shared_ptr<VideoFrame>& source, const Format& format)
+{
+    if (not source or source->packet())
+        return {};
+    auto desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(source->format()));
+    if (desc and (desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+        // Hardware frames are handled by each encoder
+        return {};
+
+    std::shared_ptr<Rendition> rendition;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        auto it = std::find_if(renditions_.begin(), renditions_.end(), [&](const auto& r) {
+            return r->format == format;
+        });
+        if (it == renditions_.end())
+            return {};
+        rendition = *it;
+    }
+
+    // Other consumers of this format wait for the first one, the other formats don't
+    std::lock_guard<std::mutex> lk(rendition->mutex);
+    if (rendition->source.lock() != source) {
+        try {
+            scale(*source, *rendition);
+            rendition->source = source;
+        } catch (const std::exception& e) {
+            // Consumers of a failed rendition scale on their own
+            JAMI_WARNING("Unable to scale rendition: {}", e.what());
+            rendition->source.reset();
+            rendition->frame.reset();
+        }
+    }
+    return rendition->frame;
+}
+
+std::size_t
+VideoRenditions::size() const
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    return renditions_.size();
+}
+
+} // namespace video
+} // namespace jami
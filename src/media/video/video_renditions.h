@@ -0,0 +1,100 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#pragma once
+
+#include "video_base.h"
+#include "video_scaler.h"
+#include "noncopyable.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace jami {
+namespace video {
+
+/**
+ * Scaled copies of the frames published by a video source.
+ *
+ * Consumers subscribe to the sizes and formats they need. The first consumer to
+ * ask for a frame in a format scales it, on its own thread, and every other
+ * consumer of that format shares the same copy instead of scaling on its own.
+ * Renditions are keyed on the frame consumers receive, after plugins processed
+ * it. Copies are letterboxed like the encoder does, to keep the source aspect ratio.
+ */
+class VideoRenditions
+{
+public:
+    /** Formats beyond this count are not computed, their consumers scale on their own */
+    static constexpr std::size_t MAX_RENDITIONS {4};
+
+    struct Format
+    {
+        int width {0};
+        int height {0};
+        AVPixelFormat format {AV_PIX_FMT_NONE};
+
+        bool operator==(const Format& o) const
+        {
+            return width == o.width and height == o.height and format == o.format;
+        }
+        bool operator!=(const Format& o) const { return not(*this == o); }
+    };
+
+    VideoRenditions() = default;
+
+    /**
+     * Reference counted: each subscribe must be matched by an unsubscribe.
+     * @return false if too many formats are already subscribed
+     */
+    bool subscribe(const Format& format);
+    void unsubscribe(const Format& format);
+
+    /**
+     * @return the rendition of source in format, scaled on first request,
+     * null if format is not subscribed or source is a hardware frame
+     */
+    std::shared_ptr<VideoFrame> get(const std::shared_ptr<VideoFrame>& source,
+                                    const Format& format);
+
+    std::size_t size() const;
+
+private:
+    NON_COPYABLE(VideoRenditions);
+
+    struct Rendition
+    {
+        Format format;
+        unsigned refs {0};
+        /** Lock scaler, source and frame: held while scaling */
+        std::mutex mutex;
+        VideoScaler scaler;
+        /** Last frame scaled, and its copy */
+        std::weak_ptr<VideoFrame> source;
+        std::shared_ptr<VideoFrame> frame;
+    };
+
+    static void scale(const VideoFrame& source, Rendition& rendition);
+
+    /** Lock renditions_ only, not the renditions */
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<Rendition>> renditions_;
+};
+
+} // namespace video
+} // namespace jami
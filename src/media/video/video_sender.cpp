@@ -93,9 +93,15 @@ VideoSender::encodeAndSendVideo(const std::shared_ptr<VideoFrame>& input_frame)
 }
 
 void
-VideoSender::update(Observable<std::shared_ptr<MediaFrame>>* /*obs*/,
+VideoSender::update(Observable<std::shared_ptr<MediaFrame>>* obs,
                     const std::shared_ptr<MediaFrame>& frame_p)
 {
+    // Follow the source, that may be the local input or the conference mixer
+    if (obs != source_) {
+        source_ = obs;
+        auto generator = dynamic_cast<VideoGenerator*>(obs);
+        videoEncoder_->setRenditions(generator ? generator->renditions() : nullptr);
+    }
     encodeAndSendVideo(std::dynamic_pointer_cast<VideoFrame>(frame_p));
 }
 
@@ -82,6 +82,7 @@ private:
 
     int rotation_ = -1;
     std::function<void(int)> changeOrientationCallback_;
+    Observable<std::shared_ptr<MediaFrame>>* source_ {nullptr};
 };
 } // namespace video
 } // namespace jami
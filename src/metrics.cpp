@@ -0,0 +1,210 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#include "metrics.h"
+
+#include <algorithm>
+
+namespace jami {
+namespace metrics {
+
+static std::atomic_uint nextShard {0};
+
+unsigned
+shardIndex()
+{
+    thread_local const unsigned idx = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return idx;
+}
+
+static inline unsigned
+msb(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#else
+    unsigned r = 0;
+    while (v >>= 1)
+        r++;
+    return r;
+#endif
+}
+
+template<typename T>
+static inline void
+atomicMin(std::atomic<T>& a, T v)
+{
+    auto cur = a.load(std::memory_order_relaxed);
+    while (v < cur and not a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+
+template<typename T>
+static inline void
+atomicMax(std::atomic<T>& a, T v)
+{
+    auto cur = a.load(std::memory_order_relaxed);
+    while (v > cur and not a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+}
+
+uint64_t
+Counter::value() const
+{
+    uint64_t total = 0;
+    for (const auto& s : shards_)
+        total += s.v.load(std::memory_order_relaxed);
+    return total;
+}
+
+unsigned
+Histogram::bucketIndex(uint64_t value)
+{
+    if (value < SUB_COUNT)
+        return static_cast<unsigned>(value);
+    auto e = msb(value);
+    if (e > MAX_EXP)
+        return BUCKETS - 1;
+    auto sub = static_cast<unsigned>((value >> (e - SUB_BITS)) & (SUB_COUNT - 1));
+    return (e - SUB_BITS + 1) * SUB_COUNT + sub;
+}
+
+uint64_t
+Histogram::bucketLowerBound(unsigned index)
+{
+    if (index < SUB_COUNT)
+        return index;
+    unsigned e = index / SUB_COUNT + SUB_BITS - 1;
+    uint64_t sub = index % SUB_COUNT;
+    return (SUB_COUNT + sub) << (e - SUB_BITS);
+}
+
+uint64_t
+Histogram::bucketUpperBound(unsigned index)
+{
+    if (index < SUB_COUNT)
+        return index;
+    unsigned e = index / SUB_COUNT + SUB_BITS - 1;
+    return bucketLowerBound(index) + (uint64_t(1) << (e - SUB_BITS)) - 1;
+}
+
+void
+Histogram::record(uint64_t value)
+{
+    auto& s = shards_[shardIndex()];
+    s.buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    s.sum.fetch_add(value, std::memory_order_relaxed);
+    atomicMin(s.min, value);
+    atomicMax(s.max, value);
+}
+
+Histogram::Snapshot
+Histogram::snapshot() const
+{
+    Snapshot snap;
+    uint64_t min = UINT64_MAX;
+    for (const auto& s : shards_) {
+        for (unsigned i = 0; i < BUCKETS; i++)
+            snap.buckets[i] += s.buckets[i].load(std::memory_order_relaxed);
+        snap.count += s.count.load(std::memory_order_relaxed);
+        snap.sum += s.sum.load(std::memory_order_relaxed);
+        min = std::min(min, s.min.load(std::memory_order_relaxed));
+        snap.max = std::max(snap.max, s.max.load(std::memory_order_relaxed));
+    }
+    snap.min = snap.count ? min : 0;
+    return snap;
+}
+
+uint64_t
+Histogram::Snapshot::percentile(double q) const
+{
+    if (count == 0)
+        return 0;
+    q = std::clamp(q, 0., 1.);
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * count + 0.5));
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return std::clamp(bucketUpperBound(i), min, max);
+    }
+    return max;
+}
+
+Registry&
+Registry::instance()
+{
+    // Intentionally leaked: metrics may be updated by threads that outlive static destruction
+    static Registry* registry = new Registry;
+    return *registry;
+}
+
+template<typename T>
+static T&
+getOrCreate(std::map<std::string, std::unique_ptr<T>>& map, const std::string& name)
+{
+    auto& m = map[name];
+    if (not m)
+        m = std::make_unique<T>();
+    return *m;
+}
+
+Counter&
+Registry::counter(const std::string& name)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    return getOrCreate(counters_, name);
+}
+
+Gauge&
+Registry::gauge(const std::string& name)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    return getOrCreate(gauges_, name);
+}
+
+Histogram&
+Registry::histogram(const std::string& name)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    return getOrCreate(histograms_, name);
+}
+
+std::map<std::string, std::string>
+Registry::snapshot() const
+{
+    std::map<std::string, std::string> ret;
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (const auto& [name, c] : counters_)
+        ret.emplace(name, std::to_string(c->value()));
+    for (const auto& [name, g] : gauges_)
+        ret.emplace(name, std::to_string(g->value()));
+    for (const auto& [name, h] : histograms_) {
+        auto snap = h->snapshot();
+        ret.emplace(name + ".count", std::to_string(snap.count));
+        ret.emplace(name + ".sum", std::to_string(snap.sum));
+        ret.emplace(name + ".min", std::to_string(snap.min));
+        ret.emplace(name + ".max", std::to_string(snap.max));
+        ret.emplace(name + ".mean", std::to_string(snap.mean()));
+        ret.emplace(name + ".p50", std::to_string(snap.percentile(.5)));
+        ret.emplace(name + ".p90", std::to_string(snap.percentile(.9)));
+        ret.emplace(name + ".p99", std::to_string(snap.percentile(.99)));
+    }
+    return ret;
+}
+
+} // namespace metrics
+} // namespace jami
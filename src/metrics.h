@@ -0,0 +1,220 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#pragma once
+
+#include "noncopyable.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace jami {
+namespace metrics {
+
+/**
+ * Number of per-thread shards used by counters and histograms.
+ * Each thread always writes to the same shard, so concurrent writers
+ * from different threads rarely share a cache line.
+ */
+static constexpr unsigned SHARDS = 8;
+
+/**
+ * Index of the shard used by the calling thread
+ */
+unsigned shardIndex();
+
+/**
+ * Monotonic counter (events, bytes...)
+ */
+class Counter
+{
+public:
+    Counter() = default;
+
+    void inc(uint64_t n = 1) { shards_[shardIndex()].v.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t value() const;
+
+private:
+    NON_COPYABLE(Counter);
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> v {0};
+    };
+    std::array<Shard, SHARDS> shards_ {};
+};
+
+/**
+ * Instantaneous value (queue depth, number of open sockets...)
+ */
+class Gauge
+{
+public:
+    Gauge() = default;
+
+    void set(int64_t v) { v_.store(v, std::memory_order_relaxed); }
+    void add(int64_t n = 1) { v_.fetch_add(n, std::memory_order_relaxed); }
+    void sub(int64_t n = 1) { v_.fetch_sub(n, std::memory_order_relaxed); }
+    int64_t value() const { return v_.load(std::memory_order_relaxed); }
+
+private:
+    NON_COPYABLE(Gauge);
+    std::atomic<int64_t> v_ {0};
+};
+
+/**
+ * Log-linear (HDR-style) histogram of unsigned values.
+ * Values are grouped by power of two, each octave being split in
+ * 2^SUB_BITS linear sub-buckets, giving a relative error below 12.5%.
+ * Values above 2^MAX_EXP are clamped in the last bucket.
+ */
+class Histogram
+{
+public:
+    static constexpr unsigned SUB_BITS = 3;
+    static constexpr unsigned SUB_COUNT = 1 << SUB_BITS;
+    static constexpr unsigned MAX_EXP = 40;
+    static constexpr unsigned BUCKETS = (MAX_EXP - SUB_BITS + 2) * SUB_COUNT;
+
+    struct Snapshot
+    {
+        uint64_t count {0};
+        uint64_t sum {0};
+        uint64_t min {0};
+        uint64_t max {0};
+        std::array<uint64_t, BUCKETS> buckets {};
+
+        /**
+         * @param q quantile in [0, 1]
+         * @return upper bound of the bucket containing the quantile
+         */
+        uint64_t percentile(double q) const;
+        double mean() const { return count ? (double) sum / count : 0.; }
+    };
+
+    Histogram() = default;
+
+    void record(uint64_t value);
+
+    template<typename Duration>
+    void recordDuration(Duration d)
+    {
+        auto c = d.count();
+        record(c > 0 ? static_cast<uint64_t>(c) : 0);
+    }
+
+    Snapshot snapshot() const;
+
+    static unsigned bucketIndex(uint64_t value);
+    static uint64_t bucketLowerBound(unsigned index);
+    static uint64_t bucketUpperBound(unsigned index);
+
+private:
+    NON_COPYABLE(Histogram);
+    struct alignas(64) Shard
+    {
+        std::array<std::atomic<uint64_t>, BUCKETS> buckets {};
+        std::atomic<uint64_t> count {0};
+        std::atomic<uint64_t> sum {0};
+        std::atomic<uint64_t> min {UINT64_MAX};
+        std::atomic<uint64_t> max {0};
+    };
+    std::array<Shard, SHARDS> shards_ {};
+};
+
+/**
+ * Measure the time elapsed between construction and destruction
+ * and record it in a histogram with the given resolution.
+ */
+template<typename Duration = std::chrono::microseconds>
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Histogram& h)
+        : histogram_(h)
+        , start_(std::chrono::steady_clock::now())
+    {}
+    ~ScopedTimer()
+    {
+        histogram_.recordDuration(
+            std::chrono::duration_cast<Duration>(std::chrono::steady_clock::now() - start_));
+    }
+
+private:
+    NON_COPYABLE(ScopedTimer);
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Process-wide registry of named metrics.
+ * Metrics are never destroyed, so references returned by the registry
+ * can be cached by hot paths (usually in a function-local static).
+ * Names are dot-separated, lowercase, e.g. "ringbuffer.underruns".
+ */
+class Registry
+{
+public:
+    static Registry& instance();
+
+    Counter& counter(const std::string& name);
+    Gauge& gauge(const std::string& name);
+    Histogram& histogram(const std::string& name);
+
+    /**
+     * Flattened view of all metrics.
+     * Counters and gauges are reported as is; each histogram "h" is
+     * reported as h.count, h.sum, h.min, h.max, h.mean, h.p50, h.p90 and h.p99.
+     */
+    std::map<std::string, std::string> snapshot() const;
+
+private:
+    Registry() = default;
+    NON_COPYABLE(Registry);
+
+    mutable std::mutex mutex_ {};
+    std::map<std::string, std::unique_ptr<Counter>> counters_ {};
+    std::map<std::string, std::unique_ptr<Gauge>> gauges_ {};
+    std::map<std::string, std::unique_ptr<Histogram>> histograms_ {};
+};
+
+inline Counter&
+counter(const std::string& name)
+{
+    return Registry::instance().counter(name);
+}
+
+inline Gauge&
+gauge(const std::string& name)
+{
+    return Registry::instance().gauge(name);
+}
+
+inline Histogram&
+histogram(const std::string& name)
+{
+    return Registry::instance().histogram(name);
+}
+
+} // namespace metrics
+} // namespace jami
@@ -127,7 +127,7 @@ protected:
             if (auto so = it->lock()) {
                 it++;
                 try {
-                    so->update(this, data);
+                    so->filter(this, data);
                 } catch (std::exception& e) {
 #ifndef __DEBUG__
                     JAMI_ERR() << e.what();
@@ -167,6 +167,11 @@ class Observer
 public:
     virtual ~Observer() {}
     virtual void update(Observable<T>*, const T&) = 0;
+    /**
+     * Called instead of update() on priority observers, before other observers are
+     * updated: data may be replaced for them (e.g. by a frame processed by plugins).
+     */
+    virtual void filter(Observable<T>* obs, T& data) { update(obs, data); }
     virtual void attached(Observable<T>*) {}
     virtual void detached(Observable<T>*) {}
 };
@@ -0,0 +1,221 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#include "persistence.h"
+
+#include "fileutils.h"
+#include "logger.h"
+#include "metrics.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace jami {
+
+Persistence&
+Persistence::instance()
+{
+    // Intentionally leaked: files may be queued by threads that outlive static destruction
+    static Persistence* persistence = new Persistence;
+    return *persistence;
+}
+
+void
+Persistence::write(const std::string& path, std::string&& data, bool secret)
+{
+    static auto& coalesced = metrics::counter("persistence.coalesced");
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto [it, added] = pending_.try_emplace(path);
+    it->second.data = std::move(data);
+    it->second.secret |= secret;
+    if (not added) {
+        coalesced.inc();
+        return;
+    }
+    it->second.due = clock::now() + WRITE_DELAY;
+    if (not thread_.joinable())
+        thread_ = std::thread([this] { loop(); });
+    cv_.notify_one();
+}
+
+bool
+Persistence::idle(const std::string& path) const
+{
+    return writing_ != path and pending_.find(path) == pending_.end();
+}
+
+void
+Persistence::flush(const std::string& path)
+{
+    std::unique_lock<std::mutex> lk(mutex_);
+    auto it = pending_.find(path);
+    if (it != pending_.end()) {
+        it->second.due = clock::time_point::min();
+        cv_.notify_one();
+    }
+    doneCv_.wait(lk, [&] { return idle(path); });
+}
+
+void
+Persistence::flush()
+{
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (pending_.empty() and writing_.empty())
+        return;
+    for (auto& [path, pending] : pending_)
+        pending.due = clock::time_point::min();
+    cv_.notify_one();
+    // Only wait for files queued before the barrier
+    std::vector<std::string> paths;
+    paths.reserve(pending_.size() + 1);
+    for (const auto& [path, pending] : pending_)
+        paths.emplace_back(path);
+    if (not writing_.empty())
+        paths.emplace_back(writing_);
+    doneCv_.wait(lk, [&] {
+        for (const auto& path : paths)
+            if (not idle(path))
+                return false;
+        return true;
+    });
+}
+
+void
+Persistence::discard(const std::string& directory)
+{
+    if (directory.empty())
+        return;
+    auto inDirectory = [&](const std::string& path) {
+        return path.size() > directory.size()
+               and path.compare(0, directory.size(), directory) == 0
+               and (directory.back() == DIR_SEPARATOR_CH
+                    or path[directory.size()] == DIR_SEPARATOR_CH);
+    };
+    std::unique_lock<std::mutex> lk(mutex_);
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (inDirectory(it->first))
+            it = pending_.erase(it);
+        else
+            ++it;
+    }
+    doneCv_.wait(lk, [&] { return not inDirectory(writing_); });
+}
+
+bool
+Persistence::writeFile(const std::string& path, const std::string& data, bool secret)
+{
+    auto tmpPath = path + ".tmp";
+#ifdef _WIN32
+    {
+        std::ofstream file = fileutils::ofstream(tmpPath, std::ios::trunc | std::ios::binary);
+        if (!file.is_open()) {
+            JAMI_WARNING("Unable to write {}", path);
+            return false;
+        }
+        file.write(data.data(), data.size());
+        if (!file) {
+            JAMI_WARNING("Unable to write {}", path);
+            return false;
+        }
+    }
+#else
+    int fd = ::open(tmpPath.c_str(),
+                    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    secret ? 0600 : 0666);
+    if (fd < 0) {
+        JAMI_WARNING("Unable to write {}: {}", path, strerror(errno));
+        return false;
+    }
+    // A stale temporary file keeps its mode: restrict it before writing any secret
+    if (secret and ::fchmod(fd, 0600) < 0) {
+        JAMI_WARNING("Unable to restrict {}: {}", path, strerror(errno));
+        ::close(fd);
+        ::unlink(tmpPath.c_str());
+        return false;
+    }
+    std::size_t written = 0;
+    while (written < data.size()) {
+        auto ret = ::write(fd, data.data() + written, data.size() - written);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            JAMI_WARNING("Unable to write {}: {}", path, strerror(errno));
+            ::close(fd);
+            ::unlink(tmpPath.c_str());
+            return false;
+        }
+        written += ret;
+    }
+    // The new content must be on disk before it replaces the old one
+    ::fsync(fd);
+    ::close(fd);
+#endif
+    std::error_code ec;
+    std::filesystem::rename(std::filesystem::u8path(tmpPath), std::filesystem::u8path(path), ec);
+    if (ec) {
+        JAMI_WARNING("Unable to replace {}: {}", path, ec.message());
+        return false;
+    }
+    return true;
+}
+
+void
+Persistence::loop()
+{
+    static auto& writes = metrics::counter("persistence.writes");
+    static auto& bytesWritten = metrics::counter("persistence.bytes_written");
+
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (true) {
+        auto next = pending_.end();
+        for (auto it = pending_.begin(); it != pending_.end(); ++it)
+            if (next == pending_.end() or it->second.due < next->second.due)
+                next = it;
+        if (next == pending_.end()) {
+            cv_.wait(lk);
+            continue;
+        }
+        if (next->second.due > clock::now()) {
+            cv_.wait_until(lk, next->second.due);
+            continue;
+        }
+
+        writing_ = next->first;
+        auto data = std::move(next->second.data);
+        auto secret = next->second.secret;
+        pending_.erase(next);
+        lk.unlock();
+        if (writeFile(writing_, data, secret)) {
+            writes.inc();
+            bytesWritten.inc(data.size());
+        }
+        lk.lock();
+        writing_.clear();
+        doneCv_.notify_all();
+    }
+}
+
+} // namespace jami
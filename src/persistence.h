@@ -0,0 +1,107 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#pragma once
+
+#include "noncopyable.h"
+
+#include <msgpack.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace jami {
+
+/**
+ * Write-behind persistence of small state files (contacts, conversation infos...).
+ *
+ * Files are written by a dedicated I/O thread, WRITE_DELAY after the first
+ * change. Writes queued for a file in the meantime are coalesced: only the
+ * last content is written. Files are replaced atomically, by writing to a
+ * temporary file renamed over the destination.
+ */
+class Persistence
+{
+public:
+    using clock = std::chrono::steady_clock;
+    static constexpr std::chrono::milliseconds WRITE_DELAY {200};
+
+    static Persistence& instance();
+
+    /**
+     * Queue data to be written to path
+     * @param secret  only let the owner read the file (0600), e.g. for keys
+     */
+    void write(const std::string& path, std::string&& data, bool secret = false);
+
+    template<typename T>
+    void writePacked(const std::string& path, const T& value, bool secret = false)
+    {
+        msgpack::sbuffer buffer;
+        msgpack::pack(buffer, value);
+        write(path, std::string(buffer.data(), buffer.size()), secret);
+    }
+
+    /**
+     * Write queued data now and wait until it is on disk.
+     * Must be called before reading a file that may have queued data.
+     */
+    void flush(const std::string& path);
+    /**
+     * Barrier: write everything queued so far, e.g. on shutdown
+     */
+    void flush();
+
+    /**
+     * Drop data queued for files in directory, before removing it
+     */
+    void discard(const std::string& directory);
+
+    /**
+     * Write data to path, replacing it atomically
+     * @param secret  only let the owner read the file (0600)
+     * @return true on success
+     */
+    static bool writeFile(const std::string& path, const std::string& data, bool secret = false);
+
+private:
+    Persistence() = default;
+    NON_COPYABLE(Persistence);
+
+    struct Pending
+    {
+        std::string data;
+        clock::time_point due;
+        bool secret {false};
+    };
+
+    void loop();
+    bool idle(const std::string& path) const;
+
+    std::mutex mutex_ {};
+    std::condition_variable cv_ {};
+    std::condition_variable doneCv_ {};
+    std::map<std::string, Pending> pending_ {};
+    std::string writing_ {};
+    std::thread thread_ {};
+};
+
+} // namespace jami
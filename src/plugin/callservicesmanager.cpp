@@ -20,6 +20,7 @@
 
 #include "callservicesmanager.h"
 
+#include "mediaprocessor.h"
 #include "pluginmanager.h"
 #include "pluginpreferencesutils.h"
 
@@ -220,6 +221,39 @@ CallServicesManager::getCallMediaHandlerStatus(const std::string& callId)
     return ret;
 }
 
+std::map<std::string, std::string>
+CallServicesManager::getCallMediaHandlerStats(const std::string& callId)
+{
+    std::map<uintptr_t, PluginMediaProcessor::Stats> stats;
+    const auto& it = callAVsubjects_.find(callId);
+    if (it != callAVsubjects_.end()) {
+        for (const auto& subject : it->second) {
+            auto processor = std::dynamic_pointer_cast<PluginMediaProcessor>(subject.second.lock());
+            if (not processor)
+                continue;
+            for (const auto& [handlerId, handlerStats] : processor->getStats()) {
+                auto& s = stats[handlerId];
+                s.frames += handlerStats.frames;
+                s.totalLatencyUs += handlerStats.totalLatencyUs;
+                s.maxLatencyUs = std::max(s.maxLatencyUs, handlerStats.maxLatencyUs);
+                s.skipped += handlerStats.skipped;
+            }
+        }
+    }
+
+    std::map<std::string, std::string> ret;
+    for (const auto& [handlerId, s] : stats) {
+        if (handlerId == 0)
+            continue;
+        auto id = std::to_string(handlerId);
+        ret[id + ".frames"] = std::to_string(s.frames);
+        ret[id + ".latency_us"] = std::to_string(s.frames ? s.totalLatencyUs / s.frames : 0);
+        ret[id + ".max_latency_us"] = std::to_string(s.maxLatencyUs);
+        ret[id + ".skipped"] = std::to_string(s.skipped);
+    }
+    return ret;
+}
+
 bool
 CallServicesManager::setPreference(const std::string& key,
                                    const std::string& value,
@@ -248,8 +282,12 @@ CallServicesManager::notifyAVSubject(CallMediaHandlerPtr& callMediaHandlerPtr,
                                      const StreamData& data,
                                      AVSubjectSPtr& subject)
 {
-    if (auto soSubject = subject.lock())
+    if (auto soSubject = subject.lock()) {
         callMediaHandlerPtr->notifyAVFrameSubject(data, soSubject);
+        // Attribute the observers it attached, for statistics
+        if (auto processor = std::dynamic_pointer_cast<PluginMediaProcessor>(soSubject))
+            processor->setHandler((uintptr_t) callMediaHandlerPtr.get());
+    }
 }
 
 void
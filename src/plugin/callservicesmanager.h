@@ -110,6 +110,14 @@ public:
      */
     std::vector<std::string> getCallMediaHandlerStatus(const std::string& callId);
 
+    /**
+     * @brief Returns processing statistics of the MediaHandlers attached to a call.
+     * @param callId
+     * @return Map of "mediaHandlerId.stat" to value, stat being frames, latency_us (mean),
+     * max_latency_us or skipped (frames passed through after a missed deadline).
+     */
+    std::map<std::string, std::string> getCallMediaHandlerStats(const std::string& callId);
+
     /**
      * @brief Sets a preference that may be changed while MediaHandler is active.
      * @param key
@@ -0,0 +1,281 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#include "mediaprocessor.h"
+
+#include "libav_deps.h"
+#include "logger.h"
+#include "metrics.h"
+
+#include <algorithm>
+
+namespace jami {
+
+PluginMediaProcessor::PluginMediaProcessor(F map)
+    : map_ {std::move(map)}
+{}
+
+PluginMediaProcessor::~PluginMediaProcessor()
+{
+    {
+        std::lock_guard<std::mutex> lk(jobMutex_);
+        running_ = false;
+    }
+    jobCv_.notify_all();
+    if (worker_.joinable())
+        worker_.join();
+    av_frame_free(&job_);
+    detached(nullptr);
+}
+
+void
+PluginMediaProcessor::attached(Observable<std::shared_ptr<MediaFrame>>* srcObs)
+{
+    if (obs_ != nullptr && obs_ != srcObs) {
+        obs_->detach(this);
+        obs_ = srcObs;
+    }
+}
+
+void
+PluginMediaProcessor::detached(Observable<std::shared_ptr<MediaFrame>>*)
+{
+    std::lock_guard<std::mutex> lk(this->mutex_);
+    for (auto& pobs : this->priority_observers_) {
+        if (auto so = pobs.lock()) {
+            so->detached(this);
+        }
+    }
+    for (auto& o : this->observers_)
+        o->detached(this);
+}
+
+/**
+ * Same geometry or audio layout: a result can stand for the frame
+ */
+static bool
+sameLayout(const AVFrame* a, const AVFrame* b)
+{
+    return a->format == b->format && a->width == b->width && a->height == b->height
+           && a->nb_samples == b->nb_samples && a->sample_rate == b->sample_rate
+           && a->ch_layout.nb_channels == b->ch_layout.nb_channels;
+}
+
+/**
+ * New frame of the same kind as frame, taking the planes of result
+ */
+static std::shared_ptr<MediaFrame>
+publishedFrame(const std::shared_ptr<MediaFrame>& frame, const AVFrame* source, AVFrame* result)
+{
+    std::shared_ptr<MediaFrame> published;
+    if (auto audio = std::dynamic_pointer_cast<AudioFrame>(frame)) {
+        auto audioFrame = std::make_shared<AudioFrame>();
+        audioFrame->has_voice = audio->has_voice;
+        published = std::move(audioFrame);
+#ifdef ENABLE_VIDEO
+    } else if (std::dynamic_pointer_cast<VideoFrame>(frame)) {
+        published = std::make_shared<VideoFrame>();
+#endif
+    } else {
+        published = std::make_shared<MediaFrame>();
+    }
+    auto f = published->pointer();
+    av_frame_move_ref(f, result);
+    // Timing and side data (e.g. orientation) of the frame it replaces
+    while (f->nb_side_data > 0)
+        av_frame_remove_side_data(f, f->side_data[0]->type);
+    av_dict_free(&f->metadata);
+    if (av_frame_copy_props(f, source) < 0)
+        return {};
+    return published;
+}
+
+void
+PluginMediaProcessor::update(Observable<std::shared_ptr<MediaFrame>>* obs,
+                             const std::shared_ptr<MediaFrame>& framePtr)
+{
+    // Not a priority observer: nothing to publish the result to
+    auto frame = framePtr;
+    filter(obs, frame);
+}
+
+void
+PluginMediaProcessor::filter(Observable<std::shared_ptr<MediaFrame>>*,
+                             std::shared_ptr<MediaFrame>& framePtr)
+{
+    auto frame = map_(framePtr);
+    if (not frame)
+        return;
+    {
+        std::lock_guard<std::mutex> lk(this->mutex_);
+        if (this->observers_.empty() and this->priority_observers_.empty())
+            return;
+    }
+    if (frame->hw_frames_ctx) {
+        // Hardware frames are not copied to system memory: process them in place
+        runPlugins(frame);
+        return;
+    }
+
+    AVFrame* result = nullptr;
+    {
+        std::lock_guard<std::mutex> lk(jobMutex_);
+        auto index = ++frames_;
+        if (state_ == JobState::DONE) {
+            // Only the result of the previous frame keeps the stream in order
+            if (jobFrame_ + 1 == index and sameLayout(job_, frame))
+                std::swap(result, job_);
+            av_frame_free(&job_);
+            state_ = JobState::IDLE;
+        }
+        if (state_ == JobState::IDLE) {
+            // Shares the planes with the original frame
+            job_ = av_frame_alloc();
+            if (job_ and av_frame_ref(job_, frame) >= 0) {
+                jobFrame_ = index;
+                state_ = JobState::QUEUED;
+                if (not worker_.joinable())
+                    worker_ = std::thread([this] { process(); });
+                jobCv_.notify_all();
+            } else {
+                av_frame_free(&job_);
+            }
+        }
+    }
+    if (not result) {
+        skip();
+        return;
+    }
+    if (auto published = publishedFrame(framePtr, frame, result))
+        framePtr = std::move(published);
+    else
+        skip();
+    av_frame_free(&result);
+}
+
+void
+PluginMediaProcessor::process()
+{
+    std::unique_lock<std::mutex> lk(jobMutex_);
+    while (true) {
+        jobCv_.wait(lk, [this] { return not running_ or state_ == JobState::QUEUED; });
+        if (not running_)
+            return;
+        state_ = JobState::PROCESSING;
+        auto job = job_;
+        lk.unlock();
+        // Plugins write in place: copy the planes still shared with the original frame
+        if (av_frame_make_writable(job) >= 0)
+            runPlugins(job);
+        else
+            JAMI_WARNING("Unable to copy frame for plugins");
+        lk.lock();
+        state_ = JobState::DONE;
+    }
+}
+
+void
+PluginMediaProcessor::runPlugins(AVFrame* frame)
+{
+    auto run = [&](Observer<AVFrame*>* observer) {
+        auto start = std::chrono::steady_clock::now();
+        try {
+            observer->update(this, frame);
+        } catch (const std::exception& e) {
+            JAMI_ERROR("Plugin failed to process frame: {}", e.what());
+        }
+        uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+        std::lock_guard<std::mutex> lk(statsMutex_);
+        auto& stats = stats_[observer].second;
+        stats.frames++;
+        stats.totalLatencyUs += latency;
+        stats.maxLatencyUs = std::max(stats.maxLatencyUs, latency);
+    };
+
+    std::lock_guard<std::mutex> lk(this->mutex_);
+    for (auto it = this->priority_observers_.begin(); it != this->priority_observers_.end();) {
+        if (auto so = it->lock()) {
+            it++;
+            run(so.get());
+        } else {
+            it = this->priority_observers_.erase(it);
+        }
+    }
+    for (auto observer : this->observers_)
+        run(observer);
+}
+
+void
+PluginMediaProcessor::skip()
+{
+    static auto& skipped = metrics::counter("plugin.frames.skipped");
+    skipped.inc();
+    std::lock_guard<std::mutex> lk(statsMutex_);
+    for (auto& stats : stats_)
+        stats.second.second.skipped++;
+}
+
+void
+PluginMediaProcessor::setHandler(uintptr_t handlerId)
+{
+    std::lock_guard<std::mutex> lk(this->mutex_);
+    std::lock_guard<std::mutex> lks(statsMutex_);
+    auto isAttached = [this](Observer<AVFrame*>* observer) {
+        if (this->observers_.count(observer))
+            return true;
+        for (auto& pobs : this->priority_observers_)
+            if (auto so = pobs.lock())
+                if (so.get() == observer)
+                    return true;
+        return false;
+    };
+    for (auto it = stats_.begin(); it != stats_.end();) {
+        if (isAttached(it->first))
+            ++it;
+        else
+            it = stats_.erase(it);
+    }
+    auto label = [&](Observer<AVFrame*>* observer) {
+        auto& stats = stats_[observer];
+        if (stats.first == 0)
+            stats.first = handlerId;
+    };
+    for (auto observer : this->observers_)
+        label(observer);
+    for (auto& pobs : this->priority_observers_)
+        if (auto so = pobs.lock())
+            label(so.get());
+}
+
+std::map<uintptr_t, PluginMediaProcessor::Stats>
+PluginMediaProcessor::getStats() const
+{
+    std::map<uintptr_t, Stats> ret;
+    std::lock_guard<std::mutex> lk(statsMutex_);
+    for (const auto& [observer, stats] : stats_) {
+        auto& handlerStats = ret[stats.first];
+        handlerStats.frames += stats.second.frames;
+        handlerStats.totalLatencyUs += stats.second.totalLatencyUs;
+        handlerStats.maxLatencyUs = std::max(handlerStats.maxLatencyUs, stats.second.maxLatencyUs);
+        handlerStats.skipped += stats.second.skipped;
+    }
+    return ret;
+}
+
+} // namespace jami
@@ -0,0 +1,126 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+#pragma once
+
+#include "media_buffer.h"
+#include "noncopyable.h"
+#include "observer.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+extern "C" {
+struct AVFrame;
+}
+
+namespace jami {
+
+/**
+ * Stream subject given to media handlers, processing frames on its own thread.
+ *
+ * Plugins attach to it as observers of AVFrame* and modify frames in place.
+ * Instead of running them on the thread producing the frames, each frame is
+ * referenced (not copied) and handed to a worker, which makes it writable and runs
+ * the plugins. The producer never waits: as a priority observer, it publishes to
+ * the other consumers a new frame with the result of the previous frame and the
+ * timing of the current one. Frames are passed through unmodified while the
+ * plugins are busy, and results that would break the stream order are dropped.
+ * Frames already shared with other consumers are never modified.
+ */
+class PluginMediaProcessor : public Observer<std::shared_ptr<MediaFrame>>,
+                             public Observable<AVFrame*>
+{
+public:
+    using F = std::function<AVFrame*(const std::shared_ptr<MediaFrame>&)>;
+
+    /** Per media handler statistics */
+    struct Stats
+    {
+        uint64_t frames {0};
+        uint64_t totalLatencyUs {0};
+        uint64_t maxLatencyUs {0};
+        /** Frames passed through unprocessed: handler busy or result out of order */
+        uint64_t skipped {0};
+    };
+
+    PluginMediaProcessor(F map);
+    ~PluginMediaProcessor();
+
+    void update(Observable<std::shared_ptr<MediaFrame>>*,
+                const std::shared_ptr<MediaFrame>& frame) override;
+    /**
+     * Replace frame by the processed one for the next observers, if any
+     */
+    void filter(Observable<std::shared_ptr<MediaFrame>>*,
+                std::shared_ptr<MediaFrame>& frame) override;
+
+    /**
+     * Here we just make sure that the processor is only attached to one
+     * Observable at a time.
+     */
+    void attached(Observable<std::shared_ptr<MediaFrame>>* srcObs) override;
+
+    /**
+     * Since the processor is only attached to one Observable, when detached
+     * we should detach all of its observers
+     */
+    void detached(Observable<std::shared_ptr<MediaFrame>>*) override;
+
+    /**
+     * Attribute observers attached since the last call to a media handler
+     */
+    void setHandler(uintptr_t handlerId);
+
+    /**
+     * @return statistics of the media handlers attached to this stream
+     */
+    std::map<uintptr_t, Stats> getStats() const;
+
+private:
+    NON_COPYABLE(PluginMediaProcessor);
+
+    enum class JobState { IDLE, QUEUED, PROCESSING, DONE };
+
+    void process();
+    void runPlugins(AVFrame* frame);
+    void skip();
+
+    F map_;
+    Observable<std::shared_ptr<MediaFrame>>* obs_ = nullptr;
+
+    // Frame exchanged with the worker
+    std::mutex jobMutex_ {};
+    std::condition_variable jobCv_ {};
+    AVFrame* job_ {nullptr};
+    JobState state_ {JobState::IDLE};
+    /** Frames received, and index of the frame in job_ */
+    uint64_t frames_ {0};
+    uint64_t jobFrame_ {0};
+    bool running_ {true};
+    std::thread worker_ {};
+
+    mutable std::mutex statsMutex_ {};
+    /** Per observer: media handler that attached it, and its statistics */
+    std::map<Observer<AVFrame*>*, std::pair<uintptr_t, Stats>> stats_ {};
+};
+
+} // namespace jami
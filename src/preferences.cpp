@@ -74,6 +74,7 @@
 namespace jami {
 
 using yaml_utils::parseValue;
+using yaml_utils::parseValueOptional;
 
 constexpr const char* const Preferences::CONFIG_LABEL;
 const char* const Preferences::DFT_ZONE = "North America";
@@ -90,6 +91,7 @@ static constexpr const char* ZONE_TONE_CHOICE_KEY {"zoneToneChoice"};
 static constexpr const char* PORT_NUM_KEY {"portNum"};
 static constexpr const char* SEARCH_BAR_DISPLAY_KEY {"searchBarDisplay"};
 static constexpr const char* MD5_HASH_KEY {"md5Hash"};
+static constexpr const char* SHARED_DHT_PORT_KEY {"sharedDhtPort"};
 
 // voip preferences
 constexpr const char* const VoipPreference::CONFIG_LABEL;
@@ -156,6 +158,7 @@ Preferences::Preferences()
     , portNum_(sip_utils::DEFAULT_SIP_PORT)
     , searchBarDisplay_(true)
     , md5Hash_(false)
+    , sharedDhtPort_(0)
 {}
 
 void
@@ -217,6 +220,7 @@ Preferences::serialize(YAML::Emitter& out) const
     out << YAML::Key << ORDER_KEY << YAML::Value << accountOrder_;
     out << YAML::Key << PORT_NUM_KEY << YAML::Value << portNum_;
     out << YAML::Key << SEARCH_BAR_DISPLAY_KEY << YAML::Value << searchBarDisplay_;
+    out << YAML::Key << SHARED_DHT_PORT_KEY << YAML::Value << sharedDhtPort_;
     out << YAML::Key << ZONE_TONE_CHOICE_KEY << YAML::Value << zoneToneChoice_;
     out << YAML::EndMap;
 }
@@ -234,6 +238,7 @@ Preferences::unserialize(const YAML::Node& in)
     parseValue(node, PORT_NUM_KEY, portNum_);
     parseValue(node, SEARCH_BAR_DISPLAY_KEY, searchBarDisplay_);
     parseValue(node, MD5_HASH_KEY, md5Hash_);
+    parseValueOptional(node, SHARED_DHT_PORT_KEY, sharedDhtPort_);
 }
 
 VoipPreference::VoipPreference()
@@ -91,6 +91,13 @@ public:
     bool getMd5Hash() const { return md5Hash_; }
     void setMd5Hash(bool md5) { md5Hash_ = md5; }
 
+    /**
+     * Loopback port of the DHT node shared by Jami accounts, 0 if each account
+     * runs its own node. See SharedDhtNode.
+     */
+    int getSharedDhtPort() const { return sharedDhtPort_; }
+    void setSharedDhtPort(int port) { sharedDhtPort_ = port; }
+
 private:
     std::string accountOrder_;
     int historyLimit_;
@@ -100,6 +107,7 @@ private:
     int portNum_;
     bool searchBarDisplay_;
     bool md5Hash_;
+    int sharedDhtPort_;
     constexpr static const char* const CONFIG_LABEL = "preferences";
 };
 
@@ -20,63 +20,128 @@
 #include "scheduled_executor.h"
 #include "logger.h"
 
+#include <algorithm>
+
 namespace jami {
 
 std::atomic<uint64_t> task_cookie = {0};
 
-ScheduledExecutor::ScheduledExecutor(const std::string& name)
+static constexpr unsigned BITS_PER_WORD = 64;
+
+static inline unsigned
+lowestBit(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(v);
+#else
+    unsigned r = 0;
+    while (not(v & 1)) {
+        v >>= 1;
+        r++;
+    }
+    return r;
+#endif
+}
+
+ScheduledExecutor::Key
+ScheduledExecutor::key(std::string_view id)
+{
+    auto k = static_cast<Key>(std::hash<std::string_view> {}(id));
+    return k == MAIN_KEY ? MAIN_KEY + 1 : k;
+}
+
+ScheduledExecutor::ScheduledExecutor(const std::string& name, unsigned threads)
     : name_(name)
+    , pendingJobs_(metrics::gauge("scheduler." + name + ".pending"))
+    , jobDelay_(metrics::histogram("scheduler." + name + ".delay_us"))
     , running_(std::make_shared<std::atomic<bool>>(true))
-    , thread_([this, is_running = running_] {
-        // The thread needs its own reference of `running_` in case the
-        // scheduler is destroyed within the thread because of a job
-
-        while (*is_running)
-            loop();
-    })
-{}
+    , threadCount_(std::max(threads, 1u))
+    , wheel_(WHEEL_SLOTS)
+    , occupied_(WHEEL_SLOTS / BITS_PER_WORD)
+{
+    // Threads need their own reference of `running_` in case the
+    // scheduler is destroyed within one of them because of a job
+    timerThread_ = std::thread([this, is_running = running_] { timerLoop(is_running); });
+    threads_.reserve(threadCount_);
+    for (unsigned i = 0; i < threadCount_; i++)
+        threads_.emplace_back([this, i, is_running = running_] { workerLoop(i, is_running); });
+}
 
 ScheduledExecutor::~ScheduledExecutor()
 {
     stop();
 
-    if (not thread_.joinable()) {
-        return;
-    }
+    auto joinThread = [](std::thread& thread) {
+        if (not thread.joinable())
+            return;
+        // Avoid deadlock
+        if (std::this_thread::get_id() == thread.get_id())
+            thread.detach();
+        else
+            thread.join();
+    };
+    joinThread(timerThread_);
+    for (auto& thread : threads_)
+        joinThread(thread);
+}
 
-    // Avoid deadlock
-    if (std::this_thread::get_id() == thread_.get_id()) {
-        thread_.detach();
-    } else {
-        thread_.join();
+void
+ScheduledExecutor::stop()
+{
+    std::size_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(timerLock_);
+        *running_ = false;
+        for (auto& slot : wheel_) {
+            dropped += slot.size();
+            slot.clear();
+        }
+        std::fill(occupied_.begin(), occupied_.end(), 0);
+        timerCount_ = 0;
+        timerCv_.notify_all();
     }
+    {
+        std::lock_guard<std::mutex> lock(jobLock_);
+        dropped += mainJobs_.size();
+        for (const auto& strand : strands_)
+            dropped += strand.second.jobs.size();
+        mainJobs_.clear();
+        strands_.clear();
+        runnable_.clear();
+        mainCv_.notify_all();
+        workersCv_.notify_all();
+    }
+    pendingJobs_.sub(dropped);
 }
 
 void
-ScheduledExecutor::stop()
+ScheduledExecutor::run(std::function<void()>&& job, const char* filename, uint32_t linum)
 {
-    std::lock_guard<std::mutex> lock(jobLock_);
-    *running_ = false;
-    jobs_.clear();
-    cv_.notify_all();
+    run(MAIN_KEY, std::move(job), filename, linum);
 }
 
 void
-ScheduledExecutor::run(std::function<void()>&& job,
-                       const char* filename, uint32_t linum)
+ScheduledExecutor::run(Key key, std::function<void()>&& job, const char* filename, uint32_t linum)
 {
-    std::lock_guard<std::mutex> lock(jobLock_);
-    auto now = clock::now();
-    jobs_[now].emplace_back(std::move(job), filename, linum);
-    cv_.notify_all();
+    if (not *running_)
+        return;
+    pendingJobs_.add();
+    enqueue(key, {Job(std::move(job), filename, linum), clock::now()});
 }
 
 std::shared_ptr<Task>
 ScheduledExecutor::schedule(std::function<void()>&& job, time_point t,
                             const char* filename, uint32_t linum)
+{
+    return schedule(MAIN_KEY, std::move(job), t, filename, linum);
+}
+
+std::shared_ptr<Task>
+ScheduledExecutor::schedule(Key key, std::function<void()>&& job, time_point t,
+                            const char* filename, uint32_t linum)
 {
     auto ret = std::make_shared<Task>(std::move(job), filename, linum);
-    schedule(ret, t);
+    schedule(key, ret, t);
     return ret;
 }
 
@@ -84,67 +149,264 @@ std::shared_ptr<Task>
 ScheduledExecutor::scheduleIn(std::function<void()>&& job, duration dt,
                               const char* filename, uint32_t linum)
 {
-    return schedule(std::move(job), clock::now() + dt,
-                    filename, linum);
+    return scheduleIn(MAIN_KEY, std::move(job), dt, filename, linum);
+}
+
+std::shared_ptr<Task>
+ScheduledExecutor::scheduleIn(Key key, std::function<void()>&& job, duration dt,
+                              const char* filename, uint32_t linum)
+{
+    return schedule(key, std::move(job), clock::now() + dt, filename, linum);
 }
 
 std::shared_ptr<RepeatedTask>
 ScheduledExecutor::scheduleAtFixedRate(std::function<bool()>&& job,
                                        duration dt,
                                        const char* filename, uint32_t linum)
+{
+    return scheduleAtFixedRate(MAIN_KEY, std::move(job), dt, filename, linum);
+}
+
+std::shared_ptr<RepeatedTask>
+ScheduledExecutor::scheduleAtFixedRate(Key key,
+                                       std::function<bool()>&& job,
+                                       duration dt,
+                                       const char* filename, uint32_t linum)
 {
     auto ret = std::make_shared<RepeatedTask>(std::move(job), filename, linum);
-    reschedule(ret, clock::now(), dt);
+    reschedule(key, ret, clock::now(), dt);
     return ret;
 }
 
 void
-ScheduledExecutor::reschedule(std::shared_ptr<RepeatedTask> task, time_point t, duration dt)
+ScheduledExecutor::reschedule(Key key, std::shared_ptr<RepeatedTask> task, time_point t, duration dt)
 {
     const char* filename =  task->job().filename;
     uint32_t linenum = task->job().linum;
-    schedule(std::make_shared<Task>([this, task = std::move(task), t, dt]() mutable {
+    schedule(key, std::make_shared<Task>([this, key, task = std::move(task), t, dt]() mutable {
         if (task->run(name_.c_str()))
-                reschedule(std::move(task), t + dt, dt);
+                reschedule(key, std::move(task), t + dt, dt);
     }, filename, linenum),
              t);
 }
 
 void
-ScheduledExecutor::schedule(std::shared_ptr<Task> task, time_point t)
+ScheduledExecutor::schedule(Key key, std::shared_ptr<Task> task, time_point t)
 {
     const char* filename =  task->job().filename;
     uint32_t linenum = task->job().linum;
+    addTimer(key,
+             Job([task = std::move(task), this] { task->run(name_.c_str()); }, filename, linenum),
+             t);
+}
+
+uint64_t
+ScheduledExecutor::tickOf(time_point t) const
+{
+    if (t <= epoch_)
+        return 0;
+    // Round up: a timer never fires before its deadline
+    return static_cast<uint64_t>((t - epoch_ + TICK - duration(1)) / TICK);
+}
+
+void
+ScheduledExecutor::setOccupied(unsigned slot, bool occupied)
+{
+    auto& word = occupied_[slot / BITS_PER_WORD];
+    auto bit = uint64_t(1) << (slot % BITS_PER_WORD);
+    if (occupied)
+        word |= bit;
+    else
+        word &= ~bit;
+}
+
+int
+ScheduledExecutor::nextOccupiedSlot(unsigned from) const
+{
+    // Scan the occupancy bitmap, wrapping around once
+    const unsigned words = WHEEL_SLOTS / BITS_PER_WORD;
+    unsigned w = from / BITS_PER_WORD;
+    uint64_t word = occupied_[w] & (~uint64_t(0) << (from % BITS_PER_WORD));
+    for (unsigned i = 0; i <= words; i++) {
+        if (word)
+            return static_cast<int>(w * BITS_PER_WORD + lowestBit(word));
+        w = (w + 1) % words;
+        word = occupied_[w];
+    }
+    return -1;
+}
+
+void
+ScheduledExecutor::addTimer(Key key, Job&& job, time_point t)
+{
+    std::unique_lock<std::mutex> lock(timerLock_);
+    if (not *running_)
+        return;
+    pendingJobs_.add();
+    auto tick = tickOf(t);
+    if (tick < currentTick_) {
+        // Already due
+        lock.unlock();
+        enqueue(key, {std::move(job), t});
+        return;
+    }
+    auto slot = static_cast<unsigned>(tick & (WHEEL_SLOTS - 1));
+    wheel_[slot].emplace_back(TimerEntry {{std::move(job), t}, tick, timerSeq_++, key});
+    setOccupied(slot, true);
+    timerCount_++;
+    // Only wake up the timer thread if it would sleep past this timer
+    if (tick < nextWakeTick_) {
+        nextWakeTick_ = tick;
+        timerCv_.notify_one();
+    }
+}
+
+void
+ScheduledExecutor::enqueue(Key key, QueuedJob&& job)
+{
     std::lock_guard<std::mutex> lock(jobLock_);
-    jobs_[t].emplace_back([task = std::move(task), this] { task->run(name_.c_str()); },
-                            filename, linenum);
-    cv_.notify_all();
+    if (not *running_) {
+        pendingJobs_.sub();
+        return;
+    }
+    if (key == MAIN_KEY) {
+        mainJobs_.emplace_back(std::move(job));
+        mainCv_.notify_one();
+        return;
+    }
+    auto& strand = strands_[key];
+    bool idle = not strand.running and strand.jobs.empty();
+    strand.jobs.emplace_back(std::move(job));
+    if (idle) {
+        runnable_.emplace_back(key);
+        if (threadCount_ == 1)
+            mainCv_.notify_one();
+        else
+            workersCv_.notify_one();
+    }
 }
 
 void
-ScheduledExecutor::loop()
+ScheduledExecutor::runJob(QueuedJob& job)
 {
-    std::vector<Job> jobs;
-    {
-        std::unique_lock<std::mutex> lock(jobLock_);
-        while (*running_ and (jobs_.empty() or jobs_.begin()->first > clock::now())) {
-            if (jobs_.empty())
-                cv_.wait(lock);
-            else {
-                auto nextJob = jobs_.begin()->first;
-                cv_.wait_until(lock, nextJob);
+    pendingJobs_.sub();
+    jobDelay_.recordDuration(
+        std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - job.due));
+    try {
+        job.job.fn();
+    } catch (const std::exception& e) {
+        JAMI_ERR("Exception running job: %s", e.what());
+    }
+}
+
+void
+ScheduledExecutor::timerLoop(const std::shared_ptr<std::atomic<bool>>& running)
+{
+    std::vector<TimerEntry> due;
+    std::unique_lock<std::mutex> lock(timerLock_);
+    while (*running) {
+        auto nowTick = static_cast<uint64_t>((clock::now() - epoch_) / TICK);
+        if (nowTick >= currentTick_) {
+            // Collect all timers expired since the last pass
+            auto ticks = std::min<uint64_t>(nowTick - currentTick_ + 1, WHEEL_SLOTS);
+            for (uint64_t i = 0; i < ticks; i++) {
+                auto slot = static_cast<unsigned>((currentTick_ + i) & (WHEEL_SLOTS - 1));
+                auto& entries = wheel_[slot];
+                for (auto it = entries.begin(); it != entries.end();) {
+                    if (it->tick <= nowTick) {
+                        due.emplace_back(std::move(*it));
+                        *it = std::move(entries.back());
+                        entries.pop_back();
+                    } else {
+                        ++it;
+                    }
+                }
+                if (entries.empty())
+                    setOccupied(slot, false);
             }
+            currentTick_ = nowTick + 1;
+            timerCount_ -= due.size();
+        }
+
+        if (not due.empty()) {
+            // Keep deadline order, then submission order for identical deadlines
+            std::sort(due.begin(), due.end(), [](const TimerEntry& a, const TimerEntry& b) {
+                return a.job.due < b.job.due or (a.job.due == b.job.due and a.seq < b.seq);
+            });
+            lock.unlock();
+            for (auto& entry : due)
+                enqueue(entry.key, std::move(entry.job));
+            due.clear();
+            lock.lock();
+            continue;
+        }
+
+        auto slot = timerCount_
+                        ? nextOccupiedSlot(static_cast<unsigned>(currentTick_ & (WHEEL_SLOTS - 1)))
+                        : -1;
+        if (slot < 0) {
+            nextWakeTick_ = UINT64_MAX;
+            timerCv_.wait(lock);
+        } else {
+            nextWakeTick_ = currentTick_ + ((slot - currentTick_) & (WHEEL_SLOTS - 1));
+            timerCv_.wait_until(lock, epoch_ + nextWakeTick_ * TICK);
         }
-        if (not *running_)
-            return;
-        jobs = std::move(jobs_.begin()->second);
-        jobs_.erase(jobs_.begin());
     }
-    for (auto& job : jobs) {
-        try {
-            job.fn();
-        } catch (const std::exception& e) {
-            JAMI_ERR("Exception running job: %s", e.what());
+}
+
+void
+ScheduledExecutor::workerLoop(unsigned index, const std::shared_ptr<std::atomic<bool>>& running)
+{
+    // The first worker runs MAIN_KEY jobs, and every other key when it is the only worker
+    const bool isMain = index == 0;
+    const bool runStrands = not isMain or threadCount_ == 1;
+    auto& cv = isMain ? mainCv_ : workersCv_;
+
+    std::unique_lock<std::mutex> lock(jobLock_);
+    while (*running) {
+        cv.wait(lock, [&] {
+            return not *running or (isMain and not mainJobs_.empty())
+                   or (runStrands and not runnable_.empty());
+        });
+        if (not *running)
+            return;
+
+        if (isMain and not mainJobs_.empty()) {
+            auto job = std::move(mainJobs_.front());
+            mainJobs_.pop_front();
+            lock.unlock();
+            runJob(job);
+            // The executor may have been destroyed by the job
+            if (not *running)
+                return;
+            lock.lock();
+            continue;
+        }
+
+        auto key = runnable_.front();
+        runnable_.pop_front();
+        auto strand = strands_.find(key);
+        if (strand == strands_.end() or strand->second.jobs.empty())
+            continue;
+        // Jobs added to a running strand are queued after the current one
+        strand->second.running = true;
+        auto job = std::move(strand->second.jobs.front());
+        strand->second.jobs.pop_front();
+        lock.unlock();
+        runJob(job);
+        if (not *running)
+            return;
+        lock.lock();
+        strand = strands_.find(key);
+        if (strand == strands_.end())
+            continue;
+        strand->second.running = false;
+        if (strand->second.jobs.empty()) {
+            strands_.erase(strand);
+        } else {
+            runnable_.emplace_back(key);
+            if (not isMain)
+                cv.notify_one();
         }
     }
 }
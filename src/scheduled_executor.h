@@ -21,7 +21,10 @@
 
 #include <thread>
 #include <functional>
+#include <deque>
 #include <map>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <chrono>
 #include <memory>
@@ -31,6 +34,7 @@
 #include <ciso646>
 
 #include "noncopyable.h"
+#include "metrics.h"
 
 #include "tracepoint.h"
 #include "trace-tools.h"
@@ -82,6 +86,10 @@ struct RepeatedJob {
 
 /**
  * A Job that can be disposed
+ *
+ * cancel() and run() may be called from different threads: the job is
+ * either run or released, never both at once. Cancelling a running job
+ * (including from the job itself) doesn't interrupt it.
  */
 class Task
 {
@@ -94,6 +102,9 @@ public:
 #pragma GCC diagnostic ignored "-Wunused-parameter"
     void run(const char* executor_name)
     {
+        auto expected = State::PENDING;
+        if (not state_.compare_exchange_strong(expected, State::RUNNING))
+            return;
         if (job_.fn) {
             jami_tracepoint(scheduled_executor_task_begin,
                             executor_name,
@@ -103,16 +114,25 @@ public:
             jami_tracepoint(scheduled_executor_task_end,
                             cookie_);
         }
+        state_.store(State::DONE);
     }
 #pragma GCC pop
 
-    void cancel() { job_.reset(); }
-    bool isCancelled() const { return !job_; }
+    void cancel()
+    {
+        auto expected = State::PENDING;
+        // Only the winner of the transition touches the job
+        if (state_.compare_exchange_strong(expected, State::CANCELLED))
+            job_.reset();
+    }
+    bool isCancelled() const { return state_.load() == State::CANCELLED; }
 
     Job& job() { return job_; }
 
 private:
+    enum class State { PENDING, RUNNING, DONE, CANCELLED };
     Job job_;
+    std::atomic<State> state_ {State::PENDING};
     uint64_t cookie_;
 };
 
@@ -177,14 +197,38 @@ private:
     uint64_t cookie_;
 };
 
+/**
+ * Executor running jobs ASAP or at a given time.
+ *
+ * Timers are stored in a hashed timing wheel (O(1) schedule and cancel) served
+ * by a dedicated timer thread, and due jobs are dispatched to worker threads.
+ *
+ * Jobs are serialized per key: two jobs with the same key never run
+ * concurrently and run in the order they became due (submission order for
+ * jobs run ASAP). Jobs submitted without a key all share MAIN_KEY and always
+ * run on the first worker thread, which is the "main thread" of the executor.
+ * Other keys are distributed on the remaining workers, if any.
+ */
 class ScheduledExecutor
 {
 public:
     using clock = std::chrono::steady_clock;
     using time_point = clock::time_point;
     using duration = clock::duration;
+    using Key = uint64_t;
 
-    ScheduledExecutor(const std::string& name_);
+    static constexpr Key MAIN_KEY = 0;
+
+    /**
+     * Compute the key serializing jobs related to an object (account, call...)
+     */
+    static Key key(std::string_view id);
+
+    /**
+     * @param name      executor name, used for tracing and metrics
+     * @param threads   number of worker threads (at least 1)
+     */
+    ScheduledExecutor(const std::string& name_, unsigned threads = 1);
     ~ScheduledExecutor();
 
     /**
@@ -193,6 +237,9 @@ public:
     void run(std::function<void()>&& job,
              const char* filename=CURRENT_FILENAME(),
              uint32_t linum=CURRENT_LINE());
+    void run(Key key, std::function<void()>&& job,
+             const char* filename=CURRENT_FILENAME(),
+             uint32_t linum=CURRENT_LINE());
 
     /**
      * Schedule job to be run at time t
@@ -200,6 +247,9 @@ public:
     std::shared_ptr<Task> schedule(std::function<void()>&& job, time_point t,
                                    const char* filename=CURRENT_FILENAME(),
                                    uint32_t linum=CURRENT_LINE());
+    std::shared_ptr<Task> schedule(Key key, std::function<void()>&& job, time_point t,
+                                   const char* filename=CURRENT_FILENAME(),
+                                   uint32_t linum=CURRENT_LINE());
 
     /**
      * Schedule job to be run after delay dt
@@ -207,6 +257,9 @@ public:
     std::shared_ptr<Task> scheduleIn(std::function<void()>&& job, duration dt,
                                      const char* filename=CURRENT_FILENAME(),
                                      uint32_t linum=CURRENT_LINE());
+    std::shared_ptr<Task> scheduleIn(Key key, std::function<void()>&& job, duration dt,
+                                     const char* filename=CURRENT_FILENAME(),
+                                     uint32_t linum=CURRENT_LINE());
 
     /**
      * Schedule job to be run every dt, starting now.
@@ -215,6 +268,11 @@ public:
                                                       duration dt,
                                                       const char* filename=CURRENT_FILENAME(),
                                                       uint32_t linum=CURRENT_LINE());
+    std::shared_ptr<RepeatedTask> scheduleAtFixedRate(Key key,
+                                                      std::function<bool()>&& job,
+                                                      duration dt,
+                                                      const char* filename=CURRENT_FILENAME(),
+                                                      uint32_t linum=CURRENT_LINE());
 
     /**
      * Stop the scheduler, can't be reversed
@@ -224,16 +282,70 @@ public:
 private:
     NON_COPYABLE(ScheduledExecutor);
 
-    void loop();
-    void schedule(std::shared_ptr<Task>, time_point t);
-    void reschedule(std::shared_ptr<RepeatedTask>, time_point t, duration dt);
+    /** Wheel resolution: timers fire at most one tick late */
+    static constexpr duration TICK = std::chrono::milliseconds(1);
+    /** Number of wheel slots, must be a power of two */
+    static constexpr unsigned WHEEL_SLOTS = 4096;
+
+    struct QueuedJob
+    {
+        Job job;
+        time_point due;
+    };
+
+    struct TimerEntry
+    {
+        QueuedJob job;
+        uint64_t tick;
+        uint64_t seq;
+        Key key;
+    };
+
+    struct Strand
+    {
+        std::deque<QueuedJob> jobs;
+        bool running {false};
+    };
+
+    void timerLoop(const std::shared_ptr<std::atomic<bool>>& running);
+    void workerLoop(unsigned index, const std::shared_ptr<std::atomic<bool>>& running);
+    void schedule(Key key, std::shared_ptr<Task>, time_point t);
+    void reschedule(Key key, std::shared_ptr<RepeatedTask>, time_point t, duration dt);
+    void addTimer(Key key, Job&& job, time_point t);
+    void enqueue(Key key, QueuedJob&& job);
+    void runJob(QueuedJob& job);
+
+    uint64_t tickOf(time_point t) const;
+    int nextOccupiedSlot(unsigned from) const;
+    void setOccupied(unsigned slot, bool occupied);
 
     std::string name_;
+    metrics::Gauge& pendingJobs_;
+    metrics::Histogram& jobDelay_;
     std::shared_ptr<std::atomic<bool>> running_;
-    std::map<time_point, std::vector<Job>> jobs_ {};
+    const unsigned threadCount_;
+
+    // Timing wheel, protected by timerLock_
+    std::mutex timerLock_ {};
+    std::condition_variable timerCv_ {};
+    const time_point epoch_ {clock::now()};
+    uint64_t currentTick_ {0};
+    uint64_t nextWakeTick_ {UINT64_MAX};
+    uint64_t timerSeq_ {0};
+    std::size_t timerCount_ {0};
+    std::vector<std::vector<TimerEntry>> wheel_;
+    std::vector<uint64_t> occupied_;
+
+    // Ready jobs, protected by jobLock_
     std::mutex jobLock_ {};
-    std::condition_variable cv_ {};
-    std::thread thread_;
+    std::condition_variable mainCv_ {};
+    std::condition_variable workersCv_ {};
+    std::deque<QueuedJob> mainJobs_ {};
+    std::unordered_map<Key, Strand> strands_ {};
+    std::deque<Key> runnable_ {};
+
+    std::thread timerThread_;
+    std::vector<std::thread> threads_;
 };
 
 } // namespace jami
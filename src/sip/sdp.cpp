@@ -37,6 +37,7 @@
 #include "libav_utils.h"
 
 #include "media_codec.h"
+#include "metrics.h"
 #include "system_codec_container.h"
 #include "compiler_intrinsics.h" // for UNUSED
 
@@ -45,6 +46,8 @@ using random_device = dht::crypto::random_device;
 
 #include <algorithm>
 #include <cassert>
+#include <iterator>
+#include <mutex>
 
 namespace jami {
 
@@ -54,6 +57,7 @@ using std::stringstream;
 
 static constexpr int POOL_INITIAL_SIZE = 16384;
 static constexpr int POOL_INCREMENT_SIZE = POOL_INITIAL_SIZE;
+static constexpr std::size_t MAX_MEDIA_TEMPLATES = 64;
 
 static std::map<MediaDirection, const char*> DIRECTION_STR {{MediaDirection::SENDRECV, "sendrecv"},
                                                             {MediaDirection::SENDONLY, "sendonly"},
@@ -261,7 +265,7 @@ Sdp::addMediaDescription(const MediaAttribute& mediaAttr)
     auto type = mediaAttr.type_;
     auto secure = mediaAttr.secure_;
 
-    JAMI_DBG("Add media description [%s]", mediaAttr.toString(true).c_str());
+    JAMI_DEBUG("Add media description [{}]", mediaAttr.toString(true));
 
     pjmedia_sdp_media* med = PJ_POOL_ZALLOC_T(memPool_.get(), pjmedia_sdp_media);
 
@@ -269,12 +273,14 @@ Sdp::addMediaDescription(const MediaAttribute& mediaAttr)
     case MediaType::MEDIA_AUDIO:
         med->desc.media = sip_utils::CONST_PJ_STR("audio");
         med->desc.port = mediaAttr.enabled_ ? localAudioRtpPort_ : 0;
-        med->desc.fmt_count = audio_codec_list_.size();
+        if (not audioTemplate_)
+            audioTemplate_ = getMediaTemplate(type, audio_codec_list_);
         break;
     case MediaType::MEDIA_VIDEO:
         med->desc.media = sip_utils::CONST_PJ_STR("video");
         med->desc.port = mediaAttr.enabled_ ? localVideoRtpPort_ : 0;
-        med->desc.fmt_count = video_codec_list_.size();
+        if (not videoTemplate_)
+            videoTemplate_ = getMediaTemplate(type, video_codec_list_);
         break;
     default:
         throw SdpException("Unsupported media type! Only audio and video are supported");
@@ -287,69 +293,21 @@ Sdp::addMediaDescription(const MediaAttribute& mediaAttr)
     med->desc.transport = secure ? sip_utils::CONST_PJ_STR("RTP/SAVP")
                                  : sip_utils::CONST_PJ_STR("RTP/AVP");
 
-    unsigned dynamic_payload = 96;
-
-    for (unsigned i = 0; i < med->desc.fmt_count; i++) {
-        pjmedia_sdp_rtpmap rtpmap;
-        rtpmap.param.slen = 0;
-
-        std::string channels; // must have the lifetime of rtpmap
-        std::string enc_name;
-        unsigned payload;
-
-        if (type == MediaType::MEDIA_AUDIO) {
-            auto accountAudioCodec = std::static_pointer_cast<AccountAudioCodecInfo>(
-                audio_codec_list_[i]);
-            payload = accountAudioCodec->payloadType;
-            enc_name = accountAudioCodec->systemCodecInfo.name;
-
-            if (accountAudioCodec->audioformat.nb_channels > 1) {
-                channels = std::to_string(accountAudioCodec->audioformat.nb_channels);
-                rtpmap.param = sip_utils::CONST_PJ_STR(channels);
-            }
-            // G722 requires G722/8000 media description even though it's @ 16000 Hz
-            // See http://tools.ietf.org/html/rfc3551#section-4.5.2
-            if (accountAudioCodec->isPCMG722())
-                rtpmap.clock_rate = 8000;
-            else
-                rtpmap.clock_rate = accountAudioCodec->audioformat.sample_rate;
-
-        } else {
-            // FIXME: get this key from header
-            payload = dynamic_payload++;
-            enc_name = video_codec_list_[i]->systemCodecInfo.name;
-            rtpmap.clock_rate = 90000;
+    // Codec formats and attributes are copied from the template
+    const auto& tmpl = type == MediaType::MEDIA_AUDIO ? *audioTemplate_ : *videoTemplate_;
+    for (const auto& format : tmpl.formats) {
+        auto pjFormat = sip_utils::CONST_PJ_STR(format);
+        pj_strdup(memPool_.get(), &med->desc.fmt[med->desc.fmt_count++], &pjFormat);
+    }
+    for (const auto& attribute : tmpl.attributes) {
+        auto attr = PJ_POOL_ZALLOC_T(memPool_.get(), pjmedia_sdp_attr);
+        auto name = sip_utils::CONST_PJ_STR(attribute.name);
+        pj_strdup(memPool_.get(), &attr->name, &name);
+        if (not attribute.value.empty()) {
+            auto value = sip_utils::CONST_PJ_STR(attribute.value);
+            pj_strdup(memPool_.get(), &attr->value, &value);
         }
-
-        auto payloadStr = std::to_string(payload);
-        auto pjPayload = sip_utils::CONST_PJ_STR(payloadStr);
-        pj_strdup(memPool_.get(), &med->desc.fmt[i], &pjPayload);
-
-        // Add a rtpmap field for each codec
-        // We could add one only for dynamic payloads because the codecs with static RTP payloads
-        // are entirely defined in the RFC 3351
-        rtpmap.pt = med->desc.fmt[i];
-        rtpmap.enc_name = sip_utils::CONST_PJ_STR(enc_name);
-
-        pjmedia_sdp_attr* attr;
-        pjmedia_sdp_rtpmap_to_attr(memPool_.get(), &rtpmap, &attr);
         med->attr[med->attr_count++] = attr;
-
-#ifdef ENABLE_VIDEO
-        if (enc_name == "H264") {
-            // FIXME: this should not be hardcoded, it will determine what profile and level
-            // our peer will send us
-            const auto accountVideoCodec = std::static_pointer_cast<AccountVideoCodecInfo>(
-                video_codec_list_[i]);
-            const auto& profileLevelID = accountVideoCodec->parameters.empty()
-                                             ? libav_utils::DEFAULT_H264_PROFILE_LEVEL_ID
-                                             : accountVideoCodec->parameters;
-            auto value = fmt::format("fmtp:{} {}", payload, profileLevelID);
-            med->attr[med->attr_count++] = pjmedia_sdp_attr_create(memPool_.get(),
-                                                                   value.c_str(),
-                                                                   NULL);
-        }
-#endif
     }
 
     if (type == MediaType::MEDIA_AUDIO) {
@@ -436,6 +394,7 @@ Sdp::setLocalMediaCapabilities(MediaType type,
     switch (type) {
     case MediaType::MEDIA_AUDIO:
         audio_codec_list_ = selectedCodecs;
+        audioTemplate_ = getMediaTemplate(type, audio_codec_list_);
         break;
 
     case MediaType::MEDIA_VIDEO:
@@ -450,6 +409,7 @@ Sdp::setLocalMediaCapabilities(MediaType type,
                                                    }),
                                     video_codec_list_.end());
         }
+        videoTemplate_ = getMediaTemplate(type, video_codec_list_);
 #else
         (void) selectedCodecs;
 #endif
@@ -461,6 +421,101 @@ Sdp::setLocalMediaCapabilities(MediaType type,
     }
 }
 
+static SdpMediaTemplate
+buildMediaTemplate(MediaType type, const std::vector<std::shared_ptr<AccountCodecInfo>>& codecs)
+{
+    SdpMediaTemplate tmpl;
+    tmpl.formats.reserve(codecs.size());
+    unsigned dynamic_payload = 96;
+
+    for (const auto& codec : codecs) {
+        unsigned payload;
+        unsigned clockRate;
+        std::string channels;
+
+        if (type == MediaType::MEDIA_AUDIO) {
+            auto accountAudioCodec = std::static_pointer_cast<AccountAudioCodecInfo>(codec);
+            payload = accountAudioCodec->payloadType;
+            if (accountAudioCodec->audioformat.nb_channels > 1)
+                channels = std::to_string(accountAudioCodec->audioformat.nb_channels);
+            // G722 requires G722/8000 media description even though it's @ 16000 Hz
+            // See http://tools.ietf.org/html/rfc3551#section-4.5.2
+            if (accountAudioCodec->isPCMG722())
+                clockRate = 8000;
+            else
+                clockRate = accountAudioCodec->audioformat.sample_rate;
+        } else {
+            // FIXME: get this key from header
+            payload = dynamic_payload++;
+            clockRate = 90000;
+        }
+        const auto& encName = codec->systemCodecInfo.name;
+
+        // Add a rtpmap field for each codec
+        // We could add one only for dynamic payloads because the codecs with static RTP payloads
+        // are entirely defined in the RFC 3351
+        tmpl.formats.emplace_back(std::to_string(payload));
+        auto rtpmap = fmt::format("{} {}/{}", payload, encName, clockRate);
+        if (not channels.empty())
+            rtpmap += "/" + channels;
+        tmpl.attributes.push_back({"rtpmap", std::move(rtpmap)});
+
+#ifdef ENABLE_VIDEO
+        if (encName == "H264") {
+            // FIXME: this should not be hardcoded, it will determine what profile and level
+            // our peer will send us
+            const auto accountVideoCodec = std::static_pointer_cast<AccountVideoCodecInfo>(codec);
+            const auto& profileLevelID = accountVideoCodec->parameters.empty()
+                                             ? libav_utils::DEFAULT_H264_PROFILE_LEVEL_ID
+                                             : accountVideoCodec->parameters;
+            tmpl.attributes.push_back({fmt::format("fmtp:{} {}", payload, profileLevelID), {}});
+        }
+#endif
+    }
+    return tmpl;
+}
+
+std::shared_ptr<const SdpMediaTemplate>
+Sdp::getMediaTemplate(MediaType type, const std::vector<std::shared_ptr<AccountCodecInfo>>& codecs)
+{
+    static auto& built = metrics::counter("sdp.templates.built");
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<const SdpMediaTemplate>> templates;
+
+    // The key holds everything the template depends on
+    std::string key = type == MediaType::MEDIA_AUDIO ? "audio" : "video";
+    for (const auto& codec : codecs) {
+        key += ';';
+        key += codec->systemCodecInfo.name;
+        if (type == MediaType::MEDIA_AUDIO) {
+            auto accountAudioCodec = std::static_pointer_cast<AccountAudioCodecInfo>(codec);
+            fmt::format_to(std::back_inserter(key),
+                           "/{}/{}/{}",
+                           accountAudioCodec->payloadType,
+                           accountAudioCodec->audioformat.sample_rate,
+                           accountAudioCodec->audioformat.nb_channels);
+        }
+#ifdef ENABLE_VIDEO
+        else {
+            key += '/';
+            key += std::static_pointer_cast<AccountVideoCodecInfo>(codec)->parameters;
+        }
+#endif
+    }
+
+    std::lock_guard<std::mutex> lk(mutex);
+    auto it = templates.find(key);
+    if (it != templates.end())
+        return it->second;
+    // Codec lists rarely change: only keep the most recent ones
+    if (templates.size() >= MAX_MEDIA_TEMPLATES)
+        templates.clear();
+    built.inc();
+    auto tmpl = std::make_shared<const SdpMediaTemplate>(buildMediaTemplate(type, codecs));
+    templates.emplace(std::move(key), tmpl);
+    return tmpl;
+}
+
 const char*
 Sdp::getSdpDirectionStr(SdpDirection direction)
 {
@@ -474,6 +529,9 @@ Sdp::getSdpDirectionStr(SdpDirection direction)
 void
 Sdp::printSession(const pjmedia_sdp_session* session, const char* header, SdpDirection direction)
 {
+    // Printing requires a copy of the session: skip it if it won't be logged
+    if (not Logger::debugEnabled())
+        return;
     static constexpr size_t BUF_SZ = 4095;
     std::unique_ptr<pj_pool_t, decltype(pj_pool_release)&>
         tmpPool_(pj_pool_create(&Manager::instance().sipVoIPLink().getCachingPool()->factory,
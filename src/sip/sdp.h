@@ -41,6 +41,7 @@
 #include <pj/assert.h>
 
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
 #include <stdexcept>
@@ -63,6 +64,22 @@ public:
 
 enum class SdpDirection { OFFER, ANSWER, NONE };
 
+/**
+ * Codec part of a media description (formats, rtpmap and fmtp attributes),
+ * formatted once per codec list and shared by all the sessions using it.
+ * Only ports, ICE and crypto attributes are added per call.
+ */
+struct SdpMediaTemplate
+{
+    struct Attribute
+    {
+        std::string name;
+        std::string value;
+    };
+    std::vector<std::string> formats;
+    std::vector<Attribute> attributes;
+};
+
 class Sdp
 {
 public:
@@ -82,6 +99,14 @@ public:
     void setLocalMediaCapabilities(
         MediaType type, const std::vector<std::shared_ptr<AccountCodecInfo>>& selectedCodecs);
 
+    /**
+     * Get the template of a media description for a codec list.
+     * Templates are cached: they are only built again when the codec list
+     * or codec parameters change.
+     */
+    static std::shared_ptr<const SdpMediaTemplate> getMediaTemplate(
+        MediaType type, const std::vector<std::shared_ptr<AccountCodecInfo>>& codecs);
+
     /**
      *  Read accessor. Get the local passive sdp session information before negotiation
      *
@@ -293,6 +318,8 @@ private:
      */
     std::vector<std::shared_ptr<AccountCodecInfo>> audio_codec_list_;
     std::vector<std::shared_ptr<AccountCodecInfo>> video_codec_list_;
+    std::shared_ptr<const SdpMediaTemplate> audioTemplate_;
+    std::shared_ptr<const SdpMediaTemplate> videoTemplate_;
 
     std::string publishedIpAddr_;
     pj_uint16_t publishedIpAddrType_;
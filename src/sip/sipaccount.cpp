@@ -139,6 +139,7 @@ SIPAccount::~SIPAccount() noexcept
     // ensure that no registration callbacks survive past this point
     destroyRegistrationInfo();
     setTransport();
+    link_.removeAccountRoute(getAccountID());
 
     delete presence_;
 }
@@ -246,7 +247,8 @@ SIPAccount::newOutgoingCall(std::string_view toUrl, const std::vector<libjami::M
 
     if (created) {
         std::weak_ptr<SIPCall> weak_call = call;
-        manager.scheduler().run([this, weak_call] {
+        // INVITE setup may resolve and create transports: keep it off the main strand
+        manager.scheduler().run(ScheduledExecutor::key(getAccountID()), [this, weak_call] {
             if (auto call = weak_call.lock()) {
                 if (not SIPStartCall(call)) {
                     JAMI_ERR("Could not send outgoing INVITE request for new call");
@@ -1061,6 +1063,7 @@ void
 SIPAccount::loadConfig()
 {
     SIPAccountBase::loadConfig();
+    link_.updateAccountRoute(getAccountID(), config().username, config().hostname);
     setCredentials(config().credentials);
     enablePresence(config().presenceEnabled);
     initStunConfiguration();
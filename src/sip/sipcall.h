@@ -40,6 +40,7 @@
 #include "media/video/video_rtp_session.h"
 #endif
 #ifdef ENABLE_PLUGIN
+#include "plugin/mediaprocessor.h"
 #include "plugin/streamdata.h"
 #endif
 #include "noncopyable.h"
@@ -370,7 +371,7 @@ private:
      * Call Streams and some typedefs
      */
     using AVMediaStream = Observable<std::shared_ptr<MediaFrame>>;
-    using MediaStreamSubject = PublishMapSubject<std::shared_ptr<MediaFrame>, AVFrame*>;
+    using MediaStreamSubject = PluginMediaProcessor;
 
     /**
      * @brief createCallAVStream
@@ -781,8 +781,27 @@ SIPVoIPLink::guessAccount(std::string_view userName,
              server.data(),
              (int) fromUri.size(),
              fromUri.data());
-    // Try to find the account id from username and server name by full match
+    // Try to find the account id from username and server name by full match,
+    // then by hostname or username only, as SIPAccount::matches() does
+    std::vector<std::string> accountIds;
+    {
+        std::lock_guard<std::mutex> lk(routesMtx_);
+        auto add = [&](const auto& index, const std::string& key) {
+            auto it = index.find(key);
+            if (it != index.end())
+                accountIds.insert(accountIds.end(), it->second.begin(), it->second.end());
+        };
+        if (not userName.empty())
+            add(routes_, routeKey(userName, server));
+        add(hostRoutes_, std::string(server));
+        if (not userName.empty())
+            add(userRoutes_, std::string(userName));
+    }
+    for (const auto& accountId : accountIds)
+        if (auto account = Manager::instance().getAccount<SIPAccount>(accountId))
+            return account;
 
+    // Otherwise, check hostname resolutions
     std::shared_ptr<SIPAccountBase> result;
     std::shared_ptr<SIPAccountBase> IP2IPAccount;
     MatchRank best = MatchRank::NONE;
@@ -806,6 +825,61 @@ SIPVoIPLink::guessAccount(std::string_view userName,
     return result ? result : IP2IPAccount;
 }
 
+void
+SIPVoIPLink::updateAccountRoute(const std::string& accountId,
+                                const std::string& userName,
+                                const std::string& server)
+{
+    std::lock_guard<std::mutex> lk(routesMtx_);
+    auto& current = accountRoutes_[accountId];
+    if (current.first == userName and current.second == server)
+        return;
+    removeRoutes(accountId, current);
+    current = {userName, server};
+    if (not userName.empty()) {
+        routes_[routeKey(userName, server)].emplace(accountId);
+        userRoutes_[userName].emplace(accountId);
+    }
+    hostRoutes_[server].emplace(accountId);
+}
+
+void
+SIPVoIPLink::removeAccountRoute(const std::string& accountId)
+{
+    std::lock_guard<std::mutex> lk(routesMtx_);
+    auto it = accountRoutes_.find(accountId);
+    if (it == accountRoutes_.end())
+        return;
+    removeRoutes(accountId, it->second);
+    accountRoutes_.erase(it);
+}
+
+void
+SIPVoIPLink::removeRoutes(const std::string& accountId,
+                          const std::pair<std::string, std::string>& route)
+{
+    auto remove = [&](auto& index, const std::string& key) {
+        auto it = index.find(key);
+        if (it == index.end())
+            return;
+        it->second.erase(accountId);
+        if (it->second.empty())
+            index.erase(it);
+    };
+    remove(routes_, routeKey(route.first, route.second));
+    remove(userRoutes_, route.first);
+    remove(hostRoutes_, route.second);
+}
+
+std::string
+SIPVoIPLink::routeKey(std::string_view userName, std::string_view server)
+{
+    std::string key;
+    key.reserve(userName.size() + server.size() + 1);
+    key.append(userName).append(1, '\n').append(server);
+    return key;
+}
+
 // Called from EventThread::run (not main thread)
 void
 SIPVoIPLink::handleEvents()
@@ -44,6 +44,9 @@
 #endif
 #include <map>
 #include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
 #include <memory>
 #include <functional>
 #include <thread>
@@ -117,6 +120,15 @@ public:
                                                  std::string_view server,
                                                  std::string_view fromUri) const;
 
+    /**
+     * Update the index used by guessAccount() for a SIP account.
+     * Must be called when the username or hostname of the account changes.
+     */
+    void updateAccountRoute(const std::string& accountId,
+                            const std::string& userName,
+                            const std::string& server);
+    void removeAccountRoute(const std::string& accountId);
+
     int getModId();
     pjsip_endpoint* getEndpoint();
     pjsip_module* getMod();
@@ -163,8 +175,25 @@ private:
     mutable pj_caching_pool cp_;
     std::unique_ptr<pj_pool_t, decltype(pj_pool_release)&> pool_;
     std::atomic_bool running_ {true};
+    // pjsip callbacks (SIPCall, transports, presence...) expect to be serialized
     std::thread sipThread_;
 
+    static std::string routeKey(std::string_view userName, std::string_view server);
+    /**
+     * @note routesMtx_ must be locked
+     */
+    void removeRoutes(const std::string& accountId,
+                      const std::pair<std::string, std::string>& route);
+
+    // SIP accounts by username and hostname, then by hostname or username
+    // only, see guessAccount()
+    mutable std::mutex routesMtx_ {};
+    std::unordered_map<std::string, std::set<std::string>> routes_ {};
+    std::unordered_map<std::string, std::set<std::string>> hostRoutes_ {};
+    std::unordered_map<std::string, std::set<std::string>> userRoutes_ {};
+    // Username and hostname indexed for each account
+    std::map<std::string, std::pair<std::string, std::string>> accountRoutes_ {};
+
     friend class SIPTest;
 };
 
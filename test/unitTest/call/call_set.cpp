@@ -0,0 +1,261 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "manager.h"
+#include "call_factory.h"
+#include "call_set.h"
+#include "conference.h"
+#include "sip/sipaccount.h"
+#include "sip/sipaccount_config.h"
+#include "sip/sipcall.h"
+#include "../../test_runner.h"
+#include "jami.h"
+
+namespace jami {
+namespace test {
+
+/**
+ * Read-copy-update call indices: CallFactory (all calls) and CallSet (calls
+ * and conferences of an account).
+ */
+class CallSetTest : public CppUnit::TestFixture
+{
+public:
+    CallSetTest()
+    {
+        // Init daemon
+        libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+        if (not Manager::instance().initialized)
+            CPPUNIT_ASSERT(libjami::start("dring-sample.yml"));
+    }
+    ~CallSetTest() { libjami::fini(); }
+
+    static std::string name() { return "CallSet"; }
+    void setUp();
+    void tearDown();
+
+private:
+    void testFactoryIndex();
+    void testCallSet();
+    void testConferences();
+    void testConcurrentReaders();
+
+    CPPUNIT_TEST_SUITE(CallSetTest);
+    CPPUNIT_TEST(testFactoryIndex);
+    CPPUNIT_TEST(testCallSet);
+    CPPUNIT_TEST(testConferences);
+    CPPUNIT_TEST(testConcurrentReaders);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::shared_ptr<SIPCall> newCall();
+
+    std::mt19937_64 rand_ {42};
+    std::unique_ptr<CallFactory> factory_;
+    std::shared_ptr<SIPAccount> account_;
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(CallSetTest, CallSetTest::name());
+
+static constexpr auto ACCOUNT_ID = "callset";
+
+void
+CallSetTest::setUp()
+{
+    // Calls are only created, never started
+    auto account = Manager::instance().accountFactory.createAccount(SIPAccount::ACCOUNT_TYPE,
+                                                                    ACCOUNT_ID);
+    CPPUNIT_ASSERT(account);
+    auto config = std::make_unique<SipAccountConfig>(ACCOUNT_ID);
+    config->username = "callset";
+    account->setConfig(std::move(config));
+    account_ = std::dynamic_pointer_cast<SIPAccount>(account);
+    CPPUNIT_ASSERT(account_);
+    factory_ = std::make_unique<CallFactory>(rand_);
+}
+
+void
+CallSetTest::tearDown()
+{
+    factory_.reset();
+    account_.reset();
+    Manager::instance().accountFactory.removeAccount(ACCOUNT_ID);
+}
+
+std::shared_ptr<SIPCall>
+CallSetTest::newCall()
+{
+    auto call = factory_->newSipCall(account_, Call::CallType::OUTGOING, {});
+    CPPUNIT_ASSERT(call);
+    return call;
+}
+
+static bool
+isSortedUnique(const std::vector<std::string>& ids)
+{
+    return std::adjacent_find(ids.begin(), ids.end(), std::greater_equal<std::string>())
+           == ids.end();
+}
+
+void
+CallSetTest::testFactoryIndex()
+{
+    std::vector<std::shared_ptr<SIPCall>> calls;
+    std::set<std::string> expected;
+    for (int i = 0; i < 20; i++) {
+        calls.emplace_back(newCall());
+        expected.emplace(calls.back()->getCallId());
+    }
+
+    // Ids are returned sorted, whatever the order of the index
+    auto ids = factory_->getCallIDs();
+    CPPUNIT_ASSERT(ids == std::vector<std::string>(expected.begin(), expected.end()));
+    CPPUNIT_ASSERT(factory_->getCallIDs(Call::LinkType::SIP) == ids);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(20), factory_->callCount());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(20), factory_->callCount(Call::LinkType::SIP));
+    CPPUNIT_ASSERT(not factory_->empty(Call::LinkType::SIP));
+
+    std::size_t visited = 0;
+    factory_->forEachCall([&](const auto& call) {
+        CPPUNIT_ASSERT(expected.count(call->getCallId()));
+        visited++;
+    });
+    CPPUNIT_ASSERT_EQUAL(std::size_t(20), visited);
+    auto target = calls[7];
+    CPPUNIT_ASSERT(factory_->findCall([&](const auto& call) { return call == target; })
+                   == target);
+
+    // Removed calls leave the index and the per-link count
+    factory_->removeCall(target->getCallId());
+    CPPUNIT_ASSERT(not factory_->hasCall(target->getCallId()));
+    CPPUNIT_ASSERT(not factory_->getCall(target->getCallId(), Call::LinkType::SIP));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(19), factory_->callCount(Call::LinkType::SIP));
+    CPPUNIT_ASSERT(not factory_->findCall([&](const auto& call) { return call == target; }));
+
+    factory_->clear();
+    CPPUNIT_ASSERT(factory_->empty());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), factory_->callCount(Call::LinkType::SIP));
+}
+
+void
+CallSetTest::testCallSet()
+{
+    CallSet set;
+    std::vector<std::shared_ptr<SIPCall>> calls;
+    for (int i = 0; i < 10; i++) {
+        calls.emplace_back(newCall());
+        set.add(calls.back());
+    }
+    auto ids = set.getCallIds();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(10), ids.size());
+    CPPUNIT_ASSERT(isSortedUnique(ids));
+    for (const auto& call : calls)
+        CPPUNIT_ASSERT(set.getCall(call->getCallId()) == call);
+
+    // Calls are referenced weakly: released calls are skipped by iterations
+    auto released = calls.back()->getCallId();
+    calls.pop_back();
+    factory_->removeCall(released);
+    CPPUNIT_ASSERT(not set.getCall(released));
+    std::size_t visited = 0;
+    set.forEachCall([&](const auto&) { visited++; });
+    CPPUNIT_ASSERT_EQUAL(std::size_t(9), visited);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(9), set.getCalls().size());
+
+    CPPUNIT_ASSERT(set.remove(calls.front()));
+    CPPUNIT_ASSERT(not set.remove(calls.front()));
+    CPPUNIT_ASSERT(not set.getCall(calls.front()->getCallId()));
+}
+
+void
+CallSetTest::testConferences()
+{
+    CallSet set;
+    for (auto id : {"conf-c", "conf-a", "conf-d", "conf-b"})
+        set.add(std::make_shared<Conference>(account_, id, false));
+
+    auto ids = set.getConferenceIds();
+    CPPUNIT_ASSERT(ids == std::vector<std::string>({"conf-a", "conf-b", "conf-c", "conf-d"}));
+    CPPUNIT_ASSERT(set.getConference("conf-b"));
+
+    CPPUNIT_ASSERT(set.removeConference("conf-b"));
+    CPPUNIT_ASSERT(not set.removeConference("conf-b"));
+    CPPUNIT_ASSERT(not set.getConference("conf-b"));
+    CPPUNIT_ASSERT(set.getConferenceIds()
+                   == std::vector<std::string>({"conf-a", "conf-c", "conf-d"}));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(3), set.getConferences().size());
+}
+
+void
+CallSetTest::testConcurrentReaders()
+{
+    constexpr std::size_t CALLS = 32;
+    CallSet set;
+    std::vector<std::shared_ptr<SIPCall>> calls;
+    for (std::size_t i = 0; i < CALLS; i++)
+        calls.emplace_back(newCall());
+
+    // Readers never lock: each one must see a consistent snapshot while the set changes
+    std::atomic_bool stop {false};
+    std::atomic_bool consistent {true};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; r++) {
+        readers.emplace_back([&] {
+            while (not stop) {
+                auto ids = set.getCallIds();
+                if (ids.size() > CALLS or not isSortedUnique(ids))
+                    consistent = false;
+                std::size_t visited = 0;
+                set.forEachCall([&](const auto& call) {
+                    if (not call)
+                        consistent = false;
+                    visited++;
+                });
+                if (visited > CALLS)
+                    consistent = false;
+            }
+        });
+    }
+    for (int round = 0; round < 200; round++) {
+        for (const auto& call : calls)
+            set.add(call);
+        for (const auto& call : calls)
+            set.remove(call);
+    }
+    stop = true;
+    for (auto& reader : readers)
+        reader.join();
+
+    CPPUNIT_ASSERT(consistent);
+    CPPUNIT_ASSERT(set.getCallIds().empty());
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::CallSetTest::name())
@@ -106,6 +106,7 @@ private:
     void testBrokenParticipantAudioAndVideo();
     void testBrokenParticipantAudioOnly();
     void testRemoveConferenceInOneOne();
+    void testConfInfoDelta();
 
     CPPUNIT_TEST_SUITE(ConferenceTest);
     CPPUNIT_TEST(testGetConference);
@@ -129,6 +130,7 @@ private:
     CPPUNIT_TEST(testBrokenParticipantAudioAndVideo);
     CPPUNIT_TEST(testBrokenParticipantAudioOnly);
     CPPUNIT_TEST(testRemoveConferenceInOneOne);
+    CPPUNIT_TEST(testConfInfoDelta);
     CPPUNIT_TEST_SUITE_END();
 
     // Common parts
@@ -1006,6 +1008,54 @@ ConferenceTest::testRemoveConferenceInOneOne()
     libjami::unregisterSignalHandlers();
 }
 
+void
+ConferenceTest::testConfInfoDelta()
+{
+    ConfInfo previous;
+    previous.w = 1280;
+    previous.h = 720;
+    for (int i = 0; i < 25; i++) {
+        ParticipantInfo p;
+        p.uri = "uri" + std::to_string(i);
+        p.device = "device" + std::to_string(i);
+        p.sinkId = "sink" + std::to_string(i);
+        p.w = p.h = 100;
+        previous.emplace_back(std::move(p));
+    }
+
+    // A voice activity change only sends one participant
+    auto current = previous;
+    current[3].voiceActivity = true;
+    auto delta = current.toDeltaJson(previous);
+    CPPUNIT_ASSERT(delta.isObject());
+    CPPUNIT_ASSERT(delta["d"].size() == 1);
+    CPPUNIT_ASSERT(!delta.isMember("r"));
+    auto received = previous;
+    CPPUNIT_ASSERT(received.applyDelta(delta));
+    CPPUNIT_ASSERT(received == current);
+
+    // Added, removed participants and layout changes
+    current.erase(current.begin() + 7);
+    ParticipantInfo added;
+    added.uri = "newcomer";
+    added.device = "newdevice";
+    added.sinkId = "newsink";
+    current.emplace_back(added);
+    current.w = 1920;
+    current.h = 1080;
+    current.layout = 2;
+    delta = current.toDeltaJson(received);
+    CPPUNIT_ASSERT(delta["d"].size() == 1);
+    CPPUNIT_ASSERT(delta["r"].size() == 1);
+    CPPUNIT_ASSERT(received.applyDelta(delta));
+    CPPUNIT_ASSERT(received == current);
+    CPPUNIT_ASSERT(received.layout == 2);
+
+    // Participants that can't be identified need a snapshot
+    current.emplace_back(added);
+    CPPUNIT_ASSERT(current.toDeltaJson(received).isNull());
+}
+
 } // namespace test
 } // namespace jami
 
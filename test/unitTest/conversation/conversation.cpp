@@ -37,6 +37,7 @@
 #include "fileutils.h"
 #include "jami.h"
 #include "manager.h"
+#include "persistence.h"
 #include "connectivity/security/certstore.h"
 
 using namespace std::string_literals;
@@ -639,7 +640,8 @@ ConversationTest::testMergeTwoDifferentHeads()
 
     aliceAccount->convModule()->addConversationMember(convId, carlaUri, false);
 
-    // Cp conversations & convInfo
+    // Cp conversations & convInfo, once queued writes are on disk
+    Persistence::instance().flush();
     auto repoPathAlice = fileutils::get_data_dir() + DIR_SEPARATOR_STR
                          + aliceAccount->getAccountID() + DIR_SEPARATOR_STR + "conversations";
     auto repoPathCarla = fileutils::get_data_dir() + DIR_SEPARATOR_STR
@@ -724,7 +726,8 @@ ConversationTest::testMergeAfterMigration()
     aliceAccount->convModule()->addConversationMember(convId, carlaUri, false);
     CPPUNIT_ASSERT(cv.wait_for(lk, 60s, [&] { return !aliceGotMessage.empty(); }));
 
-    // Cp conversations & convInfo
+    // Cp conversations & convInfo, once queued writes are on disk
+    Persistence::instance().flush();
     auto repoPathAlice = fileutils::get_data_dir() + DIR_SEPARATOR_STR
                          + aliceAccount->getAccountID() + DIR_SEPARATOR_STR + "conversations";
     auto repoPathCarla = fileutils::get_data_dir() + DIR_SEPARATOR_STR
@@ -1664,13 +1667,13 @@ ConversationTest::createFakeConversation(std::shared_ptr<JamiAccount> account,
                      + DIR_SEPARATOR_STR + "conversations" + DIR_SEPARATOR_STR + commit_str;
     std::rename(repoPath.c_str(), finalRepo.c_str());
 
-    file = std::ofstream(fileutils::get_data_dir() + DIR_SEPARATOR_STR + account->getAccountID()
-                             + DIR_SEPARATOR_STR + "convInfo",
-                         std::ios::trunc | std::ios::binary);
-
+    // Queued after any pending write of the account, so it isn't overwritten
     std::vector<ConvInfoTest> test;
     test.emplace_back(ConvInfoTest {commit_str, std::time(nullptr), 0, 0});
-    msgpack::pack(file, test);
+    Persistence::instance().writePacked(fileutils::get_data_dir() + DIR_SEPARATOR_STR
+                                            + account->getAccountID() + DIR_SEPARATOR_STR
+                                            + "convInfo",
+                                        test);
 
     account->convModule()->loadConversations(); // necessary to load fake conv
 
@@ -0,0 +1,129 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#include "manager.h"
+#include "jamidht/conversation_module.h"
+#include "jamidht/jamiaccount.h"
+#include "../../test_runner.h"
+#include "jami.h"
+#include "fileutils.h"
+#include "common.h"
+
+using namespace std::literals::chrono_literals;
+
+namespace jami {
+namespace test {
+
+/**
+ * Startup benchmark: load an account with many conversations.
+ * The number of conversations can be set with JAMI_BENCH_CONVERSATIONS (default 1000).
+ */
+class ConversationLoadTest : public CppUnit::TestFixture
+{
+public:
+    ~ConversationLoadTest() { libjami::fini(); }
+    static std::string name() { return "ConversationLoad"; }
+    void setUp();
+    void tearDown();
+
+    std::string aliceId;
+    std::string bobId;
+
+private:
+    void testLoadConversations();
+
+    CPPUNIT_TEST_SUITE(ConversationLoadTest);
+    CPPUNIT_TEST(testLoadConversations);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(ConversationLoadTest, ConversationLoadTest::name());
+
+void
+ConversationLoadTest::setUp()
+{
+    // Init daemon
+    libjami::init(
+        libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+    if (not Manager::instance().initialized)
+        CPPUNIT_ASSERT(libjami::start("jami-sample.yml"));
+
+    auto actors = load_actors_and_wait_for_announcement("actors/alice-bob.yml");
+    aliceId = actors["alice"];
+    bobId = actors["bob"];
+}
+
+void
+ConversationLoadTest::tearDown()
+{
+    wait_for_removal_of({aliceId, bobId});
+}
+
+void
+ConversationLoadTest::testLoadConversations()
+{
+    std::size_t count = 1000;
+    if (auto env = std::getenv("JAMI_BENCH_CONVERSATIONS"))
+        count = std::strtoul(env, nullptr, 10);
+
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+    auto convModule = aliceAccount->convModule();
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; ++i) {
+        auto convId = convModule->startConversation();
+        // Some history, loading must not depend on it
+        convModule->sendMessage(convId, std::string("hi"));
+    }
+    JAMI_WARNING("Created {} conversations in {}",
+                 count,
+                 dht::print_duration(std::chrono::steady_clock::now() - start));
+
+    auto conversationsPath = fileutils::get_data_dir() + DIR_SEPARATOR_STR + aliceId
+                             + DIR_SEPARATOR_STR + "conversations";
+    auto load = [&] {
+        auto start = std::chrono::steady_clock::now();
+        convModule->loadConversations();
+        auto duration = std::chrono::steady_clock::now() - start;
+        CPPUNIT_ASSERT(convModule->getConversations().size() >= count);
+        return duration;
+    };
+
+    // Without snapshots, every repository is read
+    for (const auto& repository : fileutils::readDirectory(conversationsPath))
+        fileutils::remove(conversationsPath + DIR_SEPARATOR_STR + repository + DIR_SEPARATOR_STR
+                          + ".git" + DIR_SEPARATOR_STR + "conversation_metadata");
+    auto cold = load();
+    // Snapshots were rebuilt by the previous load
+    auto warm = load();
+    JAMI_WARNING("Loaded {} conversations: cold {}, warm {}",
+                 count,
+                 dht::print_duration(cold),
+                 dht::print_duration(warm));
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::ConversationLoadTest::name())
@@ -29,6 +29,7 @@
 #include <msgpack.hpp>
 
 #include "manager.h"
+#include "persistence.h"
 #include "../../test_runner.h"
 #include "jami.h"
 #include "base64.h"
@@ -1572,7 +1573,8 @@ ConversationMembersEventTest::testMemberJoinsNoBadFile()
     aliceAccount->convModule()->addConversationMember(convId, carlaUri, false);
     CPPUNIT_ASSERT(cv.wait_for(lk, 5s, [&] { return memberMessageGenerated; }));
 
-    // Cp conversations & convInfo
+    // Cp conversations & convInfo, once queued writes are on disk
+    Persistence::instance().flush();
     auto repoPathAlice = fileutils::get_data_dir() + DIR_SEPARATOR_STR
                          + aliceAccount->getAccountID() + DIR_SEPARATOR_STR + "conversations";
     auto repoPathCarla = fileutils::get_data_dir() + DIR_SEPARATOR_STR
@@ -1658,7 +1660,8 @@ ConversationMembersEventTest::testMemberAddedNoCertificate()
     aliceAccount->convModule()->addConversationMember(convId, carlaUri, false);
     CPPUNIT_ASSERT(cv.wait_for(lk, 5s, [&] { return memberMessageGenerated; }));
 
-    // Cp conversations & convInfo
+    // Cp conversations & convInfo, once queued writes are on disk
+    Persistence::instance().flush();
     auto repoPathAlice = fileutils::get_data_dir() + DIR_SEPARATOR_STR
                          + aliceAccount->getAccountID() + DIR_SEPARATOR_STR + "conversations";
     auto repoPathCarla = fileutils::get_data_dir() + DIR_SEPARATOR_STR
@@ -1754,7 +1757,8 @@ ConversationMembersEventTest::testMemberJoinsInviteRemoved()
     aliceAccount->convModule()->addConversationMember(convId, carlaUri, false);
     CPPUNIT_ASSERT(cv.wait_for(lk, 5s, [&] { return memberMessageGenerated; }));
 
-    // Cp conversations & convInfo
+    // Cp conversations & convInfo, once queued writes are on disk
+    Persistence::instance().flush();
     auto repoPathAlice = fileutils::get_data_dir() + DIR_SEPARATOR_STR
                          + aliceAccount->getAccountID() + DIR_SEPARATOR_STR + "conversations";
     auto repoPathCarla = fileutils::get_data_dir() + DIR_SEPARATOR_STR
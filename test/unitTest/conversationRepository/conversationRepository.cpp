@@ -78,6 +78,7 @@ private:
     // void testCloneHugeRepo();
 
     void testMergeProfileWithConflict();
+    void testMetadataSnapshot();
 
     std::string addCommit(git_repository* repo,
                           const std::shared_ptr<JamiAccount> account,
@@ -98,6 +99,7 @@ private:
     CPPUNIT_TEST(testFFMerge);
     CPPUNIT_TEST(testDiff);
     CPPUNIT_TEST(testMergeProfileWithConflict);
+    CPPUNIT_TEST(testMetadataSnapshot);
     // CPPUNIT_TEST(testCloneHugeRepo);
 
     CPPUNIT_TEST_SUITE_END();
@@ -763,6 +765,50 @@ ConversationRepositoryTest::testMergeProfileWithConflict()
     CPPUNIT_ASSERT(repository->log().size() == 5 /* Initial, add, modify 1, modify 2, merge */);
 }
 
+void
+ConversationRepositoryTest::testMetadataSnapshot()
+{
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+    auto bobUri = Manager::instance().getAccount<JamiAccount>(bobId)->getUsername();
+    auto repository = ConversationRepository::createConversation(aliceAccount->weak(),
+                                                                 ConversationMode::ONE_TO_ONE,
+                                                                 bobUri);
+    CPPUNIT_ASSERT(repository != nullptr);
+    auto repoPath = fileutils::get_data_dir() + DIR_SEPARATOR_STR + aliceAccount->getAccountID()
+                    + DIR_SEPARATOR_STR + "conversations" + DIR_SEPARATOR_STR + repository->id();
+    auto metadataPath = repoPath + DIR_SEPARATOR_STR + ".git" + DIR_SEPARATOR_STR
+                        + "conversation_metadata";
+    CPPUNIT_ASSERT(fileutils::isFile(metadataPath));
+
+    auto checkMembers = [&](const ConversationRepository& repo) {
+        CPPUNIT_ASSERT(repo.mode() == ConversationMode::ONE_TO_ONE);
+        auto members = repo.members();
+        CPPUNIT_ASSERT(members.size() == 2);
+        for (const auto& member : members) {
+            if (member.uri == aliceAccount->getUsername())
+                CPPUNIT_ASSERT(member.role == MemberRole::ADMIN);
+            else
+                CPPUNIT_ASSERT(member.uri == bobUri && member.role == MemberRole::INVITED);
+        }
+        CPPUNIT_ASSERT(repo.getInitialMembers().size() == 2);
+    };
+
+    // Loaded from the snapshot
+    checkMembers(ConversationRepository(aliceAccount->weak(), repository->id()));
+
+    // HEAD moved, members are rebuilt
+    repository->commitMessage("Commit 1");
+    checkMembers(ConversationRepository(aliceAccount->weak(), repository->id()));
+
+    // Corrupted snapshot is ignored and rewritten
+    {
+        std::ofstream file(metadataPath, std::ios::trunc | std::ios::binary);
+        file << "invalid";
+    }
+    checkMembers(ConversationRepository(aliceAccount->weak(), repository->id()));
+    CPPUNIT_ASSERT(fileutils::loadTextFile(metadataPath) != "invalid");
+}
+
 /*
 void
 ConversationRepositoryTest::testCloneHugeRepo()
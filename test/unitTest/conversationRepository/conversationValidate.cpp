@@ -0,0 +1,205 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <string>
+
+#include "manager.h"
+#include "jamidht/conversationrepository.h"
+#include "connectivity/connectionmanager.h"
+#include "jamidht/gitserver.h"
+#include "jamidht/jamiaccount.h"
+#include "../../test_runner.h"
+#include "jami.h"
+#include "fileutils.h"
+#include "common.h"
+#include "../conversation/conversationcommon.h"
+
+namespace jami {
+namespace test {
+
+/**
+ * Clone and validate benchmark: clone a conversation with a long history and validate it.
+ * The number of commits can be set with JAMI_BENCH_COMMITS (default 2000).
+ * Also checks that the parallel validation still rejects an invalid commit.
+ */
+class ConversationValidateTest : public CppUnit::TestFixture
+{
+public:
+    ConversationValidateTest()
+    {
+        // Init daemon
+        libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+        if (not Manager::instance().initialized)
+            CPPUNIT_ASSERT(libjami::start("jami-sample.yml"));
+    }
+    ~ConversationValidateTest() { libjami::fini(); }
+    static std::string name() { return "ConversationValidate"; }
+    void setUp();
+    void tearDown();
+
+    std::string aliceId;
+    std::string bobId;
+
+private:
+    void testCloneAndValidate();
+    void testCloneWithInvalidCommit();
+
+    CPPUNIT_TEST_SUITE(ConversationValidateTest);
+    CPPUNIT_TEST(testCloneAndValidate);
+    CPPUNIT_TEST(testCloneWithInvalidCommit);
+    CPPUNIT_TEST_SUITE_END();
+
+    /**
+     * Bob clones Alice's conversation
+     */
+    std::unique_ptr<ConversationRepository> cloneFromAlice(const std::string& convId);
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(ConversationValidateTest, ConversationValidateTest::name());
+
+void
+ConversationValidateTest::setUp()
+{
+    auto actors = load_actors_and_wait_for_announcement("actors/alice-bob.yml");
+    aliceId = actors["alice"];
+    bobId = actors["bob"];
+}
+
+void
+ConversationValidateTest::tearDown()
+{
+    wait_for_removal_of({aliceId, bobId});
+}
+
+std::unique_ptr<ConversationRepository>
+ConversationValidateTest::cloneFromAlice(const std::string& convId)
+{
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+    auto bobAccount = Manager::instance().getAccount<JamiAccount>(bobId);
+    auto aliceDeviceId = DeviceId(std::string(aliceAccount->currentDeviceId()));
+    auto bobDeviceId = DeviceId(std::string(bobAccount->currentDeviceId()));
+
+    bobAccount->connectionManager().onICERequest([](const DeviceId&) { return true; });
+    aliceAccount->connectionManager().onICERequest([](const DeviceId&) { return true; });
+
+    std::mutex mtx;
+    std::unique_lock<std::mutex> lk {mtx};
+    std::condition_variable cv;
+    bool receiverConnected = false;
+    bool successfullyConnected = false;
+    std::shared_ptr<ChannelSocket> channelSocket = nullptr;
+    std::shared_ptr<ChannelSocket> sendSocket = nullptr;
+
+    bobAccount->connectionManager().onChannelRequest(
+        [](const std::shared_ptr<dht::crypto::Certificate>&, const std::string&) { return true; });
+    aliceAccount->connectionManager().onChannelRequest(
+        [](const std::shared_ptr<dht::crypto::Certificate>&, const std::string&) { return true; });
+    bobAccount->connectionManager().onConnectionReady(
+        [&](const DeviceId&, const std::string& name, std::shared_ptr<ChannelSocket> socket) {
+            std::lock_guard<std::mutex> lk {mtx};
+            receiverConnected = socket && (name == "git://*");
+            channelSocket = socket;
+            cv.notify_one();
+        });
+    aliceAccount->connectionManager().connectDevice(bobDeviceId,
+                                                    "git://*",
+                                                    [&](std::shared_ptr<ChannelSocket> socket,
+                                                        const DeviceId&) {
+                                                        std::lock_guard<std::mutex> lk {mtx};
+                                                        successfullyConnected = socket != nullptr;
+                                                        sendSocket = socket;
+                                                        cv.notify_one();
+                                                    });
+    CPPUNIT_ASSERT(cv.wait_for(lk, std::chrono::seconds(10), [&] {
+        return receiverConnected && successfullyConnected;
+    }));
+    lk.unlock();
+
+    bobAccount->addGitSocket(aliceDeviceId, convId, channelSocket);
+    GitServer gs(aliceId, convId, sendSocket);
+    auto cloned = ConversationRepository::cloneConversation(bobAccount->weak(),
+                                                            aliceDeviceId.toString(),
+                                                            convId);
+    gs.stop();
+    return cloned;
+}
+
+void
+ConversationValidateTest::testCloneAndValidate()
+{
+    std::size_t count = 2000;
+    if (auto env = std::getenv("JAMI_BENCH_COMMITS"))
+        count = std::strtoul(env, nullptr, 10);
+
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+
+    auto repository = ConversationRepository::createConversation(aliceAccount->weak());
+    std::vector<std::string> messages(count);
+    for (std::size_t i = 0; i < count; ++i)
+        messages[i] = "Commit " + std::to_string(i);
+    repository->commitMessages(messages);
+
+    auto start = std::chrono::steady_clock::now();
+    auto cloned = cloneFromAlice(repository->id());
+    auto cloneDuration = std::chrono::steady_clock::now() - start;
+    CPPUNIT_ASSERT(cloned != nullptr);
+
+    // Cloning validates the history, validate again with certificates already parsed
+    start = std::chrono::steady_clock::now();
+    CPPUNIT_ASSERT(cloned->validClone());
+    auto validateDuration = std::chrono::steady_clock::now() - start;
+
+    JAMI_WARNING("Cloned and validated {} commits in {}, validated again in {}",
+                 count + 1,
+                 dht::print_duration(cloneDuration),
+                 dht::print_duration(validateDuration));
+}
+
+void
+ConversationValidateTest::testCloneWithInvalidCommit()
+{
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+
+    // An unexpected file in a text commit, between valid commits: the commits
+    // around it are validated concurrently, the clone must still be rejected
+    auto repository = ConversationRepository::createConversation(aliceAccount->weak());
+    std::vector<std::string> messages(100);
+    for (std::size_t i = 0; i < messages.size(); ++i)
+        messages[i] = "Commit " + std::to_string(i);
+    repository->commitMessages(messages);
+    addFile(aliceAccount, repository->id(), "BADFILE");
+    Json::Value root;
+    root["type"] = "text/plain";
+    root["body"] = "hi";
+    commit(aliceAccount, repository->id(), root);
+    repository->commitMessages(messages);
+
+    CPPUNIT_ASSERT(cloneFromAlice(repository->id()) == nullptr);
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::ConversationValidateTest::name())
@@ -20,7 +20,16 @@
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
+#include <cstring>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include "manager.h"
 #include "opendht/dhtrunner.h"
@@ -35,6 +44,77 @@ using namespace libjami::Account;
 namespace jami {
 namespace test {
 
+/**
+ * Local STUN server answering every binding request with the same mapped
+ * address, and counting the requests.
+ */
+class StunServerStandIn
+{
+public:
+    StunServerStandIn(const std::string& mappedAddr)
+    {
+        sock_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        CPPUNIT_ASSERT(::bind(sock_, (sockaddr*) &addr, sizeof(addr)) == 0);
+        socklen_t len = sizeof(addr);
+        ::getsockname(sock_, (sockaddr*) &addr, &len);
+        port_ = ntohs(addr.sin_port);
+        timeval timeout {0, 100000};
+        ::setsockopt(sock_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::inet_pton(AF_INET, mappedAddr.c_str(), &mapped_);
+        thread_ = std::thread([this] { run(); });
+    }
+    ~StunServerStandIn()
+    {
+        stop_ = true;
+        thread_.join();
+        ::close(sock_);
+    }
+
+    std::string uri() const { return "127.0.0.1:" + std::to_string(port_); }
+    int requests() const { return requests_; }
+
+private:
+    void run()
+    {
+        std::array<uint8_t, 1500> buf;
+        while (not stop_) {
+            sockaddr_in from {};
+            socklen_t len = sizeof(from);
+            auto n = ::recvfrom(sock_, buf.data(), buf.size(), 0, (sockaddr*) &from, &len);
+            // Binding requests only (type 0x0001)
+            if (n < 20 or buf[0] != 0x00 or buf[1] != 0x01)
+                continue;
+            ++requests_;
+            // Binding success response with a XOR-MAPPED-ADDRESS attribute
+            std::array<uint8_t, 32> res {};
+            res[0] = 0x01;
+            res[1] = 0x01;
+            res[3] = 12;
+            std::memcpy(&res[4], &buf[4], 16); // magic cookie and transaction id
+            res[21] = 0x20;
+            res[23] = 8;
+            res[25] = 0x01; // IPv4
+            uint16_t port = ntohs(from.sin_port) ^ 0x2112;
+            res[26] = port >> 8;
+            res[27] = port & 0xff;
+            auto mapped = reinterpret_cast<const uint8_t*>(&mapped_);
+            for (int i = 0; i < 4; i++)
+                res[28 + i] = mapped[i] ^ res[4 + i];
+            ::sendto(sock_, res.data(), res.size(), 0, (sockaddr*) &from, len);
+        }
+    }
+
+    int sock_ {-1};
+    uint16_t port_ {0};
+    in_addr mapped_ {};
+    std::atomic_bool stop_ {false};
+    std::atomic_int requests_ {0};
+    std::thread thread_;
+};
+
 class IceTest : public CppUnit::TestFixture
 {
 public:
@@ -60,6 +140,7 @@ private:
     void testTurnSlaveIceConnection();
     void testReceiveTooManyCandidates();
     void testCompleteOnFailure();
+    void testStunCache();
 
     CPPUNIT_TEST_SUITE(IceTest);
     CPPUNIT_TEST(testRawIceConnection);
@@ -67,6 +148,7 @@ private:
     CPPUNIT_TEST(testTurnSlaveIceConnection);
     CPPUNIT_TEST(testReceiveTooManyCandidates);
     CPPUNIT_TEST(testCompleteOnFailure);
+    CPPUNIT_TEST(testStunCache);
     CPPUNIT_TEST_SUITE_END();
 };
 
@@ -631,6 +713,47 @@ IceTest::testCompleteOnFailure()
     }));
 }
 
+void
+IceTest::testStunCache()
+{
+    static constexpr auto MAPPED_ADDR = "203.0.113.7";
+    StunServerStandIn stun(MAPPED_ADDR);
+    auto& factory = Manager::instance().getIceTransportFactory();
+    factory.publicAddresses().invalidate();
+
+    IceTransportOptions ice_config;
+    ice_config.stunServers.emplace_back(StunServerInfo().setUri(stun.uri()));
+    ice_config.accountLocalAddr = ip_utils::getLocalAddr(AF_INET);
+    ice_config.streamsCount = 1;
+    ice_config.compCountPerStream = 1;
+
+    auto createTransport = [&](const char* name) {
+        auto ice = factory.createTransport(name);
+        ice->initIceInstance(ice_config);
+        CPPUNIT_ASSERT(ice->waitForInitialization(std::chrono::seconds(10)));
+        bool srflx = false;
+        for (const auto& cand : ice->getLocalCandidates(1))
+            srflx |= cand.find(MAPPED_ADDR) != std::string::npos
+                     and cand.find("srflx") != std::string::npos;
+        CPPUNIT_ASSERT(srflx);
+    };
+
+    // The first transport asks the server
+    createTransport("first ICE");
+    auto requests = stun.requests();
+    CPPUNIT_ASSERT(requests > 0);
+
+    // Next ones reuse its answer
+    for (int i = 0; i < 4; i++)
+        createTransport("next ICE");
+    CPPUNIT_ASSERT_EQUAL(requests, stun.requests());
+
+    // Until the network changes
+    factory.publicAddresses().invalidate();
+    createTransport("last ICE");
+    CPPUNIT_ASSERT(stun.requests() > requests);
+}
+
 } // namespace test
 } // namespace jami
 
@@ -0,0 +1,370 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+#include "connectivity/network_cache.h"
+#include "scheduled_executor.h"
+#include "../../test_runner.h"
+
+using namespace std::literals::chrono_literals;
+
+namespace jami {
+namespace test {
+
+/**
+ * Source of public addresses (e.g. a DHT lookup): answers queries with the
+ * configured address after a delay, from its own thread.
+ */
+class AddressSource
+{
+public:
+    using Query = NetworkCache<std::string>::Query;
+
+    ~AddressSource()
+    {
+        for (auto& t : threads_)
+            t.join();
+    }
+
+    /** A source that never answers, e.g. a stopped DHT */
+    Query silentQuery()
+    {
+        return [this](auto&&) { ++requests; };
+    }
+
+    Query query(std::chrono::milliseconds delay = 50ms)
+    {
+        return [this, delay](auto&& done) {
+            ++requests;
+            std::lock_guard<std::mutex> lk(mtx_);
+            threads_.emplace_back(
+                [done = std::move(done), delay, address = address]() {
+                    std::this_thread::sleep_for(delay);
+                    if (address.empty())
+                        done(std::nullopt);
+                    else
+                        done(std::string(address));
+                });
+        };
+    }
+
+    std::string address {"203.0.113.1"};
+    std::atomic_int requests {0};
+
+private:
+    std::mutex mtx_;
+    std::vector<std::thread> threads_;
+};
+
+struct SchedulerHolder
+{
+    ScheduledExecutor scheduler {"network_cache"};
+};
+
+/**
+ * Cache with its own scheduler, stopped before the cache is destroyed
+ */
+class TestCache : SchedulerHolder, public NetworkCache<std::string>
+{
+public:
+    TestCache(clock::duration validity,
+              clock::duration staleValidity,
+              Executor&& executor = {},
+              clock::duration queryTimeout = 10s)
+        : NetworkCache(scheduler, validity, staleValidity, queryTimeout, std::move(executor))
+    {}
+    ~TestCache() { scheduler.stop(); }
+};
+
+class NetworkCacheTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "network_cache"; }
+
+private:
+    void testDeduplication();
+    void testStaleValue();
+    void testStaleExpiry();
+    void testInvalidate();
+    void testFailure();
+    void testTimeout();
+    void testLearntValues();
+
+    CPPUNIT_TEST_SUITE(NetworkCacheTest);
+    CPPUNIT_TEST(testDeduplication);
+    CPPUNIT_TEST(testStaleValue);
+    CPPUNIT_TEST(testStaleExpiry);
+    CPPUNIT_TEST(testInvalidate);
+    CPPUNIT_TEST(testFailure);
+    CPPUNIT_TEST(testTimeout);
+    CPPUNIT_TEST(testLearntValues);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(NetworkCacheTest, NetworkCacheTest::name());
+
+/**
+ * Collect the results given to callbacks
+ */
+struct Results
+{
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<std::optional<std::string>> values;
+
+    NetworkCache<std::string>::Callback callback()
+    {
+        return [this](const std::optional<std::string>& value) {
+            std::lock_guard<std::mutex> lk(mtx);
+            values.emplace_back(value);
+            cv.notify_all();
+        };
+    }
+
+    bool wait(size_t n)
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        return cv.wait_for(lk, 10s, [&] { return values.size() >= n; });
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        return values.size();
+    }
+};
+
+void
+NetworkCacheTest::testDeduplication()
+{
+    AddressSource source;
+    TestCache cache(10s, 1min);
+    Results results;
+
+    // Transports re-created at once after a network change
+    constexpr size_t N = 64;
+    std::vector<std::thread> transports;
+    for (size_t i = 0; i < N; ++i)
+        transports.emplace_back(
+            [&] { cache.get("dht:default", source.query(), results.callback()); });
+    for (auto& t : transports)
+        t.join();
+
+    CPPUNIT_ASSERT(results.wait(N));
+    CPPUNIT_ASSERT_EQUAL(1, source.requests.load());
+    for (const auto& value : results.values)
+        CPPUNIT_ASSERT(value and *value == source.address);
+
+    // Fresh value: served without query
+    cache.get("dht:default", source.query(), results.callback());
+    CPPUNIT_ASSERT_EQUAL(N + 1, results.size());
+    CPPUNIT_ASSERT_EQUAL(1, source.requests.load());
+    CPPUNIT_ASSERT_EQUAL((uint64_t) 1, cache.queries());
+
+    // Other keys are queried separately
+    cache.get("dht:wlan0", source.query(), results.callback());
+    CPPUNIT_ASSERT(results.wait(N + 2));
+    CPPUNIT_ASSERT_EQUAL(2, source.requests.load());
+}
+
+void
+NetworkCacheTest::testStaleValue()
+{
+    AddressSource source;
+    std::atomic_int posted {0};
+    TestCache cache(50ms, 1min, [&](std::function<void()>&& cb) {
+        ++posted;
+        cb();
+    });
+    Results results;
+
+    cache.get("dht:default", source.query(), results.callback());
+    CPPUNIT_ASSERT(results.wait(1));
+    CPPUNIT_ASSERT_EQUAL(0, posted.load());
+
+    // Expired: the old value is given right away through the executor, and refreshed
+    std::this_thread::sleep_for(100ms);
+    source.address = "203.0.113.2";
+    cache.get("dht:default", source.query(500ms), results.callback());
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, results.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("203.0.113.1"), *results.values[1]);
+    CPPUNIT_ASSERT_EQUAL(1, posted.load());
+    CPPUNIT_ASSERT_EQUAL(2, source.requests.load());
+
+    // Refresh in progress: not queried again
+    cache.get("dht:default", source.query(), results.callback());
+    CPPUNIT_ASSERT_EQUAL((size_t) 3, results.size());
+    CPPUNIT_ASSERT_EQUAL(2, source.requests.load());
+
+    for (int i = 0; i < 100 and *cache.cached("dht:default") != source.address; ++i)
+        std::this_thread::sleep_for(20ms);
+    CPPUNIT_ASSERT_EQUAL(source.address, *cache.cached("dht:default"));
+    CPPUNIT_ASSERT_EQUAL((size_t) 3, results.size());
+}
+
+void
+NetworkCacheTest::testStaleExpiry()
+{
+    AddressSource source;
+    TestCache cache(50ms, 100ms);
+    Results results;
+
+    cache.get("dht:default", source.query(), results.callback());
+    CPPUNIT_ASSERT(results.wait(1));
+
+    // Too old to be used: wait for the query
+    std::this_thread::sleep_for(150ms);
+    CPPUNIT_ASSERT(not cache.cached("dht:default"));
+    cache.get("dht:default", source.query(200ms), results.callback());
+    CPPUNIT_ASSERT_EQUAL((size_t) 1, results.size());
+    CPPUNIT_ASSERT(results.wait(2));
+    CPPUNIT_ASSERT_EQUAL(2, source.requests.load());
+}
+
+void
+NetworkCacheTest::testInvalidate()
+{
+    AddressSource source;
+    TestCache cache(10s, 1min);
+    Results results;
+
+    cache.get("dht:default", source.query(), results.callback());
+    CPPUNIT_ASSERT(results.wait(1));
+    CPPUNIT_ASSERT(cache.cached("dht:default"));
+    cache.invalidate();
+    CPPUNIT_ASSERT(not cache.cached("dht:default"));
+
+    // Network changes while a query is in flight: its answer is ignored
+    cache.get("dht:default", source.query(200ms), results.callback());
+    CPPUNIT_ASSERT_EQUAL(2, source.requests.load());
+    source.address = "198.51.100.1";
+    cache.invalidate();
+    CPPUNIT_ASSERT_EQUAL(3, source.requests.load());
+    CPPUNIT_ASSERT(results.wait(2));
+    std::this_thread::sleep_for(300ms);
+    CPPUNIT_ASSERT_EQUAL((size_t) 2, results.size());
+    CPPUNIT_ASSERT_EQUAL(source.address, *results.values[1]);
+    CPPUNIT_ASSERT_EQUAL(source.address, *cache.cached("dht:default"));
+}
+
+void
+NetworkCacheTest::testFailure()
+{
+    AddressSource source;
+    source.address.clear();
+    TestCache cache(10s, 1min);
+    Results results;
+
+    cache.get("dht:default", source.query(), results.callback());
+    cache.get("dht:default", source.query(), results.callback());
+    CPPUNIT_ASSERT(results.wait(2));
+    CPPUNIT_ASSERT(not results.values[0] and not results.values[1]);
+    CPPUNIT_ASSERT(not cache.cached("dht:default"));
+
+    // Failures aren't cached
+    source.address = "203.0.113.1";
+    cache.get("dht:default", source.query(), results.callback());
+    CPPUNIT_ASSERT(results.wait(3));
+    CPPUNIT_ASSERT_EQUAL(2, source.requests.load());
+    CPPUNIT_ASSERT_EQUAL(source.address, *results.values[2]);
+}
+
+void
+NetworkCacheTest::testTimeout()
+{
+    AddressSource source;
+    TestCache cache(10s, 1min, {}, 200ms);
+    Results results;
+
+    // The query never answers: waiters fail at the deadline
+    cache.get("dht:default", source.silentQuery(), results.callback());
+    cache.get("dht:default", source.silentQuery(), results.callback());
+    CPPUNIT_ASSERT_EQUAL(1, source.requests.load());
+    CPPUNIT_ASSERT(results.wait(2));
+    CPPUNIT_ASSERT(not results.values[0] and not results.values[1]);
+
+    // Later requests aren't blocked by the lost query
+    cache.get("dht:default", source.query(), results.callback());
+    CPPUNIT_ASSERT(results.wait(3));
+    CPPUNIT_ASSERT_EQUAL(2, source.requests.load());
+    CPPUNIT_ASSERT_EQUAL(source.address, *results.values[2]);
+
+    // An answer after the deadline is ignored
+    cache.invalidate();
+    cache.get("dht:default", source.query(500ms), results.callback());
+    CPPUNIT_ASSERT(results.wait(4));
+    CPPUNIT_ASSERT(not results.values[3]);
+    std::this_thread::sleep_for(500ms);
+    CPPUNIT_ASSERT_EQUAL((size_t) 4, results.size());
+    CPPUNIT_ASSERT(not cache.cached("dht:default"));
+}
+
+void
+NetworkCacheTest::testLearntValues()
+{
+    TestCache cache(50ms, 1min, {}, 200ms);
+    bool refresh = false;
+
+    // Without value, every caller learns it
+    CPPUNIT_ASSERT(not cache.lookup("stun:udp", refresh));
+    CPPUNIT_ASSERT(refresh);
+    refresh = false;
+    CPPUNIT_ASSERT(not cache.lookup("stun:udp", refresh));
+    CPPUNIT_ASSERT(refresh);
+
+    cache.put("stun:udp", "203.0.113.1");
+    CPPUNIT_ASSERT_EQUAL(std::string("203.0.113.1"), *cache.lookup("stun:udp", refresh));
+    CPPUNIT_ASSERT(not refresh);
+
+    // Expired: a single caller refreshes it...
+    std::this_thread::sleep_for(100ms);
+    CPPUNIT_ASSERT(cache.lookup("stun:udp", refresh));
+    CPPUNIT_ASSERT(refresh);
+    CPPUNIT_ASSERT(cache.lookup("stun:udp", refresh));
+    CPPUNIT_ASSERT(not refresh);
+
+    // ...or another one if it doesn't answer in time
+    std::this_thread::sleep_for(300ms);
+    CPPUNIT_ASSERT(cache.lookup("stun:udp", refresh));
+    CPPUNIT_ASSERT(refresh);
+    cache.put("stun:udp", "203.0.113.2");
+    CPPUNIT_ASSERT_EQUAL(std::string("203.0.113.2"), *cache.lookup("stun:udp", refresh));
+    CPPUNIT_ASSERT(not refresh);
+
+    // Queries waiting for a key are answered by put()
+    Results results;
+    AddressSource source;
+    cache.invalidate();
+    cache.get("stun:udp", source.silentQuery(), results.callback());
+    cache.put("stun:udp", "203.0.113.3");
+    CPPUNIT_ASSERT_EQUAL((size_t) 1, results.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("203.0.113.3"), *results.values[0]);
+    CPPUNIT_ASSERT_EQUAL((uint64_t) 3, cache.queries());
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::NetworkCacheTest::name())
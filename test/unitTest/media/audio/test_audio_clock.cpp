@@ -0,0 +1,176 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "audio/audio_clock.h"
+#include "audio/ringbuffer.h"
+#include "audio/ringbufferpool.h"
+#include "jami.h"
+#include "logger.h"
+#include "media_buffer.h"
+
+#include "../../../test_runner.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+
+namespace jami {
+namespace test {
+
+/**
+ * Audio clock ticks. Also benchmarks the CPU used to mix conferences of increasing
+ * size in one clock. The number of ticks per size can be set with
+ * JAMI_BENCH_AUDIO_CLOCK_TICKS (default 100, i.e. 2 s).
+ */
+class AudioClockTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "audio_clock"; }
+
+    void setUp();
+    void tearDown();
+
+private:
+    void testTick();
+    void testRemoveFromTick();
+    void testConferenceBenchmark();
+
+    CPPUNIT_TEST_SUITE(AudioClockTest);
+    CPPUNIT_TEST(testTick);
+    CPPUNIT_TEST(testRemoveFromTick);
+    CPPUNIT_TEST(testConferenceBenchmark);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(AudioClockTest, AudioClockTest::name());
+
+void
+AudioClockTest::setUp()
+{
+    libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+}
+
+void
+AudioClockTest::tearDown()
+{
+    libjami::fini();
+}
+
+void
+AudioClockTest::testTick()
+{
+    AudioClock clock(std::chrono::milliseconds(5));
+    std::atomic_int first {0}, second {0};
+    auto firstId = clock.add([&] { first++; });
+    clock.add([&] { second++; });
+    CPPUNIT_ASSERT_EQUAL(std::size_t(2), clock.size());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // Both subscribers are ticked in the same pass
+    CPPUNIT_ASSERT(first > 5);
+    CPPUNIT_ASSERT(std::abs(first - second) <= 1);
+
+    // Not called anymore once removed
+    clock.remove(firstId);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), clock.size());
+    auto count = first.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CPPUNIT_ASSERT_EQUAL(count, first.load());
+    CPPUNIT_ASSERT(second > count);
+}
+
+void
+AudioClockTest::testRemoveFromTick()
+{
+    AudioClock clock(std::chrono::milliseconds(5));
+    std::atomic_int ticks {0}, added {0};
+    std::atomic<AudioClock::Id> id {0};
+    std::atomic_bool done {false};
+    id = clock.add([&] {
+        // Replace itself by another subscriber
+        ticks++;
+        clock.remove(id);
+        clock.add([&] {
+            added++;
+            done = true;
+        });
+    });
+    for (int i = 0; i < 100 and not done; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    CPPUNIT_ASSERT(done);
+    CPPUNIT_ASSERT_EQUAL(1, ticks.load());
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), clock.size());
+}
+
+void
+AudioClockTest::testConferenceBenchmark()
+{
+    unsigned ticks = 100;
+    if (auto env = std::getenv("JAMI_BENCH_AUDIO_CLOCK_TICKS"))
+        ticks = std::strtoul(env, nullptr, 10);
+    const auto format = AudioFormat::STEREO();
+    const auto frameSize = format.sample_rate * AudioClock::PERIOD.count() / 1000;
+
+    for (unsigned participants : {1u, 10u, 30u}) {
+        RingBufferPool pool;
+        std::vector<std::string> ids;
+        std::vector<std::shared_ptr<RingBuffer>> buffers;
+        for (unsigned i = 0; i < participants; ++i) {
+            ids.emplace_back("participant" + std::to_string(i));
+            buffers.emplace_back(pool.createRingBuffer(ids.back()));
+        }
+        for (unsigned i = 0; i < participants; ++i)
+            for (unsigned j = i + 1; j < participants; ++j)
+                pool.bindCallID(ids[i], ids[j]);
+
+        // One subscriber per participant, as audio inputs: receive a frame, mix the others
+        AudioClock clock;
+        std::atomic<uint64_t> mixed {0};
+        for (unsigned i = 0; i < participants; ++i) {
+            clock.add([&, i] {
+                buffers[i]->put(std::make_shared<AudioFrame>(format, frameSize));
+                if (pool.getData(ids[i]))
+                    mixed++;
+            });
+        }
+
+        auto cpuStart = std::clock();
+        auto start = std::chrono::steady_clock::now();
+        while (clock.ticks() < ticks)
+            std::this_thread::sleep_for(AudioClock::PERIOD);
+        auto cpu = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        JAMI_WARNING("{} participants: {} ticks, {:.1f}% CPU, {} overruns, {} mixes",
+                     participants,
+                     clock.ticks(),
+                     wall > 0 ? 100. * cpu / wall : 0.,
+                     clock.overruns(),
+                     mixed.load());
+        CPPUNIT_ASSERT(mixed > 0 or participants == 1);
+    }
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::AudioClockTest::name())
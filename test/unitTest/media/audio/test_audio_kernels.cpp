@@ -0,0 +1,356 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "audio/audio_kernels.h"
+#include "audio/audiobuffer.h"
+#include "logger.h"
+
+#include "../../../test_runner.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace jami {
+namespace test {
+
+/**
+ * Every kernel supported by the CPU must give exactly the scalar results.
+ * Also benchmarks the kernels. The number of samples processed can be set with
+ * JAMI_BENCH_AUDIO_KERNELS_SAMPLES (default 48000000).
+ */
+class AudioKernelsTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "audio_kernels"; }
+
+private:
+    void testSupported();
+    void testRandom();
+    void testEdgeValues();
+    void testDcBlock();
+    void testAudioBuffer();
+    void testBenchmark();
+
+    /** Lengths covering empty buffers, vector tails and a 20 ms stereo frame */
+    static std::vector<std::size_t> lengths();
+    static void checkS16(const kernels::Kernels& k, const std::vector<int16_t>& a, const std::vector<int16_t>& b);
+    static void checkFloat(const kernels::Kernels& k, const std::vector<float>& a, const std::vector<float>& b);
+
+    CPPUNIT_TEST_SUITE(AudioKernelsTest);
+    CPPUNIT_TEST(testSupported);
+    CPPUNIT_TEST(testRandom);
+    CPPUNIT_TEST(testEdgeValues);
+    CPPUNIT_TEST(testDcBlock);
+    CPPUNIT_TEST(testAudioBuffer);
+    CPPUNIT_TEST(testBenchmark);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(AudioKernelsTest, AudioKernelsTest::name());
+
+std::vector<std::size_t>
+AudioKernelsTest::lengths()
+{
+    std::vector<std::size_t> l;
+    for (std::size_t n = 0; n <= 40; ++n)
+        l.emplace_back(n);
+    l.emplace_back(1920);
+    l.emplace_back(1923);
+    return l;
+}
+
+void
+AudioKernelsTest::checkS16(const kernels::Kernels& k,
+                           const std::vector<int16_t>& a,
+                           const std::vector<int16_t>& b)
+{
+    const auto& ref = kernels::scalar();
+    const auto n = std::min(a.size(), b.size());
+
+    auto out = a, expected = a;
+    k.mixS16(out.data(), b.data(), n);
+    ref.mixS16(expected.data(), b.data(), n);
+    CPPUNIT_ASSERT(out == expected);
+
+    for (float gain : {0.f, 0.5f, -1.f, 0.3333f, 3.7f}) {
+        out = a;
+        expected = a;
+        k.gainS16(out.data(), n, gain);
+        ref.gainS16(expected.data(), n, gain);
+        CPPUNIT_ASSERT(out == expected);
+    }
+
+    std::vector<float> f(n), fExpected(n);
+    k.s16ToFloat(f.data(), a.data(), n);
+    ref.s16ToFloat(fExpected.data(), a.data(), n);
+    CPPUNIT_ASSERT(std::memcmp(f.data(), fExpected.data(), n * sizeof(float)) == 0);
+
+    CPPUNIT_ASSERT_EQUAL(ref.sumSquaresS16(a.data(), n), k.sumSquaresS16(a.data(), n));
+
+    for (unsigned channels = 1; channels <= 3; ++channels) {
+        auto frames = n / channels;
+        std::vector<std::vector<int16_t>> planes(channels, std::vector<int16_t>(frames));
+        std::vector<std::vector<int16_t>> expectedPlanes = planes;
+        std::vector<int16_t*> p, pExpected;
+        for (unsigned c = 0; c < channels; ++c) {
+            p.emplace_back(planes[c].data());
+            pExpected.emplace_back(expectedPlanes[c].data());
+        }
+        k.deinterleaveS16(p.data(), a.data(), channels, frames);
+        ref.deinterleaveS16(pExpected.data(), a.data(), channels, frames);
+        CPPUNIT_ASSERT(planes == expectedPlanes);
+
+        std::vector<const int16_t*> in(p.begin(), p.end());
+        std::vector<int16_t> interleaved(frames * channels), expectedInterleaved(frames * channels);
+        k.interleaveS16(interleaved.data(), in.data(), channels, frames);
+        ref.interleaveS16(expectedInterleaved.data(), in.data(), channels, frames);
+        CPPUNIT_ASSERT(interleaved == expectedInterleaved);
+        // Round trip
+        CPPUNIT_ASSERT(std::equal(interleaved.begin(), interleaved.end(), a.begin()));
+    }
+}
+
+void
+AudioKernelsTest::checkFloat(const kernels::Kernels& k,
+                             const std::vector<float>& a,
+                             const std::vector<float>& b)
+{
+    const auto& ref = kernels::scalar();
+    const auto n = std::min(a.size(), b.size());
+
+    auto out = a, expected = a;
+    k.mixFloat(out.data(), b.data(), n);
+    ref.mixFloat(expected.data(), b.data(), n);
+    CPPUNIT_ASSERT(std::memcmp(out.data(), expected.data(), n * sizeof(float)) == 0);
+
+    std::vector<int16_t> s16(n), s16Expected(n);
+    k.floatToS16(s16.data(), a.data(), n);
+    ref.floatToS16(s16Expected.data(), a.data(), n);
+    CPPUNIT_ASSERT(s16 == s16Expected);
+}
+
+void
+AudioKernelsTest::testSupported()
+{
+    auto isas = kernels::supported();
+    CPPUNIT_ASSERT(not isas.empty());
+    CPPUNIT_ASSERT(isas.front() == kernels::Isa::SCALAR);
+    CPPUNIT_ASSERT(kernels::active().isa == isas.back());
+    for (auto isa : isas)
+        CPPUNIT_ASSERT(kernels::get(isa)->isa == isa);
+#if defined(__x86_64__) || defined(_M_X64)
+    CPPUNIT_ASSERT(kernels::get(kernels::Isa::SSE2));
+#endif
+    JAMI_WARNING("Audio kernels: {}", kernels::active().name);
+}
+
+void
+AudioKernelsTest::testRandom()
+{
+    std::mt19937 rd(42);
+    std::uniform_int_distribution<int> s16Dist(std::numeric_limits<int16_t>::min(),
+                                               std::numeric_limits<int16_t>::max());
+    std::uniform_real_distribution<float> floatDist(-1.5f, 1.5f);
+    for (auto isa : kernels::supported()) {
+        const auto& k = *kernels::get(isa);
+        for (auto n : lengths()) {
+            std::vector<int16_t> a(n), b(n);
+            std::vector<float> fa(n), fb(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                a[i] = s16Dist(rd);
+                b[i] = s16Dist(rd);
+                fa[i] = floatDist(rd);
+                fb[i] = floatDist(rd);
+            }
+            checkS16(k, a, b);
+            checkFloat(k, fa, fb);
+            auto sum = k.sumSquaresFloat(fa.data(), n);
+            auto expected = kernels::scalar().sumSquaresFloat(fa.data(), n);
+            CPPUNIT_ASSERT(std::memcmp(&sum, &expected, sizeof(sum)) == 0);
+        }
+    }
+}
+
+void
+AudioKernelsTest::testEdgeValues()
+{
+    constexpr auto min = std::numeric_limits<int16_t>::min();
+    constexpr auto max = std::numeric_limits<int16_t>::max();
+    constexpr auto inf = std::numeric_limits<float>::infinity();
+    constexpr auto nan = std::numeric_limits<float>::quiet_NaN();
+    const std::vector<int16_t> s16Values {min, max, -1, 0, 1, min + 1, max - 1};
+    const std::vector<float> floatValues {-inf, inf, nan, -1.f, 1.f, 0.f, -0.f, 0.99999f, -1.00001f,
+                                          1.f / 32768.f, -0.5f / 32768.f, 1e30f, -1e30f};
+
+    const auto& ref = kernels::scalar();
+    for (auto isa : kernels::supported()) {
+        const auto& k = *kernels::get(isa);
+        for (auto n : lengths()) {
+            std::vector<int16_t> a(n), b(n);
+            std::vector<float> fa(n), fb(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                a[i] = s16Values[i % s16Values.size()];
+                b[i] = s16Values[(i * 3) % s16Values.size()];
+                fa[i] = floatValues[i % floatValues.size()];
+                fb[i] = floatValues[(i * 5) % floatValues.size()];
+            }
+            checkS16(k, a, b);
+            checkFloat(k, fa, fb);
+            // Squares of extreme values, both halves of the 32 bit pairs set
+            std::vector<int16_t> extreme(n, min);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(n) * 32768 * 32768,
+                                 k.sumSquaresS16(extreme.data(), n));
+        }
+    }
+
+    // Saturation and NaN mapping of the scalar reference
+    int16_t mix[] {max, min, 100};
+    int16_t add[] {1, -1, -200};
+    ref.mixS16(mix, add, 3);
+    CPPUNIT_ASSERT_EQUAL(max, mix[0]);
+    CPPUNIT_ASSERT_EQUAL(min, mix[1]);
+    CPPUNIT_ASSERT_EQUAL(int16_t(-100), mix[2]);
+
+    float f[] {nan, inf, -inf, 1.f, -1.f, 0.5f};
+    int16_t s16[6];
+    ref.floatToS16(s16, f, 6);
+    CPPUNIT_ASSERT_EQUAL(min, s16[0]);
+    CPPUNIT_ASSERT_EQUAL(max, s16[1]);
+    CPPUNIT_ASSERT_EQUAL(min, s16[2]);
+    CPPUNIT_ASSERT_EQUAL(max, s16[3]);
+    CPPUNIT_ASSERT_EQUAL(min, s16[4]);
+    CPPUNIT_ASSERT_EQUAL(int16_t(16384), s16[5]);
+
+    int16_t gain[] {min, max, 3};
+    ref.gainS16(gain, 3, -1.f);
+    CPPUNIT_ASSERT_EQUAL(max, gain[0]);
+    CPPUNIT_ASSERT_EQUAL(int16_t(min + 1), gain[1]);
+    CPPUNIT_ASSERT_EQUAL(int16_t(-3), gain[2]);
+}
+
+void
+AudioKernelsTest::testDcBlock()
+{
+    // A constant offset is removed
+    std::vector<int16_t> in(48000, 1000), out(in.size());
+    kernels::DcBlockerState state;
+    kernels::dcBlockS16(out.data(), in.data(), in.size(), state);
+    CPPUNIT_ASSERT_EQUAL(int16_t(1000), out.front());
+    CPPUNIT_ASSERT(std::abs(out.back()) < 10);
+
+    // Processing in chunks gives the same result
+    std::vector<int16_t> chunked(in.size());
+    kernels::DcBlockerState chunkedState;
+    for (std::size_t i = 0; i < in.size(); i += 960)
+        kernels::dcBlockS16(chunked.data() + i, in.data() + i, 960, chunkedState);
+    CPPUNIT_ASSERT(chunked == out);
+
+    // Full scale steps saturate instead of wrapping
+    std::vector<int16_t> steps {std::numeric_limits<int16_t>::max(), std::numeric_limits<int16_t>::min()};
+    std::vector<int16_t> stepsOut(2);
+    kernels::DcBlockerState stepsState;
+    kernels::dcBlockS16(stepsOut.data(), steps.data(), 2, stepsState);
+    CPPUNIT_ASSERT_EQUAL(std::numeric_limits<int16_t>::min(), stepsOut[1]);
+}
+
+void
+AudioKernelsTest::testAudioBuffer()
+{
+    // Frame counts across float conversion blocks, channel counts above the kernel pointers
+    std::mt19937 rd(42);
+    std::uniform_int_distribution<int> dist(std::numeric_limits<int16_t>::min(),
+                                            std::numeric_limits<int16_t>::max());
+    for (unsigned channels : {1u, 2u, 6u, 8u, 11u}) {
+        for (std::size_t frames : {0, 1, 960, 1923}) {
+            std::vector<AudioSample> in(frames * channels);
+            for (auto& s : in)
+                s = dist(rd);
+            AudioBuffer buffer(in.data(), frames, AudioFormat(48000, channels));
+            CPPUNIT_ASSERT_EQUAL(frames, buffer.frames());
+            CPPUNIT_ASSERT(buffer.interleave() == in);
+
+            std::vector<float> f(in.size()), expected(in.size());
+            CPPUNIT_ASSERT_EQUAL(in.size(), buffer.interleaveFloat(f.data()));
+            kernels::scalar().s16ToFloat(expected.data(), in.data(), in.size());
+            CPPUNIT_ASSERT(std::memcmp(f.data(), expected.data(), f.size() * sizeof(float)) == 0);
+        }
+    }
+}
+
+void
+AudioKernelsTest::testBenchmark()
+{
+    std::size_t samples = 48000000;
+    if (auto env = std::getenv("JAMI_BENCH_AUDIO_KERNELS_SAMPLES"))
+        samples = std::strtoul(env, nullptr, 10);
+    // 20 ms of 48 kHz stereo, as processed per frame
+    constexpr std::size_t FRAME {1920};
+    const auto frames = std::max<std::size_t>(1, samples / FRAME);
+
+    std::mt19937 rd(42);
+    std::uniform_int_distribution<int> dist(-20000, 20000);
+    std::vector<int16_t> a(FRAME), b(FRAME);
+    for (std::size_t i = 0; i < FRAME; ++i) {
+        a[i] = dist(rd);
+        b[i] = dist(rd);
+    }
+    std::vector<float> f(FRAME);
+    std::vector<int16_t> left(FRAME / 2), right(FRAME / 2);
+    int16_t* planes[] {left.data(), right.data()};
+
+    auto measure = [&](auto&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < frames; ++i)
+            fn();
+        std::chrono::duration<double, std::nano> d = std::chrono::steady_clock::now() - start;
+        return d.count() / (frames * FRAME);
+    };
+
+    for (auto isa : kernels::supported()) {
+        const auto& k = *kernels::get(isa);
+        uint64_t sink = 0;
+        auto mix = measure([&] { k.mixS16(a.data(), b.data(), FRAME); });
+        auto gain = measure([&] { k.gainS16(a.data(), FRAME, 0.999f); });
+        auto toFloat = measure([&] { k.s16ToFloat(f.data(), a.data(), FRAME); });
+        auto toS16 = measure([&] { k.floatToS16(a.data(), f.data(), FRAME); });
+        auto deinterleave = measure([&] { k.deinterleaveS16(planes, a.data(), 2, FRAME / 2); });
+        auto rms = measure([&] { sink += k.sumSquaresS16(a.data(), FRAME); });
+        JAMI_WARNING("{}: mix {:.3f} ns/sample, gain {:.3f}, s16 to float {:.3f}, float to s16 "
+                     "{:.3f}, deinterleave {:.3f}, sum of squares {:.3f} ({})",
+                     k.name,
+                     mix,
+                     gain,
+                     toFloat,
+                     toS16,
+                     deinterleave,
+                     rms,
+                     sink % 2);
+    }
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::AudioKernelsTest::name())
@@ -0,0 +1,145 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "audio/encoded_audio_cache.h"
+#include "jami.h"
+#include "libav_deps.h"
+#include "media_buffer.h"
+
+#include "../../../test_runner.h"
+
+#include <algorithm>
+
+namespace jami {
+namespace test {
+
+class EncodedAudioCacheTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "encoded_audio_cache"; }
+
+private:
+    void testIdenticalFrames();
+    void testPeriods();
+    void testSpeakingToSilent();
+
+    std::shared_ptr<AudioFrame> makeFrame(int16_t value) const;
+    std::vector<libjami::PacketBuffer> makePackets() const;
+
+    CPPUNIT_TEST_SUITE(EncodedAudioCacheTest);
+    CPPUNIT_TEST(testIdenticalFrames);
+    CPPUNIT_TEST(testPeriods);
+    CPPUNIT_TEST(testSpeakingToSilent);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(EncodedAudioCacheTest, EncodedAudioCacheTest::name());
+
+std::shared_ptr<AudioFrame>
+EncodedAudioCacheTest::makeFrame(int16_t value) const
+{
+    auto frame = std::make_shared<AudioFrame>(AudioFormat::STEREO(), 960);
+    auto samples = reinterpret_cast<int16_t*>(frame->pointer()->data[0]);
+    std::fill(samples, samples + 960 * 2, value);
+    return frame;
+}
+
+std::vector<libjami::PacketBuffer>
+EncodedAudioCacheTest::makePackets() const
+{
+    std::vector<libjami::PacketBuffer> packets;
+    packets.emplace_back(av_packet_alloc());
+    CPPUNIT_ASSERT(av_new_packet(packets.back().get(), 80) == 0);
+    return packets;
+}
+
+void
+EncodedAudioCacheTest::testIdenticalFrames()
+{
+    EncodedAudioCache cache;
+    auto silence = makeFrame(0);
+    auto hash = EncodedAudioCache::hash(silence->pointer());
+    CPPUNIT_ASSERT(not cache.get("opus", 1, hash, hash, silence->pointer()));
+    cache.put("opus", 1, hash, hash, silence, 960, makePackets());
+
+    // Another frame with the same samples
+    auto other = makeFrame(0);
+    CPPUNIT_ASSERT_EQUAL(hash, EncodedAudioCache::hash(other->pointer()));
+    auto entry = cache.get("opus", 1, hash, hash, other->pointer());
+    CPPUNIT_ASSERT(entry);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), entry->packets.size());
+    CPPUNIT_ASSERT_EQUAL(int64_t(960), entry->pts);
+
+    // Different samples or encoder configuration
+    auto voice = makeFrame(1000);
+    CPPUNIT_ASSERT(not cache.get("opus",
+                                 1,
+                                 hash,
+                                 EncodedAudioCache::hash(voice->pointer()),
+                                 voice->pointer()));
+    CPPUNIT_ASSERT(not cache.get("opus/fec", 1, hash, hash, other->pointer()));
+}
+
+void
+EncodedAudioCacheTest::testPeriods()
+{
+    EncodedAudioCache cache;
+    auto frame = makeFrame(0);
+    auto hash = EncodedAudioCache::hash(frame->pointer());
+    cache.put("opus", 1, hash, hash, frame, 0, makePackets());
+    // Packets are only shared during their period
+    CPPUNIT_ASSERT(not cache.get("opus", 2, hash, hash, frame->pointer()));
+    cache.put("opus", 2, hash, hash, frame, 960, makePackets());
+    CPPUNIT_ASSERT(not cache.get("opus", 1, hash, hash, frame->pointer()));
+    CPPUNIT_ASSERT(cache.get("opus", 2, hash, hash, frame->pointer()));
+}
+
+void
+EncodedAudioCacheTest::testSpeakingToSilent()
+{
+    EncodedAudioCache cache;
+    auto silence = makeFrame(0);
+    auto voice = makeFrame(1000);
+    auto silent = EncodedAudioCache::hash(silence->pointer());
+    auto speaking = EncodedAudioCache::hash(voice->pointer());
+
+    // Period 1: Alice hears silence, Bob hears Carol speaking
+    cache.put("opus", 1, silent, silent, silence, 0, makePackets());
+
+    // Period 2: Carol stops, both hear silence. Alice's packets carry her previous
+    // silence: Bob, who heard voice, must encode his own
+    cache.put("opus", 2, silent, silent, silence, 960, makePackets());
+    CPPUNIT_ASSERT(not cache.get("opus", 2, speaking, silent, silence->pointer()));
+    cache.put("opus", 2, speaking, silent, silence, 960, makePackets());
+    CPPUNIT_ASSERT_EQUAL(int64_t(960),
+                         cache.get("opus", 2, speaking, silent, silence->pointer())->pts);
+
+    // Period 3: both heard silence during period 2, they share again
+    cache.put("opus", 3, silent, silent, silence, 1920, makePackets());
+    auto shared = cache.get("opus", 3, silent, silent, silence->pointer());
+    CPPUNIT_ASSERT(shared);
+    CPPUNIT_ASSERT_EQUAL(int64_t(1920), shared->pts);
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::EncodedAudioCacheTest::name())
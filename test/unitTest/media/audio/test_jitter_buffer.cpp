@@ -0,0 +1,214 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "audio/jitter_buffer.h"
+
+#include "../../../test_runner.h"
+
+#include <random>
+
+namespace jami {
+namespace test {
+
+using namespace std::literals;
+
+class JitterBufferTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "jitter_buffer"; }
+
+private:
+    void testInOrder();
+    void testReorder();
+    void testLoss();
+    void testAdaptiveDelay();
+    void testWrap();
+
+    static constexpr unsigned CLOCK_RATE {48000};
+    /** 20 ms packets */
+    static constexpr uint32_t PACKET_TS {960};
+
+    static std::vector<uint8_t> makePacket(uint16_t seq, uint32_t ts);
+    static uint16_t seqOf(const std::vector<uint8_t>& packet);
+
+    CPPUNIT_TEST_SUITE(JitterBufferTest);
+    CPPUNIT_TEST(testInOrder);
+    CPPUNIT_TEST(testReorder);
+    CPPUNIT_TEST(testLoss);
+    CPPUNIT_TEST(testAdaptiveDelay);
+    CPPUNIT_TEST(testWrap);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(JitterBufferTest, JitterBufferTest::name());
+
+std::vector<uint8_t>
+JitterBufferTest::makePacket(uint16_t seq, uint32_t ts)
+{
+    std::vector<uint8_t> packet(12 + 80);
+    packet[0] = 0x80;
+    packet[1] = 111;
+    packet[2] = seq >> 8;
+    packet[3] = seq & 0xff;
+    packet[4] = ts >> 24;
+    packet[5] = (ts >> 16) & 0xff;
+    packet[6] = (ts >> 8) & 0xff;
+    packet[7] = ts & 0xff;
+    return packet;
+}
+
+uint16_t
+JitterBufferTest::seqOf(const std::vector<uint8_t>& packet)
+{
+    return packet[2] << 8 | packet[3];
+}
+
+void
+JitterBufferTest::testInOrder()
+{
+    JitterBuffer jb(CLOCK_RATE);
+    auto t0 = JitterBuffer::clock::now();
+    std::vector<uint8_t> packet;
+    CPPUNIT_ASSERT(not jb.pop(packet, t0));
+    CPPUNIT_ASSERT(jb.nextPlayout() == JitterBuffer::clock::time_point::max());
+
+    for (uint16_t i = 0; i < 3; ++i) {
+        auto p = makePacket(100 + i, 5000 + i * PACKET_TS);
+        CPPUNIT_ASSERT(jb.push(p.data(), p.size(), t0 + i * 20ms));
+    }
+    CPPUNIT_ASSERT_EQUAL(std::size_t(3), jb.size());
+
+    // Held for the playout delay
+    CPPUNIT_ASSERT(jb.nextPlayout() == t0 + jb.delay());
+    CPPUNIT_ASSERT(not jb.pop(packet, t0 + jb.delay() - 1ms));
+    for (uint16_t i = 0; i < 3; ++i) {
+        CPPUNIT_ASSERT(jb.pop(packet, t0 + i * 20ms + jb.delay()));
+        CPPUNIT_ASSERT_EQUAL(uint16_t(100 + i), seqOf(packet));
+    }
+    CPPUNIT_ASSERT_EQUAL(uint64_t(3), jb.stats().released);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), jb.stats().concealed);
+
+    // Duplicates and invalid packets are dropped
+    auto p = makePacket(103, 5000 + 3 * PACKET_TS);
+    CPPUNIT_ASSERT(jb.push(p.data(), p.size(), t0 + 60ms));
+    CPPUNIT_ASSERT(not jb.push(p.data(), p.size(), t0 + 60ms));
+    CPPUNIT_ASSERT(not jb.push(p.data(), 8, t0 + 60ms));
+    CPPUNIT_ASSERT_EQUAL(uint64_t(2), jb.stats().dropped);
+}
+
+void
+JitterBufferTest::testReorder()
+{
+    JitterBuffer jb(CLOCK_RATE);
+    auto t0 = JitterBuffer::clock::now();
+    for (uint16_t i : {0, 2, 1, 4, 3}) {
+        auto p = makePacket(i, i * PACKET_TS);
+        CPPUNIT_ASSERT(jb.push(p.data(), p.size(), t0 + i * 20ms + 2ms));
+    }
+    std::vector<uint8_t> packet;
+    for (uint16_t i = 0; i < 5; ++i) {
+        CPPUNIT_ASSERT(jb.pop(packet, t0 + 200ms));
+        CPPUNIT_ASSERT_EQUAL(i, seqOf(packet));
+    }
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), jb.stats().concealed);
+}
+
+void
+JitterBufferTest::testLoss()
+{
+    JitterBuffer jb(CLOCK_RATE);
+    auto t0 = JitterBuffer::clock::now();
+    auto p0 = makePacket(0, 0);
+    auto p1 = makePacket(1, PACKET_TS);
+    auto p2 = makePacket(2, 2 * PACKET_TS);
+    jb.push(p0.data(), p0.size(), t0);
+    jb.push(p2.data(), p2.size(), t0 + 40ms);
+
+    std::vector<uint8_t> packet;
+    CPPUNIT_ASSERT(jb.pop(packet, t0 + jb.delay()));
+    CPPUNIT_ASSERT_EQUAL(uint16_t(0), seqOf(packet));
+    // The next packet is not held back waiting for the missing one
+    auto delay = jb.delay();
+    CPPUNIT_ASSERT(jb.pop(packet, t0 + 40ms + delay));
+    CPPUNIT_ASSERT_EQUAL(uint16_t(2), seqOf(packet));
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), jb.stats().concealed);
+
+    // Too late, and the delay grows to avoid it next time
+    CPPUNIT_ASSERT(not jb.push(p1.data(), p1.size(), t0 + 40ms + delay + 30ms));
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), jb.stats().late);
+    CPPUNIT_ASSERT(jb.delay() > delay);
+}
+
+void
+JitterBufferTest::testAdaptiveDelay()
+{
+    JitterBuffer jb(CLOCK_RATE);
+    auto t0 = JitterBuffer::clock::now();
+    std::mt19937 rand(42);
+    std::uniform_int_distribution<int> jitter(0, 30);
+    std::vector<uint8_t> packet;
+    uint16_t seq = 0;
+    auto run = [&](unsigned count, bool jittery) {
+        for (unsigned i = 0; i < count; ++i, ++seq) {
+            auto now = t0 + seq * 20ms;
+            auto p = makePacket(seq, seq * PACKET_TS);
+            jb.push(p.data(), p.size(), now + (jittery ? jitter(rand) * 1ms : 0ms));
+            while (jb.pop(packet, now)) {}
+        }
+    };
+
+    CPPUNIT_ASSERT(jb.delay() == JitterBuffer::MIN_DELAY);
+    run(500, true);
+    auto jitteryDelay = jb.delay();
+    CPPUNIT_ASSERT(jitteryDelay > JitterBuffer::MIN_DELAY);
+    CPPUNIT_ASSERT(jitteryDelay <= JitterBuffer::MAX_DELAY);
+    auto concealed = jb.stats().concealed;
+
+    // Stable network: back to the minimum delay, without losing packets
+    run(1000, false);
+    CPPUNIT_ASSERT(jb.delay() < jitteryDelay);
+    CPPUNIT_ASSERT(jb.delay() <= JitterBuffer::MIN_DELAY + 5ms);
+    CPPUNIT_ASSERT_EQUAL(concealed, jb.stats().concealed);
+}
+
+void
+JitterBufferTest::testWrap()
+{
+    JitterBuffer jb(CLOCK_RATE);
+    auto t0 = JitterBuffer::clock::now();
+    uint16_t seq = 65530;
+    uint32_t ts = 0xffffffff - 3 * PACKET_TS;
+    for (unsigned i = 0; i < 12; ++i) {
+        auto p = makePacket(seq + i, ts + i * PACKET_TS);
+        CPPUNIT_ASSERT(jb.push(p.data(), p.size(), t0 + i * 20ms));
+    }
+    std::vector<uint8_t> packet;
+    for (unsigned i = 0; i < 12; ++i) {
+        CPPUNIT_ASSERT(jb.pop(packet, t0 + i * 20ms + jb.delay()));
+        CPPUNIT_ASSERT_EQUAL(uint16_t(seq + i), seqOf(packet));
+    }
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), jb.stats().concealed);
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::JitterBufferTest::name())
@@ -22,7 +22,12 @@
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
 #include "jami.h"
+#include "logger.h"
 #include "videomanager_interface.h"
 #include "libav_deps.h"
 #include "audio/resampler.h"
@@ -42,11 +47,19 @@ private:
     void testAudioBuffer();
     void testAudioFrame();
     void testRematrix();
+    void testContextCache();
+    void testSwitchDropsBuffered();
+    void testBatch();
+    void testBatchBenchmark();
 
     CPPUNIT_TEST_SUITE(ResamplerTest);
     CPPUNIT_TEST(testAudioBuffer);
     CPPUNIT_TEST(testAudioFrame);
     CPPUNIT_TEST(testRematrix);
+    CPPUNIT_TEST(testContextCache);
+    CPPUNIT_TEST(testSwitchDropsBuffered);
+    CPPUNIT_TEST(testBatch);
+    CPPUNIT_TEST(testBatchBenchmark);
     CPPUNIT_TEST_SUITE_END();
 
     std::unique_ptr<Resampler> resampler_;
@@ -131,6 +144,124 @@ ResamplerTest::testRematrix()
     CPPUNIT_ASSERT(output2->pointer()->data && output2->pointer()->data[0]);
 }
 
+void
+ResamplerTest::testContextCache()
+{
+    resampler_.reset(new Resampler);
+    auto ringtone = std::make_shared<libjami::AudioFrame>(AudioFormat(44100, 2), 441);
+    auto call = std::make_shared<libjami::AudioFrame>(AudioFormat(16000, 1), 160);
+
+    // Alternating between two formats keeps both contexts
+    for (int i = 0; i < 10; ++i) {
+        auto out = resampler_->resample(std::shared_ptr<libjami::AudioFrame>(ringtone), AudioFormat::STEREO());
+        CPPUNIT_ASSERT(out && out->pointer()->data[0]);
+        out = resampler_->resample(std::shared_ptr<libjami::AudioFrame>(call), AudioFormat::STEREO());
+        CPPUNIT_ASSERT(out && out->pointer()->data[0]);
+    }
+    CPPUNIT_ASSERT_EQUAL(std::size_t(2), resampler_->contextCount());
+
+    // The cache is bounded
+    for (unsigned rate = 8000; rate < 8000 + 2 * Resampler::MAX_CONTEXTS * 1000; rate += 1000) {
+        auto in = std::make_shared<libjami::AudioFrame>(AudioFormat(rate, 1), rate / 100);
+        resampler_->resample(std::move(in), AudioFormat::STEREO());
+    }
+    CPPUNIT_ASSERT_EQUAL(Resampler::MAX_CONTEXTS, resampler_->contextCount());
+}
+
+static std::shared_ptr<libjami::AudioFrame>
+makeFrame(const AudioFormat& format, std::size_t samples, AudioSample value)
+{
+    auto frame = std::make_shared<libjami::AudioFrame>(format, samples);
+    auto data = reinterpret_cast<AudioSample*>(frame->pointer()->data[0]);
+    std::fill(data, data + samples * format.nb_channels, value);
+    return frame;
+}
+
+void
+ResamplerTest::testSwitchDropsBuffered()
+{
+    resampler_.reset(new Resampler);
+    AudioFormat ringtoneFormat(44100, 2);
+    AudioFormat callFormat(16000, 1);
+
+    // Leave samples of a loud ringtone buffered in its context
+    for (int i = 0; i < 5; ++i)
+        resampler_->resample(makeFrame(ringtoneFormat, 441, 10000), AudioFormat::STEREO());
+    resampler_->resample(makeFrame(callFormat, 160, 0), AudioFormat::STEREO());
+
+    // Switching back to the cached context must not replay them
+    auto out = resampler_->resample(makeFrame(ringtoneFormat, 441, 0), AudioFormat::STEREO());
+    CPPUNIT_ASSERT(out && out->pointer()->nb_samples > 0);
+    auto data = reinterpret_cast<const AudioSample*>(out->pointer()->data[0]);
+    auto samples = out->pointer()->nb_samples * out->pointer()->ch_layout.nb_channels;
+    CPPUNIT_ASSERT(std::all_of(data, data + samples, [](AudioSample s) { return s == 0; }));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(2), resampler_->contextCount());
+}
+
+void
+ResamplerTest::testBatch()
+{
+    resampler_.reset(new Resampler);
+    std::vector<std::shared_ptr<libjami::AudioFrame>> inputs {
+        std::make_shared<libjami::AudioFrame>(AudioFormat(16000, 1), 320),
+        std::make_shared<libjami::AudioFrame>(AudioFormat::STEREO(), 960),
+        nullptr,
+        std::make_shared<libjami::AudioFrame>(AudioFormat(44100, 6), 882),
+    };
+    std::vector<std::shared_ptr<libjami::AudioFrame>> outputs;
+    resampler_->resample(inputs, AudioFormat::STEREO(), outputs);
+
+    CPPUNIT_ASSERT_EQUAL(inputs.size(), outputs.size());
+    // Already in the output format: passed through
+    CPPUNIT_ASSERT(outputs[1] == inputs[1]);
+    CPPUNIT_ASSERT(not outputs[2]);
+    for (auto i : {0, 3}) {
+        CPPUNIT_ASSERT(outputs[i] && outputs[i]->pointer()->data[0]);
+        CPPUNIT_ASSERT(outputs[i]->getFormat() == AudioFormat::STEREO());
+    }
+    // One context per stream to resample
+    CPPUNIT_ASSERT_EQUAL(std::size_t(2), resampler_->contextCount());
+}
+
+/**
+ * Resample conference-like streams of mixed formats. The number of 20 ms frames per stream
+ * can be set with JAMI_BENCH_RESAMPLER_FRAMES (default 5000).
+ */
+void
+ResamplerTest::testBatchBenchmark()
+{
+    std::size_t count = 5000;
+    if (auto env = std::getenv("JAMI_BENCH_RESAMPLER_FRAMES"))
+        count = std::strtoul(env, nullptr, 10);
+
+    const std::vector<AudioFormat> formats {AudioFormat(8000, 1),
+                                            AudioFormat(16000, 1),
+                                            AudioFormat(44100, 2),
+                                            AudioFormat::STEREO(),
+                                            AudioFormat(32000, 2),
+                                            AudioFormat(44100, 6)};
+    std::vector<std::shared_ptr<libjami::AudioFrame>> inputs;
+    for (const auto& format : formats)
+        inputs.emplace_back(
+            std::make_shared<libjami::AudioFrame>(format, format.sample_rate / 50));
+
+    resampler_.reset(new Resampler);
+    std::vector<std::shared_ptr<libjami::AudioFrame>> outputs;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; ++i) {
+        resampler_->resample(inputs, AudioFormat::STEREO(), outputs);
+        CPPUNIT_ASSERT(outputs.back() && outputs.back()->pointer()->data[0]);
+    }
+    auto duration = std::chrono::steady_clock::now() - start;
+    CPPUNIT_ASSERT_EQUAL(formats.size() - 1, resampler_->contextCount());
+    JAMI_WARNING("Resampled {} frames of {} streams in {:.1f} ms ({:.2f} us/frame)",
+                 count,
+                 inputs.size(),
+                 std::chrono::duration<double, std::milli>(duration).count(),
+                 std::chrono::duration<double, std::micro>(duration).count()
+                     / std::max<std::size_t>(count * inputs.size(), 1));
+}
+
 }} // namespace jami::test
 
 RING_TEST_RUNNER(jami::test::ResamplerTest::name());
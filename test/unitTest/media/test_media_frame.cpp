@@ -28,9 +28,16 @@ extern "C" {
 }
 
 #include "audio/audiobuffer.h"
+#include "frame_pool.h"
+#include "metrics.h"
 #include "jami.h"
 #include "videomanager_interface.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "../../test_runner.h"
 
 namespace jami { namespace test {
@@ -45,10 +52,12 @@ public:
 private:
     void testCopy();
     void testMix();
+    void testPool();
 
     CPPUNIT_TEST_SUITE(MediaFrameTest);
     CPPUNIT_TEST(testCopy);
     CPPUNIT_TEST(testMix);
+    CPPUNIT_TEST(testPool);
     CPPUNIT_TEST_SUITE_END();
 };
 
@@ -120,6 +129,96 @@ MediaFrameTest::testMix()
     CPPUNIT_ASSERT(d2[6] == std::numeric_limits<AudioSample>::max());
 }
 
+void
+MediaFrameTest::testPool()
+{
+    auto& reused = metrics::counter("media.frame_pool.reused");
+
+    // Released buffers are reused by the next frame of the same size
+    const AudioFormat& format = AudioFormat::STEREO();
+    const int nbSamples = format.sample_rate / 50;
+    { libjami::AudioFrame warmup(format, nbSamples); }
+    auto before = reused.value();
+    for (int i = 0; i < 10; i++) {
+        libjami::AudioFrame a(format, nbSamples);
+        auto f = a.pointer();
+        CPPUNIT_ASSERT(av_frame_is_writable(f));
+        CPPUNIT_ASSERT(f->extended_data == f->data);
+        CPPUNIT_ASSERT(f->buf[0]->size >= int(nbSamples * format.getBytesPerFrame()));
+        auto d = reinterpret_cast<AudioSample*>(f->data[0]);
+        d[0] = 1;
+        d[nbSamples * format.nb_channels - 1] = -1;
+    }
+    CPPUNIT_ASSERT(reused.value() >= before + 10);
+
+    before = reused.value();
+    for (int i = 0; i < 10; i++) {
+        libjami::VideoFrame v;
+        v.reserve(AV_PIX_FMT_YUV420P, 641, 481);
+        auto f = v.pointer();
+        CPPUNIT_ASSERT(av_frame_is_writable(f));
+        for (int p = 0; p < 3; p++) {
+            CPPUNIT_ASSERT(f->data[p]);
+            CPPUNIT_ASSERT(f->linesize[p] % 32 == 0);
+            CPPUNIT_ASSERT(reinterpret_cast<uintptr_t>(f->data[p]) % 32 == 0);
+        }
+        f->data[2][f->linesize[2] * (f->height / 2) - 1] = 42;
+    }
+    CPPUNIT_ASSERT(reused.value() >= before + 9);
+
+    // Same layout as av_frame_get_buffer: height padded to 32 lines, padding between planes
+    {
+        libjami::VideoFrame v;
+        v.reserve(AV_PIX_FMT_YUV420P, 641, 481);
+        auto f = v.pointer();
+        const int paddedHeight = 512;
+        CPPUNIT_ASSERT(f->data[1] >= f->data[0] + f->linesize[0] * paddedHeight + 31);
+        CPPUNIT_ASSERT(f->data[2] >= f->data[1] + f->linesize[1] * paddedHeight / 2 + 31);
+        CPPUNIT_ASSERT(f->buf[0]->data + f->buf[0]->size
+                       >= f->data[2] + f->linesize[2] * paddedHeight / 2 + 31);
+    }
+
+    // Buffers kept by all threads together are bounded
+    auto& pooled = metrics::gauge("media.frame_pool.pooled_bytes");
+    constexpr unsigned THREADS = 32;
+    std::mutex mtx;
+    std::condition_variable cv;
+    unsigned released = 0;
+    bool done = false;
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < THREADS; t++) {
+        threads.emplace_back([&] {
+            {
+                std::vector<libjami::VideoFrame> frames(16);
+                for (auto& frame : frames)
+                    frame.reserve(AV_PIX_FMT_YUV420P, 640, 1080);
+            }
+            std::unique_lock<std::mutex> lk(mtx);
+            released++;
+            cv.notify_all();
+            cv.wait(lk, [&] { return done; });
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [&] { return released == THREADS; });
+        CPPUNIT_ASSERT(pooled.value() > 0);
+        CPPUNIT_ASSERT(pooled.value() <= 64 * 1024 * 1024);
+        done = true;
+        cv.notify_all();
+    }
+    for (auto& thread : threads)
+        thread.join();
+    CPPUNIT_ASSERT(pooled.value() <= 64 * 1024 * 1024);
+
+    // Releasing buffers keeps the frame geometry
+    libjami::VideoFrame v;
+    v.reserve(AV_PIX_FMT_NV12, 320, 240);
+    frame_pool::releaseBuffers(v.pointer());
+    CPPUNIT_ASSERT(not v.pointer()->buf[0]);
+    CPPUNIT_ASSERT(v.width() == 320 && v.height() == 240);
+}
+
 }} // namespace jami::test
 
 RING_TEST_RUNNER(jami::test::MediaFrameTest::name());
@@ -0,0 +1,263 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "jami.h"
+#include "videomanager_interface.h"
+#include "video/frame_cache.h"
+#include "metrics.h"
+
+extern "C" {
+#include <libavutil/display.h>
+#include <libavutil/frame.h>
+}
+
+#include <cstring>
+
+#include "../../../test_runner.h"
+
+namespace jami { namespace video { namespace test {
+
+class FrameCacheTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "frame_cache"; }
+
+    void setUp();
+    void tearDown();
+
+private:
+    void testHitMiss();
+    void testReleasedSource();
+    void testTranspose();
+    void testTransposeShared();
+    void testTransposeRescale();
+
+    CPPUNIT_TEST_SUITE(FrameCacheTest);
+    CPPUNIT_TEST(testHitMiss);
+    CPPUNIT_TEST(testReleasedSource);
+    CPPUNIT_TEST(testTranspose);
+    CPPUNIT_TEST(testTransposeShared);
+    CPPUNIT_TEST(testTransposeRescale);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(FrameCacheTest, FrameCacheTest::name());
+
+static constexpr int WIDTH = 320;
+static constexpr int HEIGHT = 240;
+
+/**
+ * Black YUV420P frame with a white top-left pixel, rotated by angle
+ */
+static std::shared_ptr<VideoFrame>
+makeFrame(int angle)
+{
+    auto frame = std::make_shared<VideoFrame>();
+    frame->reserve(AV_PIX_FMT_YUV420P, WIDTH, HEIGHT);
+    auto f = frame->pointer();
+    for (int y = 0; y < HEIGHT; y++)
+        std::memset(f->data[0] + y * f->linesize[0], 0, WIDTH);
+    for (int p = 1; p < 3; p++)
+        for (int y = 0; y < HEIGHT / 2; y++)
+            std::memset(f->data[p] + y * f->linesize[p], 128, WIDTH / 2);
+    f->data[0][0] = 255;
+    if (angle) {
+        auto side = av_frame_new_side_data(f, AV_FRAME_DATA_DISPLAYMATRIX, sizeof(int32_t) * 9);
+        av_display_rotation_set(reinterpret_cast<int32_t*>(side->data), -angle);
+    }
+    return frame;
+}
+
+static uint8_t
+luma(const VideoFrame& frame, int x, int y)
+{
+    auto f = frame.pointer();
+    return f->data[0][y * f->linesize[0] + x];
+}
+
+static std::shared_ptr<VideoFrame>
+copyFrame(const std::shared_ptr<VideoFrame>& frame)
+{
+    auto copy = std::make_shared<VideoFrame>();
+    copy->copyFrom(*frame);
+    return copy;
+}
+
+void
+FrameCacheTest::setUp()
+{
+    libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+}
+
+void
+FrameCacheTest::tearDown()
+{
+    libjami::fini();
+}
+
+void
+FrameCacheTest::testHitMiss()
+{
+    auto& cache = FrameCache::instance();
+    auto& hits = metrics::counter("video.frame_cache.hits");
+    auto& misses = metrics::counter("video.frame_cache.misses");
+    auto hits0 = hits.value();
+    auto misses0 = misses.value();
+
+    auto source = makeFrame(0);
+    unsigned computed = 0;
+    auto compute = [&] {
+        computed++;
+        return copyFrame(source);
+    };
+
+    // First consumer computes the variant, next ones share it
+    auto first = cache.get(source, "variant", compute);
+    auto second = cache.get(source, "variant", compute);
+    auto third = cache.get(source, "variant", compute);
+    CPPUNIT_ASSERT(first);
+    CPPUNIT_ASSERT(first == second);
+    CPPUNIT_ASSERT(first == third);
+    CPPUNIT_ASSERT_EQUAL(1u, computed);
+    CPPUNIT_ASSERT_EQUAL(misses0 + 1, misses.value());
+    CPPUNIT_ASSERT_EQUAL(hits0 + 2, hits.value());
+
+    // Another variant of the same frame
+    auto other = cache.get(source, "other", compute);
+    CPPUNIT_ASSERT(other != first);
+    CPPUNIT_ASSERT_EQUAL(2u, computed);
+
+    // The same variant of another frame
+    auto next = makeFrame(0);
+    CPPUNIT_ASSERT(cache.get(next, "variant", compute) != first);
+    CPPUNIT_ASSERT_EQUAL(3u, computed);
+    CPPUNIT_ASSERT_EQUAL(misses0 + 3, misses.value());
+    CPPUNIT_ASSERT_EQUAL(hits0 + 2, hits.value());
+
+    // Failures aren't cached
+    unsigned failed = 0;
+    auto fail = [&] {
+        failed++;
+        return std::shared_ptr<VideoFrame> {};
+    };
+    CPPUNIT_ASSERT(!cache.get(source, "failing", fail));
+    CPPUNIT_ASSERT(!cache.get(source, "failing", fail));
+    CPPUNIT_ASSERT_EQUAL(2u, failed);
+}
+
+void
+FrameCacheTest::testReleasedSource()
+{
+    auto& cache = FrameCache::instance();
+    std::weak_ptr<VideoFrame> weakVariant;
+    unsigned computed = 0;
+    {
+        auto source = makeFrame(0);
+        auto variant = cache.get(source, "variant", [&] {
+            computed++;
+            return copyFrame(source);
+        });
+        weakVariant = variant;
+    }
+    // Variants are released with their source, even if not evicted yet
+    auto source = makeFrame(0);
+    auto variant = cache.get(source, "variant", [&] {
+        computed++;
+        return copyFrame(source);
+    });
+    CPPUNIT_ASSERT_EQUAL(2u, computed);
+    CPPUNIT_ASSERT(weakVariant.expired());
+}
+
+void
+FrameCacheTest::testTranspose()
+{
+    // Expected position of the top-left pixel once the frame is upright
+    struct Case
+    {
+        int angle;
+        int width;
+        int height;
+        int x;
+        int y;
+    };
+    for (const auto& c : {Case {90, HEIGHT, WIDTH, 0, WIDTH - 1},
+                          Case {180, WIDTH, HEIGHT, WIDTH - 1, HEIGHT - 1},
+                          Case {-90, HEIGHT, WIDTH, HEIGHT - 1, 0},
+                          Case {270, HEIGHT, WIDTH, HEIGHT - 1, 0}}) {
+        FrameTransposer transposer;
+        auto frame = makeFrame(c.angle);
+        auto rotated = transposer.transpose(frame);
+        CPPUNIT_ASSERT(rotated != frame);
+        CPPUNIT_ASSERT_EQUAL(c.width, rotated->width());
+        CPPUNIT_ASSERT_EQUAL(c.height, rotated->height());
+        CPPUNIT_ASSERT(luma(*rotated, c.x, c.y) > 200);
+        CPPUNIT_ASSERT(luma(*rotated, 0, 0) < 50 or (c.x == 0 and c.y == 0));
+    }
+
+    // Upright frames are returned as is
+    FrameTransposer transposer;
+    auto frame = makeFrame(0);
+    CPPUNIT_ASSERT(transposer.transpose(frame) == frame);
+}
+
+void
+FrameCacheTest::testTransposeShared()
+{
+    auto& misses = metrics::counter("video.frame_cache.misses");
+    FrameTransposer mixer, sink, recorder;
+
+    for (int i = 0; i < 3; i++) {
+        auto frame = makeFrame(90);
+        auto misses0 = misses.value();
+        // Only the first consumer runs its filter
+        auto rotated = mixer.transpose(frame);
+        CPPUNIT_ASSERT(sink.transpose(frame) == rotated);
+        CPPUNIT_ASSERT(recorder.transpose(frame) == rotated);
+        CPPUNIT_ASSERT_EQUAL(misses0 + 1, misses.value());
+    }
+
+    // Consumers switch orientation with the stream
+    auto frame = makeFrame(180);
+    auto rotated = sink.transpose(frame);
+    CPPUNIT_ASSERT_EQUAL(WIDTH, rotated->width());
+    CPPUNIT_ASSERT(mixer.transpose(frame) == rotated);
+}
+
+void
+FrameCacheTest::testTransposeRescale()
+{
+    FrameTransposer rescaled(true);
+    FrameTransposer plain;
+    auto frame = makeFrame(90);
+
+    // Rescaled rotations are distinct variants, padded to the original size
+    auto padded = rescaled.transpose(frame);
+    auto rotated = plain.transpose(frame);
+    CPPUNIT_ASSERT(padded != rotated);
+    CPPUNIT_ASSERT_EQUAL(WIDTH, padded->width());
+    CPPUNIT_ASSERT_EQUAL(HEIGHT, padded->height());
+    CPPUNIT_ASSERT_EQUAL(HEIGHT, rotated->width());
+    CPPUNIT_ASSERT_EQUAL(WIDTH, rotated->height());
+}
+
+}}} // namespace jami::test
+
+RING_TEST_RUNNER(jami::video::test::FrameCacheTest::name());
@@ -0,0 +1,282 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "jami.h"
+#include "logger.h"
+#include "videomanager_interface.h"
+#include "video/video_compositor.h"
+#include "libav_utils.h"
+
+#ifdef RING_ACCEL
+#include "video/accel.h"
+extern "C" {
+#include <libavutil/hwcontext.h>
+}
+#endif
+
+#include "../../../test_runner.h"
+
+#include <opendht/utils.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace jami { namespace video { namespace test {
+
+/**
+ * Also benchmarks the composition of four hardware decoded 720p inputs: downloaded
+ * and composed in software, as without hardware compositing, against composed on the
+ * GPU. The hardware part needs a VAAPI device and is skipped otherwise. The number of
+ * frames can be set with JAMI_BENCH_VIDEO_COMPOSITOR_FRAMES (default 300).
+ */
+class VideoCompositorTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "video_compositor"; }
+
+    void setUp();
+    void tearDown();
+
+private:
+    void testSoftware();
+    void testHardwareEligibility();
+    void testAspectRatio();
+    void testBenchmark();
+
+    CPPUNIT_TEST_SUITE(VideoCompositorTest);
+    CPPUNIT_TEST(testSoftware);
+    CPPUNIT_TEST(testHardwareEligibility);
+    CPPUNIT_TEST(testAspectRatio);
+    CPPUNIT_TEST(testBenchmark);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(VideoCompositorTest, VideoCompositorTest::name());
+
+void
+VideoCompositorTest::setUp()
+{
+    libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+}
+
+void
+VideoCompositorTest::tearDown()
+{
+    libjami::fini();
+}
+
+/** Frame of uniform luma */
+static std::shared_ptr<VideoFrame>
+makeFrame(int width, int height, uint8_t luma, AVPixelFormat format = AV_PIX_FMT_YUV420P)
+{
+    auto frame = std::make_shared<VideoFrame>();
+    frame->reserve(format, width, height);
+    libav_utils::fillWithBlack(frame->pointer());
+    auto f = frame->pointer();
+    for (int y = 0; y < height; ++y)
+        std::memset(f->data[0] + y * f->linesize[0], luma, width);
+    return frame;
+}
+
+static uint8_t
+lumaAt(const VideoFrame& frame, int x, int y)
+{
+    auto f = frame.pointer();
+    return f->data[0][y * f->linesize[0] + x];
+}
+
+void
+VideoCompositorTest::testSoftware()
+{
+    VideoCompositor compositor;
+    auto output = makeFrame(320, 240, 16);
+    std::vector<VideoCompositor::Input> inputs {{makeFrame(160, 120, 100), 0, 0, 160, 120},
+                                                {makeFrame(640, 480, 200), 160, 120, 160, 120}};
+    compositor.composeInSoftware(inputs, *output);
+
+    // Each input is scaled into its cell, the rest is left untouched
+    CPPUNIT_ASSERT_EQUAL(100, (int) lumaAt(*output, 80, 60));
+    CPPUNIT_ASSERT_EQUAL(200, (int) lumaAt(*output, 240, 180));
+    CPPUNIT_ASSERT_EQUAL(16, (int) lumaAt(*output, 240, 60));
+    CPPUNIT_ASSERT_EQUAL(16, (int) lumaAt(*output, 80, 180));
+}
+
+void
+VideoCompositorTest::testHardwareEligibility()
+{
+    VideoCompositor compositor;
+    // Software frames always go through the software path
+    std::vector<VideoCompositor::Input> inputs {{makeFrame(160, 120, 100), 0, 0, 160, 120}};
+    CPPUNIT_ASSERT(not compositor.canComposeInHardware(inputs));
+    CPPUNIT_ASSERT(not compositor.composeInHardware(inputs, 320, 240));
+    CPPUNIT_ASSERT(not compositor.canComposeInHardware({}));
+}
+
+void
+VideoCompositorTest::testAspectRatio()
+{
+    // A 16:9 input in a 4:3 cell is letterboxed, centered
+    VideoCompositor compositor;
+    auto output = makeFrame(320, 240, 16);
+    std::vector<VideoCompositor::Input> letterboxed {{makeFrame(640, 360, 200), 0, 0, 320, 240}};
+    compositor.composeInSoftware(letterboxed, *output);
+    CPPUNIT_ASSERT_EQUAL(16, (int) lumaAt(*output, 160, 10));
+    CPPUNIT_ASSERT_EQUAL(200, (int) lumaAt(*output, 160, 120));
+    CPPUNIT_ASSERT_EQUAL(16, (int) lumaAt(*output, 160, 230));
+
+#ifdef RING_ACCEL
+    AVBufferRef* device = nullptr;
+    if (not VideoCompositor::hardwareSupported()
+        or av_hwdevice_ctx_create(&device, AV_HWDEVICE_TYPE_VAAPI, nullptr, nullptr, 0) < 0) {
+        JAMI_WARNING("No VAAPI device or filters, hardware padding not tested");
+        return;
+    }
+    // A 4:3 input in a 16:9 composition is pillarboxed, centered
+    constexpr int WIDTH {1280};
+    constexpr int HEIGHT {720};
+    auto framesRef = av_hwframe_ctx_alloc(device);
+    auto framesCtx = reinterpret_cast<AVHWFramesContext*>(framesRef->data);
+    framesCtx->format = AV_PIX_FMT_VAAPI;
+    framesCtx->sw_format = AV_PIX_FMT_NV12;
+    framesCtx->width = 640;
+    framesCtx->height = 480;
+    framesCtx->initial_pool_size = 1;
+    CPPUNIT_ASSERT(av_hwframe_ctx_init(framesRef) >= 0);
+    auto input = std::make_shared<VideoFrame>();
+    CPPUNIT_ASSERT(av_hwframe_get_buffer(framesRef, input->pointer(), 0) >= 0);
+    auto uploaded = makeFrame(640, 480, 200, AV_PIX_FMT_NV12);
+    CPPUNIT_ASSERT(av_hwframe_transfer_data(input->pointer(), uploaded->pointer(), 0) >= 0);
+
+    std::vector<VideoCompositor::Input> inputs {{input, 0, 0, WIDTH, HEIGHT}};
+    // The filters may hold the first frame
+    std::shared_ptr<VideoFrame> composed;
+    for (int i = 0; i < 2 and not composed; ++i)
+        composed = compositor.composeInHardware(inputs, WIDTH, HEIGHT);
+    CPPUNIT_ASSERT(composed);
+    auto result = HardwareAccel::transferToMainMemory(*composed, AV_PIX_FMT_NV12);
+    // The input is 960 pixels wide, from 160 to 1120
+    CPPUNIT_ASSERT_EQUAL(16, (int) lumaAt(*result, 80, HEIGHT / 2));
+    CPPUNIT_ASSERT_EQUAL(200, (int) lumaAt(*result, 200, HEIGHT / 2));
+    CPPUNIT_ASSERT_EQUAL(200, (int) lumaAt(*result, WIDTH / 2, HEIGHT / 2));
+    CPPUNIT_ASSERT_EQUAL(200, (int) lumaAt(*result, 1080, HEIGHT / 2));
+    CPPUNIT_ASSERT_EQUAL(16, (int) lumaAt(*result, 1200, HEIGHT / 2));
+
+    av_buffer_unref(&framesRef);
+    av_buffer_unref(&device);
+#endif
+}
+
+void
+VideoCompositorTest::testBenchmark()
+{
+    std::size_t frames = 300;
+    if (auto env = std::getenv("JAMI_BENCH_VIDEO_COMPOSITOR_FRAMES"))
+        frames = std::strtoul(env, nullptr, 10);
+    constexpr int WIDTH {1280};
+    constexpr int HEIGHT {720};
+    // A 2x2 grid
+    std::vector<VideoCompositor::Input> inputs;
+    for (int i = 0; i < 4; ++i)
+        inputs.push_back({makeFrame(WIDTH, HEIGHT, 50 * (i + 1), AV_PIX_FMT_NV12),
+                          (i % 2) * WIDTH / 2,
+                          (i / 2) * HEIGHT / 2,
+                          WIDTH / 2,
+                          HEIGHT / 2});
+
+    VideoCompositor compositor;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < frames; ++i) {
+        auto output = makeFrame(WIDTH, HEIGHT, 16);
+        compositor.composeInSoftware(inputs, *output);
+    }
+    auto software = std::chrono::steady_clock::now() - start;
+    JAMI_WARNING("{} frames of {} inputs composed in software in {}",
+                 frames,
+                 inputs.size(),
+                 dht::print_duration(software));
+
+#ifdef RING_ACCEL
+    AVBufferRef* device = nullptr;
+    if (not VideoCompositor::hardwareSupported()
+        or av_hwdevice_ctx_create(&device, AV_HWDEVICE_TYPE_VAAPI, nullptr, nullptr, 0) < 0) {
+        JAMI_WARNING("No VAAPI device or filters, hardware compositing not benchmarked");
+        return;
+    }
+    // Decoded frames in GPU memory
+    auto framesRef = av_hwframe_ctx_alloc(device);
+    auto framesCtx = reinterpret_cast<AVHWFramesContext*>(framesRef->data);
+    framesCtx->format = AV_PIX_FMT_VAAPI;
+    framesCtx->sw_format = AV_PIX_FMT_NV12;
+    framesCtx->width = WIDTH;
+    framesCtx->height = HEIGHT;
+    framesCtx->initial_pool_size = inputs.size();
+    CPPUNIT_ASSERT(av_hwframe_ctx_init(framesRef) >= 0);
+    std::vector<VideoCompositor::Input> hwInputs = inputs;
+    for (auto& input : hwInputs) {
+        auto frame = std::make_shared<VideoFrame>();
+        CPPUNIT_ASSERT(av_hwframe_get_buffer(framesRef, frame->pointer(), 0) >= 0);
+        CPPUNIT_ASSERT(av_hwframe_transfer_data(frame->pointer(), input.frame->pointer(), 0) >= 0);
+        input.frame = frame;
+    }
+    CPPUNIT_ASSERT(compositor.canComposeInHardware(hwInputs));
+
+    // Downloaded for every frame, then composed in software
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < frames; ++i) {
+        std::vector<VideoCompositor::Input> downloaded = hwInputs;
+        for (auto& input : downloaded)
+            input.frame = HardwareAccel::transferToMainMemory(*input.frame, AV_PIX_FMT_NV12);
+        auto output = makeFrame(WIDTH, HEIGHT, 16);
+        compositor.composeInSoftware(downloaded, *output);
+    }
+    auto download = std::chrono::steady_clock::now() - start;
+
+    std::size_t composed = 0;
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < frames; ++i)
+        if (auto output = compositor.composeInHardware(hwInputs, WIDTH, HEIGHT)) {
+            CPPUNIT_ASSERT_EQUAL((int) AV_PIX_FMT_VAAPI, output->format());
+            ++composed;
+        }
+    auto hardware = std::chrono::steady_clock::now() - start;
+    // The filters may hold the first frame
+    CPPUNIT_ASSERT(composed + 1 >= frames);
+
+    // The composition is the same as in software
+    auto output = compositor.composeInHardware(hwInputs, WIDTH, HEIGHT);
+    CPPUNIT_ASSERT(output);
+    auto result = HardwareAccel::transferToMainMemory(*output, AV_PIX_FMT_NV12);
+    CPPUNIT_ASSERT_EQUAL(50, (int) lumaAt(*result, WIDTH / 4, HEIGHT / 4));
+    CPPUNIT_ASSERT_EQUAL(200, (int) lumaAt(*result, 3 * WIDTH / 4, 3 * HEIGHT / 4));
+
+    av_buffer_unref(&framesRef);
+    av_buffer_unref(&device);
+    JAMI_WARNING("{} frames of {} hardware inputs: {} downloaded and composed in software, {} "
+                 "composed on the GPU",
+                 frames,
+                 hwInputs.size(),
+                 dht::print_duration(download),
+                 dht::print_duration(hardware));
+#endif
+}
+
+}}} // namespace jami::video::test
+
+RING_TEST_RUNNER(jami::video::test::VideoCompositorTest::name());
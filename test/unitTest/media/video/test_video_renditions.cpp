@@ -0,0 +1,222 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "jami.h"
+#include "logger.h"
+#include "videomanager_interface.h"
+#include "video/video_renditions.h"
+#include "video/video_scaler.h"
+#include "libav_utils.h"
+
+#include "../../../test_runner.h"
+
+#include <opendht/utils.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+namespace jami { namespace video { namespace test {
+
+/**
+ * Also benchmarks several consumers of the same camera, each scaling every frame,
+ * against shared renditions. The number of frames can be set with
+ * JAMI_BENCH_VIDEO_RENDITIONS_FRAMES (default 300).
+ */
+class VideoRenditionsTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "video_renditions"; }
+
+    void setUp();
+    void tearDown();
+
+private:
+    void testSubscribe();
+    void testGet();
+    void testConcurrentConsumers();
+    void testBenchmark();
+
+    CPPUNIT_TEST_SUITE(VideoRenditionsTest);
+    CPPUNIT_TEST(testSubscribe);
+    CPPUNIT_TEST(testGet);
+    CPPUNIT_TEST(testConcurrentConsumers);
+    CPPUNIT_TEST(testBenchmark);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(VideoRenditionsTest, VideoRenditionsTest::name());
+
+void
+VideoRenditionsTest::setUp()
+{
+    libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+}
+
+void
+VideoRenditionsTest::tearDown()
+{
+    libjami::fini();
+}
+
+static std::shared_ptr<VideoFrame>
+makeFrame(int width, int height)
+{
+    auto frame = std::make_shared<VideoFrame>();
+    frame->reserve(AV_PIX_FMT_YUV420P, width, height);
+    libav_utils::fillWithBlack(frame->pointer());
+    return frame;
+}
+
+void
+VideoRenditionsTest::testSubscribe()
+{
+    VideoRenditions renditions;
+    VideoRenditions::Format hd {1280, 720, AV_PIX_FMT_YUV420P};
+    CPPUNIT_ASSERT(renditions.subscribe(hd));
+    CPPUNIT_ASSERT(renditions.subscribe(hd));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), renditions.size());
+
+    // Formats are counted, not subscriptions
+    for (int i = 1; i < (int) VideoRenditions::MAX_RENDITIONS; ++i)
+        CPPUNIT_ASSERT(renditions.subscribe({160 * i, 120 * i, AV_PIX_FMT_YUV420P}));
+    CPPUNIT_ASSERT(not renditions.subscribe({64, 64, AV_PIX_FMT_YUV420P}));
+    for (int i = 1; i < (int) VideoRenditions::MAX_RENDITIONS; ++i)
+        renditions.unsubscribe({160 * i, 120 * i, AV_PIX_FMT_YUV420P});
+
+    renditions.unsubscribe(hd);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), renditions.size());
+    renditions.unsubscribe(hd);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), renditions.size());
+}
+
+void
+VideoRenditionsTest::testGet()
+{
+    VideoRenditions renditions;
+    VideoRenditions::Format hd {1280, 720, AV_PIX_FMT_YUV420P};
+    VideoRenditions::Format sd {640, 480, AV_PIX_FMT_NV12};
+    VideoRenditions::Format thumb {320, 180, AV_PIX_FMT_YUV420P};
+    renditions.subscribe(hd);
+    renditions.subscribe(sd);
+
+    auto source = makeFrame(1920, 1080);
+    for (const auto& format : {hd, sd}) {
+        auto frame = renditions.get(source, format);
+        CPPUNIT_ASSERT(frame);
+        CPPUNIT_ASSERT_EQUAL(format.width, frame->width());
+        CPPUNIT_ASSERT_EQUAL(format.height, frame->height());
+        CPPUNIT_ASSERT_EQUAL((int) format.format, frame->format());
+    }
+    // Same frame for every consumer
+    CPPUNIT_ASSERT(renditions.get(source, hd) == renditions.get(source, hd));
+    // Not subscribed
+    CPPUNIT_ASSERT(not renditions.get(source, thumb));
+
+    // A new frame gives new renditions, the previous ones stay valid for their users
+    auto previous = renditions.get(source, hd);
+    auto other = makeFrame(1920, 1080);
+    auto next = renditions.get(other, hd);
+    CPPUNIT_ASSERT(next and next != previous);
+    CPPUNIT_ASSERT(renditions.get(other, hd) == next);
+    CPPUNIT_ASSERT_EQUAL(1280, previous->width());
+}
+
+void
+VideoRenditionsTest::testConcurrentConsumers()
+{
+    VideoRenditions renditions;
+    VideoRenditions::Format hd {1280, 720, AV_PIX_FMT_YUV420P};
+    VideoRenditions::Format sd {640, 360, AV_PIX_FMT_YUV420P};
+    renditions.subscribe(hd);
+    renditions.subscribe(sd);
+
+    // Encoders of each format, on their own threads, share one copy per frame
+    for (int i = 0; i < 10; ++i) {
+        auto source = makeFrame(1920, 1080);
+        std::vector<std::shared_ptr<VideoFrame>> results(6);
+        std::vector<std::thread> consumers;
+        for (std::size_t c = 0; c < results.size(); ++c)
+            consumers.emplace_back([&, c] {
+                results[c] = renditions.get(source, c % 2 ? sd : hd);
+            });
+        for (auto& consumer : consumers)
+            consumer.join();
+        for (std::size_t c = 0; c < results.size(); ++c) {
+            CPPUNIT_ASSERT(results[c]);
+            CPPUNIT_ASSERT(results[c] == results[c % 2]);
+        }
+        CPPUNIT_ASSERT(results[0] != results[1]);
+    }
+}
+
+void
+VideoRenditionsTest::testBenchmark()
+{
+    std::size_t frames = 300;
+    if (auto env = std::getenv("JAMI_BENCH_VIDEO_RENDITIONS_FRAMES"))
+        frames = std::strtoul(env, nullptr, 10);
+    // A conference: four peers receiving 720p, two receiving 360p
+    const std::vector<VideoRenditions::Format> consumers {{1280, 720, AV_PIX_FMT_YUV420P},
+                                                          {1280, 720, AV_PIX_FMT_YUV420P},
+                                                          {1280, 720, AV_PIX_FMT_YUV420P},
+                                                          {1280, 720, AV_PIX_FMT_YUV420P},
+                                                          {640, 360, AV_PIX_FMT_YUV420P},
+                                                          {640, 360, AV_PIX_FMT_YUV420P}};
+    auto source = makeFrame(1920, 1080);
+
+    // Each consumer scales every frame
+    std::vector<std::unique_ptr<VideoScaler>> scalers;
+    std::vector<std::shared_ptr<VideoFrame>> outputs;
+    for (const auto& format : consumers) {
+        scalers.emplace_back(std::make_unique<VideoScaler>());
+        outputs.emplace_back(makeFrame(format.width, format.height));
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < frames; ++i)
+        for (std::size_t c = 0; c < consumers.size(); ++c)
+            scalers[c]->scale_with_aspect(*source, *outputs[c]);
+    auto separate = std::chrono::steady_clock::now() - start;
+
+    // Shared renditions
+    VideoRenditions renditions;
+    for (const auto& format : consumers)
+        renditions.subscribe(format);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(2), renditions.size());
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < frames; ++i) {
+        // A new frame each time, as published by a camera
+        auto frame = std::make_shared<VideoFrame>();
+        frame->copyFrom(*source);
+        for (const auto& format : consumers)
+            CPPUNIT_ASSERT(renditions.get(frame, format));
+    }
+    auto shared = std::chrono::steady_clock::now() - start;
+
+    JAMI_WARNING("{} frames for {} consumers: {} scaling separately, {} with shared renditions",
+                 frames,
+                 consumers.size(),
+                 dht::print_duration(separate),
+                 dht::print_duration(shared));
+}
+
+}}} // namespace jami::video::test
+
+RING_TEST_RUNNER(jami::video::test::VideoRenditionsTest::name());
@@ -0,0 +1,193 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#include "manager.h"
+#include "sip/sipaccount.h"
+#include "sip/sdp.h"
+#include "../../test_runner.h"
+#include "jami.h"
+#include "account_const.h"
+#include "logger.h"
+
+#include <opendht/utils.h>
+
+using namespace libjami::Account;
+
+namespace jami {
+namespace test {
+
+/**
+ * SDP offers and answers built from media templates.
+ * Also benchmarks offer/answer negotiations. The number of negotiations can be set with
+ * JAMI_BENCH_SDP_NEGOTIATIONS (default 10000).
+ */
+class SdpNegotiationTest : public CppUnit::TestFixture
+{
+public:
+    SdpNegotiationTest()
+    {
+        // Init daemon
+        libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+        if (not Manager::instance().initialized)
+            CPPUNIT_ASSERT(libjami::start("dring-sample.yml"));
+    }
+    ~SdpNegotiationTest() { libjami::fini(); }
+
+    static std::string name() { return "SdpNegotiationTest"; }
+    void setUp();
+    void tearDown();
+
+private:
+    void testMediaTemplate();
+    void testNegotiationBenchmark();
+
+    void setCapabilities(Sdp& sdp) const;
+    std::vector<MediaAttribute> mediaList() const;
+
+    std::string accountId_;
+    std::vector<std::shared_ptr<AccountCodecInfo>> audioCodecs_;
+    std::vector<std::shared_ptr<AccountCodecInfo>> videoCodecs_;
+
+    CPPUNIT_TEST_SUITE(SdpNegotiationTest);
+    CPPUNIT_TEST(testMediaTemplate);
+    CPPUNIT_TEST(testNegotiationBenchmark);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(SdpNegotiationTest, SdpNegotiationTest::name());
+
+void
+SdpNegotiationTest::setUp()
+{
+    std::map<std::string, std::string> details = libjami::getAccountTemplate("SIP");
+    details[ConfProperties::TYPE] = "SIP";
+    details[ConfProperties::ALIAS] = "SDPTEST";
+    details[ConfProperties::UPNP_ENABLED] = "false";
+    accountId_ = Manager::instance().addAccount(details);
+    auto account = Manager::instance().getAccount<SIPAccount>(accountId_);
+    CPPUNIT_ASSERT(account);
+    audioCodecs_ = account->getActiveAccountCodecInfoList(MEDIA_AUDIO);
+    videoCodecs_ = account->getActiveAccountCodecInfoList(MEDIA_VIDEO);
+    CPPUNIT_ASSERT(not audioCodecs_.empty());
+}
+
+void
+SdpNegotiationTest::tearDown()
+{
+    Manager::instance().removeAccount(accountId_, true);
+}
+
+void
+SdpNegotiationTest::setCapabilities(Sdp& sdp) const
+{
+    sdp.setLocalMediaCapabilities(MediaType::MEDIA_AUDIO, audioCodecs_);
+#ifdef ENABLE_VIDEO
+    sdp.setLocalMediaCapabilities(MediaType::MEDIA_VIDEO, videoCodecs_);
+#endif
+    sdp.setPublishedIP("127.0.0.1", pj_AF_INET());
+    sdp.setLocalPublishedAudioPorts(40000, 40001);
+    sdp.setLocalPublishedVideoPorts(40002, 40003);
+}
+
+std::vector<MediaAttribute>
+SdpNegotiationTest::mediaList() const
+{
+    std::vector<MediaAttribute> list;
+    list.emplace_back(MediaType::MEDIA_AUDIO, false, true, true, "", "audio_0");
+#ifdef ENABLE_VIDEO
+    list.emplace_back(MediaType::MEDIA_VIDEO, false, true, true, "", "video_0");
+#endif
+    return list;
+}
+
+void
+SdpNegotiationTest::testMediaTemplate()
+{
+    // Same codecs, same template
+    auto audioTemplate = Sdp::getMediaTemplate(MediaType::MEDIA_AUDIO, audioCodecs_);
+    CPPUNIT_ASSERT(audioTemplate == Sdp::getMediaTemplate(MediaType::MEDIA_AUDIO, audioCodecs_));
+    CPPUNIT_ASSERT_EQUAL(audioCodecs_.size(), audioTemplate->formats.size());
+
+    // Changing the codec list changes the template
+    std::vector<std::shared_ptr<AccountCodecInfo>> firstCodec {audioCodecs_.front()};
+    auto firstTemplate = Sdp::getMediaTemplate(MediaType::MEDIA_AUDIO, firstCodec);
+    CPPUNIT_ASSERT(firstTemplate != audioTemplate);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), firstTemplate->formats.size());
+
+    // The offer holds the codecs and the per call fields
+    Sdp sdp("sdp-template");
+    setCapabilities(sdp);
+    CPPUNIT_ASSERT(sdp.createOffer(mediaList()));
+    auto session = sdp.getLocalSdpSession();
+    CPPUNIT_ASSERT(session and session->media_count > 0);
+    auto audio = session->media[0];
+    CPPUNIT_ASSERT_EQUAL(40000u, unsigned(audio->desc.port));
+    // Codecs + telephone-event
+    CPPUNIT_ASSERT_EQUAL(unsigned(audioCodecs_.size() + 1), audio->desc.fmt_count);
+    for (unsigned i = 0; i < audioCodecs_.size(); ++i) {
+        auto rtpmap = pjmedia_sdp_media_find_attr2(audio, "rtpmap", &audio->desc.fmt[i]);
+        CPPUNIT_ASSERT(rtpmap);
+    }
+    CPPUNIT_ASSERT(pjmedia_sdp_media_find_attr2(audio, "crypto", nullptr));
+    CPPUNIT_ASSERT(pjmedia_sdp_media_find_attr2(audio, "rtcp", nullptr));
+}
+
+void
+SdpNegotiationTest::testNegotiationBenchmark()
+{
+    std::size_t count = 10000;
+    if (auto env = std::getenv("JAMI_BENCH_SDP_NEGOTIATIONS"))
+        count = std::strtoul(env, nullptr, 10);
+    auto media = mediaList();
+
+    // Measure negotiations, not session dumps
+    Logger::setDebugMode(false);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; ++i) {
+        auto id = std::to_string(i);
+        Sdp offerer("offer" + id);
+        setCapabilities(offerer);
+        CPPUNIT_ASSERT(offerer.createOffer(media));
+
+        Sdp answerer("answer" + id);
+        setCapabilities(answerer);
+        answerer.setReceivedOffer(offerer.getLocalSdpSession());
+        CPPUNIT_ASSERT(answerer.processIncomingOffer(media));
+        CPPUNIT_ASSERT(answerer.startNegotiation());
+        CPPUNIT_ASSERT(answerer.getActiveLocalSdpSession());
+    }
+    auto duration = std::chrono::steady_clock::now() - start;
+    Logger::setDebugMode(true);
+    auto seconds = std::chrono::duration<double>(duration).count();
+    JAMI_WARNING("{} offer/answer negotiations in {} ({:.0f}/s)",
+                 count,
+                 dht::print_duration(duration),
+                 seconds > 0 ? count / seconds : 0.);
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::SdpNegotiationTest::name())
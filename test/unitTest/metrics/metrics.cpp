@@ -0,0 +1,144 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "metrics.h"
+#include "media/audio/ringbuffer.h"
+#include "media_buffer.h"
+
+#include <thread>
+#include <vector>
+
+#include "../../test_runner.h"
+
+namespace jami { namespace metrics { namespace test {
+
+class MetricsTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "metrics"; }
+
+private:
+    void testBuckets();
+    void testCounter();
+    void testHistogram();
+    void testRegistry();
+    void testUnderruns();
+
+    CPPUNIT_TEST_SUITE(MetricsTest);
+    CPPUNIT_TEST(testBuckets);
+    CPPUNIT_TEST(testCounter);
+    CPPUNIT_TEST(testHistogram);
+    CPPUNIT_TEST(testRegistry);
+    CPPUNIT_TEST(testUnderruns);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(MetricsTest, MetricsTest::name());
+
+void
+MetricsTest::testBuckets()
+{
+    for (uint64_t v = 0; v < (1 << 16); v++) {
+        auto idx = Histogram::bucketIndex(v);
+        CPPUNIT_ASSERT(idx < Histogram::BUCKETS);
+        CPPUNIT_ASSERT(Histogram::bucketLowerBound(idx) <= v);
+        CPPUNIT_ASSERT(Histogram::bucketUpperBound(idx) >= v);
+    }
+    // Values out of range are clamped in the last bucket
+    CPPUNIT_ASSERT(Histogram::bucketIndex(UINT64_MAX) == Histogram::BUCKETS - 1);
+}
+
+void
+MetricsTest::testCounter()
+{
+    Counter counter;
+    constexpr unsigned THREADS = 8;
+    constexpr unsigned N = 10000;
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < THREADS; t++)
+        threads.emplace_back([&] {
+            for (unsigned i = 0; i < N; i++)
+                counter.inc();
+        });
+    for (auto& t : threads)
+        t.join();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(THREADS * N), counter.value());
+}
+
+void
+MetricsTest::testHistogram()
+{
+    Histogram histogram;
+    for (uint64_t i = 1; i <= 1000; i++)
+        histogram.record(i);
+    auto snap = histogram.snapshot();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1000), snap.count);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(500500), snap.sum);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), snap.min);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1000), snap.max);
+    // Relative error is bounded by the sub-bucket resolution
+    auto p50 = snap.percentile(.5);
+    CPPUNIT_ASSERT(p50 >= 500 && p50 <= 500 * 9 / 8 + 1);
+    auto p99 = snap.percentile(.99);
+    CPPUNIT_ASSERT(p99 >= 990 && p99 <= 1000);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1000), snap.percentile(1.));
+}
+
+void
+MetricsTest::testRegistry()
+{
+    auto& c = counter("test.counter");
+    CPPUNIT_ASSERT(&c == &counter("test.counter"));
+    c.inc(3);
+    gauge("test.gauge").set(-2);
+    histogram("test.latency").record(42);
+
+    auto snap = Registry::instance().snapshot();
+    CPPUNIT_ASSERT(snap["test.counter"] == "3");
+    CPPUNIT_ASSERT(snap["test.gauge"] == "-2");
+    CPPUNIT_ASSERT(snap["test.latency.count"] == "1");
+    CPPUNIT_ASSERT(snap["test.latency.max"] == "42");
+}
+
+void
+MetricsTest::testUnderruns()
+{
+    auto& underruns = counter("ringbuffer.underruns");
+    auto initial = underruns.value();
+    RingBuffer buffer("metrics_test", 16);
+    buffer.createReadOffset("reader");
+
+    // Polling before the first frame is not an underrun
+    for (int i = 0; i < 3; i++)
+        CPPUNIT_ASSERT(not buffer.get("reader"));
+    CPPUNIT_ASSERT_EQUAL(initial, underruns.value());
+
+    // Starvation during playback is counted once
+    buffer.put(std::make_shared<AudioFrame>(AudioFormat::MONO(), 160));
+    CPPUNIT_ASSERT(buffer.get("reader"));
+    CPPUNIT_ASSERT(not buffer.get("reader"));
+    CPPUNIT_ASSERT(not buffer.get("reader"));
+    CPPUNIT_ASSERT_EQUAL(initial + 1, underruns.value());
+}
+
+}}} // namespace jami::metrics::test
+
+RING_TEST_RUNNER(jami::metrics::test::MetricsTest::name());
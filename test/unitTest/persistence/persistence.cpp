@@ -0,0 +1,153 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "persistence.h"
+#include "fileutils.h"
+#include "metrics.h"
+
+#include <map>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "../../test_runner.h"
+
+namespace jami { namespace test {
+
+class PersistenceTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "persistence"; }
+    void setUp();
+    void tearDown();
+
+private:
+    void testCoalesce();
+    void testPacked();
+    void testDiscard();
+    void testSecret();
+
+    CPPUNIT_TEST_SUITE(PersistenceTest);
+    CPPUNIT_TEST(testCoalesce);
+    CPPUNIT_TEST(testPacked);
+    CPPUNIT_TEST(testDiscard);
+    CPPUNIT_TEST(testSecret);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::string path_;
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(PersistenceTest, PersistenceTest::name());
+
+void
+PersistenceTest::setUp()
+{
+    char template_name[] = {"ring_unit_tests_XXXXXX"};
+    auto directory = mkdtemp(template_name);
+    CPPUNIT_ASSERT(directory);
+    path_ = directory;
+}
+
+void
+PersistenceTest::tearDown()
+{
+    fileutils::removeAll(path_);
+}
+
+void
+PersistenceTest::testCoalesce()
+{
+    auto& persistence = Persistence::instance();
+    auto& coalesced = metrics::counter("persistence.coalesced");
+    auto& writes = metrics::counter("persistence.writes");
+    auto coalescedBefore = coalesced.value();
+    auto writesBefore = writes.value();
+
+    auto file = path_ + DIR_SEPARATOR_STR "state";
+    for (int i = 0; i < 100; i++)
+        persistence.write(file, std::to_string(i));
+    persistence.flush(file);
+
+    CPPUNIT_ASSERT(fileutils::loadTextFile(file) == "99");
+    CPPUNIT_ASSERT(not fileutils::isFile(file + ".tmp"));
+    // Writes queued before the first one is done are coalesced
+    CPPUNIT_ASSERT(writes.value() - writesBefore >= 1);
+    CPPUNIT_ASSERT(coalesced.value() - coalescedBefore + writes.value() - writesBefore >= 100);
+
+    // Replace the existing file
+    persistence.write(file, "updated");
+    persistence.flush();
+    CPPUNIT_ASSERT(fileutils::loadTextFile(file) == "updated");
+}
+
+void
+PersistenceTest::testPacked()
+{
+    std::map<std::string, int> value {{"a", 1}, {"b", 2}};
+    auto file = path_ + DIR_SEPARATOR_STR "packed";
+    Persistence::instance().writePacked(file, value);
+    Persistence::instance().flush(file);
+
+    auto data = fileutils::loadFile(file);
+    msgpack::object_handle oh = msgpack::unpack((const char*) data.data(), data.size());
+    std::map<std::string, int> loaded;
+    oh.get().convert(loaded);
+    CPPUNIT_ASSERT(loaded == value);
+}
+
+void
+PersistenceTest::testDiscard()
+{
+    auto dir = path_ + DIR_SEPARATOR_STR "account";
+    CPPUNIT_ASSERT(fileutils::recursive_mkdir(dir));
+    auto file = dir + DIR_SEPARATOR_STR "contacts";
+    auto other = path_ + DIR_SEPARATOR_STR "accountOther";
+    Persistence::instance().write(file, "data");
+    Persistence::instance().write(other, "data");
+    Persistence::instance().discard(dir);
+    Persistence::instance().flush();
+    CPPUNIT_ASSERT(not fileutils::isFile(file));
+    CPPUNIT_ASSERT(fileutils::isFile(other));
+}
+
+void
+PersistenceTest::testSecret()
+{
+    auto old = umask(0);
+    auto file = path_ + DIR_SEPARATOR_STR "key";
+    auto shared = path_ + DIR_SEPARATOR_STR "shared";
+    // A stale temporary file must not leak its mode
+    CPPUNIT_ASSERT(Persistence::writeFile(file + ".tmp", "stale"));
+    Persistence::instance().write(file, "secret", true);
+    Persistence::instance().write(shared, "data");
+    Persistence::instance().flush();
+    umask(old);
+
+    struct stat st;
+    CPPUNIT_ASSERT(stat(file.c_str(), &st) == 0);
+    CPPUNIT_ASSERT_EQUAL(0600, (int) (st.st_mode & 0777));
+    CPPUNIT_ASSERT(stat(shared.c_str(), &st) == 0);
+    CPPUNIT_ASSERT_EQUAL(0666, (int) (st.st_mode & 0777));
+    CPPUNIT_ASSERT(fileutils::loadTextFile(file) == "secret");
+}
+
+}} // namespace jami::test
+
+RING_TEST_RUNNER(jami::test::PersistenceTest::name());
@@ -0,0 +1,191 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "jami.h"
+#include "libav_deps.h"
+#include "media_buffer.h"
+#include "plugin/mediaprocessor.h"
+
+#include "../../test_runner.h"
+
+#include <thread>
+
+namespace jami {
+namespace test {
+
+class MediaProcessorTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "media_processor"; }
+
+    void setUp();
+    void tearDown();
+
+private:
+    void testProcessed();
+    void testBusy();
+
+    std::shared_ptr<MediaFrame> makeFrame() const;
+    static int16_t firstSample(const MediaFrame& frame);
+
+    CPPUNIT_TEST_SUITE(MediaProcessorTest);
+    CPPUNIT_TEST(testProcessed);
+    CPPUNIT_TEST(testBusy);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(MediaProcessorTest, MediaProcessorTest::name());
+
+void
+MediaProcessorTest::setUp()
+{
+    libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+}
+
+void
+MediaProcessorTest::tearDown()
+{
+    libjami::fini();
+}
+
+std::shared_ptr<MediaFrame>
+MediaProcessorTest::makeFrame() const
+{
+    auto frame = std::make_shared<AudioFrame>(AudioFormat::STEREO(), 960);
+    libav_utils::fillWithSilence(frame->pointer());
+    return frame;
+}
+
+int16_t
+MediaProcessorTest::firstSample(const MediaFrame& frame)
+{
+    return reinterpret_cast<const int16_t*>(frame.pointer()->data[0])[0];
+}
+
+static PluginMediaProcessor::F
+audioMap()
+{
+    return [](const std::shared_ptr<MediaFrame>& m) -> AVFrame* { return m->pointer(); };
+}
+
+/**
+ * Wait for the worker to process a frame
+ */
+static bool
+waitProcessed(PluginMediaProcessor& processor, uint64_t frames)
+{
+    for (int i = 0; i < 500; i++) {
+        if (processor.getStats()[1].frames >= frames) {
+            // Statistics are recorded just before the result is made available
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return false;
+}
+
+void
+MediaProcessorTest::testProcessed()
+{
+    PublishObservable<std::shared_ptr<MediaFrame>> source;
+    auto processor = std::make_shared<PluginMediaProcessor>(audioMap());
+    source.attachPriorityObserver(processor);
+    FuncObserver<AVFrame*> plugin([](AVFrame* const& frame) {
+        reinterpret_cast<int16_t*>(frame->data[0])[0] = 42;
+    });
+    processor->attach(&plugin);
+    processor->setHandler(1);
+    std::shared_ptr<MediaFrame> received;
+    FuncObserver<std::shared_ptr<MediaFrame>> consumer(
+        [&](const std::shared_ptr<MediaFrame>& frame) { received = frame; });
+    source.attach(&consumer);
+
+    // The first frame is passed through while the plugins process it
+    auto first = makeFrame();
+    source.publish(first);
+    CPPUNIT_ASSERT(received == first);
+    CPPUNIT_ASSERT(waitProcessed(*processor, 1));
+
+    // Next consumers get a new frame with the result, and the timing of the current frame
+    auto second = makeFrame();
+    second->pointer()->pts = 1234;
+    source.publish(second);
+    CPPUNIT_ASSERT(received and received != second);
+    CPPUNIT_ASSERT_EQUAL(int16_t(42), firstSample(*received));
+    CPPUNIT_ASSERT_EQUAL(int64_t(1234), received->pointer()->pts);
+    CPPUNIT_ASSERT(std::dynamic_pointer_cast<AudioFrame>(received));
+
+    // Frames shared with other consumers are untouched
+    CPPUNIT_ASSERT_EQUAL(int16_t(0), firstSample(*first));
+    CPPUNIT_ASSERT_EQUAL(int16_t(0), firstSample(*second));
+
+    auto stats = processor->getStats();
+    CPPUNIT_ASSERT_EQUAL(uint64_t(1), stats[1].skipped);
+    source.detach(&consumer);
+    processor->detach(&plugin);
+}
+
+void
+MediaProcessorTest::testBusy()
+{
+    PublishObservable<std::shared_ptr<MediaFrame>> source;
+    auto processor = std::make_shared<PluginMediaProcessor>(audioMap());
+    source.attachPriorityObserver(processor);
+    FuncObserver<AVFrame*> plugin([](AVFrame* const& frame) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        reinterpret_cast<int16_t*>(frame->data[0])[0] = 42;
+    });
+    processor->attach(&plugin);
+    processor->setHandler(1);
+    std::shared_ptr<MediaFrame> received;
+    FuncObserver<std::shared_ptr<MediaFrame>> consumer(
+        [&](const std::shared_ptr<MediaFrame>& frame) { received = frame; });
+    source.attach(&consumer);
+
+    // The producer never waits for the plugins
+    auto frame = makeFrame();
+    auto start = std::chrono::steady_clock::now();
+    source.publish(frame);
+    CPPUNIT_ASSERT(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(90));
+    CPPUNIT_ASSERT(received == frame);
+
+    // Plugin still busy: passed through immediately
+    auto next = makeFrame();
+    source.publish(next);
+    CPPUNIT_ASSERT(received == next);
+    CPPUNIT_ASSERT(waitProcessed(*processor, 1));
+
+    // The result of an older frame would go back in time: dropped
+    auto last = makeFrame();
+    source.publish(last);
+    CPPUNIT_ASSERT(received == last);
+    CPPUNIT_ASSERT_EQUAL(int16_t(0), firstSample(*received));
+
+    CPPUNIT_ASSERT_EQUAL(uint64_t(3), processor->getStats()[1].skipped);
+    source.detach(&consumer);
+    processor->detach(&plugin);
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::MediaProcessorTest::name())
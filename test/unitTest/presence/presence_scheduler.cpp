@@ -0,0 +1,300 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "test_runner.h"
+
+#include "jamidht/presence_scheduler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <set>
+#include <thread>
+
+using namespace std::literals::chrono_literals;
+
+namespace jami { namespace test {
+
+class PresenceSchedulerTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "presence_scheduler"; }
+
+    void setUp();
+
+private:
+    void boundTest();
+    void priorityTest();
+    void rotationTest();
+    void lostPresenceTest();
+    void reconnectTest();
+
+    CPPUNIT_TEST_SUITE(PresenceSchedulerTest);
+    CPPUNIT_TEST(boundTest);
+    CPPUNIT_TEST(priorityTest);
+    CPPUNIT_TEST(rotationTest);
+    CPPUNIT_TEST(lostPresenceTest);
+    CPPUNIT_TEST(reconnectTest);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::shared_ptr<PresenceScheduler> makeScheduler(ScheduledExecutor& executor,
+                                                     const PresenceScheduler::Config& config);
+
+    std::mutex mtx;
+    std::set<std::string> listened;
+    std::set<std::string> everListened;
+    std::vector<std::pair<std::string, bool>> presenceEvents;
+    size_t maxConcurrent {0};
+    size_t cancelled {0};
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(PresenceSchedulerTest, PresenceSchedulerTest::name());
+
+void
+PresenceSchedulerTest::setUp()
+{
+    listened.clear();
+    everListened.clear();
+    presenceEvents.clear();
+    maxConcurrent = 0;
+    cancelled = 0;
+}
+
+std::shared_ptr<PresenceScheduler>
+PresenceSchedulerTest::makeScheduler(ScheduledExecutor& executor,
+                                     const PresenceScheduler::Config& config)
+{
+    return std::make_shared<PresenceScheduler>(
+        executor,
+        "presence_test",
+        [this](const std::string& buddy) {
+            std::lock_guard<std::mutex> lk(mtx);
+            CPPUNIT_ASSERT(listened.emplace(buddy).second);
+            everListened.emplace(buddy);
+            maxConcurrent = std::max(maxConcurrent, listened.size());
+            std::promise<size_t> token;
+            token.set_value(listened.size());
+            return token.get_future();
+        },
+        [this](const std::string& buddy, std::future<size_t>&& token) {
+            std::lock_guard<std::mutex> lk(mtx);
+            CPPUNIT_ASSERT(token.valid());
+            CPPUNIT_ASSERT(listened.erase(buddy) == 1);
+            ++cancelled;
+        },
+        [this](const std::string& buddy, bool online) {
+            std::lock_guard<std::mutex> lk(mtx);
+            presenceEvents.emplace_back(buddy, online);
+        },
+        config);
+}
+
+static std::string
+buddyName(size_t i)
+{
+    return "buddy" + std::to_string(100 + i);
+}
+
+void
+PresenceSchedulerTest::boundTest()
+{
+    ScheduledExecutor executor("presence");
+    PresenceScheduler::Config config;
+    config.maxListens = 8;
+    config.rotatingListens = 2;
+    auto scheduler = makeScheduler(executor, config);
+
+    for (size_t i = 0; i < 5; ++i)
+        CPPUNIT_ASSERT(scheduler->track(buddyName(i)));
+    CPPUNIT_ASSERT(not scheduler->track(buddyName(0)));
+    CPPUNIT_ASSERT_EQUAL((size_t) 5, scheduler->listening());
+    CPPUNIT_ASSERT_EQUAL((size_t) 0, cancelled);
+
+    for (size_t i = 5; i < 100; ++i)
+        scheduler->track(buddyName(i));
+    CPPUNIT_ASSERT_EQUAL((size_t) 8, scheduler->listening());
+    CPPUNIT_ASSERT_EQUAL((size_t) 8, listened.size());
+    CPPUNIT_ASSERT(maxConcurrent <= config.maxListens);
+    CPPUNIT_ASSERT_EQUAL((size_t) 100, scheduler->presence().size());
+
+    for (size_t i = 0; i < 100; ++i)
+        scheduler->untrack(buddyName(i));
+    CPPUNIT_ASSERT_EQUAL((size_t) 0, scheduler->listening());
+    CPPUNIT_ASSERT(listened.empty());
+    CPPUNIT_ASSERT(maxConcurrent <= config.maxListens);
+}
+
+void
+PresenceSchedulerTest::priorityTest()
+{
+    ScheduledExecutor executor("presence");
+    PresenceScheduler::Config config;
+    config.maxListens = 8;
+    config.rotatingListens = 2;
+    auto scheduler = makeScheduler(executor, config);
+
+    // buddyName(i) was last active i minutes ago
+    auto now = std::chrono::system_clock::now();
+    for (size_t i = 0; i < 50; ++i)
+        scheduler->track(buddyName(i), now - std::chrono::minutes(i));
+
+    for (size_t i = 0; i < 6; ++i)
+        CPPUNIT_ASSERT(scheduler->isListening(buddyName(i)));
+    CPPUNIT_ASSERT(not scheduler->isListening(buddyName(40)));
+
+    // Activity with a buddy promotes it to the permanent listens
+    scheduler->touch(buddyName(40), now + 1s);
+    CPPUNIT_ASSERT(scheduler->isListening(buddyName(40)));
+    CPPUNIT_ASSERT_EQUAL((size_t) 8, scheduler->listening());
+
+    // Online buddies come first, even without recent activity
+    scheduler->track(buddyName(60), now - 24h);
+    CPPUNIT_ASSERT(not scheduler->isListening(buddyName(60)));
+    scheduler->touch(buddyName(60), now + 2s);
+    auto t = scheduler->deviceAnnounced(buddyName(60), false);
+    CPPUNIT_ASSERT(t and not t->wasOnline and t->isOnline);
+    for (size_t i = 0; i < 10; ++i)
+        scheduler->touch(buddyName(10 + i), now + 10s + std::chrono::seconds(i));
+    CPPUNIT_ASSERT(scheduler->isListening(buddyName(60)));
+    CPPUNIT_ASSERT(scheduler->presence().at(buddyName(60)));
+    CPPUNIT_ASSERT(not scheduler->deviceAnnounced(buddyName(45), false));
+    CPPUNIT_ASSERT(maxConcurrent <= config.maxListens);
+
+    // Restarting listens again and drops presence without reporting it
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        listened.clear();
+    }
+    scheduler->restart();
+    CPPUNIT_ASSERT_EQUAL((size_t) 8, scheduler->listening());
+    for (const auto& [id, online] : scheduler->presence())
+        CPPUNIT_ASSERT(not online);
+    CPPUNIT_ASSERT(presenceEvents.empty());
+}
+
+void
+PresenceSchedulerTest::rotationTest()
+{
+    ScheduledExecutor executor("presence");
+    PresenceScheduler::Config config;
+    config.maxListens = 8;
+    config.rotatingListens = 4;
+    config.rotationPeriod = 10ms;
+    auto scheduler = makeScheduler(executor, config);
+
+    constexpr size_t N = 40;
+    for (size_t i = 0; i < N; ++i)
+        scheduler->track(buddyName(i));
+
+    for (int i = 0; i < 500; ++i) {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (everListened.size() == N)
+                break;
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+    std::lock_guard<std::mutex> lk(mtx);
+    CPPUNIT_ASSERT_EQUAL(N, everListened.size());
+    CPPUNIT_ASSERT(maxConcurrent <= config.maxListens);
+}
+
+void
+PresenceSchedulerTest::lostPresenceTest()
+{
+    ScheduledExecutor executor("presence");
+    PresenceScheduler::Config config;
+    config.maxListens = 4;
+    config.rotatingListens = 1;
+    config.rotationPeriod = 10ms;
+    auto scheduler = makeScheduler(executor, config);
+
+    auto now = std::chrono::system_clock::now();
+    for (size_t i = 0; i < 4; ++i)
+        scheduler->track(buddyName(i), now - std::chrono::minutes(i));
+    for (size_t i = 0; i < 4; ++i)
+        scheduler->deviceAnnounced(buddyName(i), false);
+    auto t = scheduler->deviceAnnounced(buddyName(0), false);
+    CPPUNIT_ASSERT(t and t->wasOnline and t->isOnline);
+    t = scheduler->deviceAnnounced(buddyName(0), true);
+    CPPUNIT_ASSERT(t and t->wasOnline and t->isOnline);
+
+    // More online buddies than permanent slots: the rotation evicts the least
+    // recent one, whose presence isn't known anymore
+    scheduler->track(buddyName(4), now);
+    std::pair<std::string, bool> event;
+    for (int i = 0; i < 500; ++i) {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (not presenceEvents.empty()) {
+                event = presenceEvents.front();
+                break;
+            }
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+    CPPUNIT_ASSERT_EQUAL(buddyName(3), event.first);
+    CPPUNIT_ASSERT(not event.second);
+    CPPUNIT_ASSERT(scheduler->presence().at(buddyName(0)));
+}
+
+void
+PresenceSchedulerTest::reconnectTest()
+{
+    ScheduledExecutor executor("presence");
+    PresenceScheduler::Config config;
+    config.reconnectInterval = 20ms;
+    config.reconnectJitter = 5ms;
+    config.reconnectBurst = 2;
+    auto scheduler = makeScheduler(executor, config);
+
+    constexpr size_t N = 10;
+    std::mutex runMtx;
+    std::condition_variable cv;
+    std::vector<std::chrono::steady_clock::time_point> runs;
+    std::atomic_int replaced {0};
+    auto job = [&] {
+        std::lock_guard<std::mutex> lk(runMtx);
+        runs.emplace_back(std::chrono::steady_clock::now());
+        cv.notify_all();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < N; ++i)
+        scheduler->scheduleReconnect(buddyName(i), [&replaced] { ++replaced; });
+    // Pending jobs with the same key are coalesced
+    for (size_t i = 0; i < N; ++i)
+        scheduler->scheduleReconnect(buddyName(i), job);
+
+    std::unique_lock<std::mutex> lk(runMtx);
+    CPPUNIT_ASSERT(cv.wait_for(lk, 5s, [&] { return runs.size() >= N; }));
+    CPPUNIT_ASSERT_EQUAL(N, runs.size());
+    // The first job may or may not have run before being replaced
+    CPPUNIT_ASSERT(replaced <= (int) config.reconnectBurst);
+    CPPUNIT_ASSERT_EQUAL((size_t) 0, scheduler->pendingReconnects());
+
+    // At most reconnectBurst jobs per reconnectInterval
+    auto windows = (N - replaced) / config.reconnectBurst - 1;
+    CPPUNIT_ASSERT(runs.back() - start >= windows * config.reconnectInterval);
+}
+
+}} // namespace jami::test
+
+RING_TEST_RUNNER(jami::test::PresenceSchedulerTest::name())
@@ -27,6 +27,9 @@
 #include "scheduled_executor.h"
 #include <opendht/rng.h>
 
+#include <algorithm>
+#include <array>
+
 namespace jami { namespace test {
 
 class SchedulerTest : public CppUnit::TestFixture {
@@ -35,9 +38,17 @@ public:
 
 private:
     void schedulerTest();
+    void keyedTest();
+    void timerOrderTest();
+    void cancelTest();
+    void cancelRaceTest();
 
     CPPUNIT_TEST_SUITE(SchedulerTest);
     CPPUNIT_TEST(schedulerTest);
+    CPPUNIT_TEST(keyedTest);
+    CPPUNIT_TEST(timerOrderTest);
+    CPPUNIT_TEST(cancelTest);
+    CPPUNIT_TEST(cancelRaceTest);
     CPPUNIT_TEST_SUITE_END();
 };
 
@@ -87,6 +98,158 @@ SchedulerTest::schedulerTest()
     executor.stop();
 }
 
+void
+SchedulerTest::keyedTest()
+{
+    jami::ScheduledExecutor executor("test_keyed", 4);
+
+    constexpr unsigned KEYS = 8;
+    constexpr unsigned N = 1000;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::array<std::vector<unsigned>, KEYS> order;
+    std::array<std::atomic_int, KEYS> active {};
+    std::atomic_bool overlap {false};
+    std::atomic_uint done {0};
+    const auto mainThread = std::make_shared<std::thread::id>();
+    std::atomic_bool mainMoved {false};
+
+    for (unsigned i = 0; i < N; i++) {
+        for (unsigned k = 0; k < KEYS; k++) {
+            executor.run(ScheduledExecutor::key("key" + std::to_string(k)), [&, k, i] {
+                // Jobs sharing a key never run concurrently
+                if (active[k]++ != 0)
+                    overlap = true;
+                order[k].emplace_back(i);
+                active[k]--;
+                std::lock_guard<std::mutex> l(mtx);
+                if (++done == KEYS * N + N)
+                    cv.notify_all();
+            });
+        }
+        // Jobs without key always run on the same thread
+        executor.run([&] {
+            if (*mainThread == std::thread::id())
+                *mainThread = std::this_thread::get_id();
+            else if (*mainThread != std::this_thread::get_id())
+                mainMoved = true;
+            std::lock_guard<std::mutex> l(mtx);
+            if (++done == KEYS * N + N)
+                cv.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lk(mtx);
+    CPPUNIT_ASSERT(cv.wait_for(lk, std::chrono::seconds(10), [&] { return done == KEYS * N + N; }));
+    CPPUNIT_ASSERT(not overlap);
+    CPPUNIT_ASSERT(not mainMoved);
+    for (const auto& o : order) {
+        CPPUNIT_ASSERT_EQUAL(std::size_t(N), o.size());
+        CPPUNIT_ASSERT(std::is_sorted(o.begin(), o.end()));
+    }
+}
+
+void
+SchedulerTest::timerOrderTest()
+{
+    jami::ScheduledExecutor executor("test_timers");
+
+    constexpr unsigned N = 200;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<unsigned> order;
+    bool early {false};
+
+    auto now = ScheduledExecutor::clock::now();
+    for (unsigned i = 0; i < N; i++) {
+        // Schedule in reverse order, some timers sharing the same deadline
+        unsigned delay = (N - 1 - i) / 2;
+        auto t = now + std::chrono::milliseconds(delay);
+        executor.schedule([&, t, delay] {
+            std::lock_guard<std::mutex> l(mtx);
+            if (ScheduledExecutor::clock::now() < t)
+                early = true;
+            order.emplace_back(delay);
+            if (order.size() == N)
+                cv.notify_all();
+        }, t);
+    }
+
+    std::unique_lock<std::mutex> lk(mtx);
+    CPPUNIT_ASSERT(cv.wait_for(lk, std::chrono::seconds(3), [&] { return order.size() == N; }));
+    CPPUNIT_ASSERT(not early);
+    CPPUNIT_ASSERT(std::is_sorted(order.begin(), order.end()));
+}
+
+void
+SchedulerTest::cancelTest()
+{
+    jami::ScheduledExecutor executor("test_cancel", 2);
+
+    std::atomic_uint cancelledRun {0};
+    std::atomic_uint repeated {0};
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    std::vector<std::shared_ptr<Task>> tasks;
+    for (unsigned i = 0; i < 100; i++)
+        tasks.emplace_back(executor.scheduleIn(ScheduledExecutor::key("cancel"),
+                                               [&] { cancelledRun++; },
+                                               std::chrono::milliseconds(20)));
+    for (auto& task : tasks)
+        task->cancel();
+
+    auto repeatedTask = executor.scheduleAtFixedRate(
+        ScheduledExecutor::key("repeat"),
+        [&] {
+            std::lock_guard<std::mutex> l(mtx);
+            if (++repeated == 5) {
+                cv.notify_all();
+                return false;
+            }
+            return true;
+        },
+        std::chrono::milliseconds(5));
+
+    std::unique_lock<std::mutex> lk(mtx);
+    CPPUNIT_ASSERT(cv.wait_for(lk, std::chrono::seconds(3), [&] { return repeated == 5; }));
+    lk.unlock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CPPUNIT_ASSERT_EQUAL(0u, cancelledRun.load());
+    CPPUNIT_ASSERT_EQUAL(5u, repeated.load());
+}
+
+void
+SchedulerTest::cancelRaceTest()
+{
+    jami::ScheduledExecutor executor("test_cancel_race", 4);
+
+    constexpr unsigned N = 2048;
+    std::atomic_uint ran {0};
+    std::vector<std::shared_ptr<Task>> tasks;
+    tasks.reserve(N);
+    for (unsigned i = 0; i < N; i++) {
+        // The job owns state that a racing cancel() would free under it
+        auto payload = std::make_shared<std::vector<unsigned>>(16, i);
+        tasks.emplace_back(executor.scheduleIn(
+            ScheduledExecutor::key(std::to_string(i % 8)),
+            [&ran, payload] {
+                if ((*payload)[15] == payload->front())
+                    ran++;
+            },
+            std::chrono::milliseconds(i % 3)));
+    }
+    // Cancel while the workers are running the same tasks
+    for (auto& task : tasks)
+        task->cancel();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    unsigned cancelled = std::count_if(tasks.begin(), tasks.end(), [](const auto& t) {
+        return t->isCancelled();
+    });
+    CPPUNIT_ASSERT_EQUAL(N, ran.load() + cancelled);
+}
+
 }} // namespace jami::test
 
 RING_TEST_RUNNER(jami::test::SchedulerTest::name());
@@ -0,0 +1,341 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <random>
+
+#include "manager.h"
+#include "jamidht/jamiaccount.h"
+#include "jamidht/shared_dht_node.h"
+#include "../../test_runner.h"
+#include "jami.h"
+#include "common.h"
+
+#include <opendht/default_types.h>
+
+using namespace std::literals::chrono_literals;
+
+namespace jami {
+namespace test {
+
+class SharedDhtTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "SharedDht"; }
+    void setUp();
+    void tearDown();
+
+private:
+    void testSignedAndEncryptedValues();
+    void testMultiplexedListens();
+    void testAcquire();
+
+    CPPUNIT_TEST_SUITE(SharedDhtTest);
+    CPPUNIT_TEST(testSignedAndEncryptedValues);
+    CPPUNIT_TEST(testMultiplexedListens);
+    CPPUNIT_TEST(testAcquire);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::shared_ptr<dht::DhtRunner> makeClient(const dht::crypto::Identity& id);
+
+    // Local network: a bootstrap node, another regular node and the shared node
+    std::shared_ptr<dht::DhtRunner> bootstrapNode;
+    std::shared_ptr<dht::DhtRunner> otherNode;
+    std::unique_ptr<SharedDhtNode> sharedNode;
+    std::vector<std::shared_ptr<dht::DhtRunner>> clients;
+};
+
+/**
+ * Jami accounts using the shared node
+ */
+class SharedDhtAccountTest : public CppUnit::TestFixture
+{
+public:
+    SharedDhtAccountTest()
+    {
+        // Init daemon
+        libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+        if (not Manager::instance().initialized)
+            CPPUNIT_ASSERT(libjami::start("jami-sample.yml"));
+    }
+    ~SharedDhtAccountTest() { libjami::fini(); }
+    static std::string name() { return "SharedDhtAccount"; }
+    void setUp();
+    void tearDown();
+
+private:
+    void testTrustRequest();
+
+    CPPUNIT_TEST_SUITE(SharedDhtAccountTest);
+    CPPUNIT_TEST(testTrustRequest);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::string aliceId;
+    std::string bobId;
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(SharedDhtTest, SharedDhtTest::name());
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(SharedDhtAccountTest, SharedDhtAccountTest::name());
+
+static in_port_t
+randomPort()
+{
+    static std::random_device rd;
+    return std::uniform_int_distribution<in_port_t>(20000, 60000)(rd);
+}
+
+static std::shared_ptr<dht::Value>
+makeValue(std::string_view data)
+{
+    return std::make_shared<dht::Value>(dht::Blob(data.begin(), data.end()));
+}
+
+void
+SharedDhtTest::setUp()
+{
+    bootstrapNode = std::make_shared<dht::DhtRunner>();
+    bootstrapNode->run(0, dht::DhtRunner::Config {});
+    auto bootstrap = "127.0.0.1:" + std::to_string(bootstrapNode->getBoundPort());
+
+    otherNode = std::make_shared<dht::DhtRunner>();
+    otherNode->run(0, dht::DhtRunner::Config {});
+    otherNode->bootstrap(bootstrap);
+
+    SharedDhtNode::Config config;
+    config.proxyPort = randomPort();
+    sharedNode = std::make_unique<SharedDhtNode>(config);
+    sharedNode->bootstrap({bootstrap});
+    // Bootstrapping twice with the same node is a no-op
+    sharedNode->bootstrap({bootstrap});
+}
+
+void
+SharedDhtTest::tearDown()
+{
+    for (auto& client : clients)
+        client->join();
+    clients.clear();
+    sharedNode.reset();
+    otherNode->join();
+    bootstrapNode->join();
+}
+
+std::shared_ptr<dht::DhtRunner>
+SharedDhtTest::makeClient(const dht::crypto::Identity& id)
+{
+    auto client = std::make_shared<dht::DhtRunner>();
+    dht::DhtRunner::Config config {};
+    config.dht_config.id = id;
+    config.proxy_server = sharedNode->proxyServer();
+    config.threaded = true;
+    // As done by accounts, the client has no UDP socket
+    dht::DhtRunner::Context context {};
+    context.sock = SharedDhtNode::clientSocket();
+    client->run(config, std::move(context));
+    clients.emplace_back(client);
+    return client;
+}
+
+/**
+ * Values seen by the test callbacks. Shared with the callbacks, which may
+ * run after the test method returned.
+ */
+struct Received
+{
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::string message;
+    dht::InfoHash from;
+    bool signedByBob {false};
+    size_t values {0};
+};
+
+void
+SharedDhtTest::testSignedAndEncryptedValues()
+{
+    auto aliceId = dht::crypto::generateIdentity("alice");
+    auto bobId = dht::crypto::generateIdentity("bob");
+    auto alice = makeClient(aliceId);
+    auto bob = makeClient(bobId);
+    auto alicePk = std::make_shared<dht::crypto::PublicKey>(aliceId.first->getPublicKey());
+    auto bobPk = bobId.first->getPublicKey();
+    auto received = std::make_shared<Received>();
+    std::unique_lock<std::mutex> lk {received->mtx};
+
+    // Encrypted by bob's client for alice, decrypted by alice's client
+    auto inbox = dht::InfoHash::get("inbox:" + alicePk->getId().toString());
+    auto token = alice->listen<dht::ImMessage>(inbox, [received](dht::ImMessage&& msg) {
+        std::lock_guard<std::mutex> lk {received->mtx};
+        received->message = msg.msg;
+        received->from = msg.from;
+        received->cv.notify_one();
+        return true;
+    });
+    bob->putEncrypted(inbox, alicePk, dht::ImMessage(dht::Value::INVALID_ID, "hello", 0));
+    CPPUNIT_ASSERT(
+        received->cv.wait_for(lk, 60s, [&] { return not received->message.empty(); }));
+    CPPUNIT_ASSERT_EQUAL(std::string("hello"), received->message);
+    CPPUNIT_ASSERT(received->from == bobPk.getId());
+    alice->cancelListen(inbox, token.share());
+
+    // Signed by bob's client, seen with bob's signature from the rest of the network
+    auto key = dht::InfoHash::get("shared_dht_signed");
+    auto bobKeyId = bobPk.getId();
+    bob->putSigned(key, makeValue("signed value"));
+    auto start = std::chrono::steady_clock::now();
+    while (not received->signedByBob and std::chrono::steady_clock::now() - start < 60s) {
+        otherNode->get(key,
+                       [received, bobKeyId](const std::vector<std::shared_ptr<dht::Value>>& vals) {
+                           std::lock_guard<std::mutex> lk {received->mtx};
+                           for (const auto& v : vals)
+                               if (v->owner and v->owner->getId() == bobKeyId)
+                                   received->signedByBob = true;
+                           received->cv.notify_one();
+                           return true;
+                       });
+        received->cv.wait_for(lk, 500ms, [&] { return received->signedByBob; });
+    }
+    CPPUNIT_ASSERT(received->signedByBob);
+}
+
+void
+SharedDhtTest::testMultiplexedListens()
+{
+    constexpr size_t N = 4;
+    auto received = std::make_shared<Received>();
+    std::unique_lock<std::mutex> lk {received->mtx};
+
+    auto key = dht::InfoHash::get("shared_dht_listen");
+    auto searches = sharedNode->node()->getNodesStats(AF_INET).searches;
+    std::vector<std::pair<std::shared_ptr<dht::DhtRunner>, std::shared_future<size_t>>> listens;
+    for (size_t i = 0; i < N; ++i) {
+        auto client = makeClient(dht::crypto::generateIdentity("account" + std::to_string(i)));
+        auto token = client->listen(
+            key, [received](const std::vector<std::shared_ptr<dht::Value>>& values, bool expired) {
+                if (not expired) {
+                    std::lock_guard<std::mutex> lk {received->mtx};
+                    received->values += values.size();
+                    received->cv.notify_one();
+                }
+                return true;
+            });
+        listens.emplace_back(client, token.share());
+    }
+
+    // A value put by a node outside of the daemon reaches every account
+    otherNode->put(key, makeValue("value"));
+    CPPUNIT_ASSERT(received->cv.wait_for(lk, 60s, [&] { return received->values == N; }));
+    // The listens of all accounts are served by a single search of the node
+    CPPUNIT_ASSERT_EQUAL(searches + 1, sharedNode->node()->getNodesStats(AF_INET).searches);
+    for (auto& [client, token] : listens)
+        client->cancelListen(key, token);
+}
+
+void
+SharedDhtTest::testAcquire()
+{
+    CPPUNIT_ASSERT(not SharedDhtNode::current());
+    SharedDhtNode::Config config;
+    config.proxyPort = randomPort();
+    auto otherConfig = config;
+    otherConfig.proxyPort = config.proxyPort + 1;
+
+    // Accounts share the node started by the first one
+    auto first = SharedDhtNode::acquire(config);
+    CPPUNIT_ASSERT(first);
+    auto second = SharedDhtNode::acquire(otherConfig);
+    CPPUNIT_ASSERT(second == first);
+    CPPUNIT_ASSERT(SharedDhtNode::current() == first);
+    CPPUNIT_ASSERT_EQUAL("127.0.0.1:" + std::to_string(config.proxyPort), first->proxyServer());
+
+    // The node is stopped with its last account
+    std::weak_ptr<SharedDhtNode> weak = first;
+    first.reset();
+    CPPUNIT_ASSERT(SharedDhtNode::current() == second);
+    second.reset();
+    CPPUNIT_ASSERT(weak.expired());
+    CPPUNIT_ASSERT(not SharedDhtNode::current());
+
+    // The next account starts a new one
+    auto next = SharedDhtNode::acquire(otherConfig);
+    CPPUNIT_ASSERT(next);
+    CPPUNIT_ASSERT_EQUAL("127.0.0.1:" + std::to_string(otherConfig.proxyPort), next->proxyServer());
+}
+
+void
+SharedDhtAccountTest::setUp()
+{
+    Manager::instance().preferences.setSharedDhtPort(randomPort());
+    auto actors = load_actors_and_wait_for_announcement("actors/alice-bob.yml");
+    aliceId = actors["alice"];
+    bobId = actors["bob"];
+}
+
+void
+SharedDhtAccountTest::tearDown()
+{
+    wait_for_removal_of({aliceId, bobId});
+    Manager::instance().preferences.setSharedDhtPort(0);
+}
+
+void
+SharedDhtAccountTest::testTrustRequest()
+{
+    auto aliceAccount = Manager::instance().getAccount<JamiAccount>(aliceId);
+    auto bobAccount = Manager::instance().getAccount<JamiAccount>(bobId);
+    auto node = SharedDhtNode::current();
+    CPPUNIT_ASSERT(node);
+    CPPUNIT_ASSERT_EQUAL("127.0.0.1:"
+                             + std::to_string(Manager::instance().preferences.getSharedDhtPort()),
+                         node->proxyServer());
+
+    // Signed and encrypted by alice's client, decrypted by bob's client
+    std::mutex mtx;
+    std::unique_lock<std::mutex> lk {mtx};
+    std::condition_variable cv;
+    std::map<std::string, std::shared_ptr<libjami::CallbackWrapperBase>> confHandlers;
+    bool requestReceived = false;
+    confHandlers.insert(
+        libjami::exportable_callback<libjami::ConversationSignal::ConversationRequestReceived>(
+            [&](const std::string& accountId,
+                const std::string& /* conversationId */,
+                std::map<std::string, std::string> /*metadatas*/) {
+                if (accountId == bobId) {
+                    std::lock_guard<std::mutex> lk {mtx};
+                    requestReceived = true;
+                    cv.notify_one();
+                }
+            }));
+    libjami::registerSignalHandlers(confHandlers);
+    auto bobUri = bobAccount->getUsername();
+    aliceAccount->addContact(bobUri);
+    aliceAccount->sendTrustRequest(bobUri, {});
+    CPPUNIT_ASSERT(cv.wait_for(lk, 60s, [&] { return requestReceived; }));
+    libjami::unregisterSignalHandlers();
+}
+
+} // namespace test
+} // namespace jami
+
+JAMI_TEST_RUNNER(jami::test::SharedDhtTest::name(), jami::test::SharedDhtAccountTest::name())
@@ -0,0 +1,242 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "manager.h"
+#include "sip/sipaccount.h"
+#include "sip/sipaccount_config.h"
+#include "sip/sipvoiplink.h"
+#include "../../test_runner.h"
+#include "jami.h"
+#include "account_const.h"
+#include "logger.h"
+
+#include <opendht/utils.h>
+
+using namespace libjami::Account;
+
+namespace jami {
+namespace test {
+
+/**
+ * Routing of incoming SIP requests to accounts.
+ * Also benchmarks account lookups and runs a local SIP load generator. The number of accounts
+ * can be set with JAMI_BENCH_SIP_ACCOUNTS (default 2000), the number of requests sent with
+ * JAMI_BENCH_SIP_REQUESTS (default 20000).
+ */
+class SipRoutingTest : public CppUnit::TestFixture
+{
+public:
+    SipRoutingTest()
+    {
+        // Init daemon
+        libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+        if (not Manager::instance().initialized)
+            CPPUNIT_ASSERT(libjami::start("dring-sample.yml"));
+    }
+    ~SipRoutingTest() { libjami::fini(); }
+
+    static std::string name() { return "SipRoutingTest"; }
+
+private:
+    void testGuessAccount();
+    void testLoadGenerator();
+
+    CPPUNIT_TEST_SUITE(SipRoutingTest);
+    CPPUNIT_TEST(testGuessAccount);
+    CPPUNIT_TEST(testLoadGenerator);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(SipRoutingTest, SipRoutingTest::name());
+
+static std::size_t
+envCount(const char* name, std::size_t defaultValue)
+{
+    if (auto env = std::getenv(name))
+        return std::strtoul(env, nullptr, 10);
+    return defaultValue;
+}
+
+void
+SipRoutingTest::testGuessAccount()
+{
+    auto count = envCount("JAMI_BENCH_SIP_ACCOUNTS", 2000);
+    auto& link = Manager::instance().sipVoIPLink();
+
+    // Accounts are only configured, not registered
+    std::vector<std::string> accountIds;
+    for (std::size_t i = 0; i < count; ++i) {
+        auto id = "routing" + std::to_string(i);
+        auto account = Manager::instance().accountFactory.createAccount(SIPAccount::ACCOUNT_TYPE,
+                                                                        id);
+        CPPUNIT_ASSERT(account);
+        auto config = std::make_unique<SipAccountConfig>(id);
+        config->username = "user" + std::to_string(i);
+        config->hostname = "sip" + std::to_string(i % 10) + ".example.org";
+        account->setConfig(std::move(config));
+        accountIds.emplace_back(std::move(id));
+    }
+
+    auto account = link.guessAccount("user42", "sip2.example.org", {});
+    CPPUNIT_ASSERT(account && account->getAccountID() == "routing42");
+
+    // The index follows configuration changes
+    auto renamed = Manager::instance().getAccount<SIPAccount>("routing42");
+    auto config = std::make_unique<SipAccountConfig>("routing42");
+    config->username = "renamed";
+    config->hostname = "sip2.example.org";
+    renamed->setConfig(std::move(config));
+    account = link.guessAccount("renamed", "sip2.example.org", {});
+    CPPUNIT_ASSERT(account && account->getAccountID() == "routing42");
+    account = link.guessAccount("user42", "sip2.example.org", {});
+    CPPUNIT_ASSERT(!account || account->getAccountID() != "routing42");
+    renamed.reset();
+
+    // Partial matches are found without resolving hostnames
+    account = link.guessAccount("user7", "unknown.invalid", {});
+    CPPUNIT_ASSERT(account && account->getAccountID() == "routing7");
+    account = link.guessAccount("nobody", "sip3.example.org", {});
+    CPPUNIT_ASSERT(account);
+    CPPUNIT_ASSERT_EQUAL(std::string("sip3.example.org"),
+                         std::static_pointer_cast<SIPAccount>(account)->config().hostname);
+
+    constexpr std::size_t LOOKUPS = 100000;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < LOOKUPS; ++i) {
+        auto n = (i * 7919) % count;
+        if (n == 42)
+            continue;
+        auto user = "user" + std::to_string(n);
+        auto server = "sip" + std::to_string(n % 10) + ".example.org";
+        auto found = link.guessAccount(user, server, {});
+        CPPUNIT_ASSERT(found && found->getAccountID() == accountIds[n]);
+    }
+    auto duration = std::chrono::steady_clock::now() - start;
+    JAMI_WARNING("{} account lookups among {} accounts in {}",
+                 LOOKUPS,
+                 count,
+                 dht::print_duration(duration));
+
+    for (const auto& id : accountIds)
+        Manager::instance().accountFactory.removeAccount(id);
+    account = link.guessAccount("user1", "sip1.example.org", {});
+    CPPUNIT_ASSERT(!account || account->getAccountID() != "routing1");
+}
+
+void
+SipRoutingTest::testLoadGenerator()
+{
+    auto requests = envCount("JAMI_BENCH_SIP_REQUESTS", 20000);
+    constexpr uint16_t PORT = 5096;
+
+    std::map<std::string, std::string> details = libjami::getAccountTemplate("SIP");
+    details[ConfProperties::TYPE] = "SIP";
+    details[ConfProperties::USERNAME] = "LOADTEST";
+    details[ConfProperties::ALIAS] = "LOADTEST";
+    details[ConfProperties::LOCAL_PORT] = std::to_string(PORT);
+    details[ConfProperties::UPNP_ENABLED] = "false";
+    auto accountId = Manager::instance().addAccount(details);
+    CPPUNIT_ASSERT(not accountId.empty());
+    for (int i = 0; i < 100; i++) {
+        auto account = Manager::instance().getAccount<SIPAccount>(accountId);
+        if (account && account->getRegistrationState() == RegistrationState::REGISTERED)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    auto sock = socket(AF_INET, SOCK_DGRAM, 0);
+    CPPUNIT_ASSERT(sock >= 0);
+    sockaddr_in local {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CPPUNIT_ASSERT(bind(sock, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == 0);
+    socklen_t localLen = sizeof(local);
+    getsockname(sock, reinterpret_cast<sockaddr*>(&local), &localLen);
+    timeval timeout {0, 100000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in remote {};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(PORT);
+    remote.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // Keep a bounded number of requests in flight, so that UDP buffers never overflow
+    constexpr std::size_t WINDOW = 64;
+    std::size_t sent = 0, answered = 0;
+    char buffer[4096];
+    auto start = std::chrono::steady_clock::now();
+    while (answered < requests) {
+        while (sent < requests && sent - answered < WINDOW) {
+            static constexpr std::string_view BODY = "load test";
+            auto msg = fmt::format("MESSAGE sip:LOADTEST@127.0.0.1:{port} SIP/2.0\r\n"
+                                   "Via: SIP/2.0/UDP 127.0.0.1:{local};rport;branch=z9hG4bK{n}\r\n"
+                                   "Max-Forwards: 70\r\n"
+                                   "From: <sip:loadgen@127.0.0.1>;tag={n}\r\n"
+                                   "To: <sip:LOADTEST@127.0.0.1>\r\n"
+                                   "Call-ID: {n}@loadgen\r\n"
+                                   "CSeq: 1 MESSAGE\r\n"
+                                   "Content-Type: text/plain\r\n"
+                                   "Content-Length: {len}\r\n\r\n{body}",
+                                   fmt::arg("port", PORT),
+                                   fmt::arg("local", ntohs(local.sin_port)),
+                                   fmt::arg("n", sent),
+                                   fmt::arg("len", BODY.size()),
+                                   fmt::arg("body", BODY));
+            sendto(sock,
+                   msg.data(),
+                   msg.size(),
+                   0,
+                   reinterpret_cast<sockaddr*>(&remote),
+                   sizeof(remote));
+            sent++;
+        }
+        auto len = recv(sock, buffer, sizeof(buffer), 0);
+        if (len <= 0)
+            break;
+        if (std::string_view(buffer, len).find("SIP/2.0 200") == 0)
+            answered++;
+    }
+    auto duration = std::chrono::steady_clock::now() - start;
+    close(sock);
+    Manager::instance().removeAccount(accountId, true);
+
+    auto seconds = std::chrono::duration<double>(duration).count();
+    JAMI_WARNING("{}/{} SIP MESSAGE answered in {} ({:.0f} req/s)",
+                 answered,
+                 requests,
+                 dht::print_duration(duration),
+                 seconds > 0 ? answered / seconds : 0.);
+    CPPUNIT_ASSERT(answered == requests);
+}
+
+} // namespace test
+} // namespace jami
+
+RING_TEST_RUNNER(jami::test::SipRoutingTest::name())
@@ -0,0 +1,188 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "jamidht/sync_module.h"
+#include "jamidht/conversation_module.h"
+
+#include <vector>
+
+#include "../../test_runner.h"
+
+namespace jami { namespace test {
+
+// SyncMsg as sent and read by versions without incremental sync
+struct LegacySyncMsg
+{
+    DeviceSync ds;
+    std::map<std::string, ConvInfo> c;
+    std::map<std::string, ConversationRequest> cr;
+    std::map<std::string, std::map<std::string, std::string>> p;
+    std::map<std::string, std::map<std::string, std::string>> ld;
+    MSGPACK_DEFINE(ds, c, cr, p, ld)
+};
+
+class SyncProtocolTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "syncProtocol"; }
+
+private:
+    void testSplitAndCoalesced();
+    void testCompressed();
+    void testLegacyPeer();
+    void testInvalidData();
+
+    CPPUNIT_TEST_SUITE(SyncProtocolTest);
+    CPPUNIT_TEST(testSplitAndCoalesced);
+    CPPUNIT_TEST(testCompressed);
+    CPPUNIT_TEST(testLegacyPeer);
+    CPPUNIT_TEST(testInvalidData);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(SyncProtocolTest, SyncProtocolTest::name());
+
+static SyncMsg
+makeBatch(uint64_t version, uint32_t left, std::size_t preferences)
+{
+    SyncMsg msg;
+    msg.ds.date = 42;
+    msg.v = version;
+    msg.s = 1;
+    msg.n = left;
+    for (std::size_t i = 0; i < preferences; i++)
+        msg.p["conversation" + std::to_string(i)] = {{"color", "#" + std::to_string(i)}};
+    return msg;
+}
+
+static std::vector<SyncMsg>
+readAll(SyncMsgReader& reader, const std::string& data, std::size_t chunk, bool& valid)
+{
+    std::vector<SyncMsg> msgs;
+    valid = true;
+    for (std::size_t pos = 0; pos < data.size(); pos += chunk) {
+        auto len = std::min(chunk, data.size() - pos);
+        valid &= reader.read((const uint8_t*) data.data() + pos, len, [&](SyncMsg&& msg) {
+            msgs.emplace_back(std::move(msg));
+        });
+    }
+    return msgs;
+}
+
+void
+SyncProtocolTest::testSplitAndCoalesced()
+{
+    // Three batches in one stream, read in packets not aligned on messages
+    std::string stream;
+    for (uint32_t i = 0; i < 3; i++)
+        stream += packSyncMsg(makeBatch(10, 2 - i, 4), false);
+
+    for (std::size_t chunk : {std::size_t(7), std::size_t(64), stream.size()}) {
+        SyncMsgReader reader;
+        bool valid;
+        auto msgs = readAll(reader, stream, chunk, valid);
+        CPPUNIT_ASSERT(valid);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(3), msgs.size());
+        for (uint32_t i = 0; i < 3; i++) {
+            CPPUNIT_ASSERT_EQUAL(uint64_t(10), msgs[i].v);
+            CPPUNIT_ASSERT_EQUAL(uint64_t(1), msgs[i].s);
+            CPPUNIT_ASSERT_EQUAL(2 - i, msgs[i].n);
+            CPPUNIT_ASSERT_EQUAL(std::size_t(4), msgs[i].p.size());
+        }
+    }
+}
+
+void
+SyncProtocolTest::testCompressed()
+{
+    auto batch = makeBatch(7, 0, 1000);
+    auto plain = packSyncMsg(batch, false);
+    auto compressed = packSyncMsg(batch, true);
+    CPPUNIT_ASSERT(compressed.size() < plain.size());
+
+    // Small batches are sent as is
+    auto small = makeBatch(7, 0, 1);
+    CPPUNIT_ASSERT(packSyncMsg(small, true) == packSyncMsg(small, false));
+
+    SyncMsgReader reader;
+    bool valid;
+    auto msgs = readAll(reader, compressed, 512, valid);
+    CPPUNIT_ASSERT(valid);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), msgs.size());
+    CPPUNIT_ASSERT(msgs[0].z.empty());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(7), msgs[0].v);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(42), msgs[0].ds.date);
+    CPPUNIT_ASSERT(msgs[0].p == batch.p);
+}
+
+void
+SyncProtocolTest::testLegacyPeer()
+{
+    // A legacy full sync is read with no version: it is applied, not acknowledged
+    LegacySyncMsg legacy;
+    legacy.ds.date = 5;
+    legacy.p["conversation"] = {{"color", "#ff0000"}};
+    msgpack::sbuffer buffer;
+    msgpack::pack(buffer, legacy);
+
+    SyncMsgReader reader;
+    bool valid;
+    auto msgs = readAll(reader, std::string(buffer.data(), buffer.size()), 16, valid);
+    CPPUNIT_ASSERT(valid);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), msgs.size());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), msgs[0].v);
+    CPPUNIT_ASSERT(!msgs[0].ack);
+    CPPUNIT_ASSERT(msgs[0].p == legacy.p);
+
+    // Uncompressed batches sent to a legacy peer keep the data it reads
+    auto batch = makeBatch(3, 0, 2);
+    auto data = packSyncMsg(batch, false);
+    auto oh = msgpack::unpack(data.data(), data.size());
+    LegacySyncMsg read;
+    oh.get().convert(read);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(42), read.ds.date);
+    CPPUNIT_ASSERT(read.p == batch.p);
+}
+
+void
+SyncProtocolTest::testInvalidData()
+{
+    SyncMsgReader reader;
+    std::string garbage(16, '\xc1'); // Never used by msgpack
+    bool valid;
+    auto msgs = readAll(reader, garbage, garbage.size(), valid);
+    CPPUNIT_ASSERT(!valid);
+    CPPUNIT_ASSERT(msgs.empty());
+
+    // The next packet starts a new message
+    SyncMsg ack;
+    ack.ack = true;
+    ack.a = 12;
+    msgs = readAll(reader, packSyncMsg(ack, true), 1024, valid);
+    CPPUNIT_ASSERT(valid);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), msgs.size());
+    CPPUNIT_ASSERT(msgs[0].ack);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(12), msgs[0].a);
+}
+
+}} // namespace jami::test
+
+RING_TEST_RUNNER(jami::test::SyncProtocolTest::name());
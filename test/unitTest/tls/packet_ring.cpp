@@ -0,0 +1,125 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "connectivity/security/packet_ring.h"
+
+#include <thread>
+
+#include "../../test_runner.h"
+
+namespace jami { namespace test {
+
+class PacketRingTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "packet_ring"; }
+
+private:
+    void testOrder();
+    void testDropWhenFull();
+    void testLargePacket();
+    void testConcurrent();
+
+    CPPUNIT_TEST_SUITE(PacketRingTest);
+    CPPUNIT_TEST(testOrder);
+    CPPUNIT_TEST(testDropWhenFull);
+    CPPUNIT_TEST(testLargePacket);
+    CPPUNIT_TEST(testConcurrent);
+    CPPUNIT_TEST_SUITE_END();
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(PacketRingTest, PacketRingTest::name());
+
+void
+PacketRingTest::testOrder()
+{
+    tls::PacketRing ring(4);
+    CPPUNIT_ASSERT(ring.empty());
+    for (uint8_t i = 0; i < 3; ++i)
+        CPPUNIT_ASSERT(ring.push(&i, 1));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(3), ring.size());
+    for (uint8_t i = 0; i < 3; ++i) {
+        auto pkt = ring.front();
+        CPPUNIT_ASSERT_EQUAL(std::size_t(1), pkt.size);
+        CPPUNIT_ASSERT_EQUAL(i, pkt.data[0]);
+        ring.pop();
+    }
+    CPPUNIT_ASSERT(ring.empty());
+}
+
+void
+PacketRingTest::testDropWhenFull()
+{
+    tls::PacketRing ring(2);
+    uint8_t v = 0;
+    CPPUNIT_ASSERT(ring.push(&v, 1));
+    CPPUNIT_ASSERT(ring.push(&v, 1));
+    CPPUNIT_ASSERT(not ring.push(&v, 1));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), ring.dropped());
+    ring.pop();
+    CPPUNIT_ASSERT(ring.push(&v, 1));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), ring.dropped());
+}
+
+void
+PacketRingTest::testLargePacket()
+{
+    tls::PacketRing ring(2);
+    std::vector<uint8_t> big(3 * tls::PacketRing::SLAB_SIZE, 42);
+    CPPUNIT_ASSERT(ring.push(big.data(), big.size()));
+    auto pkt = ring.front();
+    CPPUNIT_ASSERT(std::vector<uint8_t>(pkt.data, pkt.data + pkt.size) == big);
+}
+
+void
+PacketRingTest::testConcurrent()
+{
+    constexpr uint32_t COUNT = 1000000;
+    tls::PacketRing ring(1024);
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < COUNT;) {
+            if (ring.push(reinterpret_cast<const uint8_t*>(&i), sizeof(i)))
+                ++i;
+            else
+                std::this_thread::yield();
+        }
+    });
+    uint32_t expected = 0;
+    while (expected < COUNT) {
+        if (ring.empty()) {
+            std::this_thread::yield();
+            continue;
+        }
+        auto pkt = ring.front();
+        CPPUNIT_ASSERT_EQUAL(sizeof(uint32_t), pkt.size);
+        uint32_t value;
+        std::memcpy(&value, pkt.data, sizeof(value));
+        CPPUNIT_ASSERT_EQUAL(expected, value);
+        ring.pop();
+        ++expected;
+    }
+    producer.join();
+    CPPUNIT_ASSERT(ring.empty());
+}
+
+}} // namespace jami::test
+
+RING_TEST_RUNNER(jami::test::PacketRingTest::name())
@@ -0,0 +1,286 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "connectivity/security/tls_session_cache.h"
+#include "connectivity/security/tls_session.h"
+#include "persistence.h"
+#include "fileutils.h"
+
+#include <opendht/crypto.h>
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <sys/stat.h>
+
+#include "../../test_runner.h"
+
+namespace jami { namespace test {
+
+/// Reliable in-memory transport between two TLS sessions
+class PipeSocket : public GenericSocket<uint8_t>
+{
+public:
+    struct Pipe
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<uint8_t> data;
+        bool closed {false};
+
+        void close()
+        {
+            {
+                std::lock_guard<std::mutex> lk(mutex);
+                closed = true;
+            }
+            cv.notify_all();
+        }
+    };
+
+    static std::pair<std::unique_ptr<PipeSocket>, std::unique_ptr<PipeSocket>> makePair()
+    {
+        auto a = std::make_shared<Pipe>();
+        auto b = std::make_shared<Pipe>();
+        return {std::make_unique<PipeSocket>(true, a, b),
+                std::make_unique<PipeSocket>(false, b, a)};
+    }
+
+    PipeSocket(bool initiator, std::shared_ptr<Pipe> in, std::shared_ptr<Pipe> out)
+        : initiator_(initiator)
+        , in_(std::move(in))
+        , out_(std::move(out))
+    {}
+    ~PipeSocket() { shutdown(); }
+
+    void shutdown() override
+    {
+        in_->close();
+        out_->close();
+    }
+    void setOnRecv(RecvCb&&) override {}
+    bool isReliable() const override { return true; }
+    bool isInitiator() const override { return initiator_; }
+    int maxPayload() const override { return 0; }
+
+    int waitForData(std::chrono::milliseconds timeout, std::error_code& ec) const override
+    {
+        std::unique_lock<std::mutex> lk(in_->mutex);
+        in_->cv.wait_for(lk, timeout, [this] { return not in_->data.empty() or in_->closed; });
+        if (not in_->data.empty())
+            return in_->data.size();
+        if (in_->closed)
+            ec = std::make_error_code(std::errc::broken_pipe);
+        return 0;
+    }
+
+    std::size_t write(const ValueType* buf, std::size_t len, std::error_code& ec) override
+    {
+        {
+            std::lock_guard<std::mutex> lk(out_->mutex);
+            if (out_->closed) {
+                ec = std::make_error_code(std::errc::broken_pipe);
+                return 0;
+            }
+            out_->data.insert(out_->data.end(), buf, buf + len);
+        }
+        out_->cv.notify_all();
+        ec.clear();
+        return len;
+    }
+
+    std::size_t read(ValueType* buf, std::size_t len, std::error_code& ec) override
+    {
+        std::unique_lock<std::mutex> lk(in_->mutex);
+        in_->cv.wait(lk, [this] { return not in_->data.empty() or in_->closed; });
+        len = std::min(len, in_->data.size());
+        std::copy_n(in_->data.begin(), len, buf);
+        in_->data.erase(in_->data.begin(), in_->data.begin() + len);
+        ec.clear();
+        return len;
+    }
+
+private:
+    const bool initiator_;
+    std::shared_ptr<Pipe> in_;
+    std::shared_ptr<Pipe> out_;
+};
+
+class TlsSessionCacheTest : public CppUnit::TestFixture {
+public:
+    static std::string name() { return "tls_session_cache"; }
+    void setUp();
+    void tearDown();
+
+private:
+    void testStore();
+    void testBounded();
+    void testPersisted();
+    void testResumption();
+
+    CPPUNIT_TEST_SUITE(TlsSessionCacheTest);
+    CPPUNIT_TEST(testStore);
+    CPPUNIT_TEST(testBounded);
+    CPPUNIT_TEST(testPersisted);
+    CPPUNIT_TEST(testResumption);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::string path_;
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(TlsSessionCacheTest, TlsSessionCacheTest::name());
+
+void
+TlsSessionCacheTest::setUp()
+{
+    path_ = fileutils::get_cache_dir() + DIR_SEPARATOR_STR "tls_session_cache_test";
+    fileutils::removeAll(path_);
+    CPPUNIT_ASSERT(fileutils::recursive_mkdir(path_, 0700));
+}
+
+void
+TlsSessionCacheTest::tearDown()
+{
+    fileutils::removeAll(path_);
+}
+
+void
+TlsSessionCacheTest::testStore()
+{
+    tls::TlsSessionCache cache({});
+    CPPUNIT_ASSERT(cache.get("peer").empty());
+    cache.set("peer", {1, 2, 3});
+    CPPUNIT_ASSERT(cache.get("peer") == std::vector<uint8_t>({1, 2, 3}));
+    cache.set("peer", {4});
+    CPPUNIT_ASSERT(cache.get("peer") == std::vector<uint8_t>({4}));
+    cache.erase("peer");
+    CPPUNIT_ASSERT(cache.get("peer").empty());
+}
+
+void
+TlsSessionCacheTest::testBounded()
+{
+    tls::TlsSessionCache cache({});
+    for (std::size_t i = 0; i < 2 * tls::TlsSessionCache::MAX_SESSIONS; ++i)
+        cache.set(std::to_string(i), {1});
+    CPPUNIT_ASSERT_EQUAL(tls::TlsSessionCache::MAX_SESSIONS, cache.size());
+}
+
+void
+TlsSessionCacheTest::testPersisted()
+{
+    auto file = path_ + DIR_SEPARATOR_STR "sessions";
+    std::vector<uint8_t> key;
+    {
+        tls::TlsSessionCache cache(file);
+        cache.set("peer", {1, 2, 3});
+        auto ticketKey = cache.ticketKey();
+        CPPUNIT_ASSERT(ticketKey.data and ticketKey.size > 0);
+        key.assign(ticketKey.data, ticketKey.data + ticketKey.size);
+    }
+    Persistence::instance().flush();
+
+    // The ticket key and session secrets are only readable by the user
+    struct stat st;
+    CPPUNIT_ASSERT(stat(file.c_str(), &st) == 0);
+    CPPUNIT_ASSERT_EQUAL(0600, (int) (st.st_mode & 0777));
+
+    // Sessions and ticket key survive a restart
+    tls::TlsSessionCache cache(file);
+    CPPUNIT_ASSERT(cache.get("peer") == std::vector<uint8_t>({1, 2, 3}));
+    auto ticketKey = cache.ticketKey();
+    CPPUNIT_ASSERT(std::vector<uint8_t>(ticketKey.data, ticketKey.data + ticketKey.size) == key);
+}
+
+void
+TlsSessionCacheTest::testResumption()
+{
+    auto ca = dht::crypto::generateIdentity("test CA");
+    auto alice = dht::crypto::generateIdentity("alice", ca);
+    auto bob = dht::crypto::generateIdentity("bob", ca);
+    auto resumptionId = alice.second->getId().toString() + bob.second->getId().toString();
+    auto& cache = tls::TlsSessionCache::instance();
+    cache.erase(resumptionId);
+
+    std::promise<tls::DhParams> dhParams;
+    dhParams.set_value({});
+    auto dh = dhParams.get_future().share();
+    constexpr auto timeout = std::chrono::seconds(10);
+    tls::TlsSession::TlsSessionCallbacks cbs = {
+        /*.onStateChange = */ {},
+        /*.onRxData = */ {},
+        /*.onCertificatesUpdate = */ {},
+        /*.verifyCertificate = */ [](gnutls_session_t) { return (int) GNUTLS_E_SUCCESS; }};
+
+    auto connect = [&] {
+        auto sockets = PipeSocket::makePair();
+        tls::TlsParams clientParams = {
+            /*.ca_list = */ "",
+            /*.peer_ca = */ nullptr,
+            /*.cert = */ alice.second,
+            /*.cert_key = */ alice.first,
+            /*.dh_params = */ dh,
+            /*.timeout = */ timeout,
+            /*.cert_check = */ nullptr,
+            /*.resumption_id = */ resumptionId,
+        };
+        auto serverParams = clientParams;
+        serverParams.cert = bob.second;
+        serverParams.cert_key = bob.first;
+        serverParams.resumption_id = {};
+        // Both ends handshake at once, whatever the number of handshake slots
+        auto server = std::make_unique<tls::TlsSession>(std::move(sockets.second),
+                                                        serverParams,
+                                                        cbs);
+        auto client = std::make_unique<tls::TlsSession>(std::move(sockets.first),
+                                                        clientParams,
+                                                        cbs);
+        client->waitForReady(timeout);
+        server->waitForReady(timeout);
+
+        // TLS 1.3 tickets are received with the first records
+        std::error_code ec;
+        uint8_t byte = 42;
+        CPPUNIT_ASSERT(server->write(&byte, 1, ec) == 1 and not ec);
+        byte = 0;
+        CPPUNIT_ASSERT(client->read(&byte, 1, ec) == 1 and byte == 42);
+        return std::make_pair(std::move(client), std::move(server));
+    };
+
+    auto first = connect();
+    CPPUNIT_ASSERT(not first.first->isResumed());
+    CPPUNIT_ASSERT(not cache.get(resumptionId).empty());
+    first.first->shutdown();
+    first.second->shutdown();
+
+    auto second = connect();
+    CPPUNIT_ASSERT(second.first->isResumed());
+    CPPUNIT_ASSERT(second.second->isResumed());
+    second.first->shutdown();
+    second.second->shutdown();
+    cache.erase(resumptionId);
+}
+
+}} // namespace jami::test
+
+RING_TEST_RUNNER(jami::test::TlsSessionCacheTest::name())
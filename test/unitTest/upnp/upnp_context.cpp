@@ -0,0 +1,223 @@
+/*
+ *  Copyright (C) 2023 Savoir-faire Linux Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.
+ */
+
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
+
+#include "manager.h"
+#include "connectivity/upnp/upnp_context.h"
+#include "../../test_runner.h"
+#include "jami.h"
+
+using namespace std::literals::chrono_literals;
+
+namespace jami {
+namespace upnp {
+namespace test {
+
+class IgdStandIn : public IGD
+{
+public:
+    IgdStandIn()
+        : IGD(NatProtocolType::NAT_PMP)
+    {
+        setUID("stand-in");
+        setLocalIp(IpAddr("192.168.1.1"));
+        setPublicIp(IpAddr("203.0.113.1"));
+        setValid(true);
+    }
+
+    const std::string toString() const override { return "stand-in"; }
+};
+
+/**
+ * Stand-in for an IGD protocol: finds a single IGD and records the mapping
+ * requests, which stay in progress until opened.
+ */
+class ProtocolStandIn : public UPnPProtocol
+{
+public:
+    NatProtocolType getProtocol() const override { return NatProtocolType::NAT_PMP; }
+    char const* getProtocolName() const override { return "stand-in"; }
+    void clearIgds() override {}
+    void searchForIgd() override { observer_->onIgdUpdated(igd_, UpnpIgdEvent::ADDED); }
+    std::list<std::shared_ptr<IGD>> getIgdList() const override { return {igd_}; }
+    bool isReady() const override { return true; }
+    void requestMappingAdd(const Mapping& map) override
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        requests_++;
+        pending_.emplace_back(map);
+        cv_.notify_all();
+    }
+    void requestMappingRenew(const Mapping&) override {}
+    void requestMappingRemove(const Mapping&) override {}
+    void setObserver(UpnpMappingObserver* obs) override { observer_ = obs; }
+    const IpAddr getHostAddress() const override { return IpAddr("192.168.1.10"); }
+    void terminate() override {}
+
+    size_t requests()
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return requests_;
+    }
+
+    bool waitRequests(size_t count)
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        return cv_.wait_for(lk, 10s, [&] { return requests_ >= count; });
+    }
+
+    /** Open the mappings requested so far */
+    void openAll()
+    {
+        std::list<Mapping> pending;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            pending = std::move(pending_);
+            pending_.clear();
+        }
+        runOnUpnpContextQueue([this, pending = std::move(pending)]() mutable {
+            for (auto& map : pending) {
+                map.setInternalAddress(getHostAddress().toString());
+                observer_->onMappingAdded(igd_, map);
+            }
+        });
+    }
+
+private:
+    std::shared_ptr<IGD> igd_ {std::make_shared<IgdStandIn>()};
+    UpnpMappingObserver* observer_ {nullptr};
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    size_t requests_ {0};
+    std::list<Mapping> pending_;
+};
+
+class UPnPContextTest : public CppUnit::TestFixture
+{
+public:
+    static std::string name() { return "upnp_context"; }
+    void setUp();
+    void tearDown();
+
+private:
+    void testReserveOpenOnly();
+
+    CPPUNIT_TEST_SUITE(UPnPContextTest);
+    CPPUNIT_TEST(testReserveOpenOnly);
+    CPPUNIT_TEST_SUITE_END();
+
+    std::shared_ptr<ProtocolStandIn> protocol_;
+    std::shared_ptr<UPnPContext> context_;
+};
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(UPnPContextTest, UPnPContextTest::name());
+
+// Mappings provisioned by the context when an IGD is found (TCP + UDP)
+static constexpr size_t PROVISIONED = 4 + 8;
+
+/**
+ * Wait for the tasks already queued on the context's queue
+ */
+static void
+flushContextQueue()
+{
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool done = false;
+    Manager::instance().scheduler().run([&] {
+        std::lock_guard<std::mutex> lk(mtx);
+        done = true;
+        cv.notify_one();
+    });
+    std::unique_lock<std::mutex> lk(mtx);
+    CPPUNIT_ASSERT(cv.wait_for(lk, 10s, [&] { return done; }));
+}
+
+void
+UPnPContextTest::setUp()
+{
+    libjami::init(libjami::InitFlag(libjami::LIBJAMI_FLAG_DEBUG | libjami::LIBJAMI_FLAG_CONSOLE_LOG));
+    protocol_ = std::make_shared<ProtocolStandIn>();
+    context_ = std::make_shared<UPnPContext>(
+        std::vector<std::shared_ptr<UPnPProtocol>> {protocol_});
+    context_->registerController(this);
+    CPPUNIT_ASSERT(protocol_->waitRequests(PROVISIONED));
+    flushContextQueue();
+}
+
+void
+UPnPContextTest::tearDown()
+{
+    context_->shutdown();
+    context_.reset();
+    protocol_.reset();
+    libjami::fini();
+}
+
+void
+UPnPContextTest::testReserveOpenOnly()
+{
+    // Provisioned mappings are in progress: none is given, and none is requested for the caller
+    for (int i = 0; i < 16; i++) {
+        Mapping requested(PortType::UDP);
+        CPPUNIT_ASSERT(not context_->reserveMapping(requested, true));
+    }
+    flushContextQueue();
+    CPPUNIT_ASSERT_EQUAL(PROVISIONED, protocol_->requests());
+
+    // Once open, they are given to the callers
+    protocol_->openAll();
+    flushContextQueue();
+    Mapping requested(PortType::UDP);
+    auto map = context_->reserveMapping(requested, true);
+    CPPUNIT_ASSERT(map);
+    CPPUNIT_ASSERT(map->getState() == MappingState::OPEN);
+    CPPUNIT_ASSERT(not map->isAvailable());
+
+    // The pool is refilled for the next callers
+    CPPUNIT_ASSERT(protocol_->waitRequests(PROVISIONED + 1));
+    flushContextQueue();
+    CPPUNIT_ASSERT_EQUAL(PROVISIONED + 1, protocol_->requests());
+
+    // Without the option, a mapping is requested for the caller when none is open
+    for (int i = 0; i < 4; i++) {
+        Mapping tcp(PortType::TCP);
+        CPPUNIT_ASSERT(context_->reserveMapping(tcp, true));
+    }
+    flushContextQueue();
+    auto requests = protocol_->requests();
+    Mapping tcp(PortType::TCP);
+    auto pending = context_->reserveMapping(tcp);
+    CPPUNIT_ASSERT(pending);
+    CPPUNIT_ASSERT(pending->getState() != MappingState::OPEN);
+    flushContextQueue();
+    CPPUNIT_ASSERT_EQUAL(requests + 1, protocol_->requests());
+}
+
+} // namespace test
+} // namespace upnp
+} // namespace jami
+
+RING_TEST_RUNNER(jami::upnp::test::UPnPContextTest::name())